@@ -9,7 +9,12 @@
  *
  * Architecture:
  *   SemperKernel --[RPC: net_send]--> DTUBridge --[UDP]--> remote node
- *   remote node  --[UDP]--> DTUBridge --[notification]--> SemperKernel
+ *   SemperKernel --[net_outbound ring]--> DTUBridge --[UDP]--> peer N
+ *   remote node  --[UDP]--> DTUBridge --[net_inbound ring]--> SemperKernel
+ *
+ * Ring traffic is framed as described in vdtu_net.h: every message in
+ * net_outbound names its peer, and all messages for one peer found in a
+ * loop iteration are coalesced into a single datagram.
  *
  * SPDX-License-Identifier: BSD-2-Clause
  */
@@ -38,6 +43,8 @@
 
 #include "e1000_hw.h"
 #include "vdtu_ring.h"
+#include "vdtu_net.h"
+#include "vdtu_trace.h"
 
 #define COMPONENT_NAME "DTUBridge"
 
@@ -200,8 +207,11 @@ struct e1000_driver {
     uint32_t tx_head;
     uint8_t mac_addr[6];
     uint32_t rx_pkts;
+    uint32_t rx_dtu_fast;   /* rx_pkts delivered by dtu_rx_fast() */
     uint32_t tx_pkts;
     uint32_t rx_dropped;
+    uint32_t rx_stalls;     /* polls that left a datagram for a full net_inbound */
+    uint8_t rx_delivered;   /* messages of the held datagram already delivered */
     uint32_t irq_count;
 };
 
@@ -219,6 +229,24 @@ static struct vdtu_ring g_net_out_ring;  /* consumer: bridge reads kernel's outb
 static struct vdtu_ring g_net_in_ring;   /* producer: bridge writes incoming network msgs */
 static volatile bool net_rings_ready = false;
 
+/* Both net rings are packed over their whole 4 KiB dataport, so a burst
+ * of small inter-kernel messages does not need one 512-byte slot each */
+#define NET_RING_DATA_SIZE \
+    (4096 - vdtu_ring_ctrl_size(VDTU_RING_DEFAULT_LAYOUT))
+
+/* Outbound datagram being assembled for one peer */
+struct tx_frame {
+    struct pbuf *p;         /* VDTU_NET_MAX_DATAGRAM bytes, or NULL */
+    uint16_t len;           /* bytes used, including the frame header */
+    uint8_t count;          /* messages appended */
+};
+
+static struct tx_frame tx_frames[NUM_PEERS];
+static uint32_t net_tx_msgs = 0;
+static uint32_t net_tx_datagrams = 0;
+static uint32_t net_tx_dropped = 0;     /* bad route or failed send */
+static uint32_t net_rx_dropped = 0;     /* lwIP-path messages net_inbound had no room for */
+
 /* lwIP time tracking */
 static volatile uint32_t lwip_time_ms = 0;
 
@@ -344,6 +372,9 @@ static int e1000_hw_init(struct e1000_driver *drv)
              E1000_RCTL_EN | E1000_RCTL_BAM | E1000_RCTL_SECRC |
              E1000_RCTL_BSIZE_2048 | E1000_RCTL_UPE | E1000_RCTL_MPE);
 
+    /* Let the NIC verify IP/UDP checksums so dtu_rx_fast() need not */
+    e1000_wr(drv, E1000_RXCSUM, E1000_RXCSUM_IPOFL | E1000_RXCSUM_TUOFL);
+
     /* Setup TX */
     e1000_wr(drv, E1000_TDBAL, (uint32_t)(drv->tx_ring_phys & 0xFFFFFFFF));
     e1000_wr(drv, E1000_TDBAH, (uint32_t)(drv->tx_ring_phys >> 32));
@@ -426,8 +457,14 @@ static err_t e1000_netif_init(struct netif *netif)
     return ERR_OK;
 }
 
+static int dtu_rx_fast(const uint8_t *frame, uint16_t len, uint8_t status,
+                       uint8_t *delivered);
+
 /*
- * Poll RX and feed frames to lwIP (replaces ring buffer dispatch)
+ * Poll RX: DTU datagrams go straight to the kernel (dtu_rx_fast),
+ * everything else is fed to lwIP. A DTU datagram that does not fit into
+ * net_inbound stays in its descriptor, and RX stops there until the
+ * kernel made room; the next poll delivers the rest of it.
  */
 static void e1000_poll_rx_lwip(struct e1000_driver *drv)
 {
@@ -440,18 +477,29 @@ static void e1000_poll_rx_lwip(struct e1000_driver *drv)
         if (!desc->errors && (desc->status & E1000_RXD_STAT_EOP)) {
             uint16_t len = desc->length;
             if (len >= 14 && len <= FRAME_MTU) {
-                /* Create pbuf and pass to lwIP */
-                struct pbuf *p = pbuf_alloc(PBUF_RAW, len, PBUF_RAM);
-                if (p) {
-                    memcpy(p->payload, drv->rx_bufs[idx], len);
-                    if (g_netif.input(p, &g_netif) != ERR_OK) {
-                        pbuf_free(p);
-                        drv->rx_dropped++;
+                int fast = dtu_rx_fast(drv->rx_bufs[idx], len, desc->status,
+                                       &drv->rx_delivered);
+                if (fast < 0) {
+                    drv->rx_stalls++;
+                    break;
+                }
+                if (fast > 0) {
+                    drv->rx_pkts++;
+                    drv->rx_dtu_fast++;
+                } else {
+                    /* Create pbuf and pass to lwIP */
+                    struct pbuf *p = pbuf_alloc(PBUF_RAW, len, PBUF_RAM);
+                    if (p) {
+                        memcpy(p->payload, drv->rx_bufs[idx], len);
+                        if (g_netif.input(p, &g_netif) != ERR_OK) {
+                            pbuf_free(p);
+                            drv->rx_dropped++;
+                        } else {
+                            drv->rx_pkts++;
+                        }
                     } else {
-                        drv->rx_pkts++;
+                        drv->rx_dropped++;
                     }
-                } else {
-                    drv->rx_dropped++;
                 }
             }
         }
@@ -459,6 +507,7 @@ static void e1000_poll_rx_lwip(struct e1000_driver *drv)
         desc->status = 0;
         desc->errors = 0;
         desc->length = 0;
+        drv->rx_delivered = 0;
         DMB();
 
         drv->rx_tail = (idx + 1) % E1000_NUM_RX_DESC;
@@ -522,71 +571,286 @@ static void send_hello(void)
 }
 
 /*
- * UDP receive callback — a DTU message arrived from the remote node.
- * Write it to the net_inbound ring buffer for kernel consumption.
+ * Hand the messages of one DTU datagram (see vdtu_net.h) to the kernel.
+ * Each message is copied once, from the datagram straight into a
+ * reserved net_inbound slot; no staging buffer, no slot scrub.
+ *
+ * The first *delivered messages went to the kernel on an earlier call
+ * and are skipped; *delivered is advanced past the ones delivered now.
+ * Returns false if net_inbound filled up before the end of the datagram,
+ * true once the datagram is done with (delivered, or dropped as bad).
+ * The kernel is signalled once per call if it sleeps on net_inbound.
+ */
+static bool dtu_deliver(const uint8_t *data, uint16_t len, uint8_t *delivered)
+{
+    struct vdtu_net_frame frame;
+    uint8_t first = *delivered;
+    bool done = true;
+    if (len < sizeof(frame)) return true;
+
+    memcpy(&frame, data, sizeof(frame));
+    if (frame.magic != VDTU_NET_FRAME_MAGIC) {
+        VDTU_TRACE(VDTU_TRACE_ERR, NET_RX_UNFRAMED, len, 0, 0);
+        return true;
+    }
+
+    if (*delivered == 0)
+        VDTU_TRACE(VDTU_TRACE_INFO, NET_RX, frame.count, len, frame.src_node);
+
+    uint16_t off = sizeof(frame);
+    for (uint8_t i = 0; i < frame.count; i++) {
+        struct vdtu_msg_header hdr;
+        void *payload;
+
+        if (off + VDTU_HEADER_SIZE > len)
+            break;
+        memcpy(&hdr, data + off, VDTU_HEADER_SIZE);
+        off += VDTU_HEADER_SIZE;
+
+        if (hdr.length > VDTU_NET_MAX_MSG - VDTU_HEADER_SIZE ||
+            off + hdr.length > len) {
+            VDTU_TRACE(VDTU_TRACE_ERR, NET_RX_MALFORMED, i, 0, 0);
+            break;
+        }
+        if (i < *delivered) {
+            off += hdr.length;
+            continue;
+        }
+
+        /* Write to inbound ring buffer for kernel to consume */
+        if (vdtu_ring_reserve(&g_net_in_ring, hdr.length, &payload) != 0) {
+            VDTU_TRACE(VDTU_TRACE_INFO, NET_RX_FULL, i, frame.count - i, 0);
+            done = false;
+            break;
+        }
+        memcpy(payload, data + off, hdr.length);
+        vdtu_ring_commit(&g_net_in_ring,
+                         hdr.sender_core_id, hdr.sender_ep_id,
+                         hdr.sender_vpe_id, hdr.reply_ep_id,
+                         hdr.label, hdr.replylabel, hdr.flags,
+                         hdr.length);
+        off += hdr.length;
+        (*delivered)++;
+    }
+
+    if (*delivered != first && vdtu_ring_notify_needed(&g_net_in_ring))
+        net_msg_ready_emit();
+    return done;
+}
+
+static inline uint16_t rd_be16(const uint8_t *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+/* One's complement sum over len bytes, big-endian 16-bit words */
+static uint32_t csum_add(uint32_t sum, const uint8_t *p, uint16_t len)
+{
+    for (; len > 1; len -= 2, p += 2)
+        sum += rd_be16(p);
+    if (len)
+        sum += (uint32_t)p[0] << 8;
+    return sum;
+}
+
+static uint16_t csum_fold(uint32_t sum)
+{
+    while (sum >> 16)
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    return (uint16_t)sum;
+}
+
+/*
+ * Checksums of a fast-path datagram. Frames with IPE/TCPE were already
+ * dropped; if the NIC verified both checksums we are done, otherwise
+ * (offload off, or IXSM as some emulations report) verify them here.
+ */
+static bool rx_csum_ok(const uint8_t *ip, uint16_t ihl,
+                       const uint8_t *udp, uint16_t udp_len, uint8_t status)
+{
+    const uint8_t hw_ok = E1000_RXD_STAT_IPCS | E1000_RXD_STAT_TCPCS;
+    if ((status & hw_ok) == hw_ok && !(status & E1000_RXD_STAT_IXSM))
+        return true;
+
+    if (csum_fold(csum_add(0, ip, ihl)) != 0xFFFF)
+        return false;
+    if (rd_be16(udp + 6) == 0)
+        return true;    /* sender sent no UDP checksum */
+
+    uint32_t sum = csum_add(0, ip + 12, 8);     /* src + dst address */
+    sum += IP_PROTO_UDP + udp_len;
+    sum = csum_add(sum, udp, udp_len);
+    return csum_fold(sum) == 0xFFFF;
+}
+
+/*
+ * RX fast path: recognize an unfragmented IPv4/UDP datagram for our DTU
+ * port directly in the RX DMA buffer and deliver its messages without a
+ * pbuf or lwIP. Returns 1 once it is delivered, -1 if net_inbound is full
+ * (the frame has to be offered again, see dtu_deliver()), and 0 for
+ * anything else (ARP, hello, fragments, bad checksums, ...), which then
+ * takes the lwIP path as before.
+ */
+static int dtu_rx_fast(const uint8_t *frame, uint16_t len, uint8_t status,
+                       uint8_t *delivered)
+{
+    if (!net_rings_ready || len < SIZEOF_ETH_HDR + 20 + 8)
+        return 0;
+    if (rd_be16(frame + 12) != ETHTYPE_IP)
+        return 0;
+
+    const uint8_t *ip = frame + SIZEOF_ETH_HDR;
+    uint16_t ihl = (uint16_t)((ip[0] & 0x0F) * 4);
+    uint16_t ip_len = rd_be16(ip + 2);
+    if ((ip[0] >> 4) != 4 || ihl < 20 || ip_len < ihl + 8 ||
+        ip_len > len - SIZEOF_ETH_HDR)
+        return 0;
+    if ((rd_be16(ip + 6) & 0x3FFF) != 0)        /* MF flag or offset */
+        return 0;
+    if (ip[9] != IP_PROTO_UDP || memcmp(ip + 16, &self_ip_addr.addr, 4) != 0)
+        return 0;
+
+    const uint8_t *udp = ip + ihl;
+    uint16_t udp_len = rd_be16(udp + 4);
+    if (rd_be16(udp + 2) != DTU_UDP_PORT || udp_len < 8 || udp_len > ip_len - ihl)
+        return 0;
+    if (!rx_csum_ok(ip, ihl, udp, udp_len, status))
+        return 0;
+
+    return dtu_deliver(udp + 8, (uint16_t)(udp_len - 8), delivered) ? 1 : -1;
+}
+
+/*
+ * UDP receive callback — a DTU datagram that missed the fast path (e.g.
+ * one lwIP had to reassemble). Deliver it from the pbuf. lwIP cannot be
+ * asked to offer it again, so messages net_inbound has no room for are
+ * dropped and counted.
  */
 static void dtu_udp_recv_cb(void *arg, struct udp_pcb *pcb,
                              struct pbuf *p, const ip_addr_t *addr, u16_t port)
 {
-    (void)arg; (void)pcb; (void)port;
+    static uint8_t linear[VDTU_NET_MAX_DATAGRAM];
+    (void)arg; (void)pcb; (void)addr; (void)port;
 
-    if (!p || p->tot_len < VDTU_HEADER_SIZE) {
-        if (p) pbuf_free(p);
-        return;
+    if (!p) return;
+
+    if (net_rings_ready) {
+        const uint8_t *data = NULL;
+        uint8_t delivered = 0;
+        if (p->len == p->tot_len) {
+            data = p->payload;
+        } else if (p->tot_len <= sizeof(linear)) {
+            pbuf_copy_partial(p, linear, p->tot_len, 0);
+            data = linear;
+        }
+        if (data && !dtu_deliver(data, p->tot_len, &delivered))
+            net_rx_dropped += ((const struct vdtu_net_frame *)data)->count - delivered;
     }
+    pbuf_free(p);
+}
 
-    /* Extract DTU header from UDP payload */
-    struct vdtu_msg_header hdr;
-    pbuf_copy_partial(p, &hdr, VDTU_HEADER_SIZE, 0);
+/*
+ * Send the datagram assembled for a peer, if any.
+ */
+static void tx_flush(int peer)
+{
+    struct tx_frame *f = &tx_frames[peer];
+    if (!f->p) return;
 
-    /* Extract payload */
-    uint16_t payload_len = hdr.length;
-    uint8_t payload_buf[487];  /* 512 - VDTU_HEADER_SIZE */
-    if (payload_len > sizeof(payload_buf))
-        payload_len = sizeof(payload_buf);
-    if (payload_len > 0)
-        pbuf_copy_partial(p, payload_buf, payload_len, VDTU_HEADER_SIZE);
+    ((struct vdtu_net_frame *)f->p->payload)->count = f->count;
+    pbuf_realloc(f->p, f->len);
 
-    printf("[%s] NET RX: %u bytes from %d.%d.%d.%d:%u (label=0x%lx)\n",
-           COMPONENT_NAME, (unsigned)p->tot_len,
-           ip4_addr1(ip_2_ip4(addr)), ip4_addr2(ip_2_ip4(addr)),
-           ip4_addr3(ip_2_ip4(addr)), ip4_addr4(ip_2_ip4(addr)),
-           port, (unsigned long)hdr.label);
+    ip_addr_t dest_ip;
+    ip_addr_copy_from_ip4(dest_ip, peer_addrs[peer]);
+    err_t err = udp_sendto(g_udp_pcb, f->p, &dest_ip, DTU_UDP_PORT);
+    pbuf_free(f->p);
+    f->p = NULL;
 
-    pbuf_free(p);
+    net_tx_datagrams++;
+    if (err != ERR_OK) {
+        net_tx_dropped += f->count;
+        VDTU_TRACE(VDTU_TRACE_ERR, NET_TX_FAIL, peer, (uint64_t)-err, 0);
+    }
+    VDTU_TRACE(VDTU_TRACE_INFO, NET_TX, f->count, f->len, peer);
+}
 
-    /* Write to inbound ring buffer for kernel to consume */
-    if (net_rings_ready) {
-        int rc = vdtu_ring_send(&g_net_in_ring,
-                                hdr.sender_core_id, hdr.sender_ep_id,
-                                hdr.sender_vpe_id, hdr.reply_ep_id,
-                                hdr.label, hdr.replylabel, hdr.flags,
-                                payload_buf, payload_len);
-        if (rc != 0) {
-            printf("[%s] NET RX: inbound ring full!\n", COMPONENT_NAME);
+/*
+ * Append one net_outbound message to the datagram for its peer, starting
+ * a new datagram when it would not fit. The route prefix is dropped and
+ * the header length adjusted, so the peer sees a plain DTU message.
+ * Returns 0 on success, -1 if the message was dropped, or 1 if no pbuf
+ * is free; the caller then leaves the message in the ring for later.
+ */
+static int tx_append(const struct vdtu_message *msg)
+{
+    struct vdtu_net_route route;
+    if (msg->hdr.length < sizeof(route)) {
+        net_tx_dropped++;
+        return -1;
+    }
+    memcpy(&route, msg->data, sizeof(route));
+    if (route.dest_node >= NUM_PEERS) {
+        net_tx_dropped++;
+        VDTU_TRACE(VDTU_TRACE_ERR, NET_TX_BAD_PEER, route.dest_node, 0, 0);
+        return -1;
+    }
+
+    struct vdtu_msg_header hdr = msg->hdr;
+    hdr.length = (uint16_t)(msg->hdr.length - sizeof(route));
+    uint16_t wire_len = VDTU_HEADER_SIZE + hdr.length;
+
+    struct tx_frame *f = &tx_frames[route.dest_node];
+    if (f->p && (f->len + wire_len > VDTU_NET_MAX_DATAGRAM || f->count == UINT8_MAX))
+        tx_flush(route.dest_node);
+
+    if (!f->p) {
+        struct vdtu_net_frame frame = { VDTU_NET_FRAME_MAGIC, 0, my_node_id };
+        f->p = pbuf_alloc(PBUF_TRANSPORT, VDTU_NET_MAX_DATAGRAM, PBUF_RAM);
+        if (!f->p) {
+            VDTU_TRACE(VDTU_TRACE_ERR, NET_TX_NOBUF, route.dest_node, 0, 0);
+            return 1;
         }
+        memcpy(f->p->payload, &frame, sizeof(frame));
+        f->len = sizeof(frame);
+        f->count = 0;
     }
+
+    uint8_t *dst = (uint8_t *)f->p->payload + f->len;
+    memcpy(dst, &hdr, VDTU_HEADER_SIZE);
+    memcpy(dst + VDTU_HEADER_SIZE, msg->data + sizeof(route), hdr.length);
+    f->len += wire_len;
+    f->count++;
+    net_tx_msgs++;
+    return 0;
 }
 
 /*
  * RPC handler: SemperKernel calls this to send a DTU message to a remote node.
  * The kernel has already written the raw DTU message bytes into the dtu_out dataport.
+ * It goes out as a datagram of one message, so receivers parse it like
+ * ring traffic.
  */
 int net_net_send(int dest_node, int msg_len)
 {
-    if (msg_len <= 0 || msg_len > 1400) return -1;
+    struct vdtu_net_frame frame = { VDTU_NET_FRAME_MAGIC, 1, my_node_id };
+
+    /* receivers take no larger message out of a frame (see dtu_deliver) */
+    if (msg_len < VDTU_HEADER_SIZE || msg_len > VDTU_NET_MAX_MSG)
+        return -1;
     if (dest_node < 0 || dest_node >= NUM_PEERS) {
-        printf("[%s] Invalid dest_node %d\n", COMPONENT_NAME, dest_node);
+        VDTU_TRACE(VDTU_TRACE_ERR, NET_TX_BAD_PEER, dest_node, 0, 0);
         return -1;
     }
 
     const uint8_t *msg_bytes = (const uint8_t *)dtu_out;
 
     /* Build UDP datagram */
-    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, (uint16_t)msg_len, PBUF_RAM);
+    uint16_t len = (uint16_t)(sizeof(frame) + msg_len);
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, len, PBUF_RAM);
     if (!p) return -1;
 
-    memcpy(p->payload, msg_bytes, msg_len);
+    memcpy(p->payload, &frame, sizeof(frame));
+    memcpy((uint8_t *)p->payload + sizeof(frame), msg_bytes, msg_len);
 
     ip_addr_t dest_ip;
     ip_addr_copy_from_ip4(dest_ip, peer_addrs[dest_node]);
@@ -595,12 +859,11 @@ int net_net_send(int dest_node, int msg_len)
     pbuf_free(p);
 
     if (err != ERR_OK) {
-        printf("[%s] UDP send failed: %d\n", COMPONENT_NAME, err);
+        VDTU_TRACE(VDTU_TRACE_ERR, NET_TX_FAIL, dest_node, (uint64_t)-err, 0);
         return -1;
     }
 
-    printf("[%s] TX DTU msg to peer %d (%d bytes)\n",
-           COMPONENT_NAME, dest_node, msg_len);
+    VDTU_TRACE(VDTU_TRACE_INFO, NET_RPC_TX, dest_node, msg_len, 0);
     return 0;
 }
 
@@ -630,6 +893,7 @@ void eth_irq_handle(void)
 
 void pre_init(void)
 {
+    vdtu_trace_init(COMPONENT_NAME);
     printf("[%s] pre_init\n", COMPONENT_NAME);
 }
 
@@ -715,10 +979,13 @@ void post_init(void)
     /* Initialize network ring buffers (07e).
      * DTUBridge inits both rings; kernel attaches later in kernel_start().
      * post_init runs before any run(), so kernel_start() sees initialized rings. */
-    vdtu_ring_init(&g_net_out_ring, (void *)net_outbound, 4, 512);
-    vdtu_ring_init(&g_net_in_ring, (void *)net_inbound, 4, 512);
+    vdtu_ring_init_packed(&g_net_out_ring, (void *)net_outbound,
+                          NET_RING_DATA_SIZE, VDTU_NET_MAX_MSG);
+    vdtu_ring_init_packed(&g_net_in_ring, (void *)net_inbound,
+                          NET_RING_DATA_SIZE, VDTU_NET_MAX_MSG);
     net_rings_ready = true;
-    printf("[%s] Net rings initialized (4 slots x 512B)\n", COMPONENT_NAME);
+    printf("[%s] Net rings initialized (packed, %uB, msgs <= %uB)\n",
+           COMPONENT_NAME, (unsigned)NET_RING_DATA_SIZE, VDTU_NET_MAX_MSG);
 
     printf("[%s] Ready\n", COMPONENT_NAME);
 }
@@ -764,41 +1031,39 @@ int run(void)
             }
         }
 
-        /* Poll outbound ring: kernel → network (07e)
-         * Route to peer 0 by default. For now, the kernel's ring messages
-         * are PING/PONG or inter-kernel calls targeting the first peer.
-         * Multi-peer routing (by dest PE in the DTU header) is future work. */
+        /* Drain outbound ring: kernel → network (07e)
+         * Every message names its peer; all messages per peer go out
+         * together in one datagram once the ring is empty. Without a free
+         * pbuf the rest stays queued until the flushes below free some. */
         if (net_rings_ready && !vdtu_ring_is_empty(&g_net_out_ring)) {
-            const struct vdtu_message *outmsg = vdtu_ring_fetch(&g_net_out_ring);
-            if (outmsg) {
-                uint16_t total_len = VDTU_HEADER_SIZE + outmsg->hdr.length;
-                struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, total_len, PBUF_RAM);
-                if (p) {
-                    memcpy(p->payload, outmsg, total_len);
-                    ip_addr_t dest_ip;
-                    ip_addr_copy_from_ip4(dest_ip, peer_addrs[0]);
-                    err_t err = udp_sendto(g_udp_pcb, p, &dest_ip, DTU_UDP_PORT);
-                    pbuf_free(p);
-                    printf("[%s] NET TX ring: %u bytes to peer 0 (label=0x%lx, err=%d)\n",
-                           COMPONENT_NAME, total_len,
-                           (unsigned long)outmsg->hdr.label, err);
-                }
+            const struct vdtu_message *outmsg;
+            while ((outmsg = vdtu_ring_fetch(&g_net_out_ring)) != NULL) {
+                if (tx_append(outmsg) > 0)
+                    break;
                 vdtu_ring_ack(&g_net_out_ring);
-                did_work = true;
             }
+            for (int i = 0; i < NUM_PEERS; i++)
+                tx_flush(i);
+            did_work = true;
         }
 
         /* Periodic status */
         loop_count++;
         if ((loop_count % 1000000) == 0) {
-            printf("[%s] irq=%u rx=%u tx=%u drop=%u hello=%s\n",
+            printf("[%s] irq=%u rx=%u (fast %u, stalls %u) tx=%u drop=%u "
+                   "dtu_tx=%u/%u (drop %u) dtu_rx_drop=%u hello=%s\n",
                    COMPONENT_NAME,
-                   g_drv.irq_count, g_drv.rx_pkts,
-                   g_drv.tx_pkts, g_drv.rx_dropped,
+                   g_drv.irq_count, g_drv.rx_pkts, g_drv.rx_dtu_fast,
+                   g_drv.rx_stalls, g_drv.tx_pkts, g_drv.rx_dropped,
+                   net_tx_msgs, net_tx_datagrams, net_tx_dropped,
+                   net_rx_dropped,
                    hello_received ? "YES" : "no");
         }
 
-        if (!did_work) seL4_Yield();
+        /* Format deferred trace records only when there is nothing
+         * else to do, so the data path never waits on the console */
+        if (!did_work && !vdtu_trace_drain(VDTU_TRACE_DRAIN_BUDGET))
+            seL4_Yield();
     }
 
     return 0;
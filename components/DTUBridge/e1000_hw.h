@@ -71,6 +71,7 @@
 #define E1000_RDTR      0x2820  /* RX Delay Timer */
 #define E1000_RXDCTL    0x2828  /* RX Descriptor Control */
 #define E1000_RADV      0x282C  /* RX Interrupt Absolute Delay Timer */
+#define E1000_RXCSUM    0x5000  /* RX Checksum Control */
 
 /* TX Descriptor Control Registers */
 #define E1000_TXDCTL    0x3828  /* TX Descriptor Control */
@@ -198,6 +199,12 @@
 #define E1000_RCTL_BSEX     (1 << 25)  /* Buffer Size Extension */
 #define E1000_RCTL_SECRC    (1 << 26)  /* Strip Ethernet CRC */
 
+/*
+ * Receive Checksum Control (RXCSUM) Bits
+ */
+#define E1000_RXCSUM_IPOFL  (1 << 8)   /* IP Checksum Offload Enable */
+#define E1000_RXCSUM_TUOFL  (1 << 9)   /* TCP/UDP Checksum Offload Enable */
+
 /*
  * Transmit Control (TCTL) Bits
  */
@@ -252,6 +259,8 @@ struct e1000_rx_desc {
 #define E1000_RXD_ERR_CE    (1 << 0)   /* CRC Error */
 #define E1000_RXD_ERR_SE    (1 << 1)   /* Symbol Error */
 #define E1000_RXD_ERR_SEQ   (1 << 2)   /* Sequence Error */
+#define E1000_RXD_ERR_TCPE  (1 << 5)   /* TCP/UDP Checksum Error */
+#define E1000_RXD_ERR_IPE   (1 << 6)   /* IP Checksum Error */
 #define E1000_RXD_ERR_RXE   (1 << 7)   /* RX Data Error */
 
 /*
@@ -10,6 +10,7 @@
 #include <camkes.h>
 #include <sel4/sel4.h>
 #include <stddef.h>
+#include "vdtu_trace.h"
 
 /* C++ functions */
 extern void cxx_test(void);
@@ -53,67 +54,9 @@ void sel4_yield_wrapper(void)
 }
 
 #ifndef SEMPEROS_NO_NETWORK
-/*
- * Incoming network DTU message buffer.
- * DTUBridge deposits a message in the dtu_in dataport and signals us.
- * We copy it to this static buffer so the WorkLoop can poll it.
- *
- * Simple single-slot buffer for Tier 1 prototype.
- * The net_msg_arrived notification handler sets net_msg_pending=1.
- * The WorkLoop (or kernel polling loop) checks this flag.
- */
 #include <string.h>
 #include "vdtu_ring.h"
-
-static volatile int net_msg_pending = 0;
-static uint8_t net_msg_buf[2048];
-static uint16_t net_msg_len = 0;
-
-/* CAmkES notification handler: DTUBridge -> SemperKernel */
-void net_msg_arrived_handle(void)
-{
-    volatile uint8_t *src = (volatile uint8_t *)dtu_in;
-
-    /* Read length header (first 2 bytes of dtu_in) */
-    uint16_t len = (uint16_t)(src[0] | ((uint16_t)src[1] << 8));
-
-    if (len > 0 && len <= sizeof(net_msg_buf)) {
-        memcpy(net_msg_buf, (const void *)(src + 2), len);
-        net_msg_len = len;
-        __sync_synchronize();
-        net_msg_pending = 1;
-
-        /* Parse and log the DTU header */
-        if (len >= VDTU_HEADER_SIZE) {
-            const struct vdtu_msg_header *hdr = (const struct vdtu_msg_header *)net_msg_buf;
-            printf("[SemperKernel] NET RX: from PE %u EP %u, label=0x%lx, payload=%u bytes\n",
-                   hdr->sender_core_id, hdr->sender_ep_id,
-                   (unsigned long)hdr->label, hdr->length);
-        }
-    }
-}
-
-/* Accessors for C++ code */
-int net_msg_is_pending(void)
-{
-    return net_msg_pending;
-}
-
-const uint8_t *net_msg_get_buf(void)
-{
-    return net_msg_buf;
-}
-
-uint16_t net_msg_get_len(void)
-{
-    return net_msg_len;
-}
-
-void net_msg_clear(void)
-{
-    net_msg_pending = 0;
-    net_msg_len = 0;
-}
+#include "vdtu_net.h"
 
 /*
  * ================================================================
@@ -122,9 +65,14 @@ void net_msg_clear(void)
  *  net_outbound: kernel (producer) → DTUBridge (consumer) → UDP
  *  net_inbound:  UDP → DTUBridge (producer) → kernel (consumer)
  *
+ *  Outbound messages carry a vdtu_net_route prefix (see vdtu_net.h) so
+ *  the bridge knows which peer to send them to.
+ *
  *  DTUBridge initializes both rings in post_init().
  *  Kernel attaches in net_init_rings() called from kernel_start().
  *  WorkLoop calls net_poll() every iteration for PING/PONG demo.
+ *  DTUBridge signals signal_from_vpe0 for net_inbound while the kernel
+ *  sleeps in DTU::sleep() (net_prepare_wait()/net_finish_wait()).
  * ================================================================
  */
 
@@ -153,33 +101,63 @@ void net_init_rings(void)
     printf("[SemperKernel] Net rings attached (outbound + inbound)\n");
 }
 
-/* C wrapper for DTU.cc to write to outbound ring */
-int net_ring_send(uint16_t sender_pe, uint8_t sender_ep,
+/* C wrapper for DTU.cc to write to outbound ring, for peer dest_node */
+int net_ring_send(uint16_t dest_node,
+                  uint16_t sender_pe, uint8_t sender_ep,
                   uint16_t sender_vpe, uint8_t reply_ep,
                   uint64_t label, uint64_t replylabel, uint8_t flags,
                   const void *payload, uint16_t payload_len)
 {
+    struct vdtu_net_route route = { dest_node };
+    uint16_t len = (uint16_t)(sizeof(route) + payload_len);
+    void *buf;
+
     if (!net_rings_attached) return -1;
-    return vdtu_ring_send(&g_net_out_ring,
-                          sender_pe, sender_ep, sender_vpe, reply_ep,
-                          label, replylabel, flags,
-                          payload, payload_len);
+    if (payload_len > VDTU_NET_MAX_PAYLOAD)
+        return -2;
+
+    /* Build the route + payload in place, no staging copy */
+    int rc = vdtu_ring_reserve(&g_net_out_ring, len, &buf);
+    if (rc != 0) return rc;
+    memcpy(buf, &route, sizeof(route));
+    memcpy((uint8_t *)buf + sizeof(route), payload, payload_len);
+    return vdtu_ring_commit(&g_net_out_ring,
+                            sender_pe, sender_ep, sender_vpe, reply_ep,
+                            label, replylabel, flags, len);
+}
+
+/* Announce the kernel's sleep on net_inbound; 1 if a message is there */
+int net_prepare_wait(void)
+{
+    if (!net_rings_attached) return 0;
+    return vdtu_ring_prepare_wait(&g_net_in_ring);
+}
+
+void net_finish_wait(void)
+{
+    if (net_rings_attached)
+        vdtu_ring_finish_wait(&g_net_in_ring);
 }
 
-/* Called from WorkLoop every iteration to handle network I/O */
-void net_poll(void)
+/*
+ * Called from WorkLoop every iteration to handle network I/O.
+ * Returns nonzero while there is more to do: a message was handled, trace
+ * records were printed or the PING/PONG demo still counts iterations.
+ */
+int net_poll(void)
 {
-    if (!net_rings_attached) return;
+    int busy;
+
+    if (!net_rings_attached) return 0;
 
     net_poll_count++;
 
     /* Send PING after delay (let both nodes boot + hello exchange complete) */
     if (!net_ping_sent && net_poll_count == 1000000) {
         const char *payload = "PING from kernel";
-        int rc = vdtu_ring_send(&g_net_out_ring,
-                                0, 0, 0, 0,
-                                NET_LABEL_PING, 0, 0,
-                                payload, (uint16_t)strlen(payload));
+        int rc = net_ring_send(0, 0, 0, 0, 0,
+                               NET_LABEL_PING, 0, 0,
+                               payload, (uint16_t)strlen(payload));
         if (rc == 0) {
             net_ping_sent = 1;
             printf("[SemperKernel] NET: Sent PING to outbound ring\n");
@@ -196,16 +174,16 @@ void net_poll(void)
         memcpy(payload_str, msg->data, plen);
         payload_str[plen] = '\0';
 
-        printf("[SemperKernel] NET RX: label=0x%lx len=%u \"%s\"\n",
-               (unsigned long)msg->hdr.label, msg->hdr.length, payload_str);
+        VDTU_TRACE(VDTU_TRACE_DBG, NET_RING_RX,
+                   msg->hdr.label, msg->hdr.length, 0);
 
         if (msg->hdr.label == NET_LABEL_PING && !net_pong_sent) {
+            printf("[SemperKernel] NET RX: \"%s\"\n", payload_str);
             /* Received PING -> send PONG back */
             const char *pong = "PONG from kernel";
-            vdtu_ring_send(&g_net_out_ring,
-                           0, 0, 0, 0,
-                           NET_LABEL_PONG, 0, 0,
-                           pong, (uint16_t)strlen(pong));
+            net_ring_send(0, 0, 0, 0, 0,
+                          NET_LABEL_PONG, 0, 0,
+                          pong, (uint16_t)strlen(pong));
             net_pong_sent = 1;
             printf("[SemperKernel] NET: Sent PONG reply\n");
         } else if (msg->hdr.label == NET_LABEL_PONG) {
@@ -219,6 +197,10 @@ void net_poll(void)
         }
 
         vdtu_ring_ack(&g_net_in_ring);
+        busy = 1;
+    } else {
+        /* Inbound ring idle: print deferred trace records */
+        busy = vdtu_trace_drain(VDTU_TRACE_DRAIN_BUDGET) > 0;
     }
 
     /* Status report */
@@ -229,18 +211,22 @@ void net_poll(void)
             printf("[SemperKernel] NET: PING sent, PONG not yet received\n");
         }
     }
+    return busy || net_poll_count < 3000000;
 }
 #else  /* SEMPEROS_NO_NETWORK */
 /* Stubs for builds without DTUBridge (e.g. XCP-ng local-only benchmarks) */
 void net_init_rings(void) {}
-void net_poll(void) {}
-int net_ring_send(uint16_t s_pe, uint8_t s_ep, uint16_t s_vpe, uint8_t r_ep,
+int net_poll(void) { return 0; }
+int net_prepare_wait(void) { return 0; }
+void net_finish_wait(void) {}
+int net_ring_send(uint16_t dest, uint16_t s_pe, uint8_t s_ep, uint16_t s_vpe, uint8_t r_ep,
                   uint64_t label, uint64_t rlabel, uint8_t flags,
-                  const void *payload, uint16_t plen) { (void)s_pe; (void)s_ep; (void)s_vpe; (void)r_ep; (void)label; (void)rlabel; (void)flags; (void)payload; (void)plen; return -1; }
+                  const void *payload, uint16_t plen) { (void)dest; (void)s_pe; (void)s_ep; (void)s_vpe; (void)r_ep; (void)label; (void)rlabel; (void)flags; (void)payload; (void)plen; return -1; }
 #endif /* SEMPEROS_NO_NETWORK */
 
 int run(void)
 {
+    vdtu_trace_init("SemperKernel");
     printf("=== SemperOS Kernel on seL4/CAmkES ===\n");
 
     /* Verify C++ runtime is working */
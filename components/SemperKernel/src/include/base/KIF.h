@@ -72,9 +72,16 @@ struct KIF {
             REVOKE,
             EXIT,
             NOOP,
+            EXCHANGEV,
+            REVOKEV,
             COUNT
         };
 
+        // Most ranges one EXCHANGEV/REVOKEV carries; keeps the request within a 512 byte
+        // syscall slot and the per-range reply within a reply slot
+        static const uint MAX_XCHG_RANGES   = 14;
+        static const uint MAX_REVOKE_RANGES = 28;
+
         enum VPECtrl {
             VCTRL_START,
             VCTRL_WAIT,
@@ -51,3 +51,5 @@
 #define SYNC_APP_START      0
 #define CASCADING_APP_START 0
 #define KERNEL_STATISTICS   0
+// Kernelcalls use the compact marshalling encoding (see m3::Marshaller::Encoding)
+#define KRNLC_COMPACT       1
@@ -148,10 +148,26 @@ public:
 
     bool is_valid(int epid) const;
     Message *fetch_msg(int epid) const;
+    /* Up to max oldest unread messages of epid, without consuming them */
+    size_t fetch_msgs(int epid, const Message **msgs, size_t max) const;
+    /* Replies the ring of msg's reply EP has room for now */
+    size_t reply_space(const Message *msg) const;
+    /* Bitmap of recv EPs that got messages since the last call; an EP
+     * stays pending only until this returns it */
+    uint32_t ready_eps() const;
     size_t get_msgoff(int, const Message *msg) const {
         return reinterpret_cast<uintptr_t>(msg);
     }
     void mark_read(int ep, size_t off);
+    /* Consume the count oldest messages of ep with one ring update */
+    void mark_read_n(int ep, size_t count);
+    /* Collect the notifications of messages sent from now on and deliver
+     * them, one per channel, on flush_notify() */
+    void defer_notify();
+    void flush_notify();
+    /* Block until a producer signals a message for a recv EP or the network;
+     * returns at once if one has arrived in the meantime */
+    void sleep();
 
     bool wait() const {
         /* Yield to let other CAmkES components (VPE0) run.
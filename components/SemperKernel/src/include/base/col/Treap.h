@@ -134,6 +134,25 @@ public:
         return nullptr;
     }
 
+    /**
+     * Finds the node with the largest key that is less than or equal to <key>
+     *
+     * @param key the key
+     * @return the node or nullptr if all keys are larger
+     */
+    T *find_floor(typename T::key_t key) const {
+        node_t *res = nullptr;
+        for(node_t *p = _root; p != nullptr; ) {
+            if(key < p->_key)
+                p = p->_left;
+            else {
+                res = p;
+                p = p->_right;
+            }
+        }
+        return static_cast<T*>(res);
+    }
+
     /**
      * Inserts the given node in the tree. Note that it is expected, that the key of the node is
      * already set.
@@ -51,7 +51,8 @@ class BaseGateIStream;
 template<class RGATE, class SGATE>
 class BaseGateOStream : public Marshaller {
 public:
-    explicit BaseGateOStream(unsigned char *bytes, size_t total) : Marshaller(bytes, total) {
+    explicit BaseGateOStream(unsigned char *bytes, size_t total, Encoding enc = WORDS)
+        : Marshaller(bytes, total, enc) {
     }
     BaseGateOStream(const BaseGateOStream &) = default;
     BaseGateOStream &operator=(const BaseGateOStream &) = default;
@@ -89,7 +90,8 @@ public:
 template<size_t SIZE, class RGATE, class SGATE>
 class BaseStaticGateOStream : public BaseGateOStream<RGATE, SGATE> {
 public:
-    explicit BaseStaticGateOStream() : BaseGateOStream<RGATE, SGATE>(_bytes, SIZE) {
+    explicit BaseStaticGateOStream(Marshaller::Encoding enc = Marshaller::WORDS)
+        : BaseGateOStream<RGATE, SGATE>(_bytes, SIZE, enc) {
     }
     template<size_t SRCSIZE>
     BaseStaticGateOStream(const BaseStaticGateOStream<SRCSIZE, RGATE, SGATE> &os)
@@ -119,17 +121,17 @@ public:
 #if defined(__t2__) or defined(__t3__)
     // TODO alloca() uses movsp which causes an exception to be handled appropriately. since this
     // isn't that trivial to implement, we're using malloc instead.
-    explicit BaseAutoGateOStream(size_t size)
+    explicit BaseAutoGateOStream(size_t size, Marshaller::Encoding enc = Marshaller::WORDS)
         : BaseGateOStream<RGATE, SGATE>(static_cast<unsigned char*>(
-            Heap::alloc(Math::round_up(size, DTU_PKG_SIZE))), Math::round_up(size, DTU_PKG_SIZE)) {
+            Heap::alloc(Math::round_up(size, DTU_PKG_SIZE))), Math::round_up(size, DTU_PKG_SIZE), enc) {
     }
     ~BaseAutoGateOStream() {
         Heap::free(this->_bytes);
     }
 #else
-    ALWAYS_INLINE explicit BaseAutoGateOStream(size_t size)
+    ALWAYS_INLINE explicit BaseAutoGateOStream(size_t size, Marshaller::Encoding enc = Marshaller::WORDS)
         : BaseGateOStream<RGATE, SGATE>(static_cast<unsigned char*>(
-            alloca(Math::round_up(size, DTU_PKG_SIZE))), Math::round_up(size, DTU_PKG_SIZE)) {
+            alloca(Math::round_up(size, DTU_PKG_SIZE))), Math::round_up(size, DTU_PKG_SIZE), enc) {
     }
 #endif
 
@@ -160,6 +162,9 @@ public:
  * Note: unfortunately, we can't reuse the functionality of Unmarshaller here. It seems to be a
  * compiler-bug when building for Xtensa. The compiler generates wrong code when we initialize the
  * _length field to _msg->length.
+ *
+ * Messages are read as Marshaller::WORDS unless encoding() is changed before the first read.
+ * Reading beyond the end of the message yields zeroed values and sets error() to Errors::INV_ARGS.
  */
 template<class RGATE, class SGATE>
 class BaseGateIStream {
@@ -171,7 +176,7 @@ public:
      * @param err the error code
      */
     explicit BaseGateIStream(RGATE &gate, const DTU::Message *msg, Errors::Code err)
-        : _err(err), _ack(true), _pos(0), _gate(&gate), _msg(msg) {
+        : _err(err), _ack(true), _pos(0), _enc(Marshaller::WORDS), _gate(&gate), _msg(msg) {
     }
 
     /**
@@ -181,18 +186,20 @@ public:
      * @param msg the message
      */
     explicit BaseGateIStream(RGATE &gate, const DTU::Message *msg)
-        : _err(Errors::NO_ERROR), _ack(true), _pos(0), _gate(&gate), _msg(msg) {
+        : _err(Errors::NO_ERROR), _ack(true), _pos(0), _enc(Marshaller::WORDS), _gate(&gate),
+          _msg(msg) {
     }
 
     // don't do the ack twice. thus, copies never ack.
     BaseGateIStream(const BaseGateIStream &is)
-        : _err(is._err), _ack(), _pos(is._pos), _gate(is._gate), _msg(is._msg) {
+        : _err(is._err), _ack(), _pos(is._pos), _enc(is._enc), _gate(is._gate), _msg(is._msg) {
     }
     BaseGateIStream &operator=(const BaseGateIStream &is) {
         if(this != &is) {
             _err = is._err;
             _ack = false;
             _pos = is._pos;
+            _enc = is._enc;
             _gate = is._gate;
             _msg = is._msg;
         }
@@ -203,6 +210,7 @@ public:
             _err = is._err;
             _ack = is._ack;
             _pos = is._pos;
+            _enc = is._enc;
             _gate = is._gate;
             _msg = is._msg;
             is._ack = 0;
@@ -210,7 +218,8 @@ public:
         return *this;
     }
     BaseGateIStream(BaseGateIStream &&is)
-        : _err(is._err), _ack(is._ack), _pos(is._pos), _gate(is._gate), _msg(is._msg) {
+        : _err(is._err), _ack(is._ack), _pos(is._pos), _enc(is._enc), _gate(is._gate),
+          _msg(is._msg) {
         is._ack = 0;
     }
     ~BaseGateIStream() {
@@ -223,6 +232,18 @@ public:
     Errors::Code error() const {
         return _err;
     }
+    /**
+     * @return the encoding the message is read with
+     */
+    Marshaller::Encoding encoding() const {
+        return _enc;
+    }
+    /**
+     * Reads the message with encoding <enc> from now on
+     */
+    void encoding(Marshaller::Encoding enc) {
+        _enc = enc;
+    }
     /**
      * @return the receive gate
      */
@@ -317,18 +338,13 @@ public:
      */
     template<typename T>
     BaseGateIStream & operator>>(T &value) {
-        assert(_pos + sizeof(T) <= length());
-        value = *reinterpret_cast<const T*>(_msg->data + _pos);
-        _pos += Math::round_up(sizeof(T), sizeof(ulong));
+        if(!Unmarshaller::read(_msg->data, length(), _pos, _enc, value))
+            _err = Errors::INV_ARGS;
         return *this;
     }
     BaseGateIStream & operator>>(String &value) {
-        assert(_pos + sizeof(size_t) <= length());
-        size_t len = *reinterpret_cast<const size_t*>(_msg->data + _pos);
-        _pos += sizeof(size_t);
-        assert(_pos + len <= length());
-        value.reset(reinterpret_cast<const char*>(_msg->data + _pos), len);
-        _pos += Math::round_up(len, sizeof(ulong));
+        if(!Unmarshaller::read(_msg->data, length(), _pos, _enc, value))
+            _err = Errors::INV_ARGS;
         return *this;
     }
 
@@ -359,6 +375,7 @@ private:
     Errors::Code _err;
     bool _ack;
     size_t _pos;
+    Marshaller::Encoding _enc;
     RGATE *_gate;
     const DTU::Message *_msg;
 };
@@ -20,6 +20,7 @@
 #include <base/util/String.h>
 #include <base/util/Math.h>
 #include <base/DTU.h>
+#include <base/Errors.h>
 #include <assert.h>
 
 namespace m3 {
@@ -28,11 +29,22 @@ class Unmarshaller;
 
 /**
  * The marshaller puts values into a buffer, which is for example used by GateOStream.
+ *
+ * By default, every value starts at a multiple of sizeof(ulong) and strings are prefixed with
+ * their length as a size_t (WORDS). This is the layout of the syscall and service protocols.
+ * Streams between two parties that both use the marshalling classes can use COMPACT instead,
+ * which packs the values at their size without padding and prefixes strings with their length as
+ * a varint. Both ends have to agree on the encoding.
  */
 class Marshaller {
 public:
-    explicit Marshaller(unsigned char *bytes, size_t total)
-        : _bytecount(0), _bytes(bytes), _total(total) {
+    enum Encoding {
+        WORDS,
+        COMPACT,
+    };
+
+    explicit Marshaller(unsigned char *bytes, size_t total, Encoding enc = WORDS)
+        : _bytecount(0), _bytes(bytes), _total(total), _enc(enc) {
     }
 
     Marshaller(const Marshaller &) = default;
@@ -50,6 +62,12 @@ public:
     const unsigned char *bytes() const {
         return _bytes;
     }
+    /**
+     * @return the encoding of the values
+     */
+    Encoding encoding() const {
+        return _enc;
+    }
 
     /**
      * Puts the given values into this Marshaller.
@@ -72,8 +90,17 @@ public:
     template<typename T>
     Marshaller & operator<<(const T& value) {
         assert(fits(_bytecount, sizeof(T)));
-        *reinterpret_cast<T*>(_bytes + _bytecount) = value;
-        _bytecount += Math::round_up(sizeof(T), sizeof(ulong));
+        if(_enc == COMPACT) {
+            // the position is not necessarily aligned for T
+            alignas(T) unsigned char tmp[sizeof(T)];
+            *reinterpret_cast<T*>(tmp) = value;
+            memcpy(_bytes + _bytecount, tmp, sizeof(T));
+            _bytecount += sizeof(T);
+        }
+        else {
+            *reinterpret_cast<T*>(_bytes + _bytecount) = value;
+            _bytecount += Math::round_up(sizeof(T), sizeof(ulong));
+        }
         return *this;
     }
     Marshaller & operator<<(const char *value) {
@@ -99,14 +126,33 @@ public:
     void put(const Marshaller &os);
 
     Marshaller & put_str(const char *value, size_t len) {
-        assert(fits(_bytecount, len + sizeof(size_t)));
         unsigned char *start = const_cast<unsigned char*>(bytes());
-        *reinterpret_cast<size_t*>(start + _bytecount) = len;
-        memcpy(start + _bytecount + sizeof(size_t), value, len);
-        _bytecount += Math::round_up(len + sizeof(size_t), sizeof(ulong));
+        if(_enc == COMPACT) {
+            assert(fits(_bytecount, varint_size(len) + len));
+            for(size_t rem = len; ; rem >>= 7) {
+                start[_bytecount++] = (rem & 0x7F) | (rem >= 0x80 ? 0x80 : 0);
+                if(rem < 0x80)
+                    break;
+            }
+            memcpy(start + _bytecount, value, len);
+            _bytecount += len;
+        }
+        else {
+            assert(fits(_bytecount, len + sizeof(size_t)));
+            *reinterpret_cast<size_t*>(start + _bytecount) = len;
+            memcpy(start + _bytecount + sizeof(size_t), value, len);
+            _bytecount += Math::round_up(len + sizeof(size_t), sizeof(ulong));
+        }
         return *this;
     }
-    
+
+    /**
+     * @return the number of bytes of the varint for <val>
+     */
+    static constexpr size_t varint_size(size_t val) {
+        return val < 0x80 ? 1 : 1 + varint_size(val >> 7);
+    }
+
 protected:
     // needed as recursion-end
     void vput() {
@@ -118,14 +164,18 @@ protected:
     size_t _bytecount;
     unsigned char *_bytes;
     size_t _total;
+    Encoding _enc;
 };
 
 /**
  * The unmarshaller reads values from a buffer, used e.g. in GateIStream.
+ *
+ * Reads are bounds-checked: reading beyond the end yields a zeroed value (or an empty string) and
+ * sets error() to Errors::INV_ARGS.
  */
 class Unmarshaller {
 protected:
-    explicit Unmarshaller() {
+    explicit Unmarshaller() : _enc(Marshaller::WORDS), _err(Errors::NO_ERROR) {
     }
 
 public:
@@ -134,9 +184,11 @@ public:
      *
      * @param data the data to unmarshall
      * @param length the length of the data
+     * @param enc the encoding the data has been marshalled with
      */
-    explicit Unmarshaller(const unsigned char *data, size_t length)
-        : _pos(0), _length(length), _data(data) {
+    explicit Unmarshaller(const unsigned char *data, size_t length,
+                          Marshaller::Encoding enc = Marshaller::WORDS)
+        : _pos(0), _length(length), _data(data), _enc(enc), _err(Errors::NO_ERROR) {
     }
 
     Unmarshaller(const Unmarshaller &) = default;
@@ -166,6 +218,12 @@ public:
     const unsigned char *buffer() const {
         return _data;
     }
+    /**
+     * @return Errors::INV_ARGS if a read went beyond the end of the data
+     */
+    Errors::Code error() const {
+        return _err;
+    }
 
     /**
      * Pulls the given values out of this stream
@@ -187,21 +245,72 @@ public:
      */
     template<typename T>
     Unmarshaller & operator>>(T &value) {
-        assert(_pos + sizeof(T) <= length());
-        value = *reinterpret_cast<const T*>(_data + _pos);
-        _pos += Math::round_up(sizeof(T), sizeof(ulong));
+        if(!read(_data, length(), _pos, _enc, value))
+            _err = Errors::INV_ARGS;
         return *this;
     }
     Unmarshaller & operator>>(String &value) {
-        assert(_pos + sizeof(size_t) <= length());
-        size_t len = *reinterpret_cast<const size_t*>(_data + _pos);
-        _pos += sizeof(size_t);
-        assert(_pos + len <= length());
-        value.reset(reinterpret_cast<const char*>(_data + _pos), len);
-        _pos += Math::round_up(len, sizeof(ulong));
+        if(!read(_data, length(), _pos, _enc, value))
+            _err = Errors::INV_ARGS;
         return *this;
     }
 
+    /**
+     * Reads a value of encoding <enc> at <pos> from <data> of <length> bytes and advances <pos>.
+     * This is shared with BaseGateIStream, which can't inherit from Unmarshaller.
+     *
+     * @return false if the data ends before the value
+     */
+    template<typename T>
+    static bool read(const unsigned char *data, size_t length, size_t &pos,
+                     Marshaller::Encoding enc, T &value) {
+        if(pos > length || length - pos < sizeof(T)) {
+            value = T();
+            pos = length;
+            return false;
+        }
+        if(enc == Marshaller::COMPACT) {
+            alignas(T) unsigned char tmp[sizeof(T)];
+            memcpy(tmp, data + pos, sizeof(T));
+            value = *reinterpret_cast<const T*>(tmp);
+            pos += sizeof(T);
+        }
+        else {
+            value = *reinterpret_cast<const T*>(data + pos);
+            pos = Math::min(length, pos + Math::round_up(sizeof(T), sizeof(ulong)));
+        }
+        return true;
+    }
+    static bool read(const unsigned char *data, size_t length, size_t &pos,
+                     Marshaller::Encoding enc, String &value) {
+        size_t len = 0;
+        bool ok;
+        if(enc == Marshaller::COMPACT) {
+            ok = false;
+            for(uint shift = 0; pos < length && shift < sizeof(size_t) * 8; shift += 7) {
+                unsigned char b = data[pos++];
+                len |= static_cast<size_t>(b & 0x7F) << shift;
+                if(!(b & 0x80)) {
+                    ok = true;
+                    break;
+                }
+            }
+        }
+        else
+            ok = read(data, length, pos, enc, len);
+        if(!ok || length - pos < len) {
+            value.reset("", 0);
+            pos = length;
+            return false;
+        }
+        value.reset(reinterpret_cast<const char*>(data + pos), len);
+        if(enc == Marshaller::COMPACT)
+            pos += len;
+        else
+            pos = Math::min(length, pos + Math::round_up(len, sizeof(ulong)));
+        return true;
+    }
+
 protected:
     // needed as recursion-end
     void vpull() {
@@ -210,6 +319,8 @@ protected:
     size_t _pos;
     size_t _length;
     const unsigned char *_data;
+    Marshaller::Encoding _enc;
+    Errors::Code _err;
 };
 
 inline void Marshaller::put(const Unmarshaller &is) {
@@ -218,14 +329,15 @@ inline void Marshaller::put(const Unmarshaller &is) {
     _bytecount += is.remaining();
 }
 inline void Marshaller::put(const Marshaller &os) {
-    assert(fits(_bytecount, os.total()));
-    memcpy(const_cast<unsigned char*>(bytes()) + _bytecount, os.bytes(), os.total());
-    _bytecount += os.total();
+    // without the padding behind the last value, which COMPACT streams don't have in between
+    assert(fits(_bytecount, os._bytecount));
+    memcpy(const_cast<unsigned char*>(bytes()) + _bytecount, os.bytes(), os._bytecount);
+    _bytecount += os._bytecount;
 }
 
 /**
  * The following templates are used to determine the size of given values in order to determine
- * the size of a message.
+ * the size of a message. They are computed for WORDS, which is an upper bound for COMPACT.
  */
 
 template<typename T>
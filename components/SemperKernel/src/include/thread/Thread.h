@@ -49,7 +49,7 @@ public:
 
 private:
     explicit Thread()
-        : _id(_next_id++), _regs(), _stack(), _event(nullptr), _content(false) {
+        : _id(_next_id++), _regs(), _stack(), _event(nullptr), _waitstart(), _content(false) {
     }
 
     bool save() {
@@ -61,6 +61,7 @@ private:
 
     void subscribe(void *event) {
         _event = event;
+        _waitstart = thread_cycles();
     }
     void unsubscribe(void *event) {
         if(_event == event)
@@ -91,6 +92,7 @@ private:
     Regs _regs;
     word_t *_stack;
     void* _event;
+    cycles_t _waitstart;
     bool _content;
     unsigned char _msg[MAX_MSG_SIZE];
     static int _next_id;
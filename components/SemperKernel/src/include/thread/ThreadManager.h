@@ -25,10 +25,22 @@
 
 namespace m3 {
 
+/**
+ * Cooperative thread scheduler. Blocked threads are kept in wait queues, hashed by the event they
+ * wait for, so that notify() only looks at the threads of one queue instead of all blocked ones.
+ *
+ * It also records the most threads that were blocked at once and a histogram of how long
+ * threads waited, in log2 buckets of cycles.
+ */
 class ThreadManager {
     friend class Thread;
 
+    static const size_t WAIT_QUEUE_BITS = 5;
+    static const size_t WAIT_QUEUES     = 1 << WAIT_QUEUE_BITS;
+
 public:
+    static const size_t WAIT_HIST_SIZE  = sizeof(cycles_t) * 8;
+
     static ThreadManager &get() {
         return inst;
     }
@@ -37,7 +49,7 @@ public:
         return _current;
     }
     size_t thread_count() const {
-        return _ready.length() + _blocked.length() + _sleep.length();
+        return _ready.length() + _blocked + _sleep.length();
     }
     size_t ready_count() const {
         return _ready.length();
@@ -45,14 +57,32 @@ public:
     size_t sleeping_count() const {
         return _sleep.length();
     }
+    size_t blocked_count() const {
+        return _blocked;
+    }
     const unsigned char *get_current_msg() const {
         return _current->get_msg();
     }
 
+    /**
+     * @return the most threads that have been blocked at the same time
+     */
+    size_t blocked_highwater() const {
+        return _blocked_hwm;
+    }
+    /**
+     * @return the number of waits that took between 2^<i> and 2^(<i>+1) cycles
+     */
+    size_t wait_histogram(size_t i) const {
+        return _wait_hist[i];
+    }
+
     void wait_for(void *event) {
         assert(_sleep.length() > 0);
         _current->subscribe(event);
-        _blocked.append(_current);
+        _waitq[queue_of(event)].append(_current);
+        if(++_blocked > _blocked_hwm)
+            _blocked_hwm = _blocked;
         LLOG(THREAD, "Thread " << _current->id() << " waits for " << event);
         if(_ready.length())
             switch_to(_ready.remove_first());
@@ -69,13 +99,20 @@ public:
 
     void notify(void *event, void *msg = nullptr, size_t size = 0) {
         assert(size <= Thread::MAX_MSG_SIZE);
-        for(auto it = _blocked.begin(); it != _blocked.end(); ) {
+        m3::SList<Thread> &queue = _waitq[queue_of(event)];
+        if(queue.length() == 0)
+            return;
+
+        cycles_t now = thread_cycles();
+        for(auto it = queue.begin(); it != queue.end(); ) {
             auto old = it++;
             if(old->trigger_event(event)) {
                 Thread* t = &(*old);
                 t->set_msg(msg, size);
                 LLOG(THREAD, "Waking up thread " << t->id() << " for event " << event);
-                _blocked.remove(t);
+                queue.remove(t);
+                _blocked--;
+                _wait_hist[hist_bucket(now - t->_waitstart)]++;
                 _ready.append(t);
             }
         }
@@ -91,16 +128,27 @@ public:
     }
 
 private:
-    explicit ThreadManager() : _current(), _ready(), _blocked(), _sleep() {
+    explicit ThreadManager()
+        : _current(), _ready(), _waitq(), _blocked(), _blocked_hwm(), _wait_hist(), _sleep() {
         _current = new Thread();
     }
 
+    static size_t queue_of(void *event) {
+        // fibonacci hashing; events are thread ids as well as object addresses
+        uintptr_t key = reinterpret_cast<uintptr_t>(event) * static_cast<uintptr_t>(0x9e3779b97f4a7c15ULL);
+        return key >> (sizeof(uintptr_t) * 8 - WAIT_QUEUE_BITS);
+    }
+    static size_t hist_bucket(cycles_t cycles) {
+        return cycles ? sizeof(cycles_t) * 8 - 1 - __builtin_clzll(cycles) : 0;
+    }
+
     void add(Thread *t) {
         _sleep.append(t);
     }
     void remove(Thread *t) {
         _ready.remove(t);
-        _blocked.remove(t);
+        if(_waitq[queue_of(t->_event)].remove(t))
+            _blocked--;
         _sleep.remove(t);
     }
 
@@ -114,9 +162,12 @@ private:
 
     Thread *_current;
     m3::SList<Thread> _ready;
-    m3::SList<Thread> _blocked;
+    m3::SList<Thread> _waitq[WAIT_QUEUES];
+    size_t _blocked;
+    size_t _blocked_hwm;
+    size_t _wait_hist[WAIT_HIST_SIZE];
     m3::SList<Thread> _sleep;
     static ThreadManager inst;
 };
 
-}
\ No newline at end of file
+}
@@ -46,6 +46,12 @@ void thread_init(_thread_func func, void *arg, Regs *regs, word_t *stack);
 extern "C"  bool thread_save(Regs *regs);
 extern "C" bool thread_resume(Regs *regs);
 
+static inline cycles_t thread_cycles() {
+    uint32_t lo, hi;
+    asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return (static_cast<cycles_t>(hi) << 32) | lo;
+}
+
 }
 
 #endif
@@ -27,13 +27,22 @@ struct Regs {
 };
 
 enum {
-    T_STACK_WORDS = 16384  /* 128 KiB -- worker threads run full WorkLoop dispatch including revoke_rec (32 KiB frame) */
+    /* 32 KiB -- worker threads run full WorkLoop dispatch. revoke_rec keeps its work-list and
+     * revokeBatch IDs on the heap; the deepest path (-fstack-usage), a revoke syscall sending a
+     * revokeBatch with its MSG_SIZE message on the stack, takes about 5 KiB */
+    T_STACK_WORDS = 4096
 };
 
 void thread_init(_thread_func func, void *arg, Regs *regs, word_t *stack);
 extern "C" bool thread_save(Regs *regs);
 extern "C" bool thread_resume(Regs *regs);
 
+static inline cycles_t thread_cycles() {
+    uint32_t lo, hi;
+    asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return (static_cast<cycles_t>(hi) << 32) | lo;
+}
+
 }
 
 #endif
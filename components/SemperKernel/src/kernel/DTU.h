@@ -84,8 +84,8 @@ public:
     void config_mem_remote(const VPEDesc &vpe, int ep, int dstcore, int dstvpe,
         uintptr_t addr, size_t size, int perm);
 
-    void send_to(const VPEDesc &vpe, int ep, label_t label, const void *msg, size_t size,
-        label_t replylbl, int replyep);
+    m3::Errors::Code send_to(const VPEDesc &vpe, int ep, label_t label, const void *msg,
+        size_t size, label_t replylbl, int replyep);
     void reply_to(const VPEDesc &vpe, int ep, int crdep, word_t credits, label_t label,
         const void *msg, size_t size);
 
@@ -21,9 +21,8 @@
 namespace kernel {
 
 m3::Errors::Code SendGate::send(const void *data, size_t len, RecvGate *rgate) {
-    DTU::get().send_to(_vpe.desc(), _ep, _label, data, len,
+    return DTU::get().send_to(_vpe.desc(), _ep, _label, data, len,
         reinterpret_cast<uintptr_t>(rgate), rgate->epid());
-    return m3::Errors::NO_ERROR;
 }
 
 }
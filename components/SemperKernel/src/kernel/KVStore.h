@@ -17,27 +17,74 @@
 
 #pragma once
 
+#include <base/Common.h>
 #include <base/Errors.h>
 #include <base/Panic.h>
-#include <base/col/SList.h>
 
 namespace kernel {
 
 /**
  * The key-value store is currently misused in some cases, just to make things
  * work, thus some functions are really untypical for a kv-store.
+ *
+ * Entries live inline in an open-addressing table (linear probing, kept at
+ * most 3/4 full), so put/get/exists/remove are O(1) expected and only a
+ * resize allocates. Keys have to be integers. Iteration order is unspecified
+ * and put() or remove() invalidate iterators.
  */
 template<typename KEY, class VALUE>
 class KVStore {
 private:
     struct Entry;
+    static const size_t MIN_SLOTS = 8;
+
+    template<class E, class S>
+    class Iter {
+    public:
+        explicit Iter(S *store = nullptr, size_t pos = 0) : _store(store), _pos(pos) {
+            skip();
+        }
+
+        E &operator*() const {
+            return _store->_slots[_pos];
+        }
+        E *operator->() const {
+            return &operator*();
+        }
+        Iter &operator++() {
+            _pos++;
+            skip();
+            return *this;
+        }
+        Iter operator++(int) {
+            Iter tmp(*this);
+            operator++();
+            return tmp;
+        }
+        bool operator==(const Iter &rhs) const {
+            return _pos == rhs._pos;
+        }
+        bool operator!=(const Iter &rhs) const {
+            return _pos != rhs._pos;
+        }
+
+    private:
+        void skip() {
+            while(_store && _pos < _store->_cap && !_store->_slots[_pos].used)
+                _pos++;
+        }
+
+        S *_store;
+        size_t _pos;
+    };
+
 public:
-    using iterator = typename m3::SList<Entry>::iterator;
-    using const_iterator = typename m3::SList<Entry>::const_iterator;
+    using iterator = Iter<Entry, KVStore>;
+    using const_iterator = Iter<const Entry, const KVStore>;
 
     class Updater {
     public:
-        Updater(KVStore &store, KEY &key, VALUE val) : _store(store), _key(key), _val(val){
+        Updater(KVStore &store, KEY key, VALUE val) : _store(store), _key(key), _val(val){
         }
 
         // Perform put when assignment happens
@@ -59,84 +106,83 @@ public:
 
     private:
         KVStore &_store;
-        KEY &_key;
+        KEY _key;
         VALUE _val;
     };
 
-    KVStore() : _store() {
+    KVStore() : _slots(nullptr), _cap(0), _count(0) {
     };
     KVStore(const KVStore &) = delete;
     KVStore &operator=(const KVStore &) = delete;
+    ~KVStore() {
+        delete[] _slots;
+    }
 
     m3::Errors::Code put(KEY key, VALUE val){
-        // check whether the key is already existing. If so, overwrite the existing entry
-        for(auto it = _store.begin(); it != _store.end(); it++){
-            if(it->id == key){
-                it->val = val;
-                return m3::Errors::NO_ERROR;
-            }
+        // overwrite the entry if the key exists already
+        Entry *e = find(key);
+        if(e) {
+            e->val = val;
+            return m3::Errors::NO_ERROR;
         }
-        // Create a new entry if key did not exist before
-        Entry *newEntry = new Entry(key, val);
-        _store.append(newEntry);
+        if((_count + 1) * 4 > _cap * 3)
+            grow();
+        insert(key, val);
         return m3::Errors::NO_ERROR;
     }
 
     VALUE get(KEY key) const {
-        auto find = _store.end();
-        for(auto it = _store.begin(); it != _store.end(); it++){
-            if(it->id == key){
-                find = it;
-                break;
-            }
-        }
+        const Entry *e = find(key);
         // TODO: is it right to panic here?
-        if(find == _store.end())
+        if(e == nullptr)
             PANIC("Did not find key " << key << " in KV Store!");
-        return find->val;
+        return e->val;
     }
 
     iterator begin() {
-        return _store.begin();
+        return iterator(this, 0);
     }
 
     iterator end() {
-        return _store.end();
+        return iterator(this, _cap);
     }
 
     const_iterator begin() const {
-        return _store.begin();
+        return const_iterator(this, 0);
     }
 
     const_iterator end() const {
-        return _store.end();
+        return const_iterator(this, _cap);
     }
 
     bool remove(KEY key) {
-        Entry *find = nullptr;
-        for(auto it = _store.begin(); it != _store.end(); it++){
-            if(it->id == key){
-                find = it.operator ->();
-                break;
-            }
-        }
-        if(find == nullptr)
+        Entry *e = find(key);
+        if(e == nullptr)
             return false;
 
-        return _store.remove(find);
+        // Backward-shift deletion: pull later members of the probe run into
+        // the hole, so lookups never need tombstones.
+        size_t mask = _cap - 1;
+        size_t hole = static_cast<size_t>(e - _slots);
+        for(size_t i = (hole + 1) & mask; _slots[i].used; i = (i + 1) & mask) {
+            size_t home = slot_of(_slots[i].id);
+            // move it if its home is not within (hole, i]
+            if(((i - home) & mask) >= ((i - hole) & mask)) {
+                _slots[hole] = _slots[i];
+                hole = i;
+            }
+        }
+        _slots[hole].used = false;
+        _count--;
+        return true;
     }
 
     bool exists(KEY key) const {
-        for(auto it = _store.begin(); it != _store.end(); it++){
-            if(it->id == key){
-                return true;
-            }
-        }
-        return false;
+        return find(key) != nullptr;
     }
 
-    unsigned int size() {
-        return _store.length();
+    unsigned int size() const {
+        return _count;
     }
 
     constexpr VALUE operator[](KEY pos) const {
@@ -148,13 +194,61 @@ public:
     }
 
 private:
-    struct Entry : public m3::SListItem {
-        explicit Entry(KEY key, VALUE value) : id(key), val(value){
+    struct Entry {
+        Entry() : id(), val(), used(false) {
         }
         KEY id;
         VALUE val;
+        bool used;
     };
 
-    m3::SList<Entry> _store;
+    size_t slot_of(KEY key) const {
+        // Fibonacci hashing: spreads sequential ids (the common case) evenly
+        uint64_t h = static_cast<uint64_t>(key) * 0x9E3779B97F4A7C15ULL;
+        return static_cast<size_t>(h >> 32) & (_cap - 1);
+    }
+
+    const Entry *find(KEY key) const {
+        if(_count == 0)
+            return nullptr;
+        size_t mask = _cap - 1;
+        for(size_t i = slot_of(key); _slots[i].used; i = (i + 1) & mask) {
+            if(_slots[i].id == key)
+                return &_slots[i];
+        }
+        return nullptr;
+    }
+    Entry *find(KEY key) {
+        return const_cast<Entry*>(static_cast<const KVStore*>(this)->find(key));
+    }
+
+    void insert(KEY key, VALUE val) {
+        size_t mask = _cap - 1;
+        size_t i = slot_of(key);
+        while(_slots[i].used)
+            i = (i + 1) & mask;
+        _slots[i].id = key;
+        _slots[i].val = val;
+        _slots[i].used = true;
+        _count++;
+    }
+
+    void grow() {
+        Entry *old = _slots;
+        size_t oldcap = _cap;
+
+        _cap = oldcap ? oldcap * 2 : MIN_SLOTS;
+        _slots = new Entry[_cap];
+        _count = 0;
+        for(size_t i = 0; i < oldcap; ++i) {
+            if(old[i].used)
+                insert(old[i].id, old[i].val);
+        }
+        delete[] old;
+    }
+
+    Entry *_slots;
+    size_t _cap;
+    size_t _count;
 };
 }
\ No newline at end of file
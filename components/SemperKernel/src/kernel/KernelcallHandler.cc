@@ -73,6 +73,8 @@ KernelcallHandler::KernelcallHandler()
     add_operation(Kernelcalls::MHTUNLOCK, &KernelcallHandler::mhtunlock);
     add_operation(Kernelcalls::MHTRESERVE, &KernelcallHandler::mhtreserve);
     add_operation(Kernelcalls::MHTRELEASE, &KernelcallHandler::mhtrelease);
+    add_operation(Kernelcalls::MHTBATCH, &KernelcallHandler::mhtBatch);
+    add_operation(Kernelcalls::MHTINVALIDATE, &KernelcallHandler::mhtInvalidate);
     add_operation(Kernelcalls::MEMBERUPDATE, &KernelcallHandler::membershipUpdate);
     add_operation(Kernelcalls::PARTITIONMIG, &KernelcallHandler::migratePartition);
     add_operation(Kernelcalls::CREATESESSFWD, &KernelcallHandler::createSessFwd);
@@ -142,13 +144,19 @@ void KernelcallHandler::kcreatevpe(GateIStream& is) {
             // TODO: adapt args to new interface
             VPE* nkvpe = nullptr;//PEManager::get().create(m3::Util::move(name), nullptr);
             if(nkvpe != nullptr){
-                reply_vmsg(is, Kernelcalls::KCREATEVPE, Kernelcalls::KREPLY, tid, true, (size_t)nkvpe->id());
+                StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, Kernelcalls::OpStage, int, bool,
+                    size_t>()> reply(Kernelcalls::ENCODING);
+                reply << Kernelcalls::KCREATEVPE << Kernelcalls::KREPLY << tid << true << (size_t)nkvpe->id();
+                is.reply(reply);
                 KLOG(KRNLC, "Created KVPE");
                 // TODO
                 // send args accordingly and start the VPE
             }
             else{
-                reply_vmsg(is, Kernelcalls::KCREATEVPE, Kernelcalls::KREPLY, tid, false);
+                StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, Kernelcalls::OpStage, int,
+                    bool>()> reply(Kernelcalls::ENCODING);
+                reply << Kernelcalls::KCREATEVPE << Kernelcalls::KREPLY << tid << false;
+                is.reply(reply);
                 KLOG(KRNLC, "Creating KVPE failed");
             }
             break;
@@ -182,6 +190,7 @@ void KernelcallHandler::mhtget(GateIStream& is) {
         LOG_KRNL(Coordinator::get().getKPE(is.label()),
                 "kernelcall::mhtget(KREQUEST, tid=" << tid << ", mht_key=" << PRINT_HASH(mht_key) << ")");
         const MHTItem& result = MHTInstance::getInstance().localGet(mht_key, false);
+        MHTInstance::getInstance().noteFetch(mht_key, is.label());
         Kernelcalls::get().mhtgetReply(Coordinator::get().getKPE(is.label()), tid, result);
     }
     else { // KREPLY
@@ -342,6 +351,32 @@ void KernelcallHandler::mhtrelease(GateIStream& is) {
     Kernelcalls::get().reply(Coordinator::get().getKPE(is.label()));
 }
 
+void KernelcallHandler::mhtBatch(GateIStream& is) {
+    Kernelcalls::OpStage stage;
+    int tid;
+    uint count;
+    is >> stage >> tid >> count;
+    KPE *kpe = Coordinator::get().getKPE(is.label());
+    if(stage == Kernelcalls::KREQUEST) {
+        LOG_KRNL(kpe, "kernelcall::mhtBatch(KREQUEST, tid=" << tid << ", count=" << count << ")");
+        MHTInstance::getInstance().batchRequest(is, tid, count);
+    }
+    else { // KREPLY
+        LOG_KRNL(kpe, "kernelcall::mhtBatch(KREPLY, tid=" << tid << ", count=" << count << ")");
+        kpe->msg_received();
+        MHTInstance::getInstance().batchReply(is, tid, count);
+    }
+}
+
+void KernelcallHandler::mhtInvalidate(GateIStream& is) {
+    mht_key_t mht_key;
+    is >> mht_key;
+    LOG_KRNL(Coordinator::get().getKPE(is.label()),
+            "kernelcall::mhtInvalidate(mht_key=" << PRINT_HASH(mht_key) << ")");
+    MHTInstance::getInstance().remoteCache().invalidate(mht_key);
+    Kernelcalls::get().reply(Coordinator::get().getKPE(is.label()));
+}
+
 void KernelcallHandler::membershipUpdate(GateIStream &is) {
     membership_entry::krnl_id_t krnlId;
     membership_entry::pe_id_t krnlCore;
@@ -448,13 +483,19 @@ void KernelcallHandler::createSessResp(GateIStream &is) {
         ", tid=" << tid << ", res=" << res << ")");
 
     if(res != m3::Errors::INV_ARGS) {
-        size_t sizeResult = m3::vostreamsize(m3::ostreamsize<label_t, m3::Errors::Code>(), is.remaining());
+        // the syscall handler reads the result in the default encoding
+        size_t sizeResult = m3::ostreamsize<label_t, m3::Errors::Code, word_t, mht_key_t>();
         void *resultBuf = m3::Heap::alloc(sizeResult);
         if(!resultBuf)
             PANIC("Not enough memory for result of service lookup");
         GateOStream *data = new GateOStream(static_cast<unsigned char*>(resultBuf), sizeResult);
         *data << sender << res;
-        data->put(is);
+        if(res == m3::Errors::NO_ERROR) {
+            word_t sess;
+            mht_key_t srvCap;
+            is >> sess >> srvCap;
+            *data << sess << srvCap;
+        }
         PEManager::get().vpe(vpeID).srvLookupResult(data);
     }
 
@@ -692,8 +733,15 @@ void KernelcallHandler::exchangeOverSessionReply(GateIStream &is) {
     LOG_KRNL(Coordinator::get().getKPE(is.label()), "kernelcall::exchangeOverSessionReply(tid=" <<
         tid << ", res=" << res << ")");
     if(res == m3::Errors::NO_ERROR) {
-        AutoGateOStream reply(is.remaining() + m3::ostreamsize<m3::Errors::Code, unsigned long int>());
-        reply << res << is.remaining();
+        // the syscall handler reads the reply in the default encoding, followed by the serialized caps
+        int repliertid;
+        m3::CapRngDesc::Type srvcapsType;
+        capsel_t srvcapsStart;
+        uint srvcapsCount;
+        is >> repliertid >> srvcapsType >> srvcapsStart >> srvcapsCount;
+        size_t size = m3::ostreamsize<int, m3::CapRngDesc::Type, capsel_t, uint>() + is.remaining();
+        AutoGateOStream reply(size + m3::ostreamsize<m3::Errors::Code, unsigned long int>());
+        reply << res << size << repliertid << srvcapsType << srvcapsStart << srvcapsCount;
         if(is.remaining())
             reply.put(is);
         m3::ThreadManager::get().notify(reinterpret_cast<void*>(tid),
@@ -820,7 +868,7 @@ void KernelcallHandler::announceSrv(GateIStream &is) {
  * a REVOKE kernelcall to this kernel. This handler:
  *
  *   1. Looks up the capability in the MHT
- *   2. If found: calls CapTable::revoke() which recurses into revoke_rec()
+ *   2. If found: calls CapTable::revoke() which runs revoke_rec()
  *   3. If not found (already revoked): checks RevocationList for in-flight revocation
  *      and subscribes if necessary
  *   4. If no outstanding remote sub-revocations: immediately sends revokeFinish(-1)
@@ -836,6 +884,9 @@ void KernelcallHandler::revoke(GateIStream &is) {
     LOG_KRNL(Coordinator::get().getKPE(is.label()), "kernelcall::revoke(capID=" <<
         PRINT_HASH(capID) << ", parent=" << PRINT_HASH(parent) << ", originCap="
         << PRINT_HASH(originCap) << ")");
+    // the sender revokes them, so drop our copies
+    MHTInstance::getInstance().remoteCache().invalidate(parent);
+    MHTInstance::getInstance().remoteCache().invalidate(originCap);
 
     int awaited = 0;
     const MHTItem &capIt = MHTInstance::getInstance().get(capID);
@@ -869,9 +920,9 @@ void KernelcallHandler::revoke(GateIStream &is) {
  *
  * Same semantics as revoke() but processes multiple capIDs from one message. All
  * children targeted at this kernel are batched together by CapTable::revoke_rec().
- * If all sub-revocations complete synchronously, sends a single revokeFinish with
- * awaits = -count (decrements parent's counter by the batch size). Otherwise sends
- * only a reply; individual revokeFinish messages propagate as sub-revocations complete.
+ * The sub-revocations that complete synchronously are acknowledged together with a
+ * single revokeFinish (awaits = -number of them) that also serves as the reply. If
+ * none did, only a reply is sent. The others send their own revokeFinish once done.
  */
 void KernelcallHandler::revokeBatch(GateIStream &is) {
     mht_key_t parent, originCap;
@@ -880,8 +931,10 @@ void KernelcallHandler::revokeBatch(GateIStream &is) {
     LOG_KRNL(Coordinator::get().getKPE(is.label()), "kernelcall::revokeBatch(parent=" <<
         PRINT_HASH(parent) << ", originCap=" << PRINT_HASH(originCap) <<
         ", count=" << count << ")");
+    MHTInstance::getInstance().remoteCache().invalidate(parent);
+    MHTInstance::getInstance().remoteCache().invalidate(originCap);
 
-    int totalAwaited = 0;
+    int finished = 0;
     for(uint i = 0; i < count; i++) {
         mht_key_t capID;
         is >> capID;
@@ -900,11 +953,12 @@ void KernelcallHandler::revokeBatch(GateIStream &is) {
                 awaited = PEManager::get().vpe(HashUtil::hashToVpeId(capID)).objcaps().revoke(
                     nullptr, capID, originCap);
         }
-        totalAwaited += awaited;
+        if(!awaited)
+            finished++;
     }
 
-    if(!totalAwaited)
-        Kernelcalls::get().revokeFinish(Coordinator::get().getKPE(is.label()), parent, -static_cast<int>(count), true);
+    if(finished)
+        Kernelcalls::get().revokeFinish(Coordinator::get().getKPE(is.label()), parent, -finished, true);
     else
         Kernelcalls::get().reply(Coordinator::get().getKPE(is.label()));
 }
@@ -59,6 +59,7 @@ public:
     void handle_message(GateIStream &msg, m3::Subscriber<GateIStream&> *) {
         EVENT_TRACER_handle_message();
         Kernelcalls::Operation op;
+        msg.encoding(Kernelcalls::ENCODING);
         msg >> op;
         if(static_cast<size_t>(op) < sizeof(_callbacks) / sizeof(_callbacks[0])) {
             (this->*_callbacks[op])(msg);
@@ -133,6 +134,8 @@ public:
     void mhtunlock(GateIStream &is);
     void mhtreserve(GateIStream &is);
     void mhtrelease(GateIStream &is);
+    void mhtBatch(GateIStream &is);
+    void mhtInvalidate(GateIStream &is);
     void membershipUpdate(GateIStream &is);
     void migratePartition(GateIStream &is);
     void createSessFwd(GateIStream &is);
@@ -25,6 +25,7 @@
 #include "Kernelcalls.h"
 #include "KernelcallHandler.h"
 #include "Coordinator.h"
+#include "ddl/MHTInstance.h"
 
 namespace kernel {
 
@@ -38,7 +39,7 @@ m3::Errors::Code Kernelcalls::finish(GateIStream &&reply) {
 void Kernelcalls::sigvital(KPE* kernel, int creatorThread, m3::Errors::Code err) {
     KLOG_V(KRNLC, "sigvital(kernel=" << kernel->core() << ", creatorThread=" << creatorThread <<
         ", err=" << (int)err << ")");
-    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, int, m3::Errors::Code>()> msg;
+    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, int, m3::Errors::Code>()> msg(ENCODING);
     msg << SIGVITAL << creatorThread << err;
     kernel->reply(msg.bytes(), msg.total());
     }
@@ -47,7 +48,7 @@ m3::Errors::Code Kernelcalls::kcreatevpe(KPE* kernel, OpStage stage, m3::String&
     KLOG_V(KRNLC, "kcreatevpe(kernel=" << kernel->core() << ", stage=" << stage << ", name=" << name << ", core=" << core << ")");
     AutoGateOStream msg(m3::vostreamsize(
             m3::ostreamsize<Kernelcalls::Operation, Kernelcalls::OpStage, int, size_t, size_t>(),
-            name.length(), strlen(core)));
+            name.length(), strlen(core)), ENCODING);
     msg << KCREATEVPE << stage << tid << name << core;
     if(stage == Kernelcalls::OpStage::KREPLY)
         kernel->reply(msg.bytes(), msg.total());
@@ -59,7 +60,7 @@ m3::Errors::Code Kernelcalls::kcreatevpe(KPE* kernel, OpStage stage, m3::String&
 
 void Kernelcalls::kexit(KPE* kernel, int exitcode) {
     KLOG_V(KRNLC, "kexit(code=" << exitcode << ")");
-    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, int>()> msg;
+    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, int>()> msg(ENCODING);
     msg << KEXIT << exitcode;
     kernel->sendTo(msg.bytes(), msg.total());
     return;
@@ -69,7 +70,7 @@ void Kernelcalls::mhtRequest(KPE* kernel, mht_key_t mht_key, Operation op) {
     int tid = m3::ThreadManager::get().current()->id();
     KLOG_V(KRNLC, "mhtrequest(kernelcore=" << kernel->core() << ", tid=" << tid <<
             ", mht_key=" << PRINT_HASH(mht_key) << ", op=" << op << ")");
-    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, Kernelcalls::OpStage, mht_key_t, int>()> msg;
+    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, Kernelcalls::OpStage, mht_key_t, int>()> msg(ENCODING);
     msg << op << KREQUEST << tid << mht_key;
     kernel->sendTo(msg.bytes(), msg.total());
 }
@@ -82,7 +83,7 @@ void Kernelcalls::mhtForward(KPE* kernel, int tid, membership_entry::krnl_id_t d
     // condition where the destination kernel's reply arrives before the
     // KFORWARD message.
     StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, Kernelcalls::OpStage,
-            membership_entry::krnl_id_t, int, mht_key_t>()> msg;
+            membership_entry::krnl_id_t, int, mht_key_t>()> msg(ENCODING);
     msg << op << KFORWARD << tid << dest << mht_key;
     kernel->sendTo(msg.bytes(), msg.total());
 }
@@ -90,7 +91,7 @@ void Kernelcalls::mhtForward(KPE* kernel, int tid, membership_entry::krnl_id_t d
 void Kernelcalls::mhtgetLocking(KPE* kernel, mht_key_t mht_key) {
     int tid = m3::ThreadManager::get().current()->id();
     KLOG_V(KRNLC, "mhtgetLocking(kernelcore=" << kernel->core() << ", tid=" << tid << ", mht_key=" << PRINT_HASH(mht_key) << ")");
-    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, Kernelcalls::OpStage, mht_key_t, int>()> msg;
+    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, Kernelcalls::OpStage, mht_key_t, int>()> msg(ENCODING);
     msg << MHTGETLOCKING << KREQUEST << tid << mht_key;
     kernel->sendTo(msg.bytes(), msg.total());
 }
@@ -100,7 +101,7 @@ void Kernelcalls::mhtgetReply(KPE* kernel, int tid, const MHTItem& result) {
             "result.key=" << PRINT_HASH(result.getKey()) << ", result.length=" << result.getLength() << ")");
     AutoGateOStream msg(m3::vostreamsize(
             m3::ostreamsize<Kernelcalls::Operation, Kernelcalls::OpStage, int>(),
-            result.serializedSize()));
+            result.serializedSize()), ENCODING);
     msg << MHTGET << KREPLY << tid;
     result.serialize(msg);
     kernel->reply(msg.bytes(), msg.total());
@@ -111,7 +112,7 @@ void Kernelcalls::mhtput(KPE* kernel, MHTItem&& input) {
             "input.key=" << PRINT_HASH(input.getKey()) << ", input.length=" << input.getLength() << ")");
     AutoGateOStream msg(m3::vostreamsize(
             m3::ostreamsize<Kernelcalls::Operation>(),
-            input.serializedSize()));
+            input.serializedSize()), ENCODING);
     msg << MHTPUT;
     input.serialize(msg);
     kernel->sendTo(msg.bytes(), msg.total());
@@ -123,7 +124,7 @@ void Kernelcalls::mhtputUnlocking(KPE* kernel, MHTItem&& input, uint lockHandle)
         ", lockHandle=" << lockHandle << ")");
     AutoGateOStream msg(m3::vostreamsize(
             m3::ostreamsize<Kernelcalls::Operation, uint>(),
-            input.serializedSize()));
+            input.serializedSize()), ENCODING);
     msg << MHTPUT << lockHandle;
     input.serialize(msg);
     kernel->sendTo(msg.bytes(), msg.total());
@@ -131,7 +132,7 @@ void Kernelcalls::mhtputUnlocking(KPE* kernel, MHTItem&& input, uint lockHandle)
 
 void Kernelcalls::mhtlockReply(KPE* kernel, int tid, uint lockHndl) {
     KLOG_V(KRNLC, "mhtlockReply(kernelcore=" << kernel->core() << ", tid=" << tid << ", lockHndl=" << lockHndl << ")");
-    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, Kernelcalls::OpStage, int, uint>()> msg;
+    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, Kernelcalls::OpStage, int, uint>()> msg(ENCODING);
     msg << MHTLOCK << KREPLY << tid << lockHndl;
     kernel->reply(msg.bytes(), msg.total());
 }
@@ -139,7 +140,7 @@ void Kernelcalls::mhtlockReply(KPE* kernel, int tid, uint lockHndl) {
 void Kernelcalls::mhtunlock(KPE* kernel, mht_key_t mht_key, uint lockHandle) {
     KLOG_V(KRNLC, "mhtunlock(kernelcore=" << kernel->core() << ", mht_key="
             << PRINT_HASH(mht_key) << ", lockHndl=" << lockHandle << ")");
-    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, mht_key_t, uint>()> msg;
+    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, mht_key_t, uint>()> msg(ENCODING);
     msg << MHTUNLOCK << mht_key << lockHandle;
     kernel->sendTo(msg.bytes(), msg.total());
 }
@@ -147,7 +148,7 @@ void Kernelcalls::mhtunlock(KPE* kernel, mht_key_t mht_key, uint lockHandle) {
 void Kernelcalls::mhtReserveReply(KPE* kernel, int tid, uint reservationNr) {
     KLOG_V(KRNLC, "mhtReserveReply(kernelcore=" << kernel->core() << ", tid=" << tid <<
             ", reservationNr=" << reservationNr << ")");
-    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, Kernelcalls::OpStage, int, uint>()> msg;
+    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, Kernelcalls::OpStage, int, uint>()> msg(ENCODING);
     msg << MHTRESERVE << KREPLY << tid << reservationNr;
     kernel->reply(msg.bytes(), msg.total());
 }
@@ -155,18 +156,51 @@ void Kernelcalls::mhtReserveReply(KPE* kernel, int tid, uint reservationNr) {
 void Kernelcalls::mhtRelease(KPE* kernel, mht_key_t mht_key, uint reservation) {
     KLOG_V(KRNLC, "mhtrelease(kernelcore=" << kernel->core() << ", mht_key="
             << PRINT_HASH(mht_key) << ", reservation=" << reservation << ")");
-    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, mht_key_t, uint>()> msg;
+    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, mht_key_t, uint>()> msg(ENCODING);
     msg << MHTRELEASE << mht_key << reservation;
     kernel->sendTo(msg.bytes(), msg.total());
 }
 
+void Kernelcalls::mhtBatch(KPE* kernel, uint count, AutoGateOStream &ops) {
+    int tid = m3::ThreadManager::get().current()->id();
+    KLOG_V(KRNLC, "mhtBatch(kernelcore=" << kernel->core() << ", tid=" << tid <<
+            ", count=" << count << ", size=" << ops.total() << ")");
+    assert(ops.total() <= MAX_MHT_BATCH_PAYLOAD);
+    AutoGateOStream msg(m3::vostreamsize(
+        m3::ostreamsize<Kernelcalls::Operation, Kernelcalls::OpStage, int, uint>(),
+        ops.total()), ENCODING);
+    msg << MHTBATCH << KREQUEST << tid << count;
+    msg.put(ops);
+    kernel->sendTo(msg.bytes(), msg.total());
+}
+
+void Kernelcalls::mhtBatchReply(KPE* kernel, int tid, uint count, AutoGateOStream &results) {
+    KLOG_V(KRNLC, "mhtBatchReply(kernelcore=" << kernel->core() << ", tid=" << tid <<
+            ", count=" << count << ", size=" << results.total() << ")");
+    assert(results.total() <= MAX_MHT_BATCH_PAYLOAD);
+    AutoGateOStream msg(m3::vostreamsize(
+        m3::ostreamsize<Kernelcalls::Operation, Kernelcalls::OpStage, int, uint>(),
+        results.total()), ENCODING);
+    msg << MHTBATCH << KREPLY << tid << count;
+    msg.put(results);
+    kernel->reply(msg.bytes(), msg.total());
+}
+
+void Kernelcalls::mhtInvalidate(KPE* kernel, mht_key_t mht_key) {
+    KLOG_V(KRNLC, "mhtInvalidate(kernelcore=" << kernel->core() << ", mht_key="
+            << PRINT_HASH(mht_key) << ")");
+    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, mht_key_t>()> msg(ENCODING);
+    msg << MHTINVALIDATE << mht_key;
+    kernel->sendTo(msg.bytes(), msg.total());
+}
+
 void Kernelcalls::membershipUpdate(KPE *kernel, m3::PEDesc releasedPEs[], uint numPEs,
     membership_entry::krnl_id_t krnl, membership_entry::pe_id_t krnlCore, MembershipFlags flags) {
     KLOG_V(KRNLC, "membershipUpdate(kernelcore=" << kernel->core() << ", pes=[...], numPEs="
         << numPEs << ", kernel=" << krnl << ", kernelCore=" << krnlCore << ", flags=" << (int)flags << ")");
     AutoGateOStream msg(m3::vostreamsize(
         m3::ostreamsize<Kernelcalls::Operation, uint, size_t, membership_entry::krnl_id_t, MembershipFlags>(),
-        numPEs * m3::ostreamsize<m3::PEDesc::value_t>()));
+        numPEs * m3::ostreamsize<m3::PEDesc::value_t>()), ENCODING);
     msg << MEMBERUPDATE << krnl << krnlCore << flags << numPEs;
     for(size_t i = 0; i < numPEs; i++) {
         msg << releasedPEs[i].value();
@@ -178,7 +212,7 @@ void Kernelcalls::migratePartition(KPE *kernel, AutoGateOStream &payload) {
     KLOG_V(KRNLC, "migratePartition(kernelcore=" << kernel->core() << ", size=" << payload.total() << ")");
     AutoGateOStream msg(m3::vostreamsize(
         m3::ostreamsize<Kernelcalls::Operation>(),
-        payload.total()));
+        payload.total()), ENCODING);
     msg << PARTITIONMIG;
     msg.put(payload);
     kernel->sendTo(msg.bytes(), msg.total());
@@ -189,7 +223,7 @@ void Kernelcalls::createSessFwd(KPE *kernel, int vpeID, m3::String &srvname, mht
         srvname << ", cap=" << PRINT_HASH(cap) << ", argsSize=" << args.total() << ")");
     AutoGateOStream msg(m3::vostreamsize(
         m3::ostreamsize<Kernelcalls::Operation, int, size_t, mht_key_t, int>(),
-        srvname.length(), args.total()));
+        srvname.length(), args.total()), ENCODING);
     int tid = m3::ThreadManager::get().current()->id();
     msg << CREATESESSFWD << vpeID << srvname << cap << tid;
     msg.put(args);
@@ -202,12 +236,12 @@ void Kernelcalls::createSessResp(KPE *kernel, int vpeID, int tid, m3::Errors::Co
         tid << ", res=" << res << ", sess=" << sess << ", srvCap=" << PRINT_HASH(srvCap) << ")");
     if(res == m3::Errors::NO_ERROR){
         StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, int, int, m3::Errors::Code,
-            word_t, mht_key_t>()> msg;
+            word_t, mht_key_t>()> msg(ENCODING);
         msg << CREATESESSRESP << vpeID << tid << res << sess << srvCap;
         kernel->reply(msg.bytes(), msg.total());
     }
     else {
-        StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, int, int, m3::Errors::Code>()> msg;
+        StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, int, int, m3::Errors::Code>()> msg(ENCODING);
         msg << CREATESESSRESP << vpeID << tid << res;
         kernel->reply(msg.bytes(), msg.total());
     }
@@ -216,7 +250,7 @@ void Kernelcalls::createSessResp(KPE *kernel, int vpeID, int tid, m3::Errors::Co
 void Kernelcalls::createSessFail(KPE *kernel, mht_key_t cap, mht_key_t srvCap) {
     KLOG_V(KRNLC, "createSessFail(kernelcore=" << kernel->core() << ", cap=" << PRINT_HASH(cap) <<
         ", srvCap=" << PRINT_HASH(srvCap) << ")");
-    StaticGateOStream<m3::ostreamsize<mht_key_t, mht_key_t>()> msg;
+    StaticGateOStream<m3::ostreamsize<mht_key_t, mht_key_t>()> msg(ENCODING);
     msg << cap << srvCap;
     kernel->sendTo(msg.bytes(), msg.total());
 }
@@ -230,7 +264,7 @@ void Kernelcalls::exchangeOverSession(KPE *kernel, bool obtain, mht_key_t vpe, m
     AutoGateOStream msg(m3::vostreamsize(
         m3::ostreamsize<Kernelcalls::Operation, int, bool, mht_key_t, mht_key_t, word_t,
         m3::CapRngDesc::Type, capsel_t, uint>(),
-        args.total()));
+        args.total()), ENCODING);
     int tid = m3::ThreadManager::get().current()->id();
     msg << EXCHANGEOSESS << tid << obtain << vpe << srvID << sessID << caps.type() <<
         caps.start() << caps.count();
@@ -245,7 +279,7 @@ void Kernelcalls::exchangeOverSessionReply(KPE *kernel, int tid, m3::Errors::Cod
     CAP_BENCH_TRACE_X_F(KERNEL_OBT_FROM_RKERNEL);
     if(res == m3::Errors::NO_ERROR){
         AutoGateOStream msg(m3::vostreamsize(m3::ostreamsize<Kernelcalls::Operation, int, int,
-            m3::Errors::Code, m3::CapRngDesc::Type, capsel_t, uint>(), args.total()));
+            m3::Errors::Code, m3::CapRngDesc::Type, capsel_t, uint>(), args.total()), ENCODING);
         int mytid = m3::ThreadManager::get().current()->id();
         msg << EXCHANGEOSESSREPLY << tid << res << mytid << srvcaps.type() <<
             srvcaps.start() << srvcaps.count();
@@ -254,7 +288,7 @@ void Kernelcalls::exchangeOverSessionReply(KPE *kernel, int tid, m3::Errors::Cod
         kernel->reply(msg.bytes(), msg.total());
     }
     else {
-        StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, int, m3::Errors::Code>()> msg;
+        StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, int, m3::Errors::Code>()> msg(ENCODING);
         msg << EXCHANGEOSESSREPLY << tid << res;
         kernel->reply(msg.bytes(), msg.total());
     }
@@ -263,7 +297,7 @@ void Kernelcalls::exchangeOverSessionReply(KPE *kernel, int tid, m3::Errors::Cod
 void Kernelcalls::exchangeOverSessionAck(KPE *kernel, int tid, m3::Errors::Code res) {
     KLOG_V(KRNLC, "exchangeOverSessionAck(kernelcore=" << kernel->core() << ", tid=" << tid <<
         ", res=" << res << ")");
-    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, int, m3::Errors::Code>()> msg;
+    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, int, m3::Errors::Code>()> msg(ENCODING);
     msg << EXCHANGEOSESSACK << tid << res;
     kernel->sendTo(msg.bytes(), msg.total());
 }
@@ -274,7 +308,7 @@ void Kernelcalls::exchangeOverSessionAck(KPE *kernel, int tid, m3::Errors::Code
         ", res=" << res << ", capDataSize=" << capData.total() << ")");
     AutoGateOStream msg(m3::vostreamsize(
         m3::ostreamsize<Kernelcalls::Operation, int, m3::Errors::Code>(),
-        capData.total()));
+        capData.total()), ENCODING);
     msg << EXCHANGEOSESSACK << tid << res;
     if(capData.total())
         msg.put(capData);
@@ -286,7 +320,7 @@ void Kernelcalls::removeChildCapPtr(KPE *kernel, DDLCapRngDesc parents, DDLCapRn
         PRINT_HASH(parents.start) << ", count=" << parents.count << ", capsstart=" <<
         PRINT_HASH(caps.start) << ", count=" << caps.count << ")");
     StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, mht_key_t, uint, mht_key_t,
-        uint>()> msg;
+        uint>()> msg(ENCODING);
     msg << REMOVECHILDCAPPTR << parents.start << parents.count << caps.start << caps.count;
     kernel->sendTo(msg.bytes(), msg.total());
 }
@@ -294,7 +328,7 @@ void Kernelcalls::removeChildCapPtr(KPE *kernel, DDLCapRngDesc parents, DDLCapRn
 void Kernelcalls::recvBufisAttached(KPE *kernel, int core, int epid) {
     KLOG_V(KRNLC, "recvBufAttached(kernelcore=" << kernel->core() << ", core=" <<
         core << ", epid=" << epid << ")");
-    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, int, int, int>()> msg;
+    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, int, int, int>()> msg(ENCODING);
     int mytid = m3::ThreadManager::get().current()->id();
     msg << RECVBUFISATTACHED << mytid << core << epid;
     kernel->sendTo(msg.bytes(), msg.total());
@@ -303,7 +337,7 @@ void Kernelcalls::recvBufisAttached(KPE *kernel, int core, int epid) {
 void Kernelcalls::recvBufAttached(KPE *kernel, int tid, m3::Errors::Code res) {
     KLOG_V(KRNLC, "recvBufAttached(kernelcore=" << kernel->core() << ", tid=" << tid <<
         ", res=" << res << ")");
-    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, int, m3::Errors::Code>()> msg;
+    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, int, m3::Errors::Code>()> msg(ENCODING);
     msg << RECVBUFATTACHED<< tid << res;
     kernel->reply(msg.bytes(), msg.total());
 }
@@ -313,38 +347,41 @@ void Kernelcalls::announceSrv(KPE *kernel, mht_key_t id, const m3::String &name)
         ", name=" << name << ")");
     AutoGateOStream msg(m3::vostreamsize(
         m3::ostreamsize<Kernelcalls::Operation, size_t, mht_key_t>(),
-        name.length()));
+        name.length()), ENCODING);
     msg << ANNOUNCESRV << id << name;
     kernel->sendTo(msg.bytes(), msg.total());
 }
 
-void Kernelcalls::revoke(KPE *kernel, mht_key_t capID, mht_key_t parent, mht_key_t originCap) {
+m3::Errors::Code Kernelcalls::revoke(KPE *kernel, mht_key_t capID, mht_key_t parent, mht_key_t originCap) {
     KLOG_V(KRNLC, "revoke(kernelcore=" << kernel->core() << ", capID=" << PRINT_HASH(capID) <<
         ", parent=" << PRINT_HASH(parent) << ", originCap=" << PRINT_HASH(capID) << ")");
     CAP_BENCH_TRACE_X_S(KERNEL_REV_TO_RKERNEL);
-    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, mht_key_t, mht_key_t, mht_key_t>()> msg;
+    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, mht_key_t, mht_key_t, mht_key_t>()> msg(ENCODING);
     msg << REVOKE << capID << parent << originCap;
-    kernel->sendRevocationTo(msg.bytes(), msg.total());
+    MHTInstance::getInstance().remoteCache().invalidate(capID);
+    return kernel->sendRevocationTo(msg.bytes(), msg.total());
 }
 
-void Kernelcalls::revokeBatch(KPE *kernel, mht_key_t parent, mht_key_t originCap,
+m3::Errors::Code Kernelcalls::revokeBatch(KPE *kernel, mht_key_t parent, mht_key_t originCap,
     const mht_key_t *capIDs, uint count) {
     KLOG_V(KRNLC, "revokeBatch(kernelcore=" << kernel->core() << ", parent=" << PRINT_HASH(parent) <<
         ", originCap=" << PRINT_HASH(originCap) << ", count=" << count << ")");
     CAP_BENCH_TRACE_X_S(KERNEL_REV_TO_RKERNEL);
     AutoGateOStream msg(m3::vostreamsize(
         m3::ostreamsize<Kernelcalls::Operation, mht_key_t, mht_key_t, uint>(),
-        count * m3::ostreamsize<mht_key_t>()));
+        count * m3::ostreamsize<mht_key_t>()), ENCODING);
     msg << REVOKEBATCH << parent << originCap << count;
-    for(uint i = 0; i < count; i++)
+    for(uint i = 0; i < count; i++) {
         msg << capIDs[i];
-    kernel->sendRevocationTo(msg.bytes(), msg.total());
+        MHTInstance::getInstance().remoteCache().invalidate(capIDs[i]);
+    }
+    return kernel->sendRevocationTo(msg.bytes(), msg.total());
 }
 
 void Kernelcalls::revokeFinish(KPE *kernel, mht_key_t initiator, int awaits, bool includeReply) {
     KLOG_V(KRNLC, "revokeFinish(kernelcore=" << kernel->core() << ", initiator=" << PRINT_HASH(initiator) <<
         ", addedAwaits=" << awaits << ", includeReply=" << (includeReply ? "y" : "n") << ")");
-    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, mht_key_t, int, bool>()> msg;
+    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, mht_key_t, int, bool>()> msg(ENCODING);
     msg << REVOKEFINISH << initiator << awaits << includeReply;
     kernel->sendRevocationTo(msg.bytes(), msg.total());
 }
@@ -352,7 +389,7 @@ void Kernelcalls::revokeFinish(KPE *kernel, mht_key_t initiator, int awaits, boo
 void Kernelcalls::requestShutdown(KPE *kernel, OpStage stage) {
     KLOG_V(KRNLC, "requestShutdown(kernelcore=" << kernel->core() << ", stage=" <<
         (stage == OpStage::KREQUEST ? "reque" : "reply") << ")");
-    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, OpStage>()> msg;
+    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, OpStage>()> msg(ENCODING);
     msg << SHUTDOWNREQUEST << stage;
     if(stage == OpStage::KREPLY) {
         Coordinator::get().shutdownRequests--;
@@ -365,7 +402,7 @@ void Kernelcalls::requestShutdown(KPE *kernel, OpStage stage) {
 void Kernelcalls::shutdown(KPE *kernel, OpStage stage) {
     KLOG_V(KRNLC, "shutdown(kernelcore=" << kernel->core() << ", stage=" <<
         (stage == OpStage::KREQUEST ? "reque" : "reply") << ")");
-    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, OpStage>()> msg;
+    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, OpStage>()> msg(ENCODING);
     msg << SHUTDOWN << stage;
     if(stage == Kernelcalls::OpStage::KREPLY)
         kernel->reply(msg.bytes(), msg.total());
@@ -379,7 +416,7 @@ void Kernelcalls::announceKrnls(KPE* kernel, membership_entry::krnl_id_t excepti
     uint amount = coord._kpes.size();
     AutoGateOStream msg(m3::vostreamsize(
         m3::ostreamsize<Kernelcalls::Operation, uint>(),
-        m3::ostreamsize<membership_entry::krnl_id_t, membership_entry::pe_id_t>() * amount));
+        m3::ostreamsize<membership_entry::krnl_id_t, membership_entry::pe_id_t>() * amount), ENCODING);
     msg << ANNOUNCEKRNLS << amount;
     for(auto it = coord._kpes.begin(); it != coord._kpes.end(); it++)
         if(it->val->id() != exception)
@@ -402,7 +439,7 @@ void Kernelcalls::connect(membership_entry::krnl_id_t kid, membership_entry::pe_
     AutoGateOStream msg(m3::vostreamsize(
         m3::ostreamsize<Kernelcalls::Operation, OpStage, membership_entry::krnl_id_t,
         membership_entry::pe_id_t, int, MembershipFlags, uint>(),
-        numPEs * m3::ostreamsize<m3::PEDesc::value_t>()));
+        numPEs * m3::ostreamsize<m3::PEDesc::value_t>()), ENCODING);
     msg << CONNECT << stage << myKid << myCore << epid << flags << numPEs;
     for(size_t i = 0; i < numPEs; i++)
         msg << releasedPEs[i].value();
@@ -420,7 +457,7 @@ void Kernelcalls::connect(KPE *kernel, OpStage stage, membership_entry::krnl_id_
         (stage == OpStage::KREQUEST ? "reque" : "reply") << ", epid=" << epid << ")");
 
     StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation, OpStage, membership_entry::krnl_id_t,
-        membership_entry::pe_id_t, int>()> msg;
+        membership_entry::pe_id_t, int>()> msg(ENCODING);
     msg << CONNECT << stage << myKid << myCore << epid;
 
     kernel->reply(msg.bytes(), msg.total());
@@ -428,14 +465,14 @@ void Kernelcalls::connect(KPE *kernel, OpStage stage, membership_entry::krnl_id_
 
 void Kernelcalls::reply(KPE* kernel) {
     KLOG_V(KRNLC, "reply(kernel=" << kernel->core() << ")");
-    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation>()> msg;
+    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation>()> msg(ENCODING);
     msg << REPLYKRNLC;
     kernel->reply(msg.bytes(), msg.total());
 }
 
 void Kernelcalls::startApps(KPE* kernel) {
     KLOG_V(KRNLC, "startApps(kernel=" << kernel->core() << ")");
-    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation>()> msg;
+    StaticGateOStream<m3::ostreamsize<Kernelcalls::Operation>()> msg(ENCODING);
     msg << STARTAPPS;
     kernel->sendTo(msg.bytes(), msg.total());
 }
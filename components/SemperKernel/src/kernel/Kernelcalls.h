@@ -25,6 +25,8 @@
 
 #include "Gate.h"
 #include "ddl/MHTTypes.h"
+#include "vdtu_channels.h"
+#include "vdtu_net.h"
 
 namespace kernel {
 
@@ -32,7 +34,9 @@ class KPE;
 
 class Kernelcalls {
 public:
-    static constexpr size_t MSG_SIZE         = 2048;
+    // The KRNLC rings are packed into their dataports, which caps a message
+    // (header included) a bit below the 2 KiB slots of MSG_ORD
+    static constexpr size_t MSG_SIZE         = VDTU_CHANNEL_PACKED_MAX_MSG;
     static constexpr size_t MSG_ORD   = m3::nextlog2<MSG_SIZE>::val;
 
     enum Operation {
@@ -49,6 +53,8 @@ public:
         MHTREMOVE, // TODO
         MHTRESERVE,
         MHTRELEASE,
+        MHTBATCH,
+        MHTINVALIDATE,
         MEMBERUPDATE,
         PARTITIONMIG,
         CREATESESSFWD,
@@ -79,6 +85,26 @@ public:
         KFORWARD
     };
 
+    // Kernels only talk to kernels here, so the messages don't need the word layout of syscalls.
+    // Raw blobs that are passed through (e.g. service arguments) keep the encoding they came with.
+#if KRNLC_COMPACT
+    static constexpr m3::Marshaller::Encoding ENCODING = m3::Marshaller::COMPACT;
+#else
+    static constexpr m3::Marshaller::Encoding ENCODING = m3::Marshaller::WORDS;
+#endif
+
+    // Largest payload that fits both the KRNLC ring and a message of the DTUBridge, which
+    // carries all messages to kernels on other nodes (see net_ring_send())
+    static constexpr size_t MAX_PAYLOAD = m3::Math::min<size_t>(
+        MSG_SIZE - m3::DTU::HEADER_SIZE - 1, VDTU_NET_MAX_PAYLOAD);
+
+    // Most capIDs a revokeBatch message carries without exceeding MAX_PAYLOAD
+    static constexpr uint MAX_REVOKE_BATCH = (MAX_PAYLOAD -
+        m3::ostreamsize<Operation, mht_key_t, mht_key_t, uint>()) / sizeof(mht_key_t);
+    // Payload an mhtBatch message or its reply may carry besides the header
+    static constexpr size_t MAX_MHT_BATCH_PAYLOAD = MAX_PAYLOAD -
+        m3::ostreamsize<Operation, OpStage, int, uint>();
+
     static Kernelcalls &get() {
         return _inst;
     }
@@ -123,6 +149,13 @@ public:
     // Note: releasing is not acknowledged
     void mhtRelease(KPE* kernel, mht_key_t mht_key, uint reservation);
 
+    // Several gets and puts in one message; <ops> holds <count> operations of MHTBatch
+    void mhtBatch(KPE* kernel, uint count, AutoGateOStream &ops);
+    void mhtBatchReply(KPE* kernel, int tid, uint count, AutoGateOStream &results);
+
+    // Tells a kernel that fetched <mht_key> that it has been revoked
+    void mhtInvalidate(KPE* kernel, mht_key_t mht_key);
+
     void membershipUpdate(KPE *kernel, m3::PEDesc releasedPEs[], uint numPEs,
         membership_entry::krnl_id_t krnl, membership_entry::pe_id_t krnlCore, MembershipFlags flags);
 
@@ -147,8 +180,8 @@ public:
 
     void announceSrv(KPE *kernel, mht_key_t id, const m3::String &name);
 
-    void revoke(KPE *kernel, mht_key_t capID, mht_key_t parent, mht_key_t originCap);
-    void revokeBatch(KPE *kernel, mht_key_t parent, mht_key_t originCap,
+    m3::Errors::Code revoke(KPE *kernel, mht_key_t capID, mht_key_t parent, mht_key_t originCap);
+    m3::Errors::Code revokeBatch(KPE *kernel, mht_key_t parent, mht_key_t originCap,
         const mht_key_t *capIDs, uint count);
     void revokeFinish(KPE *kernel, mht_key_t initiator, int awaits, bool includeReply);
 
@@ -22,11 +22,12 @@
 #include <base/Heap.h>
 
 #include "Gate.h"
+#include "mem/SlabCache.h"
 
 namespace kernel {
 
 class SendQueue {
-    struct Entry : public m3::SListItem {
+    struct Entry : public SlabObject<Entry>, public m3::SListItem {
         explicit Entry(RecvGate *_rgate, SendGate *_sgate, const void *_msg, size_t _size)
             : SListItem(), rgate(_rgate), sgate(_sgate), msg(_msg), size(_size) {
         }
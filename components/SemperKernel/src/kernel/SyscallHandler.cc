@@ -145,6 +145,8 @@ SyscallHandler::SyscallHandler() : _serv_ep(DTU::get().alloc_ep()) {
     add_operation(m3::KIF::Syscall::REVOKE, &SyscallHandler::revoke);
     add_operation(m3::KIF::Syscall::EXIT, &SyscallHandler::exit);
     add_operation(m3::KIF::Syscall::NOOP, &SyscallHandler::noop);
+    add_operation(m3::KIF::Syscall::EXCHANGEV, &SyscallHandler::exchangev);
+    add_operation(m3::KIF::Syscall::REVOKEV, &SyscallHandler::revokev);
 #if defined(__host__)
     add_operation(m3::KIF::Syscall::COUNT, &SyscallHandler::init);
 #endif
@@ -595,6 +597,45 @@ void SyscallHandler::exchange(GateIStream &is) {
 #endif
 }
 
+/**
+ * Vectored exchange: like exchange, but for up to MAX_XCHG_RANGES (own, other) pairs with the
+ * same VPE in one syscall. Every pair is exchanged on its own, so a failing pair does not stop
+ * the others. The reply carries NO_ERROR, the number of pairs and the result of each pair.
+ */
+void SyscallHandler::exchangev(GateIStream &is) {
+    EVENT_TRACER_Syscall_exchange();
+    VPE *vpe = is.gate().session<VPE>();
+    capsel_t tcap;
+    bool obtain;
+    uint count;
+    is >> tcap >> obtain >> count;
+    LOG_SYS(vpe, ": syscall::exchangev", "(vpe=" << tcap << ", obtain=" << obtain
+        << ", count=" << count << ")");
+
+    if(count == 0 || count > m3::KIF::Syscall::MAX_XCHG_RANGES)
+        SYS_ERROR(vpe, is, m3::Errors::INV_ARGS, "Invalid number of ranges");
+
+    VPECapability *vpecap = static_cast<VPECapability*>(
+            vpe->objcaps().get(tcap, Capability::VIRTPE));
+    if(vpecap == nullptr)
+        SYS_ERROR(vpe, is, m3::Errors::INV_ARGS, "Invalid VPE cap");
+
+    VPE *t1 = obtain ? vpecap->vpe : vpe;
+    VPE *t2 = obtain ? vpe : vpecap->vpe;
+    StaticGateOStream<m3::ostreamsize<m3::Errors::Code, uint>() +
+        m3::KIF::Syscall::MAX_XCHG_RANGES * m3::ostreamsize<m3::Errors::Code>()> reply;
+    reply << m3::Errors::NO_ERROR << count;
+    for(uint i = 0; i < count; ++i) {
+        m3::CapRngDesc own, other;
+        is >> own >> other;
+        m3::Errors::Code res = do_exchange(t1, t2, own, other, obtain);
+        if(res != m3::Errors::NO_ERROR)
+            KLOG(ERR, vpe->name() << ": exchangev of " << own << " failed (" << res << ")");
+        reply << res;
+    }
+    is.reply(reply.bytes(), reply.total());
+}
+
 void SyscallHandler::vpectrl(GateIStream &is) {
     EVENT_TRACER_Syscall_vpectrl();
     VPE *vpe = is.gate().session<VPE>();
@@ -1075,6 +1116,42 @@ void SyscallHandler::revoke(GateIStream &is) {
 #endif
 }
 
+/**
+ * Vectored revoke: revokes up to MAX_REVOKE_RANGES ranges in one syscall, one after another.
+ * The reply carries NO_ERROR, the number of ranges and the result of each range.
+ */
+void SyscallHandler::revokev(GateIStream &is) {
+    EVENT_TRACER_Syscall_revoke();
+    VPE *vpe = is.gate().session<VPE>();
+    bool own;
+    uint count;
+    is >> own >> count;
+    LOG_SYS(vpe, ": syscall::revokev", "(own=" << own << ", count=" << count << ")");
+
+    if(count == 0 || count > m3::KIF::Syscall::MAX_REVOKE_RANGES)
+        SYS_ERROR(vpe, is, m3::Errors::INV_ARGS, "Invalid number of ranges");
+
+    StaticGateOStream<m3::ostreamsize<m3::Errors::Code, uint>() +
+        m3::KIF::Syscall::MAX_REVOKE_RANGES * m3::ostreamsize<m3::Errors::Code>()> reply;
+    reply << m3::Errors::NO_ERROR << count;
+    for(uint i = 0; i < count; ++i) {
+        m3::CapRngDesc crd;
+        is >> crd;
+
+        m3::Errors::Code res;
+        if(crd.type() == m3::CapRngDesc::OBJ && crd.start() < 2)
+            res = m3::Errors::INV_ARGS;
+        else {
+            CapTable &table = crd.type() == m3::CapRngDesc::OBJ ? vpe->objcaps() : vpe->mapcaps();
+            res = table.revoke(crd, own);
+        }
+        if(res != m3::Errors::NO_ERROR)
+            KLOG(ERR, vpe->name() << ": revokev of " << crd << " failed (" << res << ")");
+        reply << res;
+    }
+    is.reply(reply.bytes(), reply.total());
+}
+
 void SyscallHandler::exit(GateIStream &is) {
     EVENT_TRACER_Syscall_exit();
     VPE *vpe = is.gate().session<VPE>();
@@ -101,6 +101,8 @@ public:
     void revoke(GateIStream &is);
     void exit(GateIStream &is);
     void noop(GateIStream &is);
+    void exchangev(GateIStream &is);
+    void revokev(GateIStream &is);
 
 #if defined(__host__)
     void init(GateIStream &is);
@@ -27,7 +27,7 @@
 #include "thread/ThreadManager.h"
 
 #if defined(__sel4__)
-extern "C" void net_poll(void);
+extern "C" int net_poll(void);
 
 #if !defined(SEMPEROS_NO_NETWORK)
 /*
@@ -84,6 +84,97 @@ static void check_childs() {
 
 namespace kernel {
 
+static void handle_krnlc(KernelcallHandler &krnlch, int gate, const m3::DTU::Message *msg) {
+    GateIStream is(krnlch.rcvgate(gate), msg);
+    krnlch.handle_message(is, nullptr);
+}
+
+#if !defined(__sel4__)
+static void handle_sysc(SyscallHandler &sysch, const m3::DTU::Message *msg) {
+    RecvGate *rgate = reinterpret_cast<RecvGate*>(msg->label);
+    GateIStream is(*rgate, msg);
+    sysch.handle_message(is, nullptr);
+    EVENT_TRACE_FLUSH_LIGHT();
+}
+#else
+// Syscalls taken from one SYSC EP per round; no more than the replies a
+// sender's ring is sized for
+static const uint SYSC_BATCH = VPE::SYSC_REPLY_SLOTS;
+
+/* EPs whose doorbell bits were taken but whose rings may still hold
+ * messages. Shared by all threads running the WorkLoop: ready_eps() takes
+ * the bits of the whole kernel, so a thread that blocks in a handler must
+ * not keep the ones it took to itself. */
+static uint32_t pending_eps;
+
+/*
+ * VPEs may have several syscalls in flight, tagged by their replylabel.
+ * Messages are copied off the ring and acked before they are handled: a
+ * syscall that blocks in wait_for() lets another thread continue the
+ * WorkLoop, which has to see the next submission instead of this one
+ * again. The copies stay on this thread's stack until the handlers return.
+ */
+static void handle_sysc(SyscallHandler &sysch, m3::DTU::Message *msg) {
+    RecvGate *rgate = reinterpret_cast<RecvGate*>(msg->label);
+    /* On sel4, VPE sends may not have the correct label
+     * (vDTU doesn't auto-fill from EP config like gem5 HW).
+     * Look up the VPE from senderCoreId via PEManager. */
+    if(!msg->label) {
+        int sender_core = msg->senderCoreId;
+        if(PEManager::get().exists(sender_core)) {
+            rgate = &PEManager::get().vpe(sender_core).syscall_gate();
+        }
+    }
+    GateIStream is(*rgate, msg);
+    // already acked by handle_sysc_burst()
+    is.claim();
+    sysch.handle_message(is, nullptr);
+    EVENT_TRACE_FLUSH_LIGHT();
+}
+
+/*
+ * Take a burst of syscalls off ep: fetch up to SYSC_BATCH at once, copy
+ * them and release their slots with one tail update. A syscall whose
+ * sender's reply ring has no room left for its reply ends the burst; it
+ * stays in the ring, and the EP pending, until the sender took its
+ * replies. The replies' consumers are notified once, after the burst.
+ */
+static void handle_sysc_burst(SyscallHandler &sysch, int ep) {
+    m3::DTU &dtu = m3::DTU::get();
+    const m3::DTU::Message *msgs[SYSC_BATCH];
+    alignas(8) unsigned char bufs[SYSC_BATCH][1 << VPE::SYSC_CREDIT_ORD];
+    size_t count = dtu.fetch_msgs(ep, msgs, SYSC_BATCH);
+
+    size_t n;
+    for(n = 0; n < count; n++) {
+        size_t replies = 1;
+        for(size_t i = 0; i < n; i++) {
+            if(msgs[i]->senderCoreId == msgs[n]->senderCoreId &&
+               msgs[i]->replyEpId == msgs[n]->replyEpId)
+                replies++;
+        }
+        if(dtu.reply_space(msgs[n]) < replies)
+            break;
+
+        size_t len = m3::Math::min(sizeof(bufs[n]), m3::DTU::HEADER_SIZE + msgs[n]->length);
+        memcpy(bufs[n], msgs[n], len);
+        reinterpret_cast<m3::DTU::Message*>(bufs[n])->length = len - m3::DTU::HEADER_SIZE;
+    }
+    dtu.mark_read_n(ep, n);
+
+    dtu.defer_notify();
+    for(size_t i = 0; i < n; i++)
+        handle_sysc(sysch, reinterpret_cast<m3::DTU::Message*>(bufs[i]));
+    dtu.flush_notify();
+}
+#endif
+
+static void handle_srv(const m3::DTU::Message *msg) {
+    RecvGate *gate = reinterpret_cast<RecvGate*>(msg->label);
+    GateIStream is(*gate, msg);
+    gate->notify_all(is);
+}
+
 void WorkLoop::run() {
 #if defined(__host__)
     signal(SIGCHLD, sigchild);
@@ -103,48 +194,86 @@ void WorkLoop::run() {
         sysep[i] = sysch.epid(i);
     int srvep = sysch.srvepid();
     const m3::DTU::Message *msg;
+
+#if defined(__sel4__)
+    /* Producers ring a doorbell bit per channel, so only the EPs that got
+     * messages are visited. An EP stays in pending_eps until a fetch finds
+     * it empty, because a bit may stand for several messages and we
+     * handle one per EP and round, like the full poll does. */
+    enum { GATE_NONE, GATE_KRNLC, GATE_SYSC, GATE_SRV };
+    uint8_t ep_kind[EP_COUNT] = {};
+    int ep_gate[EP_COUNT] = {};
+    uint32_t gates = 0;
+    for(int i = 0; i < DTU::KRNLC_GATES; i++) {
+        ep_kind[krnlep[i]] = GATE_KRNLC;
+        ep_gate[krnlep[i]] = i;
+        gates |= static_cast<uint32_t>(1) << krnlep[i];
+    }
+    for(int i = 0; i < DTU::SYSC_GATES; i++) {
+        ep_kind[sysep[i]] = GATE_SYSC;
+        gates |= static_cast<uint32_t>(1) << sysep[i];
+    }
+    ep_kind[srvep] = GATE_SRV;
+    gates |= static_cast<uint32_t>(1) << srvep;
+
+    /* Messages may have arrived before the loop started */
+    pending_eps |= gates;
+#endif
+
     while(has_items()) {
         m3::DTU::get().wait();
 
+#if defined(__sel4__)
+        pending_eps |= dtu.ready_eps() & gates;
+        for(uint32_t bits = pending_eps; bits; bits &= bits - 1) {
+            int ep = __builtin_ctz(bits);
+            msg = dtu.fetch_msg(ep);
+            if(!msg) {
+                pending_eps &= ~(static_cast<uint32_t>(1) << ep);
+                continue;
+            }
+
+            switch(ep_kind[ep]) {
+                case GATE_KRNLC:
+                    handle_krnlc(krnlch, ep_gate[ep], msg);
+                    break;
+                case GATE_SYSC:
+                    handle_sysc_burst(sysch, ep);
+                    break;
+                case GATE_SRV:
+                    handle_srv(msg);
+                    break;
+            }
+        }
+#else
         for(int i = 0; i < DTU::KRNLC_GATES; i++) {
             msg = dtu.fetch_msg(krnlep[i]);
-            if(msg) {
-                GateIStream is(krnlch.rcvgate(i), msg);
-                krnlch.handle_message(is, nullptr);
-            }
+            if(msg)
+                handle_krnlc(krnlch, i, msg);
         }
 
         for(int i = 0; i < DTU::SYSC_GATES; i++) {
             msg = dtu.fetch_msg(sysep[i]);
-            if(msg) {
-                RecvGate *rgate = reinterpret_cast<RecvGate*>(msg->label);
-#if defined(__sel4__)
-                /* On sel4, VPE sends may not have the correct label
-                 * (vDTU doesn't auto-fill from EP config like gem5 HW).
-                 * Look up the VPE from senderCoreId via PEManager. */
-                if(!msg->label) {
-                    int sender_core = msg->senderCoreId;
-                    if(PEManager::get().exists(sender_core)) {
-                        rgate = &PEManager::get().vpe(sender_core).syscall_gate();
-                    }
-                }
-#endif
-                GateIStream is(*rgate, msg);
-                sysch.handle_message(is, nullptr);
-                EVENT_TRACE_FLUSH_LIGHT();
-            }
+            if(msg)
+                handle_sysc(sysch, msg);
         }
 
         msg = dtu.fetch_msg(srvep);
-        if(msg) {
-            RecvGate *gate = reinterpret_cast<RecvGate*>(msg->label);
-            GateIStream is(*gate, msg);
-            gate->notify_all(is);
-        }
+        if(msg)
+            handle_srv(msg);
+#endif
 
+#if defined(__sel4__)
+        // a burst whose handler blocked left its notifications deferred
+        dtu.flush_notify();
+#endif
         tmng.yield();
 #if defined(__sel4__)
-        net_poll();
+        bool net_busy = net_poll();
+        // every EP was found empty and no thread can run: sleep until
+        // VPE0 or the network bridge publishes a message
+        if(!pending_eps && !net_busy && !tmng.ready_count())
+            dtu.sleep();
 #endif
 #if defined(__host__)
         check_childs();
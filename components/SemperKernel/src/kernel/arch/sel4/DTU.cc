@@ -13,6 +13,7 @@
  *   - reply(ep, data, len, off) → extract reply target from original msg header,
  *     find/allocate reply channel, vdtu_ring_send()
  *   - mark_read(ep, off) → vdtu_ring_ack()
+ *   - ready_eps() → recv EPs whose channels were rung on the doorbell
  *
  * Thread safety note (re: cooperative threading):
  *   The single-threaded stub ThreadManager means revocation blocking
@@ -27,6 +28,7 @@ extern "C" {
 #include <string.h>
 #include "vdtu_ring.h"
 #include "vdtu_channels.h"
+#include "vdtu_trace.h"
 
 /* CAmkES-generated symbols — dataports and RPC stubs.
  * We declare them manually to avoid including <camkes.h> from C++
@@ -34,6 +36,7 @@ extern "C" {
 extern volatile void *msgchan_kv_0, *msgchan_kv_1, *msgchan_kv_2, *msgchan_kv_3;
 extern volatile void *msgchan_kv_4, *msgchan_kv_5, *msgchan_kv_6, *msgchan_kv_7;
 extern volatile void *memep_kv_0, *memep_kv_1, *memep_kv_2, *memep_kv_3;
+extern volatile void *doorbell_kv;
 
 /* vDTU config RPC stubs (from VDTUConfig interface) */
 int vdtu_config_recv(int target_pe, int ep_id, int buf_order, int msg_order, int flags);
@@ -47,6 +50,11 @@ int vdtu_terminate_ep(int target_pe, int ep_id);
 
 /* Notifications */
 void signal_vpe0_emit(void);
+void signal_from_vpe0_wait(void);
+
+/* Inbound network ring (camkes_entry.c) */
+int net_prepare_wait(void);
+void net_finish_wait(void);
 }
 
 #include <base/log/Kernel.h>
@@ -77,6 +85,7 @@ enum ep_state {
 
 static int           ep_channel[EP_COUNT];  /* EP → channel index (-1 = unconfigured) */
 static enum ep_state ep_type[EP_COUNT];
+static int           chan_ep[VDTU_MSG_CHANNELS];  /* channel → local recv EP (-1 = none) */
 static struct vdtu_channel_table channels;
 static bool channels_initialized = false;
 
@@ -122,7 +131,10 @@ static void ensure_channels_init(void)
         (volatile void *)memep_kv_3,
     };
     vdtu_channels_init(&channels, msg, mem);
+    vdtu_channels_set_doorbell(&channels, doorbell_kv);
 
+    for (int i = 0; i < VDTU_MSG_CHANNELS; i++)
+        chan_ep[i] = -1;
     for (int i = 0; i < EP_COUNT; i++) {
         ep_channel[i] = -1;
         ep_type[i] = EP_NONE;
@@ -145,6 +157,35 @@ static int find_send_channel_for(int dest_pe, int dest_ep)
     return -1;
 }
 
+/* Forget the recv EP of a channel, if ep was the one mapped to it */
+static void unmap_recv_ep(int ep)
+{
+    if (ep_type[ep] == EP_RECV && ep_channel[ep] >= 0 &&
+        chan_ep[ep_channel[ep]] == ep)
+        chan_ep[ep_channel[ep]] = -1;
+}
+
+/*
+ * Local channels are kernel <-> VPE0 dataports. After publishing into one,
+ * ring the doorbell if the kernel consumes it itself; otherwise wake VPE0
+ * if it announced that it is blocking on that ring (else it is polling
+ * and needs no signal).
+ */
+static bool     notify_deferred;
+static uint32_t notify_pending;   /* channels to notify on flush_notify() */
+
+static void notify_consumer(int ch, struct vdtu_ring *ring)
+{
+    if (notify_deferred) {
+        notify_pending |= static_cast<uint32_t>(1) << ch;
+        return;
+    }
+    if (chan_ep[ch] >= 0)
+        vdtu_channels_ring_doorbell(&channels, ch);
+    else if (vdtu_ring_notify_needed(ring))
+        signal_vpe0_emit();
+}
+
 /* ================================================================
  * kernel::DTU — Control plane (endpoint configuration)
  * ================================================================ */
@@ -190,6 +231,7 @@ void DTU::invalidate_ep(const VPEDesc &vpe, int ep) {
     }
     /* Clear local mapping if this is our own EP */
     if (target_pe == MY_PE && ep >= 0 && ep < EP_COUNT) {
+        unmap_recv_ep(ep);
         ep_channel[ep] = -1;
         ep_type[ep] = EP_NONE;
     }
@@ -202,12 +244,37 @@ void DTU::invalidate_eps(const VPEDesc &vpe, int first) {
     /* Clear local mappings */
     if (target_pe == MY_PE) {
         for (int i = first; i < EP_COUNT; i++) {
+            unmap_recv_ep(i);
             ep_channel[i] = -1;
             ep_type[i] = EP_NONE;
         }
     }
 }
 
+/*
+ * Initialize the ring of a receive channel for a buffer of 2^order bytes
+ * holding messages of up to 2^msgorder bytes. When that many fixed slots
+ * do not fit the 4 KiB dataport (e.g. KRNLC: 2 x 2 KiB), the ring is
+ * packed instead, so small messages do not each pin a whole slot. A
+ * packed ring caps the largest message at VDTU_CHANNEL_PACKED_MAX_MSG,
+ * which Kernelcalls::MSG_SIZE is derived from.
+ */
+static void init_recv_ring(int ch, uint order, uint msgorder) {
+    uint32_t slot_count = 1u << (order - msgorder);
+    uint32_t slot_size  = 1u << msgorder;
+    size_t avail = VDTU_CHANNEL_DATA_SIZE;
+
+    if (slot_count * slot_size <= avail) {
+        vdtu_channels_init_ring(&channels, ch, slot_count, slot_size);
+        return;
+    }
+
+    uint32_t max_msg = VDTU_CHANNEL_PACKED_MAX_MSG;
+    if (slot_size < max_msg)
+        max_msg = slot_size;
+    vdtu_channels_init_ring_packed(&channels, ch, avail, max_msg);
+}
+
 void DTU::config_recv_local(int ep, uintptr_t buf, uint order, uint msgorder, int flags) {
     ensure_channels_init();
 
@@ -219,23 +286,15 @@ void DTU::config_recv_local(int ep, uintptr_t buf, uint order, uint msgorder, in
     }
 
     /* Initialize the ring buffer in the channel's shared memory */
-    uint32_t slot_count = 1u << (order - msgorder);
-    uint32_t slot_size  = 1u << msgorder;
-
-    /* Cap to dataport limits (4 KiB dataport = 64B ctrl + slots) */
-    size_t avail = 4096 - VDTU_RING_CTRL_SIZE;
-    while (slot_count * slot_size > avail && slot_count > 2)
-        slot_count >>= 1;
-
-    vdtu_channels_init_ring(&channels, ch, slot_count, slot_size);
+    init_recv_ring(ch, order, msgorder);
 
     /* Store the mapping */
     ep_channel[ep] = ch;
     ep_type[ep] = EP_RECV;
+    chan_ep[ch] = ep;
 
     KLOG_V(EPS, "config_recv_local(ep=" << ep << " order=" << order
-         << " msgorder=" << msgorder << ") -> channel " << ch
-         << " (" << slot_count << " slots x " << slot_size << "B)");
+         << " msgorder=" << msgorder << ") -> channel " << ch);
 }
 
 void DTU::config_recv_remote(const VPEDesc &vpe, int ep, uintptr_t buf,
@@ -253,13 +312,7 @@ void DTU::config_recv_remote(const VPEDesc &vpe, int ep, uintptr_t buf,
 
     /* For remote PEs, we don't init the ring locally — the remote component does.
      * But we init it here since kernel runs first and both sides share the memory. */
-    uint32_t slot_count = 1u << (order - msgorder);
-    uint32_t slot_size  = 1u << msgorder;
-    size_t avail = 4096 - VDTU_RING_CTRL_SIZE;
-    while (slot_count * slot_size > avail && slot_count > 2)
-        slot_count >>= 1;
-
-    vdtu_channels_init_ring(&channels, ch, slot_count, slot_size);
+    init_recv_ring(ch, order, msgorder);
 
     KLOG_V(EPS, "config_recv_remote(pe=" << target_pe << " ep=" << ep << ") -> channel " << ch);
 }
@@ -349,13 +402,14 @@ void DTU::config_mem_remote(const VPEDesc &vpe, int ep, int dstcore,
 
 /* Network ring buffer send (07e) — defined in camkes_entry.c */
 extern "C" {
-    int net_ring_send(uint16_t sender_pe, uint8_t sender_ep,
+    int net_ring_send(uint16_t dest_node,
+                      uint16_t sender_pe, uint8_t sender_ep,
                       uint16_t sender_vpe, uint8_t reply_ep,
                       uint64_t label, uint64_t replylabel, uint8_t flags,
                       const void *payload, uint16_t payload_len);
 }
 
-void DTU::send_to(const VPEDesc &vpe, int ep, label_t label,
+m3::Errors::Code DTU::send_to(const VPEDesc &vpe, int ep, label_t label,
     const void *msg, size_t size, label_t replylbl, int replyep)
 {
     ensure_channels_init();
@@ -364,32 +418,35 @@ void DTU::send_to(const VPEDesc &vpe, int ep, label_t label,
     if (vpe.core >= NUM_LOCAL_PES) {
         int dest_node = (vpe.core - NUM_LOCAL_PES) / NUM_LOCAL_PES;
 
-        printf("[SemperKernel] Routing to remote node %d via ring (%zu bytes payload)\n",
-               dest_node, size);
+        VDTU_TRACE(VDTU_TRACE_DBG, NET_ROUTE, dest_node, size, 0);
 
-        int rc = net_ring_send(MY_PE, (uint8_t)ep,
+        int rc = net_ring_send((uint16_t)dest_node, MY_PE, (uint8_t)ep,
                                Platform::kernelId(), (uint8_t)replyep,
                                label, replylbl, 0,
                                msg, (uint16_t)size);
         if (rc != 0) {
             KLOG(ERR, "net_ring_send failed: " << rc);
+            return rc == -2 ? m3::Errors::INV_ARGS : m3::Errors::NO_RING_SPACE;
         }
-        return;
+        return m3::Errors::NO_ERROR;
     }
 
     /* Local PE: use shared memory channel */
     int ch = find_send_channel_for(vpe.core, ep);
     if (ch < 0) {
         KLOG(ERR, "send_to(pe=" << vpe.core << " ep=" << ep << ") no send channel");
-        return;
+        return m3::Errors::EP_INVALID;
     }
 
     struct vdtu_ring *ring = vdtu_channels_get_ring(&channels, ch);
-    if (!ring) return;
-
-    vdtu_ring_send(ring, MY_PE, (uint8_t)ep, Platform::kernelId(),
-                   (uint8_t)replyep, label, replylbl, 0,
-                   msg, (uint16_t)size);
+    if (!ring) return m3::Errors::EP_INVALID;
+
+    if (vdtu_ring_send(ring, MY_PE, (uint8_t)ep, Platform::kernelId(),
+                       (uint8_t)replyep, label, replylbl, 0,
+                       msg, (uint16_t)size) != 0)
+        return m3::Errors::NO_RING_SPACE;
+    notify_consumer(ch, ring);
+    return m3::Errors::NO_ERROR;
 }
 
 void DTU::reply_to(const VPEDesc &vpe, int ep, int crdep, word_t credits,
@@ -408,9 +465,10 @@ void DTU::reply_to(const VPEDesc &vpe, int ep, int crdep, word_t credits,
     struct vdtu_ring *ring = vdtu_channels_get_ring(&channels, ch);
     if (!ring) return;
 
-    vdtu_ring_send(ring, MY_PE, (uint8_t)crdep, Platform::kernelId(),
-                   (uint8_t)ep, label, 0, VDTU_FLAG_REPLY,
-                   msg, (uint16_t)size);
+    if (vdtu_ring_send(ring, MY_PE, (uint8_t)crdep, Platform::kernelId(),
+                       (uint8_t)ep, label, 0, VDTU_FLAG_REPLY,
+                       msg, (uint16_t)size) == 0)
+        notify_consumer(ch, ring);
 }
 
 void DTU::write_mem(const VPEDesc &vpe, uintptr_t addr, const void *data, size_t size) {
@@ -489,7 +547,10 @@ Errors::Code DTU::send(int ep, const void *msg, size_t size, label_t replylbl, i
                             (uint8_t)reply_ep,
                             ep_send_config[ep].label, replylbl, 0,
                             msg, (uint16_t)size);
-    return (rc == 0) ? Errors::NO_ERROR : Errors::NO_SPACE;
+    if (rc != 0)
+        return Errors::NO_SPACE;
+    notify_consumer(ep_channel[ep], ring);
+    return Errors::NO_ERROR;
 }
 
 Errors::Code DTU::reply(int ep, const void *data, size_t size, size_t msgoff) {
@@ -566,6 +627,11 @@ Errors::Code DTU::reply(int ep, const void *data, size_t size, size_t msgoff) {
                             replylabel, 0,
                             VDTU_FLAG_REPLY,
                             data, (uint16_t)size);
+    if (rc == 0)
+        notify_consumer(reply_ch, ring);
+    else
+        printf("[DTU] reply: ring of pe=%d ep=%d full, reply dropped\n",
+               sender_pe, reply_ep_id);
 
     /* Don't ack here — GateIStream::finish() will call mark_read() to
      * consume the original message. Acking here caused a double-ack fault
@@ -620,6 +686,79 @@ DTU::Message *DTU::fetch_msg(int ep) const {
         reinterpret_cast<const DTU::Message *>(vmsg));
 }
 
+size_t DTU::fetch_msgs(int ep, const Message **msgs, size_t max) const {
+    if (ep < 0 || ep >= EP_COUNT || ep_channel[ep] < 0)
+        return 0;
+
+    struct vdtu_ring *ring = vdtu_channels_get_ring(
+        const_cast<struct vdtu_channel_table *>(&channels), ep_channel[ep]);
+    if (!ring) return 0;
+
+    /* Same header layout, see fetch_msg() */
+    return vdtu_ring_fetch_batch(ring,
+        reinterpret_cast<const struct vdtu_message **>(msgs), max);
+}
+
+size_t DTU::reply_space(const Message *msg) const {
+    int ch = find_send_channel_for(msg->senderCoreId, msg->replyEpId);
+    /* reply() sets up the channel on first use, its ring is empty then */
+    if (ch < 0)
+        return static_cast<size_t>(-1);
+
+    struct vdtu_ring *ring = vdtu_channels_get_ring(
+        const_cast<struct vdtu_channel_table *>(&channels), ch);
+    if (!ring)
+        return static_cast<size_t>(-1);
+    /* a packed ring's room depends on the message sizes */
+    if (ring->ctrl->mode == VDTU_RING_MODE_PACKED)
+        return !vdtu_ring_is_full(ring);
+    /* one slot always stays free to tell a full ring from an empty one */
+    return ring->ctrl->slot_mask - vdtu_ring_available(ring);
+}
+
+uint32_t DTU::ready_eps() const {
+    uint32_t bells = vdtu_channels_take_doorbell(
+        const_cast<struct vdtu_channel_table *>(&channels));
+    uint32_t eps = 0;
+
+    for (; bells; bells &= bells - 1) {
+        int ep = chan_ep[__builtin_ctz(bells)];
+        if (ep >= 0)
+            eps |= static_cast<uint32_t>(1) << ep;
+    }
+    return eps;
+}
+
+/*
+ * VPE0 and DTUBridge share the notification we wait on. They only signal
+ * it for rings that announced a block, so announce it on every ring we
+ * consume before sleeping and give up if one already holds a message.
+ */
+void DTU::sleep() {
+    struct vdtu_channel_table *ct = &channels;
+    struct vdtu_ring *rings[VDTU_MSG_CHANNELS];
+    int n = 0;
+    bool empty = true;
+
+    /* a thread that blocked in a burst may have left notifications
+     * deferred; their consumers may wait for them */
+    flush_notify();
+
+    for (int ch = 0; ch < VDTU_MSG_CHANNELS && empty; ch++) {
+        struct vdtu_ring *ring = chan_ep[ch] >= 0 ? vdtu_channels_get_ring(ct, ch) : nullptr;
+        if (!ring)
+            continue;
+        rings[n++] = ring;
+        empty = !vdtu_ring_prepare_wait(ring);
+    }
+    if (empty && !net_prepare_wait())
+        signal_from_vpe0_wait();
+
+    for (int i = 0; i < n; i++)
+        vdtu_ring_finish_wait(rings[i]);
+    net_finish_wait();
+}
+
 void DTU::mark_read(int ep, size_t off) {
     if (ep < 0 || ep >= EP_COUNT || ep_channel[ep] < 0)
         return;
@@ -630,4 +769,27 @@ void DTU::mark_read(int ep, size_t off) {
     vdtu_ring_ack(ring);
 }
 
+void DTU::mark_read_n(int ep, size_t count) {
+    if (ep < 0 || ep >= EP_COUNT || ep_channel[ep] < 0)
+        return;
+
+    struct vdtu_ring *ring = vdtu_channels_get_ring(&channels, ep_channel[ep]);
+    if (!ring) return;
+
+    vdtu_ring_ack_n(ring, count);
+}
+
+void DTU::defer_notify() {
+    notify_deferred = true;
+}
+
+void DTU::flush_notify() {
+    notify_deferred = false;
+    for (uint32_t chs = notify_pending; chs; chs &= chs - 1) {
+        int ch = __builtin_ctz(chs);
+        notify_consumer(ch, vdtu_channels_get_ring(&channels, ch));
+    }
+    notify_pending = 0;
+}
+
 } // namespace m3
@@ -60,9 +60,12 @@ void VPE::init_memory(int, const char *) {
 
 void VPE::init() {
     /* Attach default receive endpoint.
-     * Use buf_order=11 (2048B buffer), msg_order=9 (512B slots) → 4 slots.
+     * Use buf_order=12 (4096B buffer), msg_order=9 (512B messages): that
+     * does not fit the dataport in fixed slots, so the ring is packed and
+     * holds at least SYSC_REPLY_SLOTS replies of 512B. A fixed 2048B ring
+     * only had 3 usable slots, fewer than VPE0 keeps syscalls in flight.
      * DEF_RCVBUF_ORDER=8 is too small (256B = 1 slot = 0 usable capacity). */
-    int buf_order = 11;  /* 2048 bytes total */
+    int buf_order = 12;  /* 4096 bytes, packed into the dataport */
     int msg_order = VPE::SYSC_CREDIT_ORD;  /* 512 byte slots */
     UNUSED m3::Errors::Code res = RecvBufs::attach(
         *this, m3::DTU::DEF_RECVEP, Platform::def_recvbuf(core()),
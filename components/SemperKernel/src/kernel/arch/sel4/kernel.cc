@@ -147,10 +147,11 @@ extern "C" void net_init_rings(void);
  *
  * We create NUM_WORKER_THREADS workers at startup so that nested
  * blocking (e.g., main blocks, worker handles a message that also
- * blocks) has a sleeping thread to switch to. Two workers is
- * sufficient for the current prototype (one active, one sleeping).
+ * blocks) has a sleeping thread to switch to. With 32 KiB stacks,
+ * four workers cost half of what two did at 128 KiB and allow three
+ * levels of nested blocking.
  */
-#define NUM_WORKER_THREADS 2
+#define NUM_WORKER_THREADS 4
 
 static kernel::WorkLoop *g_kworkloop = nullptr;
 
@@ -510,7 +510,7 @@ ThreadManager ThreadManager::inst;
 int Thread::_next_id = 1;
 
 Thread::Thread(thread_func func, void *arg)
-    : _id(_next_id++), _regs(), _stack(nullptr), _event(nullptr), _content(false) {
+    : _id(_next_id++), _regs(), _stack(nullptr), _event(nullptr), _waitstart(), _content(false) {
     /* Allocate stack and initialize registers for cooperative switch */
     _stack = new word_t[T_STACK_WORDS];
     thread_init(func, arg, &_regs, _stack);
@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) 2019, Matthias Hille <matthias.hille@tu-dresden.de>,
+ * Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of SemperOS.
+ *
+ * SemperOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * SemperOS is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <base/Common.h>
+#include <base/col/Treap.h>
+#include <base/stream/OStream.h>
+#include <base/util/Math.h>
+#include <assert.h>
+
+namespace kernel {
+
+/**
+ * Selector-indexed storage of a CapTable.
+ *
+ * Selectors are small and dense, so they index a paged array: a directory of pages with
+ * PAGE_CAPS slots each, where every directory entry holds a bitmap of the used slots. Lookups
+ * are two array loads and range checks test a word of the bitmap at a time. The directory grows
+ * on demand up to DENSE_CAPS selectors; the few selectors above (e.g. map capabilities at high
+ * virtual pages) are kept in a treap, so a single large selector can't blow up the directory.
+ *
+ * T has to be a m3::TreapNode<capsel_t> keyed by its selector. Like the treap, the array does
+ * not own the nodes.
+ */
+template<class T>
+class CapArray {
+public:
+    static const size_t PAGE_CAPS       = sizeof(word_t) * 8;
+    static const capsel_t DENSE_CAPS    = 1 << 16;
+
+private:
+    static const size_t MIN_PAGES       = 4;
+
+    struct Page {
+        word_t used;
+        T **caps;
+    };
+
+public:
+    explicit CapArray() : _dir(nullptr), _pages(0), _low(0), _count(0), _spare(nullptr), _sparse() {
+    }
+    CapArray(const CapArray &) = delete;
+    CapArray &operator=(const CapArray &) = delete;
+    ~CapArray() {
+        for(size_t i = 0; i < _pages; ++i)
+            delete[] _dir[i].caps;
+        delete[] _dir;
+        delete[] _spare;
+    }
+
+    /**
+     * @return the number of stored nodes
+     */
+    size_t count() const {
+        return _count;
+    }
+
+    /**
+     * @return the node for selector <sel> or nullptr
+     */
+    T *find(capsel_t sel) const {
+        size_t page = sel / PAGE_CAPS;
+        if(page < _pages) {
+            if(!(_dir[page].used & bit(sel)))
+                return nullptr;
+            return _dir[page].caps[sel % PAGE_CAPS];
+        }
+        if(sel >= DENSE_CAPS)
+            return _sparse.find(sel);
+        return nullptr;
+    }
+
+    /**
+     * Inserts <node> at its selector, which has to be free
+     */
+    void insert(T *node) {
+        capsel_t sel = node->key();
+        assert(find(sel) == nullptr);
+        _count++;
+        if(sel >= DENSE_CAPS) {
+            _sparse.insert(node);
+            return;
+        }
+
+        size_t page = sel / PAGE_CAPS;
+        if(page >= _pages)
+            grow(page + 1);
+        if(!_dir[page].caps) {
+            _dir[page].caps = _spare ? _spare : new T*[PAGE_CAPS];
+            _spare = nullptr;
+        }
+        _dir[page].caps[sel % PAGE_CAPS] = node;
+        _dir[page].used |= bit(sel);
+        if(page < _low)
+            _low = page;
+    }
+
+    /**
+     * Removes <node>, which has to be stored
+     */
+    void remove(T *node) {
+        capsel_t sel = node->key();
+        assert(find(sel) == node);
+        _count--;
+        if(sel >= DENSE_CAPS) {
+            _sparse.remove(node);
+            return;
+        }
+
+        Page &p = _dir[sel / PAGE_CAPS];
+        p.used &= ~bit(sel);
+        // give empty pages back, but keep one to not allocate again for every single cap
+        if(p.used == 0) {
+            if(_spare)
+                delete[] p.caps;
+            else
+                _spare = p.caps;
+            p.caps = nullptr;
+        }
+    }
+
+    /**
+     * Removes a node and returns it: the dense ones in selector order, then the sparse ones
+     *
+     * @return the node or nullptr if empty
+     */
+    T *remove_next() {
+        for(; _low < _pages; ++_low) {
+            if(_dir[_low].used) {
+                T *node = _dir[_low].caps[__builtin_ctzl(_dir[_low].used)];
+                remove(node);
+                return node;
+            }
+        }
+        T *node = static_cast<T*>(_sparse.remove_root());
+        if(node)
+            _count--;
+        return node;
+    }
+
+    /**
+     * @return true if all selectors in [start, start + count) are used (<used> = true) or all
+     *  of them are unused (<used> = false)
+     */
+    bool range_is(capsel_t start, capsel_t count, bool used) const {
+        capsel_t end = start + count;
+        for(capsel_t sel = start; sel < end; ) {
+            if(sel >= DENSE_CAPS) {
+                for(; sel < end; ++sel) {
+                    if((_sparse.find(sel) != nullptr) != used)
+                        return false;
+                }
+                break;
+            }
+
+            size_t page = sel / PAGE_CAPS;
+            if(page >= _pages) {
+                // nothing stored up to the sparse selectors
+                if(used)
+                    return false;
+                sel = m3::Math::min(end, DENSE_CAPS);
+                continue;
+            }
+
+            size_t off = sel % PAGE_CAPS;
+            capsel_t n = static_cast<capsel_t>(m3::Math::min<size_t>(end - sel, PAGE_CAPS - off));
+            word_t mask = n == PAGE_CAPS ? ~static_cast<word_t>(0)
+                                         : ((static_cast<word_t>(1) << n) - 1) << off;
+            word_t bits = _dir[page].used & mask;
+            if(used ? bits != mask : bits != 0)
+                return false;
+            sel += n;
+        }
+        return true;
+    }
+
+    /**
+     * Prints all nodes in selector order into <os>
+     */
+    void print(m3::OStream &os) const {
+        for(size_t i = 0; i < _pages; ++i) {
+            for(word_t used = _dir[i].used; used; used &= used - 1) {
+                _dir[i].caps[__builtin_ctzl(used)]->print(os);
+                os << "\n";
+            }
+        }
+        _sparse.print(os, false);
+    }
+
+private:
+    static word_t bit(capsel_t sel) {
+        return static_cast<word_t>(1) << (sel % PAGE_CAPS);
+    }
+
+    void grow(size_t pages) {
+        size_t ncount = m3::Math::max(_pages * 2, MIN_PAGES);
+        while(ncount < pages)
+            ncount *= 2;
+        ncount = m3::Math::min(ncount, static_cast<size_t>(DENSE_CAPS / PAGE_CAPS));
+
+        Page *ndir = new Page[ncount];
+        for(size_t i = 0; i < _pages; ++i)
+            ndir[i] = _dir[i];
+        for(size_t i = _pages; i < ncount; ++i)
+            ndir[i] = Page{0, nullptr};
+        delete[] _dir;
+        _dir = ndir;
+        _pages = ncount;
+    }
+
+    Page *_dir;
+    size_t _pages;
+    // all pages below are empty
+    size_t _low;
+    size_t _count;
+    T **_spare;
+    m3::Treap<T> _sparse;
+};
+
+}
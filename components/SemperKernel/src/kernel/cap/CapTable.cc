@@ -27,10 +27,7 @@ namespace kernel {
 
 void CapTable::revoke_all() {
     Capability *c;
-    // TODO it might be better to do that in a different order, because it is more expensive to
-    // remove a node that has two childs (it requires a rotate). Thus, it would be better to start
-    // with leaf nodes.
-    while((c = static_cast<Capability*>(_caps.remove_root())) != nullptr) {
+    while((c = _caps.remove_next()) != nullptr) {
         // Clean up any RevocationList entry for this cap that may be left over
         // from a previously blocked revocation root thread (e.g., if the VPE was
         // killed while waiting for remote revokeFinish responses).
@@ -74,14 +71,176 @@ void CapTable::setparent_and_set(mht_key_t parent, Capability *child, capsel_t d
 }
 
 /**
- * Recursive revocation algorithm (cf. Hille et al., USENIX ATC 2019, Section 4.3).
+ * One capability on revoke_rec()'s work-list.
+ */
+struct RevokeFrame : public SlabObject<RevokeFrame>, public m3::SListItem {
+    explicit RevokeFrame(mht_key_t _id, mht_key_t _parent)
+        : id(_id), parent(_parent), childID(0), ongoing(nullptr), local(), remote() {
+    }
+
+    mht_key_t id;
+    mht_key_t parent;
+    mht_key_t childID;      // local child currently being revoked on top of this frame
+    Revocation *ongoing;
+    m3::SList<Capability::Child> local;     // local children not visited yet
+    m3::SList<Capability::Child> remote;    // remote children, sent when the frame finishes
+};
+
+/**
+ * Revokes <c> itself and creates its frame, with its children split into
+ * local and remote ones.
+ */
+RevokeFrame *CapTable::begin_revoke(Capability *c, m3::CapRngDesc::Type type) {
+    mht_key_t parent = (type == m3::CapRngDesc::Type::OBJ) ?
+        (c->parent() | TYPE_MASK_OCAP) : (c->parent() | TYPE_MASK_MCAP);
+    mht_key_t id = (type == m3::CapRngDesc::Type::OBJ) ?
+        (c->id() | TYPE_MASK_OCAP) : (c->id() | TYPE_MASK_MCAP);
+    RevokeFrame *f = new RevokeFrame(id, parent);
+
+    // reset the child-pointer since we're revoking all childs
+    // note that we would need to do much more if delegatable capabilities could deny a revoke
+    c->setRevoking(true);
+    m3::SList<Capability::Child> children = m3::Util::move(c->children());
+
+    m3::Errors::Code res = c->revoke();
+    // actually, this is a bit specific for service+session. although it failed to revoke the service
+    // we want to revoke all childs, i.e. the sessions to remove them from the service.
+    // TODO if there are other failable revokes, we need to reconsider that
+    if(res == m3::Errors::NO_ERROR) {
+        // other kernels must not hand out their cached copies anymore
+        MHTInstance::getInstance().dropCached(c->id());
+        c->table()->unset(c->sel());
+    }
+    else {
+        // Fail fast here to speed up automated benchmarks
+        KLOG(ERR, "Error (" << res << ") during revocation of cap " << PRINT_HASH(id));
+        m3::Machine::shutdown();
+    }
+    // TODO
+    // change revocation of service capabilities so revoke is actually error free
+
+    Capability::Child *child;
+    while((child = children.remove_first()) != nullptr) {
+        if(MHTInstance::getInstance().responsibleMember(child->id) == Coordinator::get().kid())
+            f->local.append(child);
+        else
+            f->remote.append(child);
+    }
+    return f;
+}
+
+/**
+ * The remote children of a RevokeFrame that belong to one kernel.
+ */
+struct RevokeLane : public SlabObject<RevokeLane>, public m3::SListItem {
+    explicit RevokeLane(membership_entry::krnl_id_t _krnl)
+        : krnl(_krnl), kpe(Coordinator::get().getKPE(_krnl)), children() {
+    }
+
+    membership_entry::krnl_id_t krnl;
+    KPE *kpe;
+    m3::SList<Capability::Child> children;
+    // IDs of the batch being sent; kept here rather than on the worker
+    // stack, which already holds the message that is marshalled from them
+    mht_key_t capIDs[Kernelcalls::MAX_REVOKE_BATCH];
+};
+
+/**
+ * Sends one revoke request with up to MAX_REVOKE_BATCH children of <lane>.
+ */
+static void flush_revokes(RevokeFrame *f, RevokeLane *lane, mht_key_t origin) {
+    mht_key_t *capIDs = lane->capIDs;
+    uint count = 0;
+    Capability::Child *child;
+    while(count < Kernelcalls::MAX_REVOKE_BATCH && (child = lane->children.remove_first()) != nullptr) {
+        capIDs[count++] = child->id;
+        delete child;
+    }
+#ifdef KERNEL_STATISTICS
+    KPE::revokeRequests++;
+    KPE::revokedCapIDs += count;
+#endif
+    m3::Errors::Code res;
+    if(count == 1)
+        res = Kernelcalls::get().revoke(lane->kpe, capIDs[0], f->id, origin);
+    else
+        res = Kernelcalls::get().revokeBatch(lane->kpe, f->id, origin, capIDs, count);
+    // no response will come for these; don't let the revocation wait for it
+    if(res != m3::Errors::NO_ERROR) {
+        KLOG(ERR, "Sending revocation of " << count << " caps to kernel #" << lane->krnl <<
+            " failed (" << res << ")");
+        f->ongoing->awaitedResp -= count;
+    }
+}
+
+/**
+ * Sends revoke requests for the remote children of <f>, batched per kernel.
+ *
+ * The kernels are served round-robin, one batch each, as long as they have
+ * a free message slot, so a kernel that is short on slots does not hold up
+ * the others. Only if none has a free slot, we wait for the first one.
+ */
+static void send_remote_revokes(RevokeFrame *f, mht_key_t origin) {
+    if(f->remote.length() == 0)
+        return;
+
+    // account for all requests upfront: responses to the first batches may
+    // arrive while we wait for a slot and must not finish the revocation
+    if(!f->ongoing)
+        f->ongoing = RevocationList::get().add(f->id, f->parent, origin);
+    f->ongoing->awaitedResp += f->remote.length();
+
+    m3::SList<RevokeLane> lanes;
+    Capability::Child *child;
+    while((child = f->remote.remove_first()) != nullptr) {
+        membership_entry::krnl_id_t krnl = MHTInstance::getInstance().responsibleMember(child->id);
+        RevokeLane *lane = nullptr;
+        for(auto it = lanes.begin(); it != lanes.end(); ++it) {
+            if(it->krnl == krnl) {
+                lane = &*it;
+                break;
+            }
+        }
+        if(!lane) {
+            lane = new RevokeLane(krnl);
+            lanes.append(lane);
+        }
+        lane->children.append(child);
+    }
+
+    while(lanes.length() > 0) {
+        bool sent = false;
+        for(auto it = lanes.begin(); it != lanes.end(); ) {
+            RevokeLane *lane = &*it++;
+            if(!lane->kpe->canSendRevocation())
+                continue;
+            flush_revokes(f, lane, origin);
+            sent = true;
+            if(lane->children.length() == 0) {
+                lanes.remove(lane);
+                delete lane;
+            }
+        }
+
+        // every kernel is out of slots; wait for the first one
+        if(!sent) {
+            RevokeLane *lane = &*lanes.begin();
+            flush_revokes(f, lane, origin);
+            if(lane->children.length() == 0)
+                delete lanes.remove_first();
+        }
+    }
+}
+
+/**
+ * Revocation algorithm (cf. Hille et al., USENIX ATC 2019, Section 4.3).
  *
  * Protocol state machine for a single capability revocation:
  *
  *   [START] --move children--> [REVOKE_SELF] --unset cap--> [PROCESS_CHILDREN]
  *       |                                                        |
  *       |   For each child:                                      |
- *       |     local child found  --> recurse revoke_rec()        |
+ *       |     local child found  --> push it on the work-list    |
  *       |     local child gone   --> subscribe to ongoing revoke |
  *       |     remote child       --> batch by kernel, send       |
  *       |                            revoke/revokeBatch msg      |
@@ -95,6 +254,12 @@ void CapTable::setparent_and_set(mht_key_t parent, Capability *child, capsel_t d
  *       v
  *   [REMOVE_CHILD_PTR] --> tell parent to remove child pointer (local or remote)
  *
+ * The tree is walked depth-first with an explicit work-list of RevokeFrames
+ * instead of recursion, so the stack use does not depend on the depth of the
+ * tree. A frame finishes once all its local children are done; its remote
+ * children are sent then, and its awaited responses are added to its parent
+ * frame, which subscribes to it.
+ *
  * Concurrent revocations on overlapping subtrees:
  *   If a child is currently being revoked (found in RevocationList but not in MHT),
  *   the current revocation subscribes to the ongoing one. When the ongoing revocation
@@ -102,7 +267,7 @@ void CapTable::setparent_and_set(mht_key_t parent, Capability *child, capsel_t d
  *
  * Thread model:
  *   Only the revocation root blocks a thread (wait_for). Intermediate nodes in the
- *   revocation tree return their awaitedResp count to the caller, avoiding thread
+ *   revocation tree hand their awaitedResp count to their parent, avoiding thread
  *   exhaustion during deep cascading revocations.
  *
  * @param c       The capability to revoke (must not be nullptr)
@@ -111,162 +276,89 @@ void CapTable::setparent_and_set(mht_key_t parent, Capability *child, capsel_t d
  * @return        Number of outstanding remote revocations (0 if all completed locally)
  */
 int CapTable::revoke_rec(Capability *c, mht_key_t origin, m3::CapRngDesc::Type type) {
-    mht_key_t parent = (type == m3::CapRngDesc::Type::OBJ) ?
-        (c->_parent | TYPE_MASK_OCAP) : (c->_parent | TYPE_MASK_MCAP);
-    mht_key_t id = (type == m3::CapRngDesc::Type::OBJ) ?
-        (c->_id | TYPE_MASK_OCAP) : (c->_id | TYPE_MASK_MCAP);
-    Revocation *ongoing = nullptr;
-
-    // reset the child-pointer since we're revoking all childs
-    // note that we would need to do much more if delegatable capabilities could deny a revoke
-    c->setRevoking(true);
-    m3::SList<Capability::Child> children = m3::Util::move(c->_children);
+    m3::SList<RevokeFrame> work;
+    work.insert(nullptr, begin_revoke(c, type));
+    int awaited = 0;
 
-    m3::Errors::Code res = c->revoke();
-    // actually, this is a bit specific for service+session. although it failed to revoke the service
-    // we want to revoke all childs, i.e. the sessions to remove them from the service.
-    // TODO if there are other failable revokes, we need to reconsider that
-    if(res == m3::Errors::NO_ERROR)
-        c->table()->unset(c->sel());
-    else {
-        // Fail fast here to speed up automated benchmarks
-        KLOG(ERR, "Error (" << res << ") during revocation of cap " << PRINT_HASH(id));
-        m3::Machine::shutdown();
-    }
-    // TODO
-    // change revocation of service capabilities so revoke is actually error free
+    while(work.length() > 0) {
+        RevokeFrame *f = &*work.begin();
 
-    // Collect remote children grouped by destination kernel for batched sending.
-    // Use a simple array since max kernels is bounded by KRNLC_SLOTS.
-    static const uint MAX_BATCH_CAPIDS = 64;
-    struct RemoteBatch {
-        membership_entry::krnl_id_t krnlId;
-        mht_key_t capIDs[MAX_BATCH_CAPIDS];
-        uint count;
-    };
-    static RemoteBatch batches[KernelcallHandler::KRNLC_SLOTS];
-    memset(batches, 0, sizeof(batches));
-    uint numBatches = 0;
-
-    // Helper lambda to flush a single batch (send its accumulated capIDs)
-    auto flushBatch = [&ongoing, &id, &parent, &origin](RemoteBatch &batch) {
-        if(!ongoing)
-            ongoing = RevocationList::get().add(id, parent, origin);
-        ongoing->awaitedResp += batch.count;
-        if(batch.count == 1) {
-            Kernelcalls::get().revoke(Coordinator::get().getKPE(batch.krnlId),
-                batch.capIDs[0], id, origin);
-        }
-        else {
-            Kernelcalls::get().revokeBatch(Coordinator::get().getKPE(batch.krnlId),
-                id, origin, batch.capIDs, batch.count);
-        }
-        batch.count = 0;
-    };
+        Capability::Child *child = f->local.remove_first();
+        if(child) {
+            mht_key_t childID = child->id;
+            delete child;
 
-    for(auto it : children) {
-        membership_entry::krnl_id_t authority = MHTInstance::getInstance().responsibleMember(it.id);
-        if(authority == Coordinator::get().kid()) {
-            const MHTItem &childIt = MHTInstance::getInstance().get(it.id);
+            const MHTItem &childIt = MHTInstance::getInstance().get(childID);
             if(childIt.isEmpty()) {
                 // check whether this child is part of an ongoing revocation
                 Revocation *childRevoke = RevocationList::get().find(childIt.getKey());
                 if(childRevoke) {
-                    if(!ongoing)
-                        ongoing = RevocationList::get().add(id, parent, origin);
-                    childRevoke->subscribe(ongoing);
-                    ongoing->awaitedResp++;
+                    if(!f->ongoing)
+                        f->ongoing = RevocationList::get().add(f->id, f->parent, origin);
+                    childRevoke->subscribe(f->ongoing);
+                    f->ongoing->awaitedResp++;
                 }
             }
             else {
-                int add = revoke_rec(childIt.getData<Capability>(), origin, type);
-                // If the revocation of that child caused remote requests,
-                // we have to subscribe to that revocation.
-                if(add) {
-                    if(!ongoing)
-                        ongoing = RevocationList::get().add(id, parent, origin);
-                    ongoing->awaitedResp += add;
-                    RevocationList::get().find(it.id)->subscribe(ongoing);
-                }
+                f->childID = childID;
+                work.insert(nullptr, begin_revoke(childIt.getData<Capability>(), type));
             }
-        }
-        else {
-            // Find or create batch for this kernel
-            uint batchIdx = numBatches;
-            for(uint b = 0; b < numBatches; b++) {
-                if(batches[b].krnlId == authority) {
-                    batchIdx = b;
-                    break;
-                }
-            }
-            if(batchIdx == numBatches) {
-                batches[numBatches].krnlId = authority;
-                batches[numBatches].count = 0;
-                numBatches++;
-            }
-            // Flush batch if full to prevent buffer overflow
-            if(batches[batchIdx].count >= MAX_BATCH_CAPIDS)
-                flushBatch(batches[batchIdx]);
-            batches[batchIdx].capIDs[batches[batchIdx].count++] = it.id;
-        }
-    }
-
-    // Send remaining batched revocation messages
-    for(uint b = 0; b < numBatches; b++) {
-        if(batches[b].count == 0)
             continue;
-        if(!ongoing)
-            ongoing = RevocationList::get().add(id, parent, origin);
-        ongoing->awaitedResp += batches[b].count;
-        if(batches[b].count == 1) {
-            Kernelcalls::get().revoke(Coordinator::get().getKPE(batches[b].krnlId),
-                batches[b].capIDs[0], id, origin);
-        }
-        else {
-            Kernelcalls::get().revokeBatch(Coordinator::get().getKPE(batches[b].krnlId),
-                id, origin, batches[b].capIDs, batches[b].count);
         }
-    }
-
-    // Once all directly reachable children are done, check if some of them were remote.
-    // 1. If we are the revocation root this thread is going to wait for incoming responses.
-    // 2. If we are not the revocation root: (TL;DR: do nothing)
-    // 2.1. If the parent is local, the number of awaited responses will be returned by
-    //      revoke_rec() and thus added to the parent's awaitedResp counter.
-    // 2.2. If the parent is remote this thread is done.
-    //      The incoming responses will be handled by the KernelcallHandler.
 
+        // all local children are done; now the remote ones
+        send_remote_revokes(f, origin);
+        work.remove_first();
 
+        // Once all directly reachable children are done, check if some of them were remote.
+        // 1. If we are the revocation root this thread is going to wait for incoming responses.
+        // 2. If we are not the revocation root: (TL;DR: do nothing)
+        // 2.1. If the parent is local, the number of awaited responses is added to the
+        //      parent frame's awaitedResp counter below.
+        // 2.2. If the parent is remote this thread is done.
+        //      The incoming responses will be handled by the KernelcallHandler.
+        if(f->id == origin) {
+            if(f->ongoing) {
+                if(f->ongoing->awaitedResp > 0) { // remote revokes appeared
+                    // wait for the outstanding revokes to finish
+                    int mytid = m3::ThreadManager::get().current()->id();
+                    m3::ThreadManager::get().wait_for(reinterpret_cast<void*>(mytid));
+                    CAP_BENCH_TRACE_X_F(KERNEL_REV_THRD_WAKEUP);
+                    // this thread will be notified once all responses arrived
+                    KLOG_V(KRNLC, "Continued revoke for cap " << PRINT_HASH(f->id) << ". Finishing revoke");
+                }
+                // remove ongoing entry
+                f->ongoing->notifySubscribers();
+                RevocationList::get().remove(f->id);
+                f->ongoing = nullptr;
+            }
 
-    if(id == origin) {
-        if(ongoing) {
-            if( ongoing->awaitedResp > 0) { // remote revokes appeared
-                // wait for the outstanding revokes to finish
-                int mytid = m3::ThreadManager::get().current()->id();
-                m3::ThreadManager::get().wait_for(reinterpret_cast<void*>(mytid));
-                CAP_BENCH_TRACE_X_F(KERNEL_REV_THRD_WAKEUP);
-                // this thread will be notified once all responses arrived
-                KLOG_V(KRNLC, "Continued revoke for cap " << PRINT_HASH(id) << ". Finishing revoke");
+            // revocation finished, tell parent to removes the child ptr to this cap
+            if(f->parent & ~TYPE_MASK_CAP) {
+                membership_entry::krnl_id_t parentAuthority =
+                    MHTInstance::getInstance().responsibleKrnl(HashUtil::hashToPeId(f->parent));
+                if(parentAuthority == Coordinator::get().kid())
+                    MHTInstance::getInstance().get(f->parent).getData<Capability>()->removeChildAllTypes(f->id);
+                else
+                    Kernelcalls::get().removeChildCapPtr(Coordinator::get().getKPE(parentAuthority),
+                        DDLCapRngDesc(f->parent, 1), DDLCapRngDesc(f->id, 1));
             }
-        // remove ongoing entry
-            ongoing->notifySubscribers();
-            RevocationList::get().remove(id);
-            ongoing = nullptr;
         }
 
-        // revocation finished, tell parent to removes the child ptr to this cap
-        if(parent & ~TYPE_MASK_CAP) {
-            membership_entry::krnl_id_t parentAuthority =
-                MHTInstance::getInstance().responsibleKrnl(HashUtil::hashToPeId(parent));
-            if(parentAuthority == Coordinator::get().kid())
-                MHTInstance::getInstance().get(parent).getData<Capability>()->removeChildAllTypes(id);
-            else
-                Kernelcalls::get().removeChildCapPtr(Coordinator::get().getKPE(parentAuthority),
-                    DDLCapRngDesc(parent, 1), DDLCapRngDesc(id, 1));
+        awaited = f->ongoing ? f->ongoing->awaitedResp : 0;
+        delete f;
+
+        // If the revocation of that child caused remote requests,
+        // the parent has to subscribe to that revocation.
+        if(awaited && work.length() > 0) {
+            RevokeFrame *p = &*work.begin();
+            if(!p->ongoing)
+                p->ongoing = RevocationList::get().add(p->id, p->parent, origin);
+            p->ongoing->awaitedResp += awaited;
+            RevocationList::get().find(p->childID)->subscribe(p->ongoing);
         }
     }
-
-    return ongoing ? ongoing->awaitedResp : 0;
+    return awaited;
 }
 
 int CapTable::revoke(Capability *c, mht_key_t capID, mht_key_t origin) {
@@ -295,10 +387,7 @@ int CapTable::revoke(Capability *c, mht_key_t capID, mht_key_t origin) {
         if(ongoingRevoke) {
             // Note: We only add this revocation as a subscriber to the existing
             //       Revocation entry (which is for the same capID)
-            Revocation *subscriber = new Revocation(capID, ongoingRevoke->parent, origin, 1,
-                (capID == origin) ? m3::ThreadManager::get().current()->id() : -1);
-            ongoingRevoke->subscribe(subscriber);
-
+            ongoingRevoke->subscribe(capID);
 
             if(capID == origin) {
                 // If this cap is the revocation root, this thread waits for it to finish.
@@ -375,7 +464,14 @@ m3::Errors::Code CapTable::revoke(const m3::CapRngDesc &crd, bool own) {
                         if(!ongoing)
                             ongoing = RevocationList::get().add(id, id, origin);
                         ongoing->awaitedResp++;
-                        Kernelcalls::get().revoke(Coordinator::get().getKPE(authority), it.id, id, origin);
+                        m3::Errors::Code sendRes = Kernelcalls::get().revoke(
+                            Coordinator::get().getKPE(authority), it.id, id, origin);
+                        // no response will come for it; don't let the revocation wait for it
+                        if(sendRes != m3::Errors::NO_ERROR) {
+                            KLOG(ERR, "Sending revocation of " << PRINT_HASH(it.id) << " to kernel #"
+                                << authority << " failed (" << sendRes << ")");
+                            ongoing->awaitedResp--;
+                        }
                     }
                 }
 
@@ -402,7 +498,7 @@ m3::Errors::Code CapTable::revoke(const m3::CapRngDesc &crd, bool own) {
 
 m3::OStream &operator<<(m3::OStream &os, const CapTable &ct) {
     os << "CapTable[" << ct.id() << "]:\n";
-    ct._caps.print(os, false);
+    ct._caps.print(os);
     return os;
 }
 
@@ -18,24 +18,25 @@
 #pragma once
 
 #include <base/Common.h>
-#include <base/col/Treap.h>
 #include <base/col/SList.h>
 #include <base/util/CapRngDesc.h>
 
 #include "com/Services.h"
 #include "cap/Capability.h"
+#include "cap/CapArray.h"
 #include "cap/Revocations.h"
 
 namespace kernel {
 
 class CapTable;
+struct RevokeFrame;
 
 m3::OStream &operator<<(m3::OStream &os, const CapTable &ct);
 
 class CapTable {
     friend m3::OStream &operator<<(m3::OStream &os, const CapTable &ct);
 
-    struct Reservation : public m3::SListItem {
+    struct Reservation : public SlabObject<Reservation>, public m3::SListItem {
         Reservation(capsel_t _key) : key(_key) {}
         capsel_t key;
     };
@@ -61,22 +62,10 @@ public:
         return get(i) != nullptr;
     }
     bool range_unused(const m3::CapRngDesc &crd) const {
-        if(!range_valid(crd))
-            return false;
-        for(capsel_t i = crd.start(); i < crd.start() + crd.count(); ++i) {
-            if(get(i) != nullptr)
-                return false;
-        }
-        return true;
+        return range_valid(crd) && _caps.range_is(crd.start(), crd.count(), false);
     }
     bool range_used(const m3::CapRngDesc &crd) const {
-        if(!range_valid(crd))
-            return false;
-        for(capsel_t i = crd.start(); i < crd.start() + crd.count(); ++i) {
-            if(get(i) == nullptr)
-                return false;
-        }
-        return true;
+        return range_valid(crd) && _caps.range_is(crd.start(), crd.count(), true);
     }
 
     Capability *obtain(capsel_t dst, Capability *c);
@@ -139,6 +128,7 @@ public:
     void revoke_all();
 
 private:
+    static RevokeFrame *begin_revoke(Capability *c, m3::CapRngDesc::Type type);
     static int revoke_rec(Capability *c, mht_key_t origin, m3::CapRngDesc::Type type);
     bool range_valid(const m3::CapRngDesc &crd) const {
         return crd.count() == 0 || crd.start() + crd.count() > crd.start();
@@ -146,7 +136,7 @@ private:
 
     uint _id;
     m3::CapRngDesc::Type _type;
-    m3::Treap<Capability> _caps;
+    CapArray<Capability> _caps;
     m3::SList<Reservation> _reserved;
 };
 
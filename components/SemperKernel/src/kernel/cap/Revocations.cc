@@ -23,9 +23,9 @@ namespace kernel {
 RevocationList RevocationList::_inst;
 
 void Revocation::notifySubscribers() {
-    for (auto sub = subscribers.begin(); sub != subscribers.end();) {
-        auto curSub = sub++;
-        Revocation *entry = RevocationList::get().find(curSub->rev->capID);
+    // index-based: notifying may subscribe more revocations to this one
+    for(size_t i = 0; i < subscribers.length(); i++) {
+        Revocation *entry = RevocationList::get().find(subscribers[i]);
         if(entry) {
             entry->awaitedResp--;
 
@@ -53,10 +53,8 @@ void Revocation::notifySubscribers() {
                 }
             }
         }
-
-        subscribers.remove(&*curSub);
-        delete &*curSub;
     }
+    subscribers.clear();
 }
 
 
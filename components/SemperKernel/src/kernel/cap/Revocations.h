@@ -17,21 +17,67 @@
 
 #pragma once
 
-#include <base/col/SList.h>
-
 #include "ddl/MHTTypes.h"
+#include "mem/SlabCache.h"
 
 namespace kernel {
 
 struct Revocation;
 
-struct RevocationSub : m3::SListItem {
-    explicit RevocationSub(Revocation *_rev) : rev(_rev) {}
+/**
+ * The revocations waiting for one revocation to finish, by cap ID. The
+ * first INLINE_SUBS are stored in place, so the common case of one or two
+ * waiting parents does not allocate.
+ */
+class RevocationSubs {
+    static const size_t INLINE_SUBS = 4;
+
+public:
+    explicit RevocationSubs() : _heap(nullptr), _count(0), _cap(INLINE_SUBS) {
+    }
+    RevocationSubs(const RevocationSubs &) = delete;
+    RevocationSubs &operator=(const RevocationSubs &) = delete;
+    ~RevocationSubs() {
+        delete[] _heap;
+    }
+
+    size_t length() const {
+        return _count;
+    }
+    mht_key_t operator[](size_t i) const {
+        return _heap ? _heap[i] : _inline[i];
+    }
+
+    void append(mht_key_t capID) {
+        if(_count == _cap) {
+            mht_key_t *subs = new mht_key_t[_cap * 2];
+            for(size_t i = 0; i < _count; i++)
+                subs[i] = (*this)[i];
+            delete[] _heap;
+            _heap = subs;
+            _cap *= 2;
+        }
+        if(_heap)
+            _heap[_count++] = capID;
+        else
+            _inline[_count++] = capID;
+    }
+
+    void clear() {
+        delete[] _heap;
+        _heap = nullptr;
+        _count = 0;
+        _cap = INLINE_SUBS;
+    }
 
-    Revocation *rev;
+private:
+    mht_key_t _inline[INLINE_SUBS];
+    mht_key_t *_heap;
+    size_t _count;
+    size_t _cap;
 };
 
-struct Revocation {
+struct Revocation : public SlabObject<Revocation> {
     explicit Revocation(mht_key_t _capID, mht_key_t _parent, mht_key_t _origin, int _awaitedResp, int _tid)
     : capID(_capID), parent(_parent), origin(_origin), awaitedResp(_awaitedResp), tid(_tid), subscribers() {
 #ifndef NDEBUG
@@ -53,7 +99,10 @@ struct Revocation {
     }
 
     void subscribe(Revocation *sub) {
-        subscribers.append(new RevocationSub(sub));
+        subscribe(sub->capID);
+    }
+    void subscribe(mht_key_t subID) {
+        subscribers.append(subID);
     }
     void notifySubscribers();
 
@@ -62,23 +111,20 @@ struct Revocation {
     mht_key_t origin; // cap which started revocation
     int awaitedResp; // own awaited resps
     int tid; // tid of origin's thread
-    m3::SList<RevocationSub> subscribers; // revocations waiting for this one to finish
+    RevocationSubs subscribers; // revocations waiting for this one to finish
 };
 
 class RevocationList {
-    // Open-addressing hash table size (must be power of 2).
-    // Bounded by: threads * kernels in-flight revocations. 256 is generous.
-    static const size_t HASH_CAP = 256;
-    static const size_t HASH_MASK = HASH_CAP - 1;
+    // Initial size of the open-addressing table (must be power of 2). It
+    // doubles whenever it gets 3/4 full.
+    static const size_t MIN_CAP = 256;
 
     // Fibonacci hash for 64-bit keys
-    static size_t hash_index(mht_key_t key) {
-        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> 56) & HASH_MASK;
+    size_t hash_index(mht_key_t key) const {
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> 32) & (_cap - 1);
     }
 
-    explicit RevocationList() : _count(0) {
-        for(size_t i = 0; i < HASH_CAP; i++)
-            _buckets[i] = nullptr;
+    explicit RevocationList() : _buckets(nullptr), _cap(0), _count(0) {
     }
 public:
 
@@ -92,16 +138,11 @@ public:
         if(find_exact(cap) != nullptr)
             PANIC("Cannot insert second entry for revocation of cap: " << PRINT_HASH(cap));
 #endif
-        if(_count >= HASH_CAP)
-            PANIC("RevocationList full (" << _count << "/" << HASH_CAP
-                << ") while inserting cap: " << PRINT_HASH(cap));
+        if((_count + 1) * 4 > _cap * 3)
+            grow();
         Revocation *rev = new Revocation(cap, parent, origin, 0,
                 (origin == cap) ? m3::ThreadManager::get().current()->id() : -1);
-        size_t idx = hash_index(cap);
-        while(_buckets[idx] != nullptr)
-            idx = (idx + 1) & HASH_MASK;
-        _buckets[idx] = rev;
-        _count++;
+        insert(rev);
         return rev;
     }
 
@@ -117,48 +158,69 @@ public:
      * @param cap       The cap ID to remove
      */
     void remove(mht_key_t cap) {
+        if(_count == 0)
+            return;
+        size_t mask = _cap - 1;
         size_t idx = hash_index(cap);
         while(_buckets[idx] != nullptr) {
             if(_buckets[idx]->capID == cap) {
-                Revocation *rev = _buckets[idx];
-                _buckets[idx] = nullptr;
+                delete _buckets[idx];
                 _count--;
-                // Re-insert displaced entries (Robin Hood fixup)
-                size_t next = (idx + 1) & HASH_MASK;
-                while(_buckets[next] != nullptr) {
-                    Revocation *displaced = _buckets[next];
-                    _buckets[next] = nullptr;
-                    _count--;
-                    reinsert(displaced);
-                    next = (next + 1) & HASH_MASK;
+                // Backward-shift deletion: pull later members of the probe
+                // run into the hole, so lookups never need tombstones.
+                size_t hole = idx;
+                for(size_t i = (hole + 1) & mask; _buckets[i] != nullptr; i = (i + 1) & mask) {
+                    size_t home = hash_index(_buckets[i]->capID);
+                    // move it if its home is not within (hole, i]
+                    if(((i - home) & mask) >= ((i - hole) & mask)) {
+                        _buckets[hole] = _buckets[i];
+                        hole = i;
+                    }
                 }
-                delete rev;
+                _buckets[hole] = nullptr;
                 return;
             }
-            idx = (idx + 1) & HASH_MASK;
+            idx = (idx + 1) & mask;
         }
     }
 
 private:
     Revocation *find_exact(mht_key_t cap) {
+        if(_count == 0)
+            return nullptr;
         size_t idx = hash_index(cap);
         while(_buckets[idx] != nullptr) {
             if(_buckets[idx]->capID == cap)
                 return _buckets[idx];
-            idx = (idx + 1) & HASH_MASK;
+            idx = (idx + 1) & (_cap - 1);
         }
         return nullptr;
     }
 
-    void reinsert(Revocation *rev) {
+    void insert(Revocation *rev) {
         size_t idx = hash_index(rev->capID);
         while(_buckets[idx] != nullptr)
-            idx = (idx + 1) & HASH_MASK;
+            idx = (idx + 1) & (_cap - 1);
         _buckets[idx] = rev;
         _count++;
     }
 
-    Revocation *_buckets[HASH_CAP];
+    void grow() {
+        Revocation **old = _buckets;
+        size_t oldcap = _cap;
+
+        _cap = oldcap ? oldcap * 2 : MIN_CAP;
+        _buckets = new Revocation*[_cap]();
+        _count = 0;
+        for(size_t i = 0; i < oldcap; i++) {
+            if(old[i])
+                insert(old[i]);
+        }
+        delete[] old;
+    }
+
+    Revocation **_buckets;
+    size_t _cap;
     size_t _count;
     static RevocationList _inst;
 };
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2019, Matthias Hille <matthias.hille@tu-dresden.de>,
+ * Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of SemperOS.
+ *
+ * SemperOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * SemperOS is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#include <base/log/Kernel.h>
+
+#include "ddl/MHTCache.h"
+#include "cap/Capability.h"
+
+namespace kernel {
+
+const MHTItem *MHTCache::find(mht_key_t key, membership_entry::krnl_id_t krnl) {
+    Slot &s = _slots[slot_of(key)];
+    if(s.item._mht_key == key) {
+        if(s.krnl == krnl) {
+            _stats.hits++;
+            return &s.item;
+        }
+        // the PE has got another owner in the meantime
+        drop(s);
+    }
+    _stats.misses++;
+    return nullptr;
+}
+
+const MHTItem &MHTCache::insert(MHTItem &item, membership_entry::krnl_id_t krnl, uint gen) {
+    // it might be gone already
+    if(gen != _gen)
+        return item;
+
+    Slot &s = _slots[slot_of(item._mht_key)];
+    drop(s);
+    KLOG(MHT, "Caching remote item " << PRINT_HASH(item._mht_key) << " of kernel #" << krnl);
+    s.item._mht_key = item._mht_key;
+    s.item.length = item.length;
+    s.item.data = item.data;
+    s.krnl = krnl;
+    item.data = nullptr;
+    return s.item;
+}
+
+void MHTCache::invalidate(mht_key_t key) {
+    // also if it is not here: it might be on its way
+    _gen++;
+    Slot &s = _slots[slot_of(key)];
+    if(s.item._mht_key == key)
+        drop(s);
+}
+
+void MHTCache::invalidatePE(membership_entry::pe_id_t pe) {
+    _gen++;
+    for(size_t i = 0; i < SLOTS; i++) {
+        if(!_slots[i].item.isEmpty() && HashUtil::hashToPeId(_slots[i].item._mht_key) == pe)
+            drop(_slots[i]);
+    }
+}
+
+void MHTCache::revalidate(const membership_entry *members) {
+    _gen++;
+    for(size_t i = 0; i < SLOTS; i++) {
+        Slot &s = _slots[i];
+        if(s.item.isEmpty())
+            continue;
+        const membership_entry &m = members[HashUtil::hashToPeId(s.item._mht_key)];
+        if(m.krnl_id != s.krnl || (m.flags & MIGRATING))
+            drop(s);
+    }
+}
+
+void MHTCache::clear() {
+    for(size_t i = 0; i < SLOTS; i++) {
+        if(!_slots[i].item.isEmpty())
+            drop(_slots[i]);
+    }
+}
+
+void MHTCache::drop(Slot &s) {
+    if(s.item.isEmpty())
+        return;
+    KLOG(MHT, "Dropping cached remote item " << PRINT_HASH(s.item._mht_key));
+    // the data has been created by MHTItem::deserialize()
+    switch(HashUtil::hashToType(s.item._mht_key)) {
+        case SRVCAP:
+            delete static_cast<ServiceCapability*>(s.item.data);
+            break;
+        case VPECAP:
+            delete static_cast<VPECapability*>(s.item.data);
+            break;
+        default:
+            break;
+    }
+    s.item.data = nullptr;
+    s.item._mht_key = 0;
+    s.item.length = 0;
+    _stats.drops++;
+}
+
+}
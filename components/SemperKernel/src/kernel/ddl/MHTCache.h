@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2019, Matthias Hille <matthias.hille@tu-dresden.de>,
+ * Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of SemperOS.
+ *
+ * SemperOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * SemperOS is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include "MHTTypes.h"
+
+namespace kernel {
+
+/**
+ * A bounded cache for items that have been fetched from other kernels. It only takes types whose
+ * content does not change while the item exists, i.e., service and VPE capabilities.
+ *
+ * The cache is direct-mapped. An entry is dropped when the next fetched item maps to its slot,
+ * when a revocation names it, when its owner reports that it has been revoked there (see
+ * MHTInstance::dropCached()), when its PE gets another owner or starts migrating, or when its
+ * partition is received by this kernel. The returned references are valid until the calling
+ * thread blocks, like the results of remote lookups.
+ *
+ * A fetch may be overtaken by the report that its item is gone. Every drop therefore advances a
+ * generation number, and an item is only cached if the generation did not change while it was
+ * fetched.
+ */
+class MHTCache {
+public:
+    static const size_t SLOT_BITS   = 6;
+    static const size_t SLOTS       = 1 << SLOT_BITS;
+
+    struct Stats {
+        size_t hits;
+        size_t misses;
+        size_t drops;
+    };
+
+    static bool cacheable(mht_key_t key) {
+        ItemType type = HashUtil::hashToType(key);
+        return type == SRVCAP || type == VPECAP;
+    }
+
+    explicit MHTCache() : _slots(), _stats(), _gen() {
+    }
+    MHTCache(const MHTCache &) = delete;
+    MHTCache &operator=(const MHTCache &) = delete;
+    ~MHTCache() {
+        clear();
+    }
+
+    /**
+     * @param key   the key of a cacheable item
+     * @param krnl  the kernel that is currently responsible for <key>
+     * @return the cached item or nullptr
+     */
+    const MHTItem *find(mht_key_t key, membership_entry::krnl_id_t krnl);
+
+    /**
+     * @return the generation to pass to insert() for a fetch that is about to be sent
+     */
+    uint generation() const {
+        return _gen;
+    }
+
+    /**
+     * Caches <item>, which has been fetched from kernel <krnl>, and takes over its data, unless
+     * entries have been dropped since generation <gen>.
+     *
+     * @return the cached item or <item>
+     */
+    const MHTItem &insert(MHTItem &item, membership_entry::krnl_id_t krnl, uint gen);
+
+    void invalidate(mht_key_t key);
+    void invalidatePE(membership_entry::pe_id_t pe);
+
+    /**
+     * Drops all entries whose PE is no longer owned by the kernel they have been fetched from,
+     * according to <members>.
+     */
+    void revalidate(const membership_entry *members);
+
+    void clear();
+
+    const Stats &stats() const {
+        return _stats;
+    }
+
+private:
+    struct Slot {
+        explicit Slot() : item(0U), krnl() {
+        }
+        MHTItem item;
+        membership_entry::krnl_id_t krnl;
+    };
+
+    static size_t slot_of(mht_key_t key) {
+        return (key * 0x9E3779B97F4A7C15ULL) >> (64 - SLOT_BITS);
+    }
+
+    void drop(Slot &s);
+
+    Slot _slots[SLOTS];
+    Stats _stats;
+    uint _gen;
+};
+
+}
@@ -35,7 +35,7 @@ MHTInstance *MHTInstance::_inst;
 MHTInstance::nextResItem MHTInstance::nextIdx;
 MHTItem MHTInstance::resItems[3];
 
-MHTInstance::MHTInstance() {
+MHTInstance::MHTInstance() : partitions(), _remoteCache(), _fetchedBy() {
     KLOG(MHT, "Initializing DDL.\n\tID bits=" << ID_BITS << ", max PEs=" << MAX_PES_DDL <<
         ", PE bits=" << PE_BITS << ",\n\tVPE bits=" << VPE_BITS << ", type bits=" <<
         TYPE_BITS << ", hash bits=" << HASH_BITS << ",\n\ttype mask=" << m3::fmt(TYPE_MASK, "0x#", ID_BITS/4));
@@ -48,8 +48,7 @@ MHTInstance::MHTInstance() {
     size_t kid = Coordinator::get().kid();
     for(membership_entry::pe_id_t i = 0; i < Platform::pe_count(); i++) {
         memberTable[i] = {i, static_cast<membership_entry::krnl_id_t>(kid), 1, MembershipFlags::NONE};
-        PartitionEntry *p = new PartitionEntry(new MHTPartition(i));
-        partitions.append(p);
+        partitions[i] = new MHTPartition(i);
     }
 
     // handle unused slots in the ID space
@@ -57,8 +56,7 @@ MHTInstance::MHTInstance() {
         // create partitions
         for(membership_entry::pe_id_t i = Platform::pe_count(); i < MAX_PES_DDL; i++) {
             memberTable[i] = {i, static_cast<membership_entry::krnl_id_t>(kid), 1, MembershipFlags::UNPOPULATED};
-            PartitionEntry *p = new PartitionEntry(new MHTPartition(i));
-            partitions.append(p);
+            partitions[i] = new MHTPartition(i);
         }
     }
 }
@@ -77,6 +75,7 @@ m3::Errors::Code MHTInstance::put(MHTItem &&kv_pair) {
         // check if the partition currently migrates and forward the request if so
         if(dest == nullptr)
             dest = MHTInstance::getInstance().getMigrationDestination(HashUtil::hashToPeId(kv_pair._mht_key));
+        _remoteCache.invalidate(kv_pair._mht_key);
         if(dest != nullptr)
             Kernelcalls::get().mhtput(dest, m3::Util::move(kv_pair));
         else {
@@ -97,6 +96,7 @@ m3::Errors::Code MHTInstance::putUnlocking(MHTItem &&item, uint lockHandle) {
     } else {
         // the partition is remote, transfer data to the remote node
         membership_entry::krnl_id_t krnlID = responsibleMember(item._mht_key);
+        _remoteCache.invalidate(item._mht_key);
         Kernelcalls::get().mhtputUnlocking(Coordinator::get().getKPE(krnlID), m3::Util::move(item), lockHandle);
         return m3::Errors::NO_ERROR;
     }
@@ -172,9 +172,19 @@ const MHTItem &MHTInstance::get(mht_key_t mht_key, bool locking) {
         }
     } else {
         KLOG(MHT, "Request is remote");
+        membership_entry::krnl_id_t krnl = responsibleMember(mht_key);
+        bool cacheable = !locking && MHTCache::cacheable(mht_key) &&
+            !(memberTable[HashUtil::hashToPeId(mht_key)].flags & MIGRATING);
+        if(cacheable) {
+            const MHTItem *cached = _remoteCache.find(mht_key, krnl);
+            if(cached)
+                return *cached;
+        }
+
         // request has to be served by another kernel
         // the request is identified by the current thread's ID
-        KPE *remoteKrnl = Coordinator::get().getKPE(responsibleMember(mht_key));
+        uint gen = _remoteCache.generation();
+        KPE *remoteKrnl = Coordinator::get().getKPE(krnl);
         if(locking)
             Kernelcalls::get().mhtgetLocking(remoteKrnl, mht_key);
         else
@@ -184,7 +194,11 @@ const MHTItem &MHTInstance::get(mht_key_t mht_key, bool locking) {
                 reinterpret_cast<void*>(m3::ThreadManager::get().current()->id()));
         // when the thread is resumed the thread's message buffer contains the result
         assert(m3::ThreadManager::get().get_current_msg() != nullptr);
-        const MHTItem *res = reinterpret_cast<const MHTItem*>(m3::ThreadManager::get().get_current_msg());
+        MHTItem *res = reinterpret_cast<MHTItem*>(
+            const_cast<unsigned char*>(m3::ThreadManager::get().get_current_msg()));
+        // if the PE got another owner meanwhile, the next find() drops the entry again
+        if(cacheable && res->validData())
+            return _remoteCache.insert(*res, krnl, gen);
         return *res;
     }
     }
@@ -266,6 +280,184 @@ m3::Errors::Code MHTInstance::release(mht_key_t mht_key, uint reservation) {
     }
 }
 
+void MHTInstance::run(MHTBatch &batch) {
+    KLOG(MHT, "Running batch of " << batch._count << " operations");
+
+    bool remote = false;
+    for(uint i = 0; i < batch._count; i++) {
+        MHTBatch::Op &op = batch._ops[i];
+        if(findPartition(op.key)) {
+            // copy the result right away, get() reuses its result items
+            if(op.op == Kernelcalls::MHTGET)
+                op.borrow(get(op.key));
+            else
+                op.err = put(m3::Util::move(op.item));
+            op.done = true;
+            continue;
+        }
+
+        if(op.op == Kernelcalls::MHTGET && MHTCache::cacheable(op.key) &&
+            !(memberTable[HashUtil::hashToPeId(op.key)].flags & MIGRATING)) {
+            const MHTItem *cached = _remoteCache.find(op.key, responsibleMember(op.key));
+            if(cached) {
+                op.borrow(*cached);
+                op.done = true;
+                continue;
+            }
+        }
+        else if(op.op == Kernelcalls::MHTPUT) {
+            // it would never fit into a message
+            if(op.serializedSize() > Kernelcalls::MAX_MHT_BATCH_PAYLOAD) {
+                KLOG(ERR, "Item " << PRINT_HASH(op.key) << " too large for a batch");
+                op.err = m3::Errors::NO_SPACE;
+                op.done = true;
+                continue;
+            }
+            _remoteCache.invalidate(op.key);
+        }
+        remote = true;
+    }
+    if(!remote)
+        return;
+
+    m3::ThreadManager &tmng = m3::ThreadManager::get();
+    int tid = tmng.current()->id();
+    _batches.put(tid, &batch);
+    while(true) {
+        for(uint i = 0; i < batch._count; i++)
+            batch._ops[i].sent = false;
+
+        // hold one reference while sending: replies may arrive while we wait for message
+        // slots, but we want to be woken up only once all of them are in
+        batch._awaited = 1;
+        for(uint i = 0; i < batch._count; i++) {
+            if(batch._ops[i].done || batch._ops[i].sent)
+                continue;
+
+            // collect the operations for this kernel that fit into one message
+            membership_entry::krnl_id_t krnl = responsibleMember(batch._ops[i].key);
+            size_t size = 0;
+            uint count = 0;
+            for(uint j = i; j < batch._count; j++) {
+                MHTBatch::Op &op = batch._ops[j];
+                if(op.done || op.sent || responsibleMember(op.key) != krnl)
+                    continue;
+                size_t opsize = op.serializedSize();
+                if(size + opsize > Kernelcalls::MAX_MHT_BATCH_PAYLOAD)
+                    continue;
+                size += opsize;
+                op.sent = true;
+                count++;
+            }
+            assert(count > 0);
+
+            AutoGateOStream ops(size, Kernelcalls::ENCODING);
+            for(uint j = i; j < batch._count; j++) {
+                MHTBatch::Op &op = batch._ops[j];
+                if(op.done || !op.sent || responsibleMember(op.key) != krnl)
+                    continue;
+                ops << op.op << j;
+                if(op.op == Kernelcalls::MHTGET)
+                    ops << op.key;
+                else
+                    op.item.serialize(ops);
+            }
+
+            batch._awaited++;
+            Kernelcalls::get().mhtBatch(Coordinator::get().getKPE(krnl), count, ops);
+        }
+
+        if(--batch._awaited > 0)
+            tmng.wait_for(reinterpret_cast<void*>(tid));
+
+        // gets whose results did not fit into the replies are sent again
+        bool open = false;
+        for(uint i = 0; i < batch._count; i++)
+            open |= !batch._ops[i].done;
+        if(!open)
+            break;
+    }
+    _batches.remove(tid);
+}
+
+void MHTInstance::batchRequest(GateIStream &is, int tid, uint count) {
+    // the most a result takes besides the item
+    static constexpr size_t RESULT_SIZE = m3::ostreamsize<uint, m3::Errors::Code, bool>();
+    // run() fills the request up to the same limit, and no operation is smaller than its result
+    assert(count <= MHTBatch::MAX_OPS && count * RESULT_SIZE <= Kernelcalls::MAX_MHT_BATCH_PAYLOAD);
+
+    AutoGateOStream results(Kernelcalls::MAX_MHT_BATCH_PAYLOAD, Kernelcalls::ENCODING);
+    membership_entry::krnl_id_t krnl = is.label();
+    size_t size = 0;
+    uint answered = 0;
+    for(uint i = 0; i < count; i++) {
+        Kernelcalls::Operation op;
+        uint idx;
+        is >> op >> idx;
+        if(op == Kernelcalls::MHTGET) {
+            mht_key_t mht_key;
+            is >> mht_key;
+            // the partition might have been migrated since the request was sent
+            if(!findPartition(mht_key)) {
+                results << idx << m3::Errors::INV_ARGS;
+                size += m3::ostreamsize<uint, m3::Errors::Code>();
+                answered++;
+                continue;
+            }
+
+            // serialize the item right away: the following puts might move it within the table
+            const MHTItem &item = localGet(mht_key, false);
+            size_t itemSize = item.isEmpty() ? 0 : item.serializedSize();
+            // not even a reply of its own could carry it
+            if(RESULT_SIZE + itemSize > Kernelcalls::MAX_MHT_BATCH_PAYLOAD) {
+                KLOG(ERR, "Item " << PRINT_HASH(mht_key) << " too large for a batch reply");
+                results << idx << m3::Errors::NO_SPACE;
+                size += m3::ostreamsize<uint, m3::Errors::Code>();
+                answered++;
+                continue;
+            }
+            // keep room for the results of this and the following operations
+            if(size + (count - i) * RESULT_SIZE + itemSize > Kernelcalls::MAX_MHT_BATCH_PAYLOAD)
+                continue;
+            noteFetch(mht_key, krnl);
+            results << idx << m3::Errors::NO_ERROR << !item.isEmpty();
+            if(!item.isEmpty())
+                item.serialize(results);
+            size += RESULT_SIZE + itemSize;
+        }
+        else {
+            MHTItem input(is);
+            results << idx << put(m3::Util::move(input));
+            size += m3::ostreamsize<uint, m3::Errors::Code>();
+        }
+        answered++;
+    }
+
+    Kernelcalls::get().mhtBatchReply(Coordinator::get().getKPE(krnl), tid, answered, results);
+}
+
+void MHTInstance::batchReply(GateIStream &is, int tid, uint count) {
+    MHTBatch *batch = _batches.get(tid);
+    for(uint i = 0; i < count; i++) {
+        uint idx;
+        m3::Errors::Code err;
+        is >> idx >> err;
+        assert(idx < batch->_count);
+        MHTBatch::Op &op = batch->_ops[idx];
+        op.err = err;
+        if(op.op == Kernelcalls::MHTGET && err == m3::Errors::NO_ERROR) {
+            bool found;
+            is >> found;
+            if(found)
+                op.item = MHTItem(is);
+        }
+        op.done = true;
+    }
+
+    if(--batch->_awaited == 0)
+        m3::ThreadManager::get().notify(reinterpret_cast<void*>(tid), nullptr, 0);
+}
+
 void MHTInstance::migratePartitions(m3::PEDesc pes[], uint numPEs, membership_entry::krnl_id_t receiver) {
     KLOG(MHT, "Migrating " << numPEs << " DDL partitions to kernel #" << (uint)receiver);
     // calculate memory necessary to transmit data
@@ -278,7 +470,7 @@ void MHTInstance::migratePartitions(m3::PEDesc pes[], uint numPEs, membership_en
     }
     // stream content: number of partitions [<< partition number << number of items << items]
     AutoGateOStream ser(m3::vostreamsize(
-        m3::ostreamsize<uint>(), size));
+        m3::ostreamsize<uint>(), size), Kernelcalls::ENCODING);
     ser << numPEs;
     for(size_t i = 0; i < numPEs; i++)
         parts[i]->serialize(ser);
@@ -294,7 +486,13 @@ void MHTInstance::receivePartitions(GateIStream& is) {
         MHTPartition *part = new MHTPartition(0);
         part->deserialize(is);
         assert(findPartition(HashUtil::structured_hash(part->_id, 0, NOTYPE, 0)) == nullptr);
-        partitions.append(new PartitionEntry(part));
+        // drop the outdated copy we might still have from before it was migrated away
+        MHTPartition *old = partitions[part->_id];
+        partitions[part->_id] = part;
+        delete old;
+        _remoteCache.invalidatePE(part->_id);
+        // kernels that fetched from it dropped their entries when the PE got a new owner
+        _fetchedBy[part->_id] = 0;
     }
 }
 
@@ -340,6 +538,7 @@ void MHTInstance::updateMembership(m3::PEDesc releasedPEs[], uint numPEs, member
             memberTable[idx].flags = flags;
         }
     }
+    _remoteCache.revalidate(memberTable);
 }
 
 bool MHTInstance::keyLocality(mht_key_t key) {
@@ -349,6 +548,26 @@ bool MHTInstance::keyLocality(mht_key_t key) {
         return false;
 }
 
+void MHTInstance::noteFetch(mht_key_t key, membership_entry::krnl_id_t krnl) {
+    if(MHTCache::cacheable(key))
+        _fetchedBy[HashUtil::hashToPeId(key)] |= static_cast<uint64_t>(1) << (krnl % 64);
+}
+
+void MHTInstance::dropCached(mht_key_t key) {
+    if(!MHTCache::cacheable(key))
+        return;
+    uint64_t krnls = _fetchedBy[HashUtil::hashToPeId(key)];
+    if(!krnls)
+        return;
+
+    KLOG(MHT, "Revoking cached item " << PRINT_HASH(key));
+    KVStore<size_t, KPE*> &kpes = Coordinator::get().getKPEList();
+    for(auto it = kpes.begin(); it != kpes.end(); it++) {
+        if(krnls & (static_cast<uint64_t>(1) << (it->id % 64)))
+            Kernelcalls::get().mhtInvalidate(it->val, key);
+    }
+}
+
 uint MHTInstance::localPEs() const {
     membership_entry::krnl_id_t kid = Coordinator::get().kid();
     uint count = 0;
@@ -373,20 +592,17 @@ MHTPartition* MHTInstance::findPartition(mht_key_t key) {
         KLOG(MHT, "Partition is not stored locally");
         return nullptr;
     }
-    membership_entry::pe_id_t peId = HashUtil::hashToPeId(key);
-    for(auto it = partitions.begin(); it != partitions.end(); it++) {
-        if(it->partition->_id == peId)
-            return it->partition;
-    }
-    KLOG(ERR, "MHT Partition not found! Key: " << PRINT_HASH(key));
-    return nullptr;
+    MHTPartition *part = partitions[HashUtil::hashToPeId(key)];
+    if(!part)
+        KLOG(ERR, "MHT Partition not found! Key: " << PRINT_HASH(key));
+    return part;
 }
 
 void MHTInstance::printContents() {
     KLOG(MHT, "- Printing content of MHT -");
-    for(auto it = partitions.begin(); it != partitions.end(); it++) {
-        if(it->partition->_count)
-            it->partition->printItems();
+    for(size_t i = 0; i < MAX_PES_DDL; i++) {
+        if(partitions[i] && partitions[i]->count())
+            partitions[i]->printItems();
     }
 }
 
@@ -23,15 +23,112 @@
 #include "pes/KPE.h"
 #include "ddl/MHTTypes.h"
 #include "ddl/MHTPartition.h"
+#include "ddl/MHTCache.h"
 #include "KernelcallHandler.h"
+#include "Kernelcalls.h"
+#include "KVStore.h"
 #include "Coordinator.h"
 #include "Platform.h"
 
 namespace kernel {
 
-struct PartitionEntry : public m3::SListItem {
-    explicit PartitionEntry(MHTPartition *part) : partition(part) {}
-    MHTPartition* partition;
+/**
+ * A set of gets and puts that MHTInstance::run() issues at once: operations on other kernels'
+ * partitions are collected into one MHTBATCH message per kernel and the thread waits for all
+ * replies together instead of a round trip per key.
+ */
+class MHTBatch {
+    friend MHTInstance;
+    friend KernelcallHandler;
+public:
+    static const uint MAX_OPS = 32;
+
+    explicit MHTBatch() : _count(0), _awaited(0) {
+    }
+    MHTBatch(const MHTBatch &) = delete;
+    MHTBatch &operator=(const MHTBatch &) = delete;
+
+    /**
+     * Adds a get of <key>
+     *
+     * @return the index of the operation
+     */
+    uint get(mht_key_t key) {
+        assert(_count < MAX_OPS);
+        _ops[_count].op = Kernelcalls::MHTGET;
+        _ops[_count].key = key;
+        return _count++;
+    }
+
+    /**
+     * Adds a put of <item>, which hands over its data like MHTInstance::put(). The key must not
+     * have been added as a get before, because the put would free the data of its result.
+     *
+     * @return the index of the operation
+     */
+    uint put(MHTItem &&item) {
+        assert(_count < MAX_OPS);
+        for(uint i = 0; i < _count; i++)
+            assert(_ops[i].op != Kernelcalls::MHTGET || _ops[i].key != item.getKey());
+        _ops[_count].op = Kernelcalls::MHTPUT;
+        _ops[_count].key = item.getKey();
+        _ops[_count].item = m3::Util::move(item);
+        return _count++;
+    }
+
+    uint count() const {
+        return _count;
+    }
+
+    /**
+     * @return the item fetched by get <i>; empty if the key does not exist. As for
+     *  MHTInstance::get(), the data of remote items is a copy owned by the caller.
+     */
+    const MHTItem &item(uint i) const {
+        return _ops[i].item;
+    }
+    /**
+     * @return the result of operation <i>; Errors::NO_SPACE if the item does not fit into a
+     *  message to or from the responsible kernel
+     */
+    m3::Errors::Code error(uint i) const {
+        return _ops[i].err;
+    }
+
+private:
+    struct Op {
+        explicit Op() : op(Kernelcalls::MHTGET), key(0), item(0U), err(m3::Errors::NO_ERROR),
+            done(false), sent(false) {
+        }
+
+        void borrow(const MHTItem &src) {
+            item.data = src.data;
+            item._mht_key = src._mht_key;
+            item.length = src.length;
+        }
+
+        // the space the operation takes in an MHTBATCH message
+        size_t serializedSize() const {
+            return op == Kernelcalls::MHTGET
+                ? m3::ostreamsize<Kernelcalls::Operation, uint, mht_key_t>()
+                : m3::vostreamsize(m3::ostreamsize<Kernelcalls::Operation, uint>(),
+                    item.serializedSize());
+        }
+
+        Kernelcalls::Operation op;
+        mht_key_t key;
+        // the item to put or the result of a get
+        MHTItem item;
+        m3::Errors::Code err;
+        bool done;
+        // included in a message of the current round
+        bool sent;
+    };
+
+    Op _ops[MAX_OPS];
+    uint _count;
+    // replies outstanding in the current round
+    uint _awaited;
 };
 
 class MHTInstance {
@@ -92,6 +189,24 @@ public:
      */
     m3::Errors::Code release(mht_key_t mht_key, uint reservation);
 
+    /**
+     * Executes all operations of <batch>. Local keys and cached items are served directly,
+     * the remaining operations are sent to the responsible kernels in one message per kernel,
+     * after which the thread waits once for all of them. Operations that did not fit into a
+     * message or its reply are sent again in the next round.
+     *
+     * @param batch the operations; their results are stored there as well
+     */
+    void run(MHTBatch &batch);
+
+    /**
+     * Serves the <count> operations in <is>, which the kernel that sent it collected in run(),
+     * and replies the results to thread <tid> there. Gets whose items do not fit into the reply
+     * are left out; the requester sends them again. Items too large for any reply are answered
+     * with Errors::NO_SPACE.
+     */
+    void batchRequest(GateIStream &is, int tid, uint count);
+
     /**
      * Migrates partitions which are owned by the local kernel to another kernel.
      *
@@ -146,6 +261,24 @@ public:
 
     uint localPEs() const;
 
+    /**
+     * @return the cache for items of other kernels
+     */
+    MHTCache &remoteCache() {
+        return _remoteCache;
+    }
+
+    /**
+     * Notes that kernel <krnl> has fetched the item <key> of a local partition. If the item is
+     * cacheable, <krnl> is told when it is revoked.
+     */
+    void noteFetch(mht_key_t key, membership_entry::krnl_id_t krnl);
+
+    /**
+     * Tells the kernels that might have cached <key> to drop it, because it is being revoked
+     */
+    void dropCached(mht_key_t key);
+
     MHTPartition* findPartition(mht_key_t key);
 
     KPE* getMigrationDestination(membership_entry::pe_id_t partID) {
@@ -164,10 +297,18 @@ private:
     explicit MHTInstance();
     explicit MHTInstance(uint64_t memberTab, uint64_t parts, size_t partsSize);
 
-    // list of MHTPartitions
-    m3::SList<PartitionEntry> partitions;
+    // stores the <count> results in <is> into the batch of thread <tid>
+    void batchReply(GateIStream &is, int tid, uint count);
+
+    // the MHTPartitions stored locally, indexed by PE ID
+    MHTPartition *partitions[MAX_PES_DDL];
     // membership table
     membership_entry *memberTable;
+    MHTCache _remoteCache;
+    // kernels (a bit per ID modulo 64) that fetched cacheable items, by local partition
+    uint64_t _fetchedBy[MAX_PES_DDL];
+    // batches waiting for replies, by thread ID
+    KVStore<int, MHTBatch*> _batches;
     m3::SList<MigratingPartitionEntry> _migratingPartitions;
     static MHTInstance *_inst;
 
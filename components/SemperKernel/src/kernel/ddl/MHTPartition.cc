@@ -16,7 +16,6 @@
  */
 
 #include <base/log/Kernel.h>
-#include <base/col/SList.h>
 #include <base/util/Util.h>
 #include <base/Heap.h>
 #include <base/Errors.h>
@@ -29,101 +28,67 @@ namespace kernel {
 
 const MHTItem MHTPartition::emptyIndicator;
 
-struct MHTItemStorable : m3::SListItem {
-    MHTItemStorable(MHTItem &&dat) : data(m3::Util::move(dat)) {}
-    MHTItem data;
-};
-
 MHTPartition::~MHTPartition() {
-    for(size_t b = 0; b < NUM_BUCKETS; b++) {
-        for(auto it = _buckets[b].begin(); it != _buckets[b].end(); it++) {
-            if(it.operator ->() != nullptr)
-                m3::Heap::free(it.operator ->());
-        }
-        _buckets[b].remove_all();
-    }
 }
 
 m3::Errors::Code MHTPartition::put(MHTItem &&kv_pair, uint lockHandle) {
-    size_t idx = bucket_index(kv_pair._mht_key);
     // check if this replaces another item
-    for(auto it = _buckets[idx].begin(); it != _buckets[idx].end(); it++){
-        if(it->data._mht_key == kv_pair._mht_key) {
-            if(!it->data.islocked() || lockHandle == it->data.getLockHandle()) {
-                if(lockHandle)
-                    it->data.lockHandle = 0;
-                if(it->data.data)
-                    m3::Heap::free(it->data.data);
-                it->data.transferData(kv_pair);
-                return m3::Errors::NO_ERROR;
-            } else {
-                if(lockHandle == it->data.getLockHandle())
-                KLOG(MHT, "Inserting MHTItem failed! Item is locked. mhtKey: " <<
-                    PRINT_HASH(kv_pair._mht_key) << " lockHandle: " << kv_pair.getLockHandle() <<
-                    " (" << lockHandle << ")");
-                return m3::Errors::NO_PERM;
-            }
+    MHTItem *it = _items.find(kv_pair._mht_key);
+    if(it) {
+        if(!it->islocked() || lockHandle == it->getLockHandle()) {
+            if(lockHandle)
+                it->lockHandle = 0;
+            if(it->data)
+                m3::Heap::free(it->data);
+            it->transferData(kv_pair);
+            return m3::Errors::NO_ERROR;
+        } else {
+            if(lockHandle == it->getLockHandle())
+            KLOG(MHT, "Inserting MHTItem failed! Item is locked. mhtKey: " <<
+                PRINT_HASH(kv_pair._mht_key) << " lockHandle: " << kv_pair.getLockHandle() <<
+                " (" << lockHandle << ")");
+            return m3::Errors::NO_PERM;
         }
     }
-    // otherwise create a new item for the kv_pair
-    MHTItemStorable *item = new MHTItemStorable(m3::Util::move(kv_pair));
-    if(!item) {
+    // otherwise store the kv_pair in a free slot
+    if(!_items.insert(m3::Util::move(kv_pair))) {
         KLOG(ERR, "Could not get storage for item in MHT!");
         return m3::Errors::OUT_OF_MEM;
     }
-    _buckets[idx].append(item);
-    _count++;
     return m3::Errors::NO_ERROR;
 }
 
 const MHTItem &MHTPartition::get(mht_key_t mht_key, bool locking) {
-    size_t idx = bucket_index(mht_key);
     // Note: we enforce the locking policy here
-    for(auto it = _buckets[idx].begin(); it != _buckets[idx].end(); it++){
-        if(it->data._mht_key == mht_key) {
-            if(it->data.islocked()) {
-                // let this thread wait until the item is unlocked
-                it->data.enqueueTicket();
-            }
-            if(locking)
-                it->data.lock();
-
-            return it->data;
-        }
+    MHTItem *it = _items.find(mht_key);
+    if(it && it->islocked()) {
+        // let this thread wait until the item is unlocked
+        it->enqueueTicket();
+        // the table may have changed while we waited
+        it = _items.find(mht_key);
     }
-    // not found - return an empty item
-    return emptyIndicator;
+    if(it == nullptr) {
+        // not found - return an empty item
+        return emptyIndicator;
+    }
+    if(locking)
+        it->lock();
+    return *it;
 }
 
 bool MHTPartition::remove(mht_key_t mht_key) {
-    size_t idx = bucket_index(mht_key);
     // TODO
     // if there are waiting requests, delete them and answer them as failed
-    for(auto it = _buckets[idx].begin(); it != _buckets[idx].end(); it++){
-        if(it->data._mht_key == mht_key) {
-            MHTItemStorable *item = it.operator ->();
-            if(item != nullptr) {
-                // Remove from list first, then free (avoids use-after-free)
-                _buckets[idx].remove(item);
-                _count--;
-                delete item;
-                return true;
-            }
-            return false;
-        }
-    }
-    return false;
+    return _items.remove(mht_key);
 }
 
 int MHTPartition::lock(mht_key_t mht_key) {
-    size_t idx = bucket_index(mht_key);
-    for(auto it = _buckets[idx].begin(); it != _buckets[idx].end(); it++){
-        if(it->data._mht_key == mht_key) {
-            if(it->data.islocked()) {
-                return -1;
-            }
-            return it->data.lock();
+    MHTItem *it = _items.find(mht_key);
+    if(it) {
+        if(it->islocked()) {
+            return -1;
         }
+        return it->lock();
     }
     // not found - locking impossible
     KLOG(MHT, "MHT: Could not lock key " << PRINT_HASH(mht_key) << " (not found).");
@@ -131,69 +96,56 @@ int MHTPartition::lock(mht_key_t mht_key) {
 }
 
 bool MHTPartition::unlock(mht_key_t mht_key, uint lockHandle) {
-    size_t idx = bucket_index(mht_key);
-    for(auto it = _buckets[idx].begin(); it != _buckets[idx].end(); it++){
-        if(it->data._mht_key == mht_key)
-            return it->data.unlock(lockHandle);
-    }
+    MHTItem *it = _items.find(mht_key);
+    if(it)
+        return it->unlock(lockHandle);
     // not found - unlocking succeeds
     return true;
 }
 
 uint MHTPartition::reserve(mht_key_t mht_key) {
-    size_t idx = bucket_index(mht_key);
     // check whether there exists an item already
-    for(auto it = _buckets[idx].begin(); it != _buckets[idx].end(); it++)
-        if(it->data._mht_key == mht_key)
-            return 0;
+    if(_items.find(mht_key))
+        return 0;
 
     // reserve the slot
     MHTItem placeholder(nullptr, 0, mht_key);
     placeholder.reservation = true;
     uint reservationNr = placeholder.lock();
-    _buckets[idx].append(new MHTItemStorable(m3::Util::move(placeholder)));
-    _count++;
+    if(!_items.insert(m3::Util::move(placeholder))) {
+        KLOG(ERR, "Could not get storage for item in MHT!");
+        return 0;
+    }
     return reservationNr;
 }
 
 m3::Errors::Code MHTPartition::release(mht_key_t mht_key, uint reservation) {
-    size_t idx = bucket_index(mht_key);
-    m3::Errors::Code err = m3::Errors::NO_ERROR;
-    for(auto it = _buckets[idx].begin(); it != _buckets[idx].end(); it++){
-        if(it->data._mht_key == mht_key) {
-            if(it->data.unlock(reservation)) {
-                delete &(*it);
-                _count--;
-                break;
-            }
-            else
-                err = m3::Errors::NO_PERM;
-        }
+    MHTItem *it = _items.find(mht_key);
+    if(it) {
+        if(!it->unlock(reservation))
+            return m3::Errors::NO_PERM;
+        _items.remove(mht_key);
     }
-    return err;
+    return m3::Errors::NO_ERROR;
 }
 
 void MHTPartition::enqueueTicket(mht_key_t mht_key) {
-    size_t idx = bucket_index(mht_key);
-    for(auto it = _buckets[idx].begin(); it != _buckets[idx].end(); it++){
-        if(it->data._mht_key == mht_key)
-            it->data.enqueueTicket();
-    }
+    MHTItem *it = _items.find(mht_key);
+    if(it)
+        it->enqueueTicket();
 }
 
 size_t MHTPartition::serializedSize() {
     size_t size = m3::ostreamsize<membership_entry::pe_id_t, size_t>();
-    for(size_t b = 0; b < NUM_BUCKETS; b++)
-        for(auto it = _buckets[b].begin(); it != _buckets[b].end(); it++)
-            size += it->data.serializedSize();
+    for(auto it = _items.begin(); it != _items.end(); it++)
+        size += it->serializedSize();
     return size;
 }
 
 void MHTPartition::serialize(GateOStream &ser) {
-    ser << _id << _count;
-    for(size_t b = 0; b < NUM_BUCKETS; b++)
-        for(auto it = _buckets[b].begin(); it != _buckets[b].end(); it++)
-            it->data.serialize(ser);
+    ser << _id << _items.count();
+    for(auto it = _items.begin(); it != _items.end(); it++)
+        it->serialize(ser);
 }
 
 template<class T>
@@ -202,22 +154,11 @@ m3::Errors::Code MHTPartition::deserialize(T &ser) {
     ser >> _id >> numItems;
     for(size_t i = 0; i < numItems; i++) {
         MHTItem it(ser);
-        MHTItemStorable *item = new MHTItemStorable(m3::Util::move(it));
-        if(!item) {
+        if(!_items.insert(m3::Util::move(it))) {
             KLOG(ERR, "Could not get storage for item in MHT!");
-            for(size_t b = 0; b < NUM_BUCKETS; b++) {
-                for(auto jt = _buckets[b].begin(); jt != _buckets[b].end(); ) {
-                    auto old = jt++;
-                    delete &(*old);
-                }
-                _buckets[b].remove_all();
-            }
-            _count = 0;
+            _items.clear();
             return m3::Errors::OUT_OF_MEM;
         }
-        size_t idx = bucket_index(item->data._mht_key);
-        _buckets[idx].append(item);
-        _count++;
     }
     return m3::Errors::NO_ERROR;
 }
@@ -226,9 +167,8 @@ template m3::Errors::Code MHTPartition::deserialize<GateIStream>(GateIStream &se
 
 void MHTPartition::printItems() {
     KLOG(MHT, "-- Printing Items of partition #" << _id);
-    for(size_t b = 0; b < NUM_BUCKETS; b++)
-        for(auto it = _buckets[b].begin(); it != _buckets[b].end(); it++)
-            it->data.printState();
+    for(auto it = _items.begin(); it != _items.end(); it++)
+        it->printState();
 }
 
 }
@@ -17,30 +17,20 @@
 
 #pragma once
 
-#include <base/col/SList.h>
-
 #include "MHTTypes.h"
+#include "MHTTable.h"
 
 namespace kernel {
 
 struct MHTItem;
-struct MHTItemStorable;
 class MHTInstance;
 
 class MHTPartition {
     friend MHTInstance;
     friend KPE;
 
-    // Number of hash buckets (must be power of 2)
-    static const size_t NUM_BUCKETS = 64;
-    static const size_t BUCKET_MASK = NUM_BUCKETS - 1;
-
-    static size_t bucket_index(mht_key_t key) {
-        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> 58) & BUCKET_MASK;
-    }
-
 public:
-    MHTPartition(membership_entry::pe_id_t id) : _id(id), _count(0) {}
+    MHTPartition(membership_entry::pe_id_t id) : _id(id), _items() {}
     MHTPartition(const MHTPartition &) = delete;
     MHTPartition &operator=(const MHTPartition &) = delete;
     MHTPartition(MHTPartition &&) = delete;
@@ -60,7 +50,8 @@ private:
     m3::Errors::Code put(MHTItem &&kv_pair, uint lockHandle = 0);
 
     /**
-     * Get the item with the given key.
+     * Get the item with the given key. The reference is valid until the
+     * partition is modified next.
      * @param mht_key
      * @param key       Unhashed key to resolve collisions -- currently not supported
      * @param locking   defaults to false. If set, the get operation locks the key
@@ -145,9 +136,12 @@ private:
     template<class T>
     m3::Errors::Code deserialize(T &ser);
 
+    size_t count() const {
+        return _items.count();
+    }
+
     membership_entry::pe_id_t _id;
-    m3::SList<MHTItemStorable> _buckets[NUM_BUCKETS];
-    size_t _count;
+    MHTTable<mht_key_t, MHTItem> _items;
     static const MHTItem emptyIndicator;
 };
 }
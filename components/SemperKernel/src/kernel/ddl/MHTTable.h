@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) 2019, Matthias Hille <matthias.hille@tu-dresden.de>,
+ * Nils Asmussen <nils@os.inf.tu-dresden.de>
+ * Economic rights: Technische Universitaet Dresden (Germany)
+ *
+ * This file is part of SemperOS.
+ *
+ * SemperOS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * SemperOS is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details.
+ */
+
+#pragma once
+
+#include <base/Common.h>
+#include <base/util/Util.h>
+#include <assert.h>
+
+namespace kernel {
+
+/**
+ * Growable open-addressing hash table storing its items inline, used as
+ * the storage of an MHTPartition.
+ *
+ * Robin Hood hashing: every slot has a control byte holding its item's
+ * distance from its home slot plus one (0 = empty). Lookups walk the
+ * control bytes and stop as soon as they are further from home than the
+ * slot they look at, so even misses stay short at high load. Removal
+ * shifts the following items back instead of leaving tombstones.
+ *
+ * ITEM has to be default constructible (as an empty item), move
+ * assignable and provide getKey(). Items move on insert and remove, so
+ * pointers into the table are only valid until the next modification.
+ */
+template<typename KEY, class ITEM>
+class MHTTable {
+    static const size_t MIN_SLOTS   = 16;
+    static const uint8_t MAX_DIST   = 0xFE;
+
+    template<class I, class T>
+    class Iter {
+    public:
+        explicit Iter(T *table = nullptr, size_t pos = 0) : _table(table), _pos(pos) {
+            skip();
+        }
+
+        I &operator*() const {
+            return _table->_slots[_pos];
+        }
+        I *operator->() const {
+            return &operator*();
+        }
+        Iter &operator++() {
+            _pos++;
+            skip();
+            return *this;
+        }
+        Iter operator++(int) {
+            Iter tmp(*this);
+            operator++();
+            return tmp;
+        }
+        bool operator!=(const Iter &rhs) const {
+            return _pos != rhs._pos;
+        }
+
+    private:
+        void skip() {
+            while(_table && _pos < _table->_cap && !_table->_ctrl[_pos])
+                _pos++;
+        }
+
+        T *_table;
+        size_t _pos;
+    };
+
+public:
+    using iterator = Iter<ITEM, MHTTable>;
+    using const_iterator = Iter<const ITEM, const MHTTable>;
+
+    MHTTable() : _slots(nullptr), _ctrl(nullptr), _cap(0), _count(0), _shift(64) {
+    }
+    MHTTable(const MHTTable &) = delete;
+    MHTTable &operator=(const MHTTable &) = delete;
+    ~MHTTable() {
+        delete[] _slots;
+        delete[] _ctrl;
+    }
+
+    size_t count() const {
+        return _count;
+    }
+    size_t capacity() const {
+        return _cap;
+    }
+
+    iterator begin() {
+        return iterator(this, 0);
+    }
+    iterator end() {
+        return iterator(this, _cap);
+    }
+    const_iterator begin() const {
+        return const_iterator(this, 0);
+    }
+    const_iterator end() const {
+        return const_iterator(this, _cap);
+    }
+
+    /**
+     * @return the item with the given key or nullptr
+     */
+    ITEM *find(KEY key) {
+        if(_count == 0)
+            return nullptr;
+        size_t mask = _cap - 1;
+        size_t i = home(key);
+        for(uint dist = 1; _ctrl[i] >= dist; dist++, i = (i + 1) & mask) {
+            if(_slots[i].getKey() == key)
+                return &_slots[i];
+        }
+        return nullptr;
+    }
+
+    /**
+     * Moves <item> into the table. Its key must not be present yet.
+     *
+     * @return the stored item or nullptr if growing the table failed
+     */
+    ITEM *insert(ITEM &&item) {
+        if((_count + 1) * 4 > _cap * 3 && !grow())
+            return nullptr;
+        KEY key = item.getKey();
+        while(!place(item)) {
+            if(!grow())
+                return nullptr;
+        }
+        _count++;
+        return find(key);
+    }
+
+    /**
+     * Removes the item with the given key. It is moved into <out> if given,
+     * otherwise destroyed.
+     *
+     * @return true if the key was found
+     */
+    bool remove(KEY key, ITEM *out = nullptr) {
+        ITEM *it = find(key);
+        if(it == nullptr)
+            return false;
+
+        size_t mask = _cap - 1;
+        size_t hole = static_cast<size_t>(it - _slots);
+        if(out)
+            *out = m3::Util::move(_slots[hole]);
+        else
+            ITEM dead(m3::Util::move(_slots[hole]));
+
+        size_t next = (hole + 1) & mask;
+        while(_ctrl[next] > 1) {
+            _slots[hole] = m3::Util::move(_slots[next]);
+            _ctrl[hole] = _ctrl[next] - 1;
+            hole = next;
+            next = (next + 1) & mask;
+        }
+        _ctrl[hole] = 0;
+        _count--;
+        return true;
+    }
+
+    /**
+     * Destroys all items and releases the storage.
+     */
+    void clear() {
+        delete[] _slots;
+        delete[] _ctrl;
+        _slots = nullptr;
+        _ctrl = nullptr;
+        _cap = 0;
+        _count = 0;
+        _shift = 64;
+    }
+
+private:
+    size_t home(KEY key) const {
+        // Fibonacci hashing; the top bits are the best mixed ones
+        return static_cast<size_t>((static_cast<uint64_t>(key) * 0x9E3779B97F4A7C15ULL) >> _shift);
+    }
+
+    /**
+     * Robin Hood insert of <item>, which is consumed on success. Fails if
+     * an item would end up further than MAX_DIST from home.
+     */
+    bool place(ITEM &item) {
+        size_t mask = _cap - 1;
+        size_t i = home(item.getKey());
+        uint dist = 1;
+        for(;; dist++, i = (i + 1) & mask) {
+            if(dist > MAX_DIST)
+                return false;
+            if(!_ctrl[i]) {
+                _slots[i] = m3::Util::move(item);
+                _ctrl[i] = dist;
+                return true;
+            }
+            // take the slot from an item closer to its home
+            if(_ctrl[i] < dist) {
+                ITEM tmp(m3::Util::move(_slots[i]));
+                uint tmpdist = _ctrl[i];
+                _slots[i] = m3::Util::move(item);
+                _ctrl[i] = dist;
+                item = m3::Util::move(tmp);
+                dist = tmpdist;
+            }
+        }
+    }
+
+    bool grow() {
+        ITEM *oldslots = _slots;
+        uint8_t *oldctrl = _ctrl;
+        size_t oldcap = _cap;
+
+        size_t cap = oldcap ? oldcap * 2 : MIN_SLOTS;
+        _slots = new ITEM[cap];
+        _ctrl = new uint8_t[cap]();
+        if(!_slots || !_ctrl) {
+            delete[] _slots;
+            delete[] _ctrl;
+            _slots = oldslots;
+            _ctrl = oldctrl;
+            return false;
+        }
+        _cap = cap;
+        _shift = 64 - m3::getnextlog2(cap);
+
+        for(size_t i = 0; i < oldcap; ++i) {
+            if(oldctrl[i]) {
+                // the new table is at most 3/8 full, so this is far from MAX_DIST
+                UNUSED bool placed = place(oldslots[i]);
+                assert(placed);
+            }
+        }
+        delete[] oldslots;
+        delete[] oldctrl;
+        return true;
+    }
+
+    ITEM *_slots;
+    uint8_t *_ctrl;
+    size_t _cap;
+    size_t _count;
+    uint _shift;
+};
+
+}
@@ -117,6 +117,11 @@ void MHTItem::serialize(GateOStream &ser) const {
 template<class T>
 void MHTItem::deserialize(T &is) {
     is >> _mht_key >> length;
+    // capabilities serialize their ID again (see Capability::serialize())
+    if(HashUtil::hashToType(_mht_key) & GENERICOCAP) {
+        mht_key_t capid;
+        is >> capid;
+    }
     // TODO
     // cases SERVICE, ACTIVE
     switch(HashUtil::hashToType(_mht_key)) {
@@ -93,7 +93,11 @@ enum MembershipFlags : uint8_t {
 static_assert(HASH_BITS > 0, "DDL ID space too small");
 
 class MHTPartition;
+template<typename KEY, class ITEM>
+class MHTTable;
 class MHTInstance;
+class MHTCache;
+class MHTBatch;
 class KPE;
 class KernelcallHandler;
 class Capability;
@@ -214,7 +218,10 @@ struct DDLTicket : public m3::SListItem {
 
 struct MHTItem {
     friend MHTPartition;
+    friend MHTTable<mht_key_t, MHTItem>;
     friend MHTInstance;
+    friend MHTCache;
+    friend MHTBatch;
     friend KPE;
     friend KernelcallHandler;
 
@@ -351,8 +358,7 @@ private:
     /**
      * Private default constructor creates an empty item.
      */
-    MHTItem() {
-        MHTItem(0);
+    MHTItem() : MHTItem(0) {
     };
 
     void *data;
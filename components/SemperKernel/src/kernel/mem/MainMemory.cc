@@ -44,7 +44,7 @@ MainMemory::Allocation MainMemory::allocate(size_t size) {
         if(!_mods[i]->available())
             continue;
         uintptr_t res = _mods[i]->map().allocate(size);
-        if(res)
+        if(res != static_cast<uintptr_t>(-1))
             return Allocation(i, res, size);
     }
     return Allocation();
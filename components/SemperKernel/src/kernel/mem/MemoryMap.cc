@@ -24,43 +24,139 @@
 
 namespace kernel {
 
-MemoryMap::MemoryMap(uintptr_t addr, size_t size) : list(new Area()) {
-    list->addr = addr;
-    list->size = size;
-    list->next = nullptr;
+MemoryMap::MemoryMap(uintptr_t addr, size_t size)
+    : _tree(), _head(), _tail(), _bins(), _binmask(), _free(), _areas() {
+    if(size > 0)
+        insert_after(nullptr, addr, size);
+}
+
+MemoryMap::MemoryMap(MemoryMap &&m)
+    : _tree(), _head(m._head), _tail(m._tail), _bins(), _binmask(m._binmask), _free(m._free),
+      _areas(m._areas) {
+    // the areas (and thus the bins) move over, only the tree has to be rebuilt
+    for(size_t i = 0; i < BINS; ++i)
+        _bins[i] = m._bins[i];
+    for(Area *a = _head; a != nullptr; a = a->next)
+        _tree.insert(a);
+    m._tree.clear();
+    m._head = m._tail = nullptr;
+    for(size_t i = 0; i < BINS; ++i)
+        m._bins[i] = nullptr;
+    m._binmask = m._free = m._areas = 0;
 }
 
 MemoryMap::~MemoryMap() {
-    for(Area *a = list; a != nullptr;) {
+    for(Area *a = _head; a != nullptr;) {
         Area *n = a->next;
         delete a;
         a = n;
     }
-    list = nullptr;
+    _tree.clear();
+    _head = _tail = nullptr;
 }
 
-uintptr_t MemoryMap::allocate(size_t size) {
-    Area *a;
-    Area *p = nullptr;
-    for(a = list; a != nullptr; p = a, a = a->next) {
+MemoryMap::Area *MemoryMap::find_fit(size_t size) {
+    size_t bin = bin_of(size);
+    // every area in the bins from <first> on is large enough. take the smallest of them to keep
+    // the large areas intact as long as possible
+    size_t first = (size & (size - 1)) ? bin + 1 : bin;
+    if(first < BINS) {
+        size_t fitting = _binmask & ~((static_cast<size_t>(1) << first) - 1);
+        if(fitting)
+            return _bins[__builtin_ctzl(fitting)];
+    }
+
+    // otherwise, only areas in the bin of the request might still be large enough
+    for(Area *a = _bins[bin]; a != nullptr; a = a->binnext) {
         if(a->size >= size)
-            break;
+            return a;
+    }
+    return nullptr;
+}
+
+MemoryMap::Area *MemoryMap::insert_after(Area *prev, uintptr_t addr, size_t size) {
+    Area *a = new Area(addr, size);
+    a->prev = prev;
+    a->next = prev ? prev->next : _head;
+    if(a->next)
+        a->next->prev = a;
+    else
+        _tail = a;
+    if(prev)
+        prev->next = a;
+    else
+        _head = a;
+
+    _tree.insert(a);
+    bin_insert(a);
+    _free += size;
+    _areas++;
+    return a;
+}
+
+void MemoryMap::remove(Area *a) {
+    if(a->prev)
+        a->prev->next = a->next;
+    else
+        _head = a->next;
+    if(a->next)
+        a->next->prev = a->prev;
+    else
+        _tail = a->prev;
+
+    _tree.remove(a);
+    bin_remove(a);
+    _free -= a->size;
+    _areas--;
+    delete a;
+}
+
+void MemoryMap::resize(Area *a, uintptr_t addr, size_t size) {
+    // areas never overlap, so <a> can't move past its neighbours and stays valid in the tree
+    bin_remove(a);
+    _free = _free - a->size + size;
+    a->key(addr);
+    a->size = size;
+    bin_insert(a);
+}
+
+void MemoryMap::bin_insert(Area *a) {
+    size_t bin = bin_of(a->size);
+    a->binprev = nullptr;
+    a->binnext = _bins[bin];
+    if(_bins[bin])
+        _bins[bin]->binprev = a;
+    _bins[bin] = a;
+    _binmask |= static_cast<size_t>(1) << bin;
+}
+
+void MemoryMap::bin_remove(Area *a) {
+    size_t bin = bin_of(a->size);
+    if(a->binprev)
+        a->binprev->binnext = a->binnext;
+    else {
+        _bins[bin] = a->binnext;
+        if(_bins[bin] == nullptr)
+            _binmask &= ~(static_cast<size_t>(1) << bin);
     }
+    if(a->binnext)
+        a->binnext->binprev = a->binprev;
+}
+
+uintptr_t MemoryMap::allocate(size_t size) {
+    if(size == 0)
+        return -1;
+    Area *a = find_fit(size);
     if(a == nullptr)
         return -1;
 
     /* take it from the front */
-    uintptr_t res = a->addr;
-    a->size -= size;
-    a->addr += size;
+    uintptr_t res = a->addr();
     /* if the area is empty now, remove it */
-    if(a->size == 0) {
-        if(p)
-            p->next = a->next;
-        else
-            list = a->next;
-        delete a;
-    }
+    if(a->size == size)
+        remove(a);
+    else
+        resize(a, res + size, a->size - size);
     KLOG(MEM, "Requested " << (size / 1024) << " KiB of memory @ " << m3::fmt(res, "p"));
     return res;
 }
@@ -68,103 +164,60 @@ uintptr_t MemoryMap::allocate(size_t size) {
 void MemoryMap::free(uintptr_t addr, size_t size) {
     KLOG(MEM, "Free'd " << (size / 1024) << " KiB of memory @ " << m3::fmt(addr, "p"));
 
-    /* find the area behind ours */
-    Area *n, *p = nullptr;
-    for(n = list; n != nullptr && addr > n->addr; p = n, n = n->next)
-        ;
+    /* find the areas before and behind ours */
+    Area *p = _tree.find_floor(addr);
+    Area *n = p ? p->next : _head;
+    assert(!p || p->addr() + p->size <= addr);
+    assert(!n || addr + size <= n->addr());
 
+    bool with_prev = p && p->addr() + p->size == addr;
+    bool with_next = n && addr + size == n->addr();
     /* merge with prev and next */
-    if(p && p->addr + p->size == addr && n && addr + size == n->addr) {
-        p->size += size + n->size;
-        p->next = n->next;
-        delete n;
+    if(with_prev && with_next) {
+        size_t total = p->size + size + n->size;
+        remove(n);
+        resize(p, p->addr(), total);
     }
     /* merge with prev */
-    else if(p && p->addr + p->size == addr) {
-        p->size += size;
-    }
+    else if(with_prev)
+        resize(p, p->addr(), p->size + size);
     /* merge with next */
-    else if(n && addr + size == n->addr) {
-        n->addr -= size;
-        n->size += size;
-    }
+    else if(with_next)
+        resize(n, addr, n->size + size);
     /* create new area between them */
-    else {
-        Area *a = new Area();
-        a->addr = addr;
-        a->size = size;
-        if(p)
-            p->next = a;
-        else
-            list = a;
-        a->next = n;
-    }
+    else
+        insert_after(p, addr, size);
 }
 
 uintptr_t MemoryMap::detach(size_t size) {
     /* detached are must be multiple of page size */
     assert(!(size & PAGE_MASK));
-    Area *a;
-    uint count = 0;
-    for(a = list; a != nullptr; a = a->next) {
-        count++;
-    }
-    if(count == 0)
-        return -1;
 
-    /* find the rearmost fitting area */
-    Area *p = a;
-    for(int i = count; i >= 0; i--) {
-        int k;
-        for(a = list, k = 1; k < i; k++, p = a, a = a->next) {
-        }
-        if( (a->size - (m3::Math::round_up<uintptr_t>(a->addr, PAGE_SIZE) - a->addr) ) >= size)
+    /* find the rearmost area that has <size> page-aligned bytes at its end */
+    Area *a;
+    for(a = _tail; a != nullptr; a = a->prev) {
+        if(m3::Math::round_dn<uintptr_t>(a->addr() + a->size, PAGE_SIZE) >= a->addr() + size)
             break;
-        /* no area with sufficient size */
-        else if(i == 0)
-            return -1;
     }
+    if(a == nullptr)
+        return -1;
 
     /* take it from the end */
-    uintptr_t res;
-    /* the end is not page aligned */
-    if((static_cast<size_t>(a->addr) + a->size) & PAGE_MASK) {
-        res = m3::Math::round_dn<uintptr_t>(a->addr + static_cast<uintptr_t>(a->size), PAGE_SIZE) - size;
-        /* put the remaining tail in a new area */
-        Area *t = new Area();
-        t->addr = res + size;
-        t->size = (a->addr + a->size) - (res + size);
-        t->next = a->next;
-
-        a->next = t;
-        a->size -= (size + t->size);
-    }
-    else {
-        res = a->addr + a->size - size;
-        a->size -= size;
-    }
+    uintptr_t end = a->addr() + a->size;
+    uintptr_t res = m3::Math::round_dn<uintptr_t>(end, PAGE_SIZE) - size;
+    Area *prev = a;
+    if(res > a->addr())
+        resize(a, a->addr(), res - a->addr());
     /* if the area is empty now, remove it */
-    if(a->size == 0) {
-        if(p)
-            p->next = a->next;
-        else
-            list = a->next;
-        delete a;
+    else {
+        prev = a->prev;
+        remove(a);
     }
+    /* the end is not page aligned: put the remaining tail in a new area */
+    if(end > res + size)
+        insert_after(prev, res + size, end - (res + size));
     KLOG(MEM, "Detached " << (size / 1024) << " KiB of memory @ " << m3::fmt(res, "p"));
     return res;
 }
 
-size_t MemoryMap::get_size(size_t *areas) const {
-    size_t total = 0;
-    if(areas)
-        *areas = 0;
-    for(Area *a = list; a != nullptr; a = a->next) {
-        total += a->size;
-        if(areas)
-            (*areas)++;
-    }
-    return total;
-}
-
 }
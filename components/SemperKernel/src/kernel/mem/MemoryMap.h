@@ -18,17 +18,45 @@
 #pragma once
 
 #include <base/Common.h>
+#include <base/col/Treap.h>
 #include <base/stream/OStream.h>
 
+#include "mem/SlabCache.h"
+
 namespace kernel {
 
+/**
+ * Keeps the free areas of a memory module. The areas are linked in address order and kept in a
+ * treap by address, so that free() finds its neighbours in O(log n). Additionally, every area is
+ * in the bin of its size class (the log2 of its size) and a bitmask tells which bins are
+ * non-empty. allocate() takes an area from the smallest bin above the one of the request, so it
+ * does not need to search; only if there is none, it looks through the request's own bin.
+ */
 class MemoryMap {
-    struct Area {
-        uintptr_t addr;
+    struct Area : public m3::TreapNode<uintptr_t>, public SlabObject<Area> {
+        explicit Area(uintptr_t addr, size_t _size)
+            : m3::TreapNode<uintptr_t>(addr), size(_size), prev(), next(), binprev(), binnext() {
+        }
+
+        uintptr_t addr() const {
+            return key();
+        }
+
+        void print(m3::OStream &os) const override {
+            os << "\t@ " << m3::fmt(addr(), "p") << ", " << (size / 1024) << " KiB";
+        }
+
         size_t size;
+        // neighbours in address order
+        Area *prev;
         Area *next;
+        // neighbours in the bin
+        Area *binprev;
+        Area *binnext;
     };
 
+    static const size_t BINS    = sizeof(size_t) * 8;
+
 public:
     /**
      * Creates a memory-map of <size> bytes.
@@ -37,6 +65,9 @@ public:
      * @param size the mem size
      */
     explicit MemoryMap(uintptr_t addr, size_t size);
+    MemoryMap(MemoryMap &&m);
+    MemoryMap(const MemoryMap &) = delete;
+    MemoryMap &operator=(const MemoryMap &) = delete;
 
     /**
      * Destroys this map
@@ -76,18 +107,40 @@ public:
      * @param areas will be set to the number of areas in the map
      * @return the free bytes
      */
-    size_t get_size(size_t *areas = nullptr) const;
+    size_t get_size(size_t *areas = nullptr) const {
+        if(areas)
+            *areas = _areas;
+        return _free;
+    }
 
     friend m3::OStream &operator<<(m3::OStream &os, const MemoryMap &map) {
-        size_t areas;
-        os << "Total: " << (map.get_size(&areas) / 1024) << " KiB:\n";
-        for(Area *a = map.list; a != nullptr; a = a->next)
-            os << "\t@ " << m3::fmt(a->addr, "p") << ", " << (a->size / 1024) << " KiB\n";
+        os << "Total: " << (map._free / 1024) << " KiB:\n";
+        for(Area *a = map._head; a != nullptr; a = a->next) {
+            a->print(os);
+            os << "\n";
+        }
         return os;
     }
 
 private:
-    Area *list;
+    static size_t bin_of(size_t size) {
+        return sizeof(unsigned long) * 8 - 1 - static_cast<size_t>(__builtin_clzl(size));
+    }
+
+    Area *find_fit(size_t size);
+    Area *insert_after(Area *prev, uintptr_t addr, size_t size);
+    void remove(Area *a);
+    void resize(Area *a, uintptr_t addr, size_t size);
+    void bin_insert(Area *a);
+    void bin_remove(Area *a);
+
+    m3::Treap<Area> _tree;
+    Area *_head;
+    Area *_tail;
+    Area *_bins[BINS];
+    size_t _binmask;
+    size_t _free;
+    size_t _areas;
 };
 
 }
@@ -15,14 +15,16 @@
  * General Public License version 2 for more details.
  */
 
+#include <base/Config.h>
 #include <base/Heap.h>
+#include <base/util/Math.h>
 #include <base/log/Kernel.h>
 
 #include "mem/Slab.h"
 
 namespace kernel {
 
-m3::SList<Slab> Slab::_slabs;
+Slab *Slab::_classes[Slab::CLASSES];
 
 Slab::Pool::Pool(size_t objsize, size_t count)
     : total(count), free(count), mem(m3::Heap::alloc(objsize * count)) {
@@ -35,52 +37,80 @@ Slab::Pool::~Pool() {
 Slab *Slab::get(size_t objsize) {
     assert(objsize >= sizeof(word_t));
 
-    size_t size = 1UL << m3::getnextlog2(objsize + sizeof(word_t));
-    for(auto s = _slabs.begin(); s != _slabs.end(); ++s) {
-        if(s->_objsize == size) {
-            KLOG(SLAB, "Using " << s->_objsize << "B slab for " << objsize << "B objects");
-            return &*s;
-        }
+    // every object is preceded by a pointer to its pool
+    size_t order = m3::getnextlog2(objsize + sizeof(word_t));
+    Slab *s = _classes[order];
+    if(s) {
+        KLOG(SLAB, "Using " << s->_objsize << "B slab for " << objsize << "B objects");
+        return s;
     }
 
+    size_t size = 1UL << order;
     KLOG(SLAB, "Creating " << size << "B slab for " << objsize << "B objects");
-    Slab *s = new Slab(size);
-    _slabs.append(s);
+    s = new Slab(size);
+    _classes[order] = s;
     return s;
 }
 
-void *Slab::alloc() {
-    if(EXPECT_FALSE(!_freelist)) {
-        KLOG(SLAB, "Extending " << _objsize << "B slab by " << (_objsize * STEP_SIZE) << "B");
+void Slab::log_stats() {
+    for(size_t i = 0; i < CLASSES; ++i) {
+        Slab *s = _classes[i];
+        if(!s)
+            continue;
+        const Stats &st = s->_stats;
+        size_t pooled = st.capacity * s->_objsize;
+        KLOG(INFO, "Slab " << s->_objsize << "B: allocs=" << st.allocs << " frees=" << st.frees
+            << " inuse=" << st.inuse << " peak=" << st.highwater << " pooled=" << pooled
+            << "B unused=" << (pooled - st.requested) << "B");
+    }
+}
+
+bool Slab::refill() {
+    // take at least a page at once, so small classes don't refill every few objects
+    size_t count = m3::Math::max(STEP_SIZE, PAGE_SIZE / _objsize);
+    KLOG(SLAB, "Extending " << _objsize << "B slab by " << (_objsize * count) << "B");
 
-        Pool *p = new Pool(_objsize, STEP_SIZE);
-        // NEW (semperos-sel4): NULL check on slab extension. Original SemperOS
-        // did not guard this; heap exhaustion from leaked caps exposed this gap.
-        if(!p || !p->mem) {
-            KLOG(ERR, "Slab::alloc: heap exhausted extending " << _objsize << "B slab");
-            return nullptr;
-        }
-        void **mem = reinterpret_cast<void**>(p->mem);
-        void **end = mem + (_objsize * STEP_SIZE) / sizeof(void*);
-        while(mem < end) {
-            mem[0] = p;
-            mem[1] = _freelist;
-            _freelist = mem;
-            mem += _objsize / sizeof(void*);
-        }
-        _pools.append(p);
+    Pool *p = new Pool(_objsize, count);
+    // NEW (semperos-sel4): NULL check on slab extension. Original SemperOS
+    // did not guard this; heap exhaustion from leaked caps exposed this gap.
+    if(!p || !p->mem) {
+        KLOG(ERR, "Slab::alloc: heap exhausted extending " << _objsize << "B slab");
+        delete p;
+        return false;
+    }
+    void **mem = reinterpret_cast<void**>(p->mem);
+    void **end = mem + (_objsize * count) / sizeof(void*);
+    while(mem < end) {
+        mem[0] = p;
+        mem[1] = _freelist;
+        _freelist = mem;
+        mem += _objsize / sizeof(void*);
     }
+    _pools.append(p);
+    _stats.capacity += count;
+    return true;
+}
 
-    if(!_freelist)
+void *Slab::alloc(size_t reqsize) {
+    if(EXPECT_FALSE(!_freelist) && !refill())
         return nullptr;
+
     void **ptr = _freelist;
     reinterpret_cast<Pool*>(ptr[0])->free--;
     _freelist = reinterpret_cast<void**>(_freelist[1]);
+
+    _stats.allocs++;
+    _stats.requested += reqsize;
+    if(++_stats.inuse > _stats.highwater)
+        _stats.highwater = _stats.inuse;
     return ptr + 1;
 }
 
-void Slab::free(void *addr) {
+void Slab::free(void *addr, size_t reqsize) {
     void **ptr = reinterpret_cast<void**>(addr) - 1;
+    _stats.frees++;
+    _stats.inuse--;
+    _stats.requested -= reqsize;
 
     // don't free pools for now. otherwise we shrink and extend back and forth.
     // TODO maybe we should do that only on memory pressure or so
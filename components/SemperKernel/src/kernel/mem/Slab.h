@@ -24,7 +24,16 @@
 
 namespace kernel {
 
-class Slab : public m3::SListItem {
+/**
+ * Size-class slab allocator. Every power-of-two class has its own free
+ * list; Slab::get() finds the class by the log2 of the size. Empty classes
+ * are refilled with a pool of at least a page at once.
+ *
+ * Each class counts its allocations, frees, objects in use and their peak,
+ * so the kernel heap can be sized from what was actually used (see
+ * log_stats()).
+ */
+class Slab {
     struct Pool : public m3::DListItem {
         explicit Pool(size_t objsize, size_t count);
         ~Pool();
@@ -36,20 +45,47 @@ class Slab : public m3::SListItem {
 
 public:
     static const size_t STEP_SIZE   = 64;
+    static const size_t CLASSES     = sizeof(size_t) * 8;
+
+    struct Stats {
+        size_t allocs;
+        size_t frees;
+        size_t inuse;       // objects
+        size_t highwater;   // objects
+        size_t capacity;    // objects in all pools
+        size_t requested;   // bytes requested by the objects in use
+    };
 
     static Slab *get(size_t objsize);
 
-    explicit Slab(size_t objsize) : _freelist(), _objsize(objsize) {
+    /**
+     * Logs the counters of all size classes, the bytes they hold in their
+     * pools and how much of it is not used by objects (free objects plus
+     * the rounding up to the class size).
+     */
+    static void log_stats();
+
+    explicit Slab(size_t objsize) : _freelist(), _objsize(objsize), _stats() {
     }
 
-    void *alloc();
-    void free(void *ptr);
+    void *alloc(size_t reqsize);
+    void free(void *ptr, size_t reqsize);
+
+    size_t objsize() const {
+        return _objsize;
+    }
+    const Stats &stats() const {
+        return _stats;
+    }
 
 private:
+    bool refill();
+
     void **_freelist;
     size_t _objsize;
+    Stats _stats;
     m3::DList<Pool> _pools;
-    static m3::SList<Slab> _slabs;
+    static Slab *_classes[CLASSES];
 };
 
 }
@@ -25,18 +25,19 @@ namespace kernel {
 
 class SlabCache {
 public:
-    explicit SlabCache(size_t objsize) : _slab(Slab::get(objsize)) {
+    explicit SlabCache(size_t objsize) : _slab(Slab::get(objsize)), _objsize(objsize) {
     }
 
     void *alloc() {
-        return _slab->alloc();
+        return _slab->alloc(_objsize);
     }
     void free(void *ptr) {
-        _slab->free(ptr);
+        _slab->free(ptr, _objsize);
     }
 
 private:
     Slab *_slab;
+    size_t _objsize;
 };
 
 template<class T>
@@ -32,6 +32,22 @@ unsigned long KPE::replies = 0;
 unsigned long KPE::delayedNormalMsgs = 0;
 unsigned long KPE::delayedRevocationMsgs = 0;
 unsigned long KPE::delayedReplies = 0;
+unsigned long KPE::revokeRequests = 0;
+unsigned long KPE::revokedCapIDs = 0;
+unsigned long KPE::opMsgs[Kernelcalls::COUNT];
+unsigned long KPE::opBytes[Kernelcalls::COUNT];
+
+void KPE::countOp(const void *data, size_t size) {
+    // every kernelcall starts with its operation, in both encodings
+    Kernelcalls::Operation op;
+    if(size < sizeof(op))
+        return;
+    memcpy(&op, data, sizeof(op));
+    if(static_cast<size_t>(op) < Kernelcalls::COUNT) {
+        opMsgs[op]++;
+        opBytes[op] += size;
+    }
+}
 #endif
 
 bool KPE::_shutdownReplySent = false;
@@ -69,6 +85,7 @@ void KPE::sendTo(const void* data, size_t size) {
     KLOG(KPES, "Sending " << size << "B to kernel #" << _id << " on core #" << _core);
 #ifdef KERNEL_STATISTICS
     normalMsgs++;
+    countOp(data, size);
 #endif
     // TODO
     // messages larger than the receive buffer should be split
@@ -77,7 +94,7 @@ void KPE::sendTo(const void* data, size_t size) {
     DTU::get().send_to(VPEDesc(_core, _id), _remoteEP, Coordinator::get().kid(), data, size, _id, _localEP);
 }
 
-void KPE::sendRevocationTo(const void* data, size_t size) {
+m3::Errors::Code KPE::sendRevocationTo(const void* data, size_t size) {
     // Use one slot less for normal sending in order to be able to receive replies
     while(_msgsInflight >= KernelcallHandler::MAX_MSG_INFLIGHT - 1) {
         KLOG(KPES, "Sending revocation to kernel #" << _id << " delayed due to msg slot shortage");
@@ -93,12 +110,16 @@ void KPE::sendRevocationTo(const void* data, size_t size) {
     KLOG(KPES, "Sending revocation of " << size << "B to kernel #" << _id << " on core #" << _core);
 #ifdef KERNEL_STATISTICS
     revocationMsgs++;
+    countOp(data, size);
 #endif
     // TODO
     // messages larger than the receive buffer should be split
     assert(size + m3::DTU::HEADER_SIZE < Kernelcalls::MSG_SIZE);
-    _msgsInflight++;
-    DTU::get().send_to(VPEDesc(_core, _id), _remoteEP, Coordinator::get().kid(), data, size, _id, _localEP);
+    m3::Errors::Code res = DTU::get().send_to(VPEDesc(_core, _id), _remoteEP,
+        Coordinator::get().kid(), data, size, _id, _localEP);
+    if(res == m3::Errors::NO_ERROR)
+        _msgsInflight++;
+    return res;
 }
 
 void KPE::reply(const void* data, size_t size) {
@@ -125,6 +146,7 @@ void KPE::reply(const void* data, size_t size) {
     KLOG(KPES, "Sending reply of " << size << "B to kernel #" << _id << " on core #" << _core);
 #ifdef KERNEL_STATISTICS
     replies++;
+    countOp(data, size);
 #endif
     assert(size + m3::DTU::HEADER_SIZE < Kernelcalls::MSG_SIZE);
     _lastMsgReply = true;
@@ -145,6 +167,7 @@ void KPE::forwardTo(const void* data, size_t size, label_t label) {
     KLOG(KPES, "Forwarding " << size << "B from kernel #" << label << " to kernel #" << _id);
 #ifdef KERNEL_STATISTICS
     normalMsgs++;
+    countOp(data, size);
 #endif
     // TODO
     // messages larger than the receive buffer should be split
@@ -136,7 +136,14 @@ public:
     void start(int argc, char** argv, size_t pe_count, m3::PEDesc PEs[]);
 
     void sendTo(const void* data, size_t size);
-    void sendRevocationTo(const void* data, size_t size);
+    m3::Errors::Code sendRevocationTo(const void* data, size_t size);
+
+    /**
+     * @return true if sendRevocationTo() would send right away instead of waiting for a slot
+     */
+    bool canSendRevocation() const {
+        return _msgsInflight < KernelcallHandler::MAX_MSG_INFLIGHT - 1;
+    }
 
     void forwardTo(const void* data, size_t size, label_t label);
 
@@ -203,8 +210,17 @@ public:
     static unsigned long delayedNormalMsgs;
     static unsigned long delayedRevocationMsgs;
     static unsigned long delayedReplies;
+    static unsigned long revokeRequests;
+    static unsigned long revokedCapIDs;
+    // messages and their bytes sent per kernelcall
+    static unsigned long opMsgs[Kernelcalls::COUNT];
+    static unsigned long opBytes[Kernelcalls::COUNT];
 #endif
 private:
+#ifdef KERNEL_STATISTICS
+    static void countOp(const void *data, size_t size);
+#endif
+
     /**
      * Creates a KPE stub to resemble kernels which are migrating targets
      *
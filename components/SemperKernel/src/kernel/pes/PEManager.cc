@@ -26,6 +26,7 @@
 #include "pes/PEManager.h"
 #include "Platform.h"
 #include "ddl/MHTInstance.h"
+#include "mem/Slab.h"
 
 namespace kernel {
 
@@ -284,6 +285,24 @@ bool PEManager::terminate() {
             " revocation= " << KPE::revocationMsgs + KPE::delayedRevocationMsgs
             << "/" << KPE::delayedRevocationMsgs << " replies= " << KPE::replies + KPE::delayedReplies
             << "/" << KPE::delayedReplies);
+        KLOG(INFO, "Kernel # " << Coordinator::get().kid() << " remote revokes (msgs/capIDs): "
+            << KPE::revokeRequests << "/" << KPE::revokedCapIDs);
+        for(size_t op = 0; op < Kernelcalls::COUNT; ++op) {
+            if(KPE::opMsgs[op])
+                KLOG(INFO, "  kernelcall " << op << ": msgs=" << KPE::opMsgs[op] << " bytes="
+                    << KPE::opBytes[op] << " avg=" << KPE::opBytes[op] / KPE::opMsgs[op]);
+        }
+        Slab::log_stats();
+        const MHTCache::Stats &cs = MHTInstance::getInstance().remoteCache().stats();
+        KLOG(INFO, "Kernel # " << Coordinator::get().kid() << " remote item cache: hits="
+            << cs.hits << " misses=" << cs.misses << " drops=" << cs.drops);
+        m3::ThreadManager &tm = m3::ThreadManager::get();
+        KLOG(INFO, "Kernel # " << Coordinator::get().kid() << " threads: " << tm.thread_count()
+            << " blocked peak=" << tm.blocked_highwater());
+        for(size_t i = 0; i < m3::ThreadManager::WAIT_HIST_SIZE; ++i) {
+            if(tm.wait_histogram(i))
+                KLOG(INFO, "  waits of 2^" << i << " cycles: " << tm.wait_histogram(i));
+        }
 #endif
         return true;
     }
@@ -82,6 +82,8 @@ public:
     };
 
     static constexpr int SYSC_CREDIT_ORD    = m3::nextlog2<512>::val;
+    // replies of SYSC_CREDIT_ORD size the default receive ring holds at once
+    static constexpr int SYSC_REPLY_SLOTS   = 6;
 
 #if defined(__gem5__) || defined(__sel4__)
     // TODO this will move to another place in order to be used by VPE and KPE
@@ -212,9 +212,10 @@ int config_config_recv(int target_pe, int ep_id,
     uint32_t slot_count = 1u << (buf_order - msg_order);
 
     /* Cap to what fits in a 4 KiB dataport */
-    size_t needed = vdtu_ring_total_size(slot_count, slot_size);
+    size_t needed = vdtu_ring_total_size_layout(slot_count, slot_size,
+                                                VDTU_RING_DEFAULT_LAYOUT);
     if (needed > 4096) {
-        slot_count = (4096 - VDTU_RING_CTRL_SIZE) / slot_size;
+        slot_count = (4096 - vdtu_ring_ctrl_size(VDTU_RING_DEFAULT_LAYOUT)) / slot_size;
         uint32_t p = 1;
         while (p * 2 <= slot_count) p *= 2;
         slot_count = p;
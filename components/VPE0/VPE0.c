@@ -26,11 +26,15 @@
  *   EXCHANGE   = 9
  *   REVOKE     = 16
  *   NOOP       = 18
+ *   EXCHANGEV  = 19
+ *   REVOKEV    = 20
  */
 #define SYSCALL_CREATEGATE  4
 #define SYSCALL_EXCHANGE    9
 #define SYSCALL_REVOKE      16
 #define SYSCALL_NOOP        18
+#define SYSCALL_EXCHANGEV   19
+#define SYSCALL_REVOKEV     20
 
 /* CapRngDesc::Type */
 #define CAP_TYPE_OBJ  0
@@ -58,51 +62,215 @@ static void init_channel_table(void)
         (volatile void *)memep_kv_3,
     };
     vdtu_channels_init(&channels, msg, mem);
+    vdtu_channels_set_doorbell(&channels, doorbell_kv);
+}
+
+static inline uint64_t rdtsc(void)
+{
+    uint32_t lo, hi;
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
 }
 
 /*
- * Wait for a reply on any recv channel (skip channel 0 = kernel's recv EP).
- * Returns the error code from the reply, or -1 on timeout.
- * If out_cycles is non-NULL and the reply contains a second word (kernel-measured
- * cap_op_cycles from SEMPER_BENCH_MODE), it is written to *out_cycles.
+ * Reply wait policy: poll the reply rings for a bounded, adaptive number
+ * of rounds, then announce the block in the rings and sleep on
+ * signal_from_kernel. The kernel only signals rings whose consumer has
+ * announced a block (see vdtu_ring_notify_needed()).
+ *
+ * There is no timed notification wait, so a reply that never comes
+ * blocks for good, like a lost reply on the DTU does.
  */
-static int wait_for_reply_ex(uint64_t *out_cycles)
+static struct vdtu_ring_waiter reply_waiter;
+
+static int block_on_kernel(void *arg)
 {
-    int timeout = 100000000;
-    const struct vdtu_message *reply = NULL;
-    struct vdtu_ring *ring = NULL;
-
-    if (out_cycles) *out_cycles = 0;
-
-    while (timeout-- > 0) {
-        for (int ch = 1; ch < VDTU_MSG_CHANNELS; ch++) {
-            if (!channels.msg[ch]) continue;
-            if (!channels.msg_rings[ch].ctrl)
-                vdtu_channels_attach_ring(&channels, ch);
-            struct vdtu_ring *r = vdtu_channels_get_ring(&channels, ch);
-            if (r && !vdtu_ring_is_empty(r)) {
-                reply = vdtu_ring_fetch(r);
-                if (reply) {
-                    ring = r;
-                    break;
-                }
-            }
-        }
-        if (reply) break;
+    (void)arg;
+    signal_from_kernel_wait();
+    return 1;
+}
+
+/*
+ * Asynchronous syscalls: sysc_submit() posts tagged syscalls to the syscall
+ * ring without waiting for them. The tag travels as replylabel, the kernel
+ * returns it as the reply's label, and sysc_reap() collects completions in
+ * whatever order the kernel finishes them. Syscalls that block in the
+ * kernel (e.g. revokes waiting on a remote kernel) thus overlap with the
+ * ones behind them.
+ *
+ * Tag 0 is the synchronous path below. Async completions it comes across
+ * are stashed for the next sysc_reap(); at most SYSC_MAX_INFLIGHT async
+ * syscalls may be outstanding, so the stash never overflows. The kernel
+ * sizes our DEF_RECVEP ring for six maximum-size replies
+ * (VPE::SYSC_REPLY_SLOTS); one of them is kept for the synchronous call.
+ */
+#define SYSC_TAG_SYNC       0
+#define SYSC_MAX_INFLIGHT   5
+
+struct sysc_sqe {
+    uint64_t    tag;            /* != SYSC_TAG_SYNC */
+    const void *payload;
+    uint16_t    len;
+};
+
+struct sysc_cqe {
+    uint64_t tag;
+    int      result;            /* first reply word: kernel error code */
+    uint64_t word;              /* second reply word, 0 if none */
+};
+
+static struct sysc_cqe cq_stash[SYSC_MAX_INFLIGHT];
+static uint32_t cq_stashed;
+static uint32_t sysc_inflight;
+
+/*
+ * After publishing into the kernel's syscall ring: mark it on the doorbell
+ * and wake the kernel if it announced that it sleeps.
+ */
+static void notify_kernel(struct vdtu_ring *ring)
+{
+    vdtu_channels_ring_doorbell(&channels, send_chan);
+    if (vdtu_ring_notify_needed(ring))
+        signal_kernel_emit();
+}
+
+/* Attach and collect the reply rings (skip channel 0 = kernel's recv EP) */
+static void reply_rings(struct vdtu_ring **rings)
+{
+    rings[0] = NULL;
+    for (int ch = 1; ch < VDTU_MSG_CHANNELS; ch++) {
+        rings[ch] = NULL;
+        if (!channels.msg[ch]) continue;
+        if (!channels.msg_rings[ch].ctrl)
+            vdtu_channels_attach_ring(&channels, ch);
+        rings[ch] = vdtu_channels_get_ring(&channels, ch);
     }
+}
 
-    if (!reply) return -1;
+/*
+ * Consume one reply from ring. Its tag and first word go to cqe; up to
+ * max_words words following the first are copied to out_words.
+ */
+static void take_reply(struct vdtu_ring *ring, struct sysc_cqe *cqe,
+                       uint64_t *out_words, uint32_t max_words)
+{
+    const struct vdtu_message *reply = vdtu_ring_fetch(ring);
 
-    int result = -1;
+    cqe->tag = reply->hdr.label;
+    cqe->result = -1;
+    cqe->word = 0;
     if (reply->hdr.length >= sizeof(uint64_t)) {
-        result = (int)(*(const uint64_t *)reply->data);
-    }
-    /* Second word: kernel-measured cycles (present when SEMPER_BENCH_MODE is on) */
-    if (out_cycles && reply->hdr.length >= 2 * sizeof(uint64_t)) {
-        *out_cycles = *(const uint64_t *)(reply->data + sizeof(uint64_t));
+        uint32_t words = reply->hdr.length / sizeof(uint64_t) - 1;
+        cqe->result = (int)(*(const uint64_t *)reply->data);
+        if (words)
+            cqe->word = *(const uint64_t *)(reply->data + sizeof(uint64_t));
+        if (out_words)
+            memcpy(out_words, reply->data + sizeof(uint64_t),
+                   (words < max_words ? words : max_words) * sizeof(uint64_t));
     }
     vdtu_ring_ack(ring);
-    return result;
+}
+
+/*
+ * Wait for the reply to the synchronous syscall.
+ * Returns the error code from the reply (its first word).
+ * Up to max_words words following it are copied to out_words; the rest of
+ * out_words is zeroed.
+ */
+static int wait_for_reply_words(uint64_t *out_words, uint32_t max_words)
+{
+    struct vdtu_ring *rings[VDTU_MSG_CHANNELS];
+    struct sysc_cqe cqe;
+
+    reply_rings(rings);
+    for (;;) {
+        if (out_words) memset(out_words, 0, max_words * sizeof(uint64_t));
+        uint32_t ch = vdtu_ring_wait_any(&reply_waiter, rings, VDTU_MSG_CHANNELS,
+                                         block_on_kernel, NULL);
+        take_reply(rings[ch], &cqe, out_words, max_words);
+        if (cqe.tag != SYSC_TAG_SYNC)
+            cq_stash[cq_stashed++] = cqe;
+        else
+            return cqe.result;
+    }
+}
+
+/*
+ * Post n tagged syscalls with one ring publish and one doorbell.
+ * Returns the number posted, which is less than n if the ring or the
+ * in-flight limit is full, or -1 on error.
+ */
+static int sysc_submit(const struct sysc_sqe *sqes, uint32_t n)
+{
+    struct vdtu_ring_msg_desc descs[SYSC_MAX_INFLIGHT];
+    struct vdtu_ring *ring = vdtu_channels_get_ring(&channels, send_chan);
+    if (!ring) return -1;
+
+    if (n > SYSC_MAX_INFLIGHT - sysc_inflight)
+        n = SYSC_MAX_INFLIGHT - sysc_inflight;
+    for (uint32_t i = 0; i < n; i++) {
+        if (sqes[i].tag == SYSC_TAG_SYNC) return -1;
+        descs[i].sender_pe   = MY_PE;
+        descs[i].sender_ep   = SYSC_EP;
+        descs[i].sender_vpe  = MY_VPE_ID;
+        descs[i].reply_ep    = DEF_RECVEP;
+        descs[i].label       = 0;
+        descs[i].replylabel  = sqes[i].tag;
+        descs[i].flags       = 0;
+        descs[i].payload     = sqes[i].payload;
+        descs[i].payload_len = sqes[i].len;
+    }
+    if (n == 0) return 0;
+
+    int sent = vdtu_ring_send_batch(ring, descs, n);
+    if (sent < 0) return -1;
+    if (sent > 0) {
+        sysc_inflight += (uint32_t)sent;
+        notify_kernel(ring);
+    }
+    return sent;
+}
+
+/*
+ * Collect completions of async syscalls into cqes, waiting until at least
+ * min_n (<= outstanding) arrived. Returns the number collected (<= max).
+ */
+static uint32_t sysc_reap(struct sysc_cqe *cqes, uint32_t max, uint32_t min_n)
+{
+    struct vdtu_ring *rings[VDTU_MSG_CHANNELS];
+    uint32_t n = 0;
+
+    while (n < max && cq_stashed > 0)
+        cqes[n++] = cq_stash[--cq_stashed];
+
+    reply_rings(rings);
+    while (n < max && sysc_inflight - n > 0) {
+        uint32_t ch = VDTU_MSG_CHANNELS;
+        if (n < min_n)
+            ch = vdtu_ring_wait_any(&reply_waiter, rings, VDTU_MSG_CHANNELS,
+                                    block_on_kernel, NULL);
+        else {
+            for (uint32_t c = 1; c < VDTU_MSG_CHANNELS; c++) {
+                if (rings[c] && !vdtu_ring_is_empty(rings[c])) { ch = c; break; }
+            }
+            if (ch == VDTU_MSG_CHANNELS) break;
+        }
+        /* sync calls wait for their replies, so none can come here */
+        take_reply(rings[ch], &cqes[n], NULL, 0);
+        n++;
+    }
+    sysc_inflight -= n;
+    return n;
+}
+
+/*
+ * Like wait_for_reply_words(). If out_cycles is non-NULL and the reply contains
+ * a second word (kernel-measured cap_op_cycles from SEMPER_BENCH_MODE), it is
+ * written to *out_cycles.
+ */
+static int wait_for_reply_ex(uint64_t *out_cycles)
+{
+    return wait_for_reply_words(out_cycles, out_cycles ? 1 : 0);
 }
 
 static int wait_for_reply(void)
@@ -112,10 +280,11 @@ static int wait_for_reply(void)
 
 /*
  * Send a syscall with the given payload and wait for reply.
- * Returns the error code from the kernel's reply.
- * If out_cycles is non-NULL, the kernel-measured cycle count is stored there.
+ * Returns the error code from the kernel's reply; up to max_words reply
+ * words following it are stored in out_words.
  */
-static int send_syscall_ex(const void *payload, uint16_t payload_len, uint64_t *out_cycles)
+static int send_syscall_words(const void *payload, uint16_t payload_len,
+                              uint64_t *out_words, uint32_t max_words)
 {
     struct vdtu_ring *ring = vdtu_channels_get_ring(&channels, send_chan);
     if (!ring) return -1;
@@ -126,8 +295,18 @@ static int send_syscall_ex(const void *payload, uint16_t payload_len, uint64_t *
                             0, 0, 0,
                             payload, payload_len);
     if (rc != 0) return -1;
+    notify_kernel(ring);
 
-    return wait_for_reply_ex(out_cycles);
+    return wait_for_reply_words(out_words, max_words);
+}
+
+/*
+ * Send a syscall with the given payload and wait for reply.
+ * If out_cycles is non-NULL, the kernel-measured cycle count is stored there.
+ */
+static int send_syscall_ex(const void *payload, uint16_t payload_len, uint64_t *out_cycles)
+{
+    return send_syscall_words(payload, payload_len, out_cycles, out_cycles ? 1 : 0);
 }
 
 static int send_syscall(const void *payload, uint16_t payload_len)
@@ -266,6 +445,116 @@ static int send_exchange(uint64_t tcap, uint32_t own_start, uint32_t own_count,
     return send_syscall(&payload, sizeof(payload));
 }
 
+/*
+ * Bulk variants: one syscall for up to VEC_MAX_XCHG / VEC_MAX_REVOKE ranges
+ * (KIF::Syscall::MAX_XCHG_RANGES / MAX_REVOKE_RANGES). The kernel handles
+ * every range on its own and replies
+ *   [0] error (NO_ERROR unless the request itself is invalid)
+ *   [1] count
+ *   [2..] error code per range
+ */
+#define VEC_MAX_XCHG    14
+#define VEC_MAX_REVOKE  28
+
+struct crd_wire {
+    uint32_t type;
+    uint32_t start;
+    uint32_t count;
+    uint32_t _pad;
+} __attribute__((packed));
+
+static void crd_set(struct crd_wire *crd, uint32_t start, uint32_t count)
+{
+    crd->type  = CAP_TYPE_OBJ;
+    crd->start = start;
+    crd->count = count;
+    crd->_pad  = 0;
+}
+
+/*
+ * Send an EXCHANGEV syscall: exchange own_start[i] -> other_start[i] (one
+ * selector each) for i < n with the VPE at tcap.
+ *
+ * Message format:
+ *   [0]      opcode   = EXCHANGEV (19)
+ *   [1]      tcap
+ *   [2]      obtain   = bool
+ *   [3]      count
+ *   [4..]    count x { own CapRngDesc, other CapRngDesc } (32 bytes each)
+ *
+ * Per-range results are stored in res[0..n-1].
+ * Returns the kernel's overall error code (0 = request accepted).
+ */
+static int send_exchangev(uint64_t tcap, const uint32_t *own_start,
+                          const uint32_t *other_start, uint32_t n, int obtain,
+                          int *res)
+{
+    struct {
+        uint64_t opcode;
+        uint64_t tcap;
+        uint64_t obtain;
+        uint64_t count;
+        struct crd_wire rng[VEC_MAX_XCHG][2];
+    } __attribute__((packed)) payload;
+    uint64_t words[1 + VEC_MAX_XCHG];
+
+    if (n == 0 || n > VEC_MAX_XCHG) return -1;
+
+    payload.opcode = SYSCALL_EXCHANGEV;
+    payload.tcap   = tcap;
+    payload.obtain = obtain ? 1 : 0;
+    payload.count  = n;
+    for (uint32_t i = 0; i < n; i++) {
+        crd_set(&payload.rng[i][0], own_start[i], 1);
+        crd_set(&payload.rng[i][1], other_start[i], 1);
+    }
+
+    int err = send_syscall_words(&payload,
+                                 (uint16_t)(4 * sizeof(uint64_t) + n * 2 * sizeof(struct crd_wire)),
+                                 words, 1 + n);
+    for (uint32_t i = 0; i < n; i++)
+        res[i] = err ? err : (int)words[1 + i];
+    return err;
+}
+
+/*
+ * Send a REVOKEV syscall for the selectors sel[0..n-1].
+ *
+ * Message format:
+ *   [0]      opcode   = REVOKEV (20)
+ *   [1]      own      = bool
+ *   [2]      count
+ *   [3..]    count x CapRngDesc (16 bytes each)
+ *
+ * Per-range results are stored in res[0..n-1].
+ * Returns the kernel's overall error code (0 = request accepted).
+ */
+static int send_revokev(const uint32_t *sel, uint32_t n, int *res)
+{
+    struct {
+        uint64_t opcode;
+        uint64_t own;
+        uint64_t count;
+        struct crd_wire rng[VEC_MAX_REVOKE];
+    } __attribute__((packed)) payload;
+    uint64_t words[1 + VEC_MAX_REVOKE];
+
+    if (n == 0 || n > VEC_MAX_REVOKE) return -1;
+
+    payload.opcode = SYSCALL_REVOKEV;
+    payload.own    = 1;
+    payload.count  = n;
+    for (uint32_t i = 0; i < n; i++)
+        crd_set(&payload.rng[i], sel[i], 1);
+
+    int err = send_syscall_words(&payload,
+                                 (uint16_t)(3 * sizeof(uint64_t) + n * sizeof(struct crd_wire)),
+                                 words, 1 + n);
+    for (uint32_t i = 0; i < n; i++)
+        res[i] = err ? err : (int)words[1 + i];
+    return err;
+}
+
 /* Benchmark variants that return kernel-measured cycles */
 static int send_exchange_ex(uint64_t tcap, uint32_t own_start, uint32_t own_count,
                              uint32_t other_start, uint32_t other_count, int obtain,
@@ -336,13 +625,6 @@ static int send_revoke_ex(uint64_t cap_sel, uint64_t *out_cycles)
 #define BENCH_CHAIN_WARMUP 50
 #define BENCH_CHAIN_ITERS  200
 
-static inline uint64_t rdtsc(void)
-{
-    uint32_t lo, hi;
-    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
-    return ((uint64_t)hi << 32) | lo;
-}
-
 /* TSC frequency accessors — from tsc_calibrate.h constants */
 #define tsc_mhz    TSC_FREQ_MHZ
 #define tsc_method TSC_METHOD
@@ -603,6 +885,7 @@ int run(void)
            TSC_FREQ_MHZ, TSC_METHOD);
 
     init_channel_table();
+    vdtu_ring_waiter_init(&reply_waiter, VDTU_RING_SPIN_MIN, VDTU_RING_SPIN_MAX);
 
     /* Wait for kernel to configure our endpoints */
     printf("[VPE0] Waiting for channels...\n");
@@ -925,6 +1208,136 @@ int run(void)
         printf("[VPE0] Test 11 (chain revoke depth %d): %s\n", depth, ok ? "PASS" : "FAIL");
     }
 
+    /* ==============================================================
+     * Test 12: Bulk EXCHANGE + REVOKE — one syscall each for 8 gates
+     *
+     * Creates gates at sel 300..307, delegates all of them to VPE1
+     * (sel 310..317) with one EXCHANGEV and revokes them with one
+     * REVOKEV. Range 8 of the REVOKEV names cap 1, which is not
+     * revokeable: it must fail on its own without affecting the rest.
+     * ============================================================== */
+    {
+        #define BULK_N  8
+        int ok = 1;
+        uint32_t own[BULK_N], other[BULK_N], sels[BULK_N + 1];
+        int res[BULK_N + 1];
+
+        for (uint32_t i = 0; i < BULK_N && ok; i++) {
+            own[i] = 300 + i;
+            other[i] = 310 + i;
+            sels[i] = own[i];
+            err = send_creategate(own[i], 0xB000 + i, 6, 8);
+            if (err != 0) {
+                printf("[VPE0]   Test 12 setup: CREATEGATE(%u) failed: %d\n", own[i], err);
+                ok = 0;
+            }
+        }
+        sels[BULK_N] = 1;
+
+        if (ok) {
+            err = send_exchangev(2, own, other, BULK_N, 0, res);
+            for (int i = 0; i < BULK_N; i++) {
+                if (err != 0 || res[i] != 0) {
+                    printf("[VPE0]   Test 12: EXCHANGEV range %d failed: %d/%d\n", i, err, res[i]);
+                    ok = 0;
+                    break;
+                }
+            }
+        }
+
+        err = send_revokev(sels, BULK_N + 1, res);
+        if (err != 0) {
+            printf("[VPE0]   Test 12: REVOKEV failed: %d\n", err);
+            ok = 0;
+        }
+        else {
+            for (int i = 0; i < BULK_N; i++) {
+                if (res[i] != 0) {
+                    printf("[VPE0]   Test 12: REVOKEV range %d failed: %d\n", i, res[i]);
+                    ok = 0;
+                }
+            }
+            if (res[BULK_N] == 0) {
+                printf("[VPE0]   Test 12: REVOKEV of cap 1 did not fail\n");
+                ok = 0;
+            }
+        }
+
+        if (ok) pass++; else fail++;
+        printf("[VPE0] Test 12 (bulk EXCHANGE+REVOKE x%d): %s\n", BULK_N, ok ? "PASS" : "FAIL");
+    }
+
+    /* ==============================================================
+     * Test 13: Async syscalls — SYSC_MAX_INFLIGHT (5) tagged CREATEGATEs in flight at once
+     *
+     * Posts CREATEGATE for sel 400..404 with one sysc_submit(), reaps
+     * the completions (in any order) and checks that every tag came
+     * back exactly once with success. A synchronous NOOP in between
+     * must not swallow async completions. The gates are revoked with
+     * one REVOKEV afterwards.
+     * ============================================================== */
+    {
+        #define ASYNC_N  SYSC_MAX_INFLIGHT
+        int ok = 1;
+        uint64_t gate[ASYNC_N][6];
+        struct sysc_sqe sqe[ASYNC_N];
+        struct sysc_cqe cqe[ASYNC_N];
+        uint32_t sels[ASYNC_N];
+        int res[ASYNC_N];
+        uint32_t seen = 0, got = 0;
+
+        for (uint32_t i = 0; i < ASYNC_N; i++) {
+            sels[i] = 400 + i;
+            gate[i][0] = SYSCALL_CREATEGATE;
+            gate[i][1] = 0;
+            gate[i][2] = sels[i];
+            gate[i][3] = 0xA000 + i;
+            gate[i][4] = 6;
+            gate[i][5] = 8;
+            sqe[i].tag = 0x5000 + i;
+            sqe[i].payload = gate[i];
+            sqe[i].len = sizeof(gate[i]);
+        }
+
+        int sent = sysc_submit(sqe, ASYNC_N);
+        if (sent != ASYNC_N) {
+            printf("[VPE0]   Test 13: submit posted %d of %d\n", sent, ASYNC_N);
+            ok = 0;
+        }
+        if (sent > 0) {
+            err = send_noop();
+            if (err != 0) {
+                printf("[VPE0]   Test 13: NOOP between async calls failed: %d\n", err);
+                ok = 0;
+            }
+            while (got < (uint32_t)sent) {
+                uint32_t n = sysc_reap(cqe, ASYNC_N, 1);
+                if (n == 0) {
+                    ok = 0;
+                    break;
+                }
+                for (uint32_t i = 0; i < n; i++) {
+                    uint64_t idx = cqe[i].tag - 0x5000;
+                    if (idx >= ASYNC_N || (seen & (1u << idx)) || cqe[i].result != 0) {
+                        printf("[VPE0]   Test 13: bad completion tag=%#llx res=%d\n",
+                               (unsigned long long)cqe[i].tag, cqe[i].result);
+                        ok = 0;
+                    }
+                    else
+                        seen |= 1u << idx;
+                }
+                got += n;
+            }
+            if (seen != (1u << sent) - 1)
+                ok = 0;
+        }
+
+        send_revokev(sels, ASYNC_N, res);
+
+        if (ok) pass++; else fail++;
+        printf("[VPE0] Test 13 (async CREATEGATE x%d): %s\n", ASYNC_N, ok ? "PASS" : "FAIL");
+    }
+
     printf("[VPE0] === %d passed, %d failed ===\n", pass, fail);
 
     /* ==============================================================
@@ -1175,6 +1588,11 @@ int run(void)
         }
     }
 
+    printf("[VPE0] Reply waits: %llu, satisfied spinning: %llu, blocked: %llu\n",
+           (unsigned long long)reply_waiter.waits,
+           (unsigned long long)reply_waiter.spin_hits,
+           (unsigned long long)reply_waiter.blocks);
+
     printf("\n[VPE0] === Experiment 2A complete ===\n");
 
     return 0;
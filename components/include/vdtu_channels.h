@@ -15,10 +15,23 @@
 #define VDTU_MSG_CHANNELS  8
 #define VDTU_MEM_CHANNELS  4
 
+/* Every channel is one 4 KiB dataport */
+#define VDTU_CHANNEL_SIZE  4096
+
+/* Bytes after the ring ctrl block of a channel */
+#define VDTU_CHANNEL_DATA_SIZE \
+    (VDTU_CHANNEL_SIZE - (VDTU_RING_DEFAULT_LAYOUT == VDTU_RING_LAYOUT_V2 ? \
+                          VDTU_RING_CTRL_V2_SIZE : VDTU_RING_CTRL_SIZE))
+
+/* Largest message (header + payload) of a channel packed over its whole
+ * dataport, e.g. the kernel's KRNLC rings */
+#define VDTU_CHANNEL_PACKED_MAX_MSG  VDTU_RING_PACKED_MAX_MSG(VDTU_CHANNEL_DATA_SIZE)
+
 struct vdtu_channel_table {
     volatile void *msg[VDTU_MSG_CHANNELS];
     volatile void *mem[VDTU_MEM_CHANNELS];
     struct vdtu_ring msg_rings[VDTU_MSG_CHANNELS];
+    uint32_t *doorbell;     /* bit n = msg channel n has messages, or NULL */
 };
 
 /*
@@ -43,11 +56,39 @@ struct vdtu_ring *vdtu_channels_get_ring(struct vdtu_channel_table *ct,
 int vdtu_channels_init_ring(struct vdtu_channel_table *ct, int channel_idx,
                             uint32_t slot_count, uint32_t slot_size);
 
+/*
+ * Initialize a packed ring buffer in a message channel (receiver side).
+ * Messages of up to max_msg_size bytes are packed into data_size bytes.
+ */
+int vdtu_channels_init_ring_packed(struct vdtu_channel_table *ct, int channel_idx,
+                                   uint32_t data_size, uint32_t max_msg_size);
+
 /*
  * Attach to an existing ring buffer in a message channel (sender side).
  */
 int vdtu_channels_attach_ring(struct vdtu_channel_table *ct, int channel_idx);
 
+/*
+ * Use the word at mem as the doorbell of this component's recv channels.
+ * The dataport must be shared with every producer of those channels.
+ */
+void vdtu_channels_set_doorbell(struct vdtu_channel_table *ct,
+                                volatile void *mem);
+
+/*
+ * Producer: ring the doorbell for channel_idx after publishing into it.
+ * No-op if the table has no doorbell.
+ */
+void vdtu_channels_ring_doorbell(struct vdtu_channel_table *ct,
+                                 int channel_idx);
+
+/*
+ * Consumer: take the set of channels rung since the last call.
+ * Without a doorbell every channel is reported, so the caller falls back
+ * to polling all of them.
+ */
+uint32_t vdtu_channels_take_doorbell(struct vdtu_channel_table *ct);
+
 /*
  * Get the raw dataport pointer for a memory channel index.
  * Returns NULL if channel_idx is out of range.
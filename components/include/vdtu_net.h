@@ -0,0 +1,53 @@
+/*
+ * vdtu_net.h -- Inter-node DTU transport format (SemperKernel <-> DTUBridge)
+ *
+ * Outbound (net_outbound ring, kernel -> DTUBridge):
+ *   Each message's payload starts with a struct vdtu_net_route naming the
+ *   peer it goes to; the DTU payload follows. hdr.length covers both.
+ *   The bridge strips the route before the message goes on the wire.
+ *
+ * Wire (one UDP datagram on the DTU port):
+ *   [vdtu_net_frame][msg][msg]...
+ *   Each msg is a DTU header (VDTU_HEADER_SIZE bytes) followed by
+ *   hdr.length bytes of payload, back to back. The bridge coalesces all
+ *   messages it finds for the same peer into one datagram of at most
+ *   VDTU_NET_MAX_DATAGRAM bytes.
+ */
+
+#ifndef VDTU_NET_H
+#define VDTU_NET_H
+
+#include <stdint.h>
+#include "vdtu_ring.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define VDTU_NET_FRAME_MAGIC    0x5444      /* "DT" */
+
+/* Largest UDP payload the bridge sends (fits a 1500-byte Ethernet MTU) */
+#define VDTU_NET_MAX_DATAGRAM   1400
+
+/* Largest DTU message (header + payload) carried between nodes */
+#define VDTU_NET_MAX_MSG        512
+
+struct __attribute__((packed)) vdtu_net_route {
+    uint16_t dest_node;         /* index into the bridge's peer table */
+};
+
+/* Largest payload the kernel can send to another node (net_ring_send) */
+#define VDTU_NET_MAX_PAYLOAD \
+    (VDTU_NET_MAX_MSG - VDTU_HEADER_SIZE - sizeof(struct vdtu_net_route))
+
+struct __attribute__((packed)) vdtu_net_frame {
+    uint16_t magic;             /* VDTU_NET_FRAME_MAGIC               */
+    uint8_t  count;             /* messages in this datagram          */
+    uint8_t  src_node;          /* KERNEL_ID of the sending node      */
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VDTU_NET_H */
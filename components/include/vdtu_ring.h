@@ -14,9 +14,14 @@
  *   - fetch_msg returns a pointer to the next unread slot
  *   - mark_read (ack) advances the consumer position
  *
- * Memory layout in a shared dataport:
+ * Memory layout in a shared dataport (v1; see "Ring Buffer Control
+ * Structure" below for the cache-line-split v2 layout):
  *   [0..63]   Ring control header (head, tail, counts, sizes)
  *   [64..]    Message slots (slot_count * slot_size bytes)
+ *
+ * A ring can instead be initialized in packed mode (see "Packed Mode"
+ * below), where messages of any size are stored back-to-back in the
+ * data area rather than one per fixed-size slot.
  */
 
 #ifndef VDTU_RING_H
@@ -84,6 +89,7 @@ struct __attribute__((packed)) vdtu_message {
 /* Message header flags */
 #define VDTU_FLAG_REPLY         (1 << 0)
 #define VDTU_FLAG_GRANT_CREDITS (1 << 1)
+#define VDTU_FLAG_WRAP          (1 << 7)    /* packed rings: skip to offset 0 */
 
 /* Credits */
 #define VDTU_CREDITS_UNLIM      0xFFFF
@@ -91,23 +97,78 @@ struct __attribute__((packed)) vdtu_message {
 /* EP lifecycle states — verified implementation (from proofs/extracted/) */
 #include "vdtu_ep_state.h"
 
+/*
+ * --------------------------------------------------------------------------
+ *  Memory Ordering
+ *
+ *  head and tail are the only fields both sides write concurrently. They
+ *  follow the C11 acquire/release protocol: the producer fills a slot and
+ *  then publishes it with a release store of head; the consumer observes
+ *  head with an acquire load before touching slot data, and hands the
+ *  slot back with a release store of tail. This is correct on weakly
+ *  ordered targets (ARM/AArch64 seL4), not only on x86 TSO.
+ *
+ *  The GCC/Clang __atomic builtins implement the C11 memory model and,
+ *  unlike <stdatomic.h>, also compile in the C++11 kernel, which includes
+ *  this header and shares struct vdtu_ring_ctrl.
+ * --------------------------------------------------------------------------
+ */
+
+#define VDTU_LOAD_RELAXED(p)        __atomic_load_n((p), __ATOMIC_RELAXED)
+#define VDTU_LOAD_ACQUIRE(p)        __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define VDTU_STORE_RELEASE(p, v)    __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define VDTU_FENCE()                __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
 /*
  * --------------------------------------------------------------------------
  *  Ring Buffer Control Structure
  *
- *  Sits at the start of each shared dataport. Padded to 64 bytes for
- *  cache-line alignment and to separate producer/consumer fields.
+ *  Sits at the start of each shared dataport. Two layouts exist:
+ *
+ *  v1 (default): one 64-byte line holding head, tail and the geometry.
+ *    Every producer store to head and consumer store to tail invalidates
+ *    the other side's copy of the line.
+ *
+ *    [0..63]    head, tail, geometry, ep_state
+ *    [64..]     slots
+ *
+ *  v2: the v1 line keeps only read-mostly fields (its head/tail words are
+ *    unused); head and tail each get a line of their own, so the producer
+ *    and the consumer never write to the same cache line.
+ *
+ *    [0..63]    geometry, ep_state, layout
+ *    [64..127]  head (producer line)
+ *    [128..191] tail (consumer line)
+ *    [192..]    slots
+ *
+ *  The layout word sits in what used to be v1 padding, which v1 init
+ *  zeroes, so attach recognizes rings set up by older code as v1.
  * --------------------------------------------------------------------------
  */
 
+#define VDTU_CACHELINE_SIZE     64
 #define VDTU_RING_CTRL_SIZE     64
+#define VDTU_RING_CTRL_V2_SIZE  (3 * VDTU_CACHELINE_SIZE)
+
+#define VDTU_RING_LAYOUT_V1     1
+#define VDTU_RING_LAYOUT_V2     2
+
+#define VDTU_RING_MODE_SLOTS    0       /* fixed power-of-2 slots */
+#define VDTU_RING_MODE_PACKED   1       /* byte-granular records  */
+
+/* Layout used by vdtu_ring_init() and the channel table; override with
+ * -DVDTU_RING_DEFAULT_LAYOUT=VDTU_RING_LAYOUT_V2 (both sides must agree
+ * on the dataport size, attach itself follows whatever init chose) */
+#ifndef VDTU_RING_DEFAULT_LAYOUT
+#define VDTU_RING_DEFAULT_LAYOUT VDTU_RING_LAYOUT_V1
+#endif
 
 struct vdtu_ring_ctrl {
-    /* Written by producer */
-    volatile uint32_t head;         /* next slot to write (producer)    */
+    /* v1 only: written by producer (release), read by consumer (acquire) */
+    uint32_t head;                  /* next slot to write (producer)    */
 
-    /* Written by consumer */
-    volatile uint32_t tail;         /* next slot to read (consumer)     */
+    /* v1 only: written by consumer (release), read by producer (acquire) */
+    uint32_t tail;                  /* next slot to read (consumer)     */
 
     /* Immutable after init */
     uint32_t slot_count;            /* number of slots (power of 2)     */
@@ -117,16 +178,44 @@ struct vdtu_ring_ctrl {
     /* EP lifecycle (set by control plane, checked by data plane) */
     volatile uint32_t ep_state;     /* VDTU_EP_UNCONFIGURED .. TERMINATED */
 
-    uint8_t  _pad[VDTU_RING_CTRL_SIZE - 6 * sizeof(uint32_t)];
+    /* Immutable after init: VDTU_RING_LAYOUT_V* (0 = legacy v1) */
+    uint32_t layout;
+
+    /* Immutable after init: VDTU_RING_MODE_* and bytes behind the ctrl
+     * block. In packed mode slot_size is the largest message (header
+     * included) and head/tail are byte offsets into the data area. */
+    uint32_t mode;
+    uint32_t data_size;
+
+    /* Set by a consumer about to block, cleared by the producer that
+     * signals it (see "Notification" below) */
+    uint32_t consumer_waiting;
+
+    uint8_t  _pad[VDTU_RING_CTRL_SIZE - 10 * sizeof(uint32_t)];
+};
+
+/* v2: producer and consumer indices on separate cache lines */
+struct vdtu_ring_ctrl_v2 {
+    struct vdtu_ring_ctrl common;   /* read-mostly line */
+
+    uint32_t head;                  /* producer line */
+    uint8_t  _pad_head[VDTU_CACHELINE_SIZE - sizeof(uint32_t)];
+
+    uint32_t tail;                  /* consumer line */
+    uint8_t  _pad_tail[VDTU_CACHELINE_SIZE - sizeof(uint32_t)];
 };
 
 /* Compile-time check that control is exactly 64 bytes */
 #ifdef __cplusplus
 static_assert(sizeof(struct vdtu_ring_ctrl) == VDTU_RING_CTRL_SIZE,
               "ring ctrl must be 64 bytes");
+static_assert(sizeof(struct vdtu_ring_ctrl_v2) == VDTU_RING_CTRL_V2_SIZE,
+              "ring ctrl v2 must be 3 cache lines");
 #else
 _Static_assert(sizeof(struct vdtu_ring_ctrl) == VDTU_RING_CTRL_SIZE,
                "ring ctrl must be 64 bytes");
+_Static_assert(sizeof(struct vdtu_ring_ctrl_v2) == VDTU_RING_CTRL_V2_SIZE,
+               "ring ctrl v2 must be 3 cache lines");
 #endif
 
 /*
@@ -135,12 +224,32 @@ _Static_assert(sizeof(struct vdtu_ring_ctrl) == VDTU_RING_CTRL_SIZE,
  *
  *  Wraps a pointer to the shared memory region. The caller provides the
  *  backing memory (either a CAmkES dataport or malloc'd for testing).
+ *  head/tail point at the shared indices of whichever layout is in use.
+ *
+ *  The handle is private to one component. Each side keeps a cached copy
+ *  of the index the other side owns and only re-reads the shared one when
+ *  the cached value says the ring is full (producer) or empty (consumer).
+ *  Both indices only move forward, so a stale copy can only under-report
+ *  free slots / pending messages, never over-report them.
  * --------------------------------------------------------------------------
  */
 
+/* Producer-side counters, private to the handle */
+struct vdtu_ring_stats {
+    uint64_t sent;                  /* messages published               */
+    uint64_t notifies;              /* vdtu_ring_notify_needed() hits   */
+};
+
 struct vdtu_ring {
     struct vdtu_ring_ctrl *ctrl;    /* points to start of shared region */
-    uint8_t *slots;                 /* points to ctrl + RING_CTRL_SIZE  */
+    uint8_t *slots;                 /* points past the control block    */
+    uint32_t *head;                 /* shared producer index            */
+    uint32_t *tail;                 /* shared consumer index            */
+    uint32_t cached_tail;           /* producer's last view of *tail    */
+    uint32_t cached_head;           /* consumer's last view of *head    */
+    uint8_t *reserved;              /* slot handed out by reserve, or NULL */
+    uint16_t reserved_len;          /* payload bytes the caller may write  */
+    struct vdtu_ring_stats stats;
 };
 
 /*
@@ -152,6 +261,8 @@ struct vdtu_ring {
 /**
  * Initialize a ring buffer in the given memory region.
  *
+ * Uses VDTU_RING_DEFAULT_LAYOUT; see vdtu_ring_init_layout().
+ *
  * @param ring       Output handle
  * @param mem        Pointer to shared memory (must be >= ring_total_size)
  * @param slot_count Number of message slots (must be power of 2, >= 2)
@@ -161,9 +272,26 @@ struct vdtu_ring {
 int vdtu_ring_init(struct vdtu_ring *ring, void *mem,
                    uint32_t slot_count, uint32_t slot_size);
 
+/**
+ * Initialize a ring buffer with an explicit control layout.
+ *
+ * @param ring       Output handle
+ * @param mem        Pointer to shared memory
+ *                   (must be >= vdtu_ring_total_size_layout())
+ * @param slot_count Number of message slots (must be power of 2, >= 2)
+ * @param slot_size  Bytes per slot (must be power of 2, >= VDTU_HEADER_SIZE)
+ * @param layout     VDTU_RING_LAYOUT_V1 or VDTU_RING_LAYOUT_V2
+ * @return 0 on success, -1 on invalid parameters
+ */
+int vdtu_ring_init_layout(struct vdtu_ring *ring, void *mem,
+                          uint32_t slot_count, uint32_t slot_size,
+                          uint32_t layout);
+
 /**
  * Attach to an already-initialized ring buffer (other side called init).
  *
+ * The control layout is taken from the ring itself.
+ *
  * @param ring  Output handle
  * @param mem   Pointer to shared memory (already initialized by producer)
  * @return 0 on success
@@ -171,7 +299,24 @@ int vdtu_ring_init(struct vdtu_ring *ring, void *mem,
 int vdtu_ring_attach(struct vdtu_ring *ring, void *mem);
 
 /**
- * Compute total bytes needed for a ring buffer.
+ * Size of the control block for a layout.
+ */
+static inline size_t vdtu_ring_ctrl_size(uint32_t layout) {
+    return layout == VDTU_RING_LAYOUT_V2 ? VDTU_RING_CTRL_V2_SIZE
+                                         : VDTU_RING_CTRL_SIZE;
+}
+
+/**
+ * Compute total bytes needed for a ring buffer with the given layout.
+ */
+static inline size_t vdtu_ring_total_size_layout(uint32_t slot_count,
+                                                 uint32_t slot_size,
+                                                 uint32_t layout) {
+    return vdtu_ring_ctrl_size(layout) + (size_t)slot_count * slot_size;
+}
+
+/**
+ * Compute total bytes needed for a ring buffer (v1 layout).
  */
 static inline size_t vdtu_ring_total_size(uint32_t slot_count, uint32_t slot_size) {
     return VDTU_RING_CTRL_SIZE + (size_t)slot_count * slot_size;
@@ -179,25 +324,26 @@ static inline size_t vdtu_ring_total_size(uint32_t slot_count, uint32_t slot_siz
 
 /**
  * Check if ring is full (no space for producer to write).
+ *
+ * Producer-side check: consults the cached tail first and only reads the
+ * consumer's index when the cached view says full. A packed ring is full
+ * when a message of the maximum size would not fit.
  */
-static inline int vdtu_ring_is_full(const struct vdtu_ring *ring) {
-    uint32_t next_head = (ring->ctrl->head + 1) & ring->ctrl->slot_mask;
-    return next_head == ring->ctrl->tail;
-}
+int vdtu_ring_is_full(const struct vdtu_ring *ring);
 
 /**
  * Check if ring is empty (no messages for consumer to read).
  */
 static inline int vdtu_ring_is_empty(const struct vdtu_ring *ring) {
-    return ring->ctrl->head == ring->ctrl->tail;
+    return VDTU_LOAD_ACQUIRE(ring->head) == VDTU_LOAD_ACQUIRE(ring->tail);
 }
 
 /**
  * Number of messages available for reading.
+ *
+ * Packed rings have to walk the pending records to count them.
  */
-static inline uint32_t vdtu_ring_available(const struct vdtu_ring *ring) {
-    return (ring->ctrl->head - ring->ctrl->tail) & ring->ctrl->slot_mask;
-}
+uint32_t vdtu_ring_available(const struct vdtu_ring *ring);
 
 /**
  * Send a message: write header + payload into the next slot, advance head.
@@ -215,7 +361,8 @@ static inline uint32_t vdtu_ring_available(const struct vdtu_ring *ring) {
  * @param flags         Header flags (VDTU_FLAG_REPLY, etc.)
  * @param payload       Payload data (may be NULL if payload_len == 0)
  * @param payload_len   Payload length in bytes
- * @return 0 on success, -1 if ring is full, -2 if payload too large
+ * @return 0 on success, -1 if ring is full, -2 if payload too large,
+ *         -3 if the endpoint is terminated
  */
 int vdtu_ring_send(struct vdtu_ring *ring,
                    uint16_t sender_pe, uint8_t sender_ep,
@@ -235,18 +382,348 @@ int vdtu_ring_send(struct vdtu_ring *ring,
  * @param ring  Ring buffer handle
  * @return Pointer to message (vdtu_message*), or NULL if ring is empty
  */
-const struct vdtu_message *vdtu_ring_fetch(const struct vdtu_ring *ring);
+const struct vdtu_message *vdtu_ring_fetch(struct vdtu_ring *ring);
 
 /**
  * Acknowledge/consume the current message (advance tail).
  *
  * Must be called after vdtu_ring_fetch() to release the slot.
- * Matches DTU mark_read() / ACK_MSG semantics.
+ * Matches DTU mark_read() / ACK_MSG semantics. Acking an empty ring is
+ * a no-op.
  *
  * @param ring  Ring buffer handle
  */
 void vdtu_ring_ack(struct vdtu_ring *ring);
 
+/*
+ * --------------------------------------------------------------------------
+ *  Batched API
+ *
+ *  Producers that have a burst of messages (syscall storms, revocation
+ *  fan-out) fill several slots and publish head once, so the consumer
+ *  sees the whole burst after a single barrier. Consumers fetch up to N
+ *  messages at once and release them with a single tail update.
+ * --------------------------------------------------------------------------
+ */
+
+/* One message of a batch send; fields match vdtu_ring_send() arguments */
+struct vdtu_ring_msg_desc {
+    uint16_t    sender_pe;
+    uint8_t     sender_ep;
+    uint16_t    sender_vpe;
+    uint8_t     reply_ep;
+    uint64_t    label;
+    uint64_t    replylabel;
+    uint8_t     flags;
+    const void *payload;
+    uint16_t    payload_len;
+};
+
+/**
+ * Send up to count messages, publishing head once after all slots are filled.
+ *
+ * Messages are written in array order. If fewer than count slots are free,
+ * only the first (free) messages are written; the caller retries the rest.
+ *
+ * @param ring   Ring buffer handle
+ * @param msgs   Array of message descriptors
+ * @param count  Number of descriptors in msgs
+ * @return Number of messages enqueued (0 if full), -2 if any payload is
+ *         too large (nothing is enqueued), -3 if the endpoint is terminated
+ */
+int vdtu_ring_send_batch(struct vdtu_ring *ring,
+                         const struct vdtu_ring_msg_desc *msgs,
+                         uint32_t count);
+
+/**
+ * Fetch up to max unread messages without consuming them.
+ *
+ * msgs[0] is the oldest message. All returned pointers stay valid until
+ * they are released with vdtu_ring_ack_n() (or vdtu_ring_ack() each).
+ *
+ * @param ring  Ring buffer handle
+ * @param msgs  Output array of message pointers
+ * @param max   Capacity of msgs
+ * @return Number of messages stored in msgs (0 if ring is empty)
+ */
+uint32_t vdtu_ring_fetch_batch(struct vdtu_ring *ring,
+                               const struct vdtu_message **msgs,
+                               uint32_t max);
+
+/**
+ * Consume n messages at once (advance tail by n).
+ *
+ * n is clamped to the number of available messages.
+ *
+ * @param ring  Ring buffer handle
+ * @param n     Number of messages to release
+ */
+void vdtu_ring_ack_n(struct vdtu_ring *ring, uint32_t n);
+
+/*
+ * --------------------------------------------------------------------------
+ *  Zero-copy API
+ *
+ *  reserve() hands out the payload area of the next free slot so the
+ *  caller can marshal straight into shared memory; commit() fills in the
+ *  header and publishes the slot. Nothing is visible to the consumer
+ *  until commit. At most one reservation is outstanding per handle; a
+ *  plain send or batch send drops it.
+ *
+ *  Slots are not zeroed in full. Everything past a slot's recorded
+ *  header length is kept zero: the slots are cleared once at init and
+ *  every send/commit only clears the bytes between the new length and
+ *  the larger of the previous length and what was reserved.
+ * --------------------------------------------------------------------------
+ */
+
+/**
+ * Reserve the next slot for an in-place message of up to payload_len bytes.
+ *
+ * The caller may write the first payload_len bytes at *payload. The
+ * reservation is held until vdtu_ring_commit() or vdtu_ring_cancel();
+ * reserving again replaces it.
+ *
+ * @param ring         Ring buffer handle
+ * @param payload_len  Maximum payload the caller will write
+ * @param payload      Output: payload area of the reserved slot
+ * @return 0 on success, -1 if ring is full, -2 if payload too large,
+ *         -3 if the endpoint is terminated
+ */
+int vdtu_ring_reserve(struct vdtu_ring *ring, uint16_t payload_len,
+                      void **payload);
+
+/**
+ * Fill in the header of the reserved slot and publish it.
+ *
+ * @param ring          Ring buffer handle
+ * @param sender_pe     Sender's PE ID
+ * @param sender_ep     Sender's endpoint ID
+ * @param sender_vpe    Sender's VPE ID
+ * @param reply_ep      Reply endpoint ID
+ * @param label         Message label (from send EP config)
+ * @param replylabel    Reply label
+ * @param flags         Header flags (VDTU_FLAG_REPLY, etc.)
+ * @param payload_len   Bytes actually written (<= the reserved length)
+ * @return 0 on success, -1 if nothing is reserved, -2 if payload_len
+ *         exceeds the reservation
+ */
+int vdtu_ring_commit(struct vdtu_ring *ring,
+                     uint16_t sender_pe, uint8_t sender_ep,
+                     uint16_t sender_vpe, uint8_t reply_ep,
+                     uint64_t label, uint64_t replylabel, uint8_t flags,
+                     uint16_t payload_len);
+
+/**
+ * Drop the outstanding reservation without publishing anything.
+ *
+ * @param ring  Ring buffer handle
+ */
+void vdtu_ring_cancel(struct vdtu_ring *ring);
+
+/*
+ * --------------------------------------------------------------------------
+ *  Packed Mode
+ *
+ *  Fixed slots waste most of a dataport: a 4 KiB page holds one or two
+ *  2 KiB kernelcall slots, and a 30-byte reply still occupies a whole
+ *  slot. A packed ring stores each message as a record of header +
+ *  payload, rounded up to VDTU_RING_PACKED_ALIGN, directly after the
+ *  previous one. head and tail are byte offsets into the data area.
+ *
+ *    [ctrl][rec][rec][rec][free ...][WRAP][free]
+ *
+ *  A record never wraps. When the next record does not fit before the
+ *  end of the data area, the producer sets VDTU_FLAG_WRAP in the flags
+ *  byte at head and writes the record at offset 0; the consumer follows
+ *  the marker. fetch therefore still returns a contiguous vdtu_message
+ *  and the rest of the API (send, batch, reserve/commit, fetch, ack) is
+ *  unchanged. Offsets are VDTU_RING_PACKED_ALIGN-aligned, so the flags
+ *  byte of a record or a wrap marker always fits before the end.
+ *
+ *  So that a drained ring can always take a message no matter where
+ *  its offsets were left, the largest record is bounded by
+ *  vdtu_ring_packed_max_msg().
+ * --------------------------------------------------------------------------
+ */
+
+#define VDTU_RING_PACKED_ALIGN  VDTU_DTU_PKG_SIZE
+
+/**
+ * Bytes a message with payload_len bytes of payload occupies in a packed ring.
+ */
+static inline uint32_t vdtu_ring_packed_record_size(uint32_t payload_len) {
+    return (VDTU_HEADER_SIZE + payload_len + VDTU_RING_PACKED_ALIGN - 1) &
+           ~(uint32_t)(VDTU_RING_PACKED_ALIGN - 1);
+}
+
+/**
+ * Largest message (header + payload) a packed data area of data_size bytes
+ * accepts: two such records and one alignment unit must fit. The macro is a
+ * constant expression for data_size >= VDTU_RING_PACKED_ALIGN, so headers
+ * can size their messages by it.
+ */
+#define VDTU_RING_PACKED_MAX_MSG(data_size) \
+    (((((data_size) & ~(VDTU_RING_PACKED_ALIGN - 1)) - VDTU_RING_PACKED_ALIGN) / 2) & \
+     ~(VDTU_RING_PACKED_ALIGN - 1))
+
+static inline uint32_t vdtu_ring_packed_max_msg(uint32_t data_size) {
+    uint32_t usable = data_size & ~(uint32_t)(VDTU_RING_PACKED_ALIGN - 1);
+    if (usable < VDTU_RING_PACKED_ALIGN)
+        return 0;
+    return VDTU_RING_PACKED_MAX_MSG(usable);
+}
+
+/**
+ * Compute total bytes needed for a packed ring with the given layout.
+ */
+static inline size_t vdtu_ring_total_size_packed(uint32_t data_size,
+                                                 uint32_t layout) {
+    return vdtu_ring_ctrl_size(layout) + data_size;
+}
+
+/**
+ * Initialize a packed ring in the given memory region.
+ *
+ * Uses VDTU_RING_DEFAULT_LAYOUT. data_size is rounded down to
+ * VDTU_RING_PACKED_ALIGN.
+ *
+ * @param ring          Output handle
+ * @param mem           Pointer to shared memory
+ *                      (must be >= vdtu_ring_total_size_packed())
+ * @param data_size     Bytes available for records after the ctrl block
+ * @param max_msg_size  Largest message (header + payload) accepted; must be
+ *                      >= VDTU_HEADER_SIZE and <= vdtu_ring_packed_max_msg()
+ * @return 0 on success, -1 on invalid parameters
+ */
+int vdtu_ring_init_packed(struct vdtu_ring *ring, void *mem,
+                          uint32_t data_size, uint32_t max_msg_size);
+
+/*
+ * --------------------------------------------------------------------------
+ *  Notification
+ *
+ *  Consumers that would rather block than poll announce it in the ring,
+ *  so a producer only pays for a signal when somebody is actually
+ *  asleep, i.e. on the empty-to-non-empty transition the sleeper waits
+ *  for. The ring does not know about seL4; the caller supplies the
+ *  signal (producer) and the blocking wait (consumer).
+ *
+ *    producer                          consumer
+ *    send()  (release head)            consumer_waiting = 1
+ *    fence                             fence
+ *    if consumer_waiting:              if ring still empty:
+ *        consumer_waiting = 0              block on notification
+ *        signal                        consumer_waiting = 0
+ *
+ *  The two fences guarantee that at least one side sees the other's
+ *  store: either the producer sees the flag and signals, or the consumer
+ *  sees the message and does not block. seL4 notifications latch, so a
+ *  signal that arrives before the consumer blocks is not lost.
+ * --------------------------------------------------------------------------
+ */
+
+/**
+ * Producer: after publishing (send, batch send or commit), check whether
+ * the consumer is blocked on this ring and must be signalled.
+ *
+ * Clears the flag, so one sleep costs at most one signal however many
+ * messages follow.
+ *
+ * @return 1 if the caller must signal the consumer, 0 otherwise
+ */
+int vdtu_ring_notify_needed(struct vdtu_ring *ring);
+
+/**
+ * Consumer: announce that the caller is about to block on this ring.
+ *
+ * @return 0 if the ring is still empty and the caller may block,
+ *         1 if a message arrived meanwhile (the announcement is withdrawn)
+ */
+int vdtu_ring_prepare_wait(struct vdtu_ring *ring);
+
+/**
+ * Consumer: withdraw the announcement after waking up (or giving up).
+ */
+void vdtu_ring_finish_wait(struct vdtu_ring *ring);
+
+/*
+ * Adaptive spin-then-block over a set of rings that share one
+ * notification. Each wait first polls the rings up to 'spin' times; when
+ * that finds a message the budget grows (spinning paid off), when it
+ * has to block the budget shrinks, within [spin_min, spin_max].
+ */
+struct vdtu_ring_waiter {
+    uint32_t spin;                  /* current spin budget (polls)      */
+    uint32_t spin_min;
+    uint32_t spin_max;
+    uint64_t waits;                 /* calls to vdtu_ring_wait_any()    */
+    uint64_t spin_hits;             /* waits satisfied while spinning   */
+    uint64_t blocks;                /* times the block callback ran     */
+    uint64_t timeouts;              /* waits the block callback gave up */
+};
+
+/* Default spin bounds, in polls of the whole ring set */
+#ifndef VDTU_RING_SPIN_MIN
+#define VDTU_RING_SPIN_MIN      64
+#endif
+#ifndef VDTU_RING_SPIN_MAX
+#define VDTU_RING_SPIN_MAX      16384
+#endif
+
+void vdtu_ring_waiter_init(struct vdtu_ring_waiter *w,
+                           uint32_t spin_min, uint32_t spin_max);
+
+/**
+ * Wait until one of the rings has a message.
+ *
+ * NULL entries and rings without a ctrl block are skipped. block(arg)
+ * must wait on the notification the rings' producers signal. It returns
+ * nonzero once signalled, or 0 to give up (e.g. on a timeout).
+ *
+ * @return index of a non-empty ring, or count if block() gave up
+ */
+uint32_t vdtu_ring_wait_any(struct vdtu_ring_waiter *w,
+                            struct vdtu_ring *const *rings, uint32_t count,
+                            int (*block)(void *), void *arg);
+
+/*
+ * --------------------------------------------------------------------------
+ *  Doorbell
+ *
+ *  A consumer that owns many rings would otherwise have to look into
+ *  every one of them to find the few that hold messages. A doorbell is
+ *  a 32-bit word in memory shared by that consumer and all producers of
+ *  its rings; bit n stands for ring n. A producer rings the bit after
+ *  publishing, the consumer takes the whole word at once and only visits
+ *  the rings whose bits were set.
+ *
+ *  A bit is a hint, not a count: it may stand for several messages, and
+ *  a consumer that leaves messages in a ring has to remember the bit
+ *  itself. Producers ring after the release of head and the consumer
+ *  takes with acquire before it fetches, so a taken bit always covers
+ *  the message that rang it.
+ * --------------------------------------------------------------------------
+ */
+
+#define VDTU_DOORBELL_BITS      32
+
+/**
+ * Producer: mark ring 'bit' as having messages (after publishing).
+ */
+static inline void vdtu_doorbell_ring(uint32_t *bell, uint32_t bit) {
+    __atomic_fetch_or(bell, (uint32_t)1 << bit, __ATOMIC_RELEASE);
+}
+
+/**
+ * Consumer: take and clear all pending bits.
+ *
+ * @return bitmap of rings that were rung since the last take
+ */
+static inline uint32_t vdtu_doorbell_take(uint32_t *bell) {
+    return __atomic_exchange_n(bell, 0, __ATOMIC_ACQUIRE);
+}
+
 /**
  * Get the slot offset for a fetched message (for DTU get_msgoff compatibility).
  *
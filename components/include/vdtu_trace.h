@@ -0,0 +1,146 @@
+/*
+ * vdtu_trace.h -- Level-gated binary trace log for the data path
+ *
+ * printf on the data path costs a trip through the (slow) serial console
+ * per packet. VDTU_TRACE() instead appends a fixed-size binary record to
+ * an in-memory log ring; vdtu_trace_drain(), called by the component
+ * when it has nothing better to do, formats and prints them later.
+ *
+ * VDTU_TRACE_LEVEL (compile time, default 0) selects what is kept:
+ *   0  nothing: VDTU_TRACE() and the drain compile to nothing
+ *   1  VDTU_TRACE_ERR   drops and failures
+ *   2  VDTU_TRACE_INFO  per-datagram summaries
+ *   3  VDTU_TRACE_DBG   per-message detail
+ *
+ * The log is a power-of-2 array of records indexed by a free-running
+ * counter. Producers claim an index with one atomic add, so emitting is
+ * lock-free and safe from several threads (e.g. the DTUBridge IRQ and
+ * run threads). When the drain falls behind, the oldest records are
+ * overwritten and counted as lost.
+ */
+
+#ifndef VDTU_TRACE_H
+#define VDTU_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef VDTU_TRACE_LEVEL
+#define VDTU_TRACE_LEVEL        0
+#endif
+
+#define VDTU_TRACE_ERR          1
+#define VDTU_TRACE_INFO         2
+#define VDTU_TRACE_DBG          3
+
+/* Records in the log (power of 2) */
+#ifndef VDTU_TRACE_RECORDS
+#define VDTU_TRACE_RECORDS      256
+#endif
+
+/* Records a component formats per drain call */
+#define VDTU_TRACE_DRAIN_BUDGET 8
+
+/*
+ * Trace events: X(name, format). The format receives the record's three
+ * arguments as unsigned long long.
+ */
+#define VDTU_TRACE_EVENTS(X)                                                  \
+    X(NET_TX,           "NET TX: %llu msgs, %llu bytes to peer %llu")         \
+    X(NET_TX_FAIL,      "NET TX: send to peer %llu failed (err=-%llu)")       \
+    X(NET_TX_BAD_PEER,  "NET TX: invalid dest_node %llu")                     \
+    X(NET_TX_NOBUF,     "NET TX: no pbuf for peer %llu, message left queued") \
+    X(NET_RX,           "NET RX: %llu msgs, %llu bytes from node %llu")       \
+    X(NET_RX_UNFRAMED,  "NET RX: dropped unframed datagram (%llu bytes)")     \
+    X(NET_RX_MALFORMED, "NET RX: malformed message %llu, dropping rest")      \
+    X(NET_RX_FULL,      "NET RX: ring full at message %llu, %llu left")       \
+    X(NET_RPC_TX,       "TX DTU msg to peer %llu (%llu bytes)")               \
+    X(NET_ROUTE,        "Routing to remote node %llu via ring (%llu bytes payload)") \
+    X(NET_RING_RX,      "NET RX: label=0x%llx len=%llu")
+
+#define VDTU_TRACE_EVENT_ENUM(name, fmt) VDTU_EV_##name,
+enum vdtu_trace_event {
+    VDTU_TRACE_EVENTS(VDTU_TRACE_EVENT_ENUM)
+    VDTU_EV_COUNT
+};
+#undef VDTU_TRACE_EVENT_ENUM
+
+struct vdtu_trace_rec {
+    uint64_t tsc;                   /* timestamp counter at emit        */
+    uint32_t seq;                   /* index + 1 once complete, else 0  */
+    uint16_t event;                 /* enum vdtu_trace_event            */
+    uint8_t  level;
+    uint8_t  _pad;
+    uint64_t arg[3];
+};
+
+/* Record the event if level is compiled in; arguments are cast to uint64_t */
+#define VDTU_TRACE(level, event, a0, a1, a2)                                  \
+    do {                                                                      \
+        if ((level) <= VDTU_TRACE_LEVEL)                                      \
+            vdtu_trace_emit((level), VDTU_EV_##event, (uint64_t)(a0),         \
+                            (uint64_t)(a1), (uint64_t)(a2));                  \
+    } while (0)
+
+#if VDTU_TRACE_LEVEL > 0
+
+/**
+ * Name the component in drained output (default "vdtu").
+ */
+void vdtu_trace_init(const char *component);
+
+/**
+ * Append a record to the log. Use VDTU_TRACE() instead.
+ */
+void vdtu_trace_emit(uint8_t level, uint16_t event,
+                     uint64_t a0, uint64_t a1, uint64_t a2);
+
+/**
+ * Take the oldest record not yet read (single reader).
+ *
+ * @return 1 if *out was filled, 0 if the log is empty
+ */
+int vdtu_trace_read(struct vdtu_trace_rec *out);
+
+/**
+ * Records overwritten before the reader got to them.
+ */
+uint32_t vdtu_trace_lost(void);
+
+/**
+ * Format a record as one line (no trailing newline).
+ *
+ * @return length as snprintf() returns it
+ */
+int vdtu_trace_format(const struct vdtu_trace_rec *rec, char *buf, size_t len);
+
+/**
+ * Print up to budget records to the console.
+ *
+ * @return number of records printed
+ */
+uint32_t vdtu_trace_drain(uint32_t budget);
+
+#else
+
+static inline void vdtu_trace_init(const char *component) { (void)component; }
+static inline void vdtu_trace_emit(uint8_t level, uint16_t event,
+                                   uint64_t a0, uint64_t a1, uint64_t a2) {
+    (void)level; (void)event; (void)a0; (void)a1; (void)a2;
+}
+static inline uint32_t vdtu_trace_drain(uint32_t budget) {
+    (void)budget;
+    return 0;
+}
+
+#endif /* VDTU_TRACE_LEVEL > 0 */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VDTU_TRACE_H */
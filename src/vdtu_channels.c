@@ -52,6 +52,20 @@ int vdtu_channels_init_ring(struct vdtu_channel_table *ct, int channel_idx,
                           slot_count, slot_size);
 }
 
+int vdtu_channels_init_ring_packed(struct vdtu_channel_table *ct, int channel_idx,
+                                   uint32_t data_size, uint32_t max_msg_size)
+{
+    if (!ct || channel_idx < 0 || channel_idx >= VDTU_MSG_CHANNELS)
+        return -1;
+
+    void *mem = (void *)ct->msg[channel_idx];
+    if (!mem)
+        return -1;
+
+    return vdtu_ring_init_packed(&ct->msg_rings[channel_idx], mem,
+                                 data_size, max_msg_size);
+}
+
 int vdtu_channels_attach_ring(struct vdtu_channel_table *ct, int channel_idx)
 {
     if (!ct || channel_idx < 0 || channel_idx >= VDTU_MSG_CHANNELS)
@@ -64,6 +78,37 @@ int vdtu_channels_attach_ring(struct vdtu_channel_table *ct, int channel_idx)
     return vdtu_ring_attach(&ct->msg_rings[channel_idx], mem);
 }
 
+void vdtu_channels_set_doorbell(struct vdtu_channel_table *ct,
+                                volatile void *mem)
+{
+    if (!ct)
+        return;
+
+    ct->doorbell = (uint32_t *)mem;
+}
+
+void vdtu_channels_ring_doorbell(struct vdtu_channel_table *ct,
+                                 int channel_idx)
+{
+    if (!ct || !ct->doorbell ||
+        channel_idx < 0 || channel_idx >= VDTU_MSG_CHANNELS)
+        return;
+
+    vdtu_doorbell_ring(ct->doorbell, (uint32_t)channel_idx);
+}
+
+uint32_t vdtu_channels_take_doorbell(struct vdtu_channel_table *ct)
+{
+    const uint32_t all = ((uint32_t)1 << VDTU_MSG_CHANNELS) - 1;
+
+    if (!ct)
+        return 0;
+    if (!ct->doorbell)
+        return all;
+
+    return vdtu_doorbell_take(ct->doorbell) & all;
+}
+
 volatile void *vdtu_channels_get_mem(struct vdtu_channel_table *ct,
                                      int channel_idx)
 {
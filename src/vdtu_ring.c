@@ -9,8 +9,166 @@ static int is_power_of_2(uint32_t n) {
     return n >= 2 && (n & (n - 1)) == 0;
 }
 
+static int is_packed(const struct vdtu_ring *ring) {
+    return ring->ctrl->mode == VDTU_RING_MODE_PACKED;
+}
+
+/*
+ * Producer: number of free slots starting at head, refreshing the cached
+ * tail from shared memory only when the cached view leaves less than
+ * 'want' slots. The acquire load orders the consumer's reads of the slots
+ * it released before our overwrite of them.
+ */
+static uint32_t producer_space(struct vdtu_ring *ring, uint32_t head,
+                               uint32_t want)
+{
+    uint32_t mask = ring->ctrl->slot_mask;
+    uint32_t space = mask - ((head - ring->cached_tail) & mask);
+    if (space < want) {
+        ring->cached_tail = VDTU_LOAD_ACQUIRE(ring->tail);
+        space = mask - ((head - ring->cached_tail) & mask);
+    }
+    return space;
+}
+
+/*
+ * Packed: where a record of rec bytes goes when the producer is at head
+ * and the consumer at tail. Free space runs from head up to tail; a
+ * record may not end exactly on tail, since head == tail means empty.
+ */
+static int packed_fit(uint32_t size, uint32_t head, uint32_t tail,
+                      uint32_t rec, uint32_t *pos)
+{
+    if (head >= tail) {
+        /* [head, size) is free, and [0, tail) behind a wrap marker */
+        if (head + rec < size || (head + rec == size && tail != 0)) {
+            *pos = head;
+            return 1;
+        }
+        if (rec < tail) {
+            *pos = 0;
+            return 1;
+        }
+        return 0;
+    }
+    if (head + rec < tail) {
+        *pos = head;
+        return 1;
+    }
+    return 0;
+}
+
+/* Packed producer: packed_fit() against the cached tail, then a fresh one */
+static int packed_place(struct vdtu_ring *ring, uint32_t head, uint32_t rec,
+                        uint32_t *pos)
+{
+    uint32_t size = ring->ctrl->data_size;
+    if (packed_fit(size, head, ring->cached_tail, rec, pos))
+        return 1;
+    ring->cached_tail = VDTU_LOAD_ACQUIRE(ring->tail);
+    return packed_fit(size, head, ring->cached_tail, rec, pos);
+}
+
+/* Packed: head or tail value after a record of rec bytes at pos */
+static uint32_t packed_advance(const struct vdtu_ring *ring, uint32_t pos,
+                               uint32_t rec)
+{
+    pos += rec;
+    return pos >= ring->ctrl->data_size ? 0 : pos;
+}
+
+/*
+ * Consumer: whether a message is pending at tail, refreshing the cached
+ * head only when the cached view says empty. The acquire load makes the
+ * producer's slot contents visible.
+ */
+static int consumer_pending(struct vdtu_ring *ring, uint32_t tail)
+{
+    if (ring->cached_head != tail)
+        return 1;
+    ring->cached_head = VDTU_LOAD_ACQUIRE(ring->head);
+    return ring->cached_head != tail;
+}
+
+static uint8_t *slot_at(const struct vdtu_ring *ring, uint32_t idx)
+{
+    return ring->slots + (size_t)idx * ring->ctrl->slot_size;
+}
+
+/* Consumer: the message at position tail (following a wrap marker) */
+static uint8_t *consumer_msg(const struct vdtu_ring *ring, uint32_t tail)
+{
+    if (!is_packed(ring))
+        return slot_at(ring, tail);
+    if (ring->slots[tail] & VDTU_FLAG_WRAP)
+        return ring->slots;
+    return ring->slots + tail;
+}
+
+/* Consumer: position after the message at tail */
+static uint32_t consumer_next(const struct vdtu_ring *ring, uint32_t tail)
+{
+    if (!is_packed(ring))
+        return (tail + 1) & ring->ctrl->slot_mask;
+
+    const uint8_t *msg = consumer_msg(ring, tail);
+    uint16_t len = ((const struct vdtu_msg_header *)msg)->length;
+    return packed_advance(ring, (uint32_t)(msg - ring->slots),
+                          vdtu_ring_packed_record_size(len));
+}
+
+/* Point the handle at the shared indices and slots of the ring's layout */
+static void bind_layout(struct vdtu_ring *ring, void *mem, uint32_t layout)
+{
+    ring->ctrl = (struct vdtu_ring_ctrl *)mem;
+    if (layout == VDTU_RING_LAYOUT_V2) {
+        struct vdtu_ring_ctrl_v2 *v2 = (struct vdtu_ring_ctrl_v2 *)mem;
+        ring->head = &v2->head;
+        ring->tail = &v2->tail;
+    } else {
+        ring->head = &ring->ctrl->head;
+        ring->tail = &ring->ctrl->tail;
+    }
+    ring->slots = (uint8_t *)mem + vdtu_ring_ctrl_size(layout);
+}
+
+/* Common part of slot and packed init once the geometry is validated */
+static void init_ctrl(struct vdtu_ring *ring, void *mem, uint32_t layout,
+                      uint32_t mode, uint32_t slot_count, uint32_t slot_size,
+                      uint32_t data_size)
+{
+    struct vdtu_ring_ctrl *ctrl = (struct vdtu_ring_ctrl *)mem;
+    memset(ctrl, 0, vdtu_ring_ctrl_size(layout));
+
+    ctrl->slot_count = slot_count;
+    ctrl->slot_size  = slot_size;
+    ctrl->slot_mask  = slot_count ? slot_count - 1 : 0;
+    ctrl->ep_state   = VDTU_EP_ACTIVE;
+    ctrl->layout     = layout;
+    ctrl->mode       = mode;
+    ctrl->data_size  = data_size;
+
+    bind_layout(ring, mem, layout);
+    ring->cached_tail = 0;
+    ring->cached_head = 0;
+    ring->reserved = NULL;
+    ring->reserved_len = 0;
+    memset(&ring->stats, 0, sizeof(ring->stats));
+
+    /* Start from clean slots; sends only scrub what earlier sends wrote */
+    memset(ring->slots, 0, data_size);
+}
+
 int vdtu_ring_init(struct vdtu_ring *ring, void *mem,
                    uint32_t slot_count, uint32_t slot_size)
+{
+    return vdtu_ring_init_layout(ring, mem, slot_count, slot_size,
+                                 VDTU_RING_DEFAULT_LAYOUT);
+}
+
+int vdtu_ring_init_layout(struct vdtu_ring *ring, void *mem,
+                          uint32_t slot_count, uint32_t slot_size,
+                          uint32_t layout)
 {
     if (!ring || !mem)
         return -1;
@@ -18,20 +176,27 @@ int vdtu_ring_init(struct vdtu_ring *ring, void *mem,
         return -1;
     if (slot_size < VDTU_HEADER_SIZE || !is_power_of_2(slot_size))
         return -1;
+    if (layout != VDTU_RING_LAYOUT_V1 && layout != VDTU_RING_LAYOUT_V2)
+        return -1;
 
-    struct vdtu_ring_ctrl *ctrl = (struct vdtu_ring_ctrl *)mem;
-    memset(ctrl, 0, sizeof(*ctrl));
+    init_ctrl(ring, mem, layout, VDTU_RING_MODE_SLOTS, slot_count, slot_size,
+              slot_count * slot_size);
+    return 0;
+}
 
-    ctrl->head       = 0;
-    ctrl->tail       = 0;
-    ctrl->slot_count = slot_count;
-    ctrl->slot_size  = slot_size;
-    ctrl->slot_mask  = slot_count - 1;
-    ctrl->ep_state   = VDTU_EP_ACTIVE;
+int vdtu_ring_init_packed(struct vdtu_ring *ring, void *mem,
+                          uint32_t data_size, uint32_t max_msg_size)
+{
+    if (!ring || !mem)
+        return -1;
 
-    ring->ctrl = ctrl;
-    ring->slots = (uint8_t *)mem + VDTU_RING_CTRL_SIZE;
+    data_size &= ~(uint32_t)(VDTU_RING_PACKED_ALIGN - 1);
+    if (max_msg_size < VDTU_HEADER_SIZE ||
+        max_msg_size > vdtu_ring_packed_max_msg(data_size))
+        return -1;
 
+    init_ctrl(ring, mem, VDTU_RING_DEFAULT_LAYOUT, VDTU_RING_MODE_PACKED,
+              0, max_msg_size, data_size);
     return 0;
 }
 
@@ -40,12 +205,148 @@ int vdtu_ring_attach(struct vdtu_ring *ring, void *mem)
     if (!ring || !mem)
         return -1;
 
-    ring->ctrl = (struct vdtu_ring_ctrl *)mem;
-    ring->slots = (uint8_t *)mem + VDTU_RING_CTRL_SIZE;
+    /* layout 0 is a ring initialized before the field existed: v1 */
+    uint32_t layout = ((struct vdtu_ring_ctrl *)mem)->layout;
+    bind_layout(ring, mem, layout == VDTU_RING_LAYOUT_V2 ? VDTU_RING_LAYOUT_V2
+                                                         : VDTU_RING_LAYOUT_V1);
+    ring->cached_tail = VDTU_LOAD_ACQUIRE(ring->tail);
+    ring->cached_head = VDTU_LOAD_ACQUIRE(ring->head);
+    ring->reserved = NULL;
+    ring->reserved_len = 0;
+    memset(&ring->stats, 0, sizeof(ring->stats));
 
     return 0;
 }
 
+int vdtu_ring_is_full(const struct vdtu_ring *ring)
+{
+    if (!is_packed(ring)) {
+        uint32_t next_head = (VDTU_LOAD_RELAXED(ring->head) + 1) &
+                             ring->ctrl->slot_mask;
+        if (next_head != ring->cached_tail)
+            return 0;
+        return next_head == VDTU_LOAD_ACQUIRE(ring->tail);
+    }
+
+    uint32_t head = VDTU_LOAD_RELAXED(ring->head);
+    uint32_t rec = vdtu_ring_packed_record_size(ring->ctrl->slot_size -
+                                                VDTU_HEADER_SIZE);
+    uint32_t pos;
+    if (packed_fit(ring->ctrl->data_size, head, ring->cached_tail, rec, &pos))
+        return 0;
+    return !packed_fit(ring->ctrl->data_size, head,
+                       VDTU_LOAD_ACQUIRE(ring->tail), rec, &pos);
+}
+
+uint32_t vdtu_ring_available(const struct vdtu_ring *ring)
+{
+    uint32_t head = VDTU_LOAD_ACQUIRE(ring->head);
+    uint32_t tail = VDTU_LOAD_ACQUIRE(ring->tail);
+    if (!is_packed(ring))
+        return (head - tail) & ring->ctrl->slot_mask;
+
+    uint32_t n = 0;
+    for (; tail != head; n++)
+        tail = consumer_next(ring, tail);
+    return n;
+}
+
+/*
+ * Bytes of the slot's payload area that may be non-zero: the length
+ * recorded in its header. Clamped, since the header sits in memory the
+ * consumer can write to.
+ */
+static uint16_t slot_dirty_len(const struct vdtu_ring *ring, const uint8_t *slot)
+{
+    uint16_t len = ((const struct vdtu_msg_header *)slot)->length;
+    uint32_t cap = ring->ctrl->slot_size - VDTU_HEADER_SIZE;
+    return len > cap ? (uint16_t)cap : len;
+}
+
+/*
+ * Bytes past payload_len that must end up zero. Slots carry stale data
+ * up to their recorded length; a packed record only owns its alignment
+ * padding (the space after it belongs to the next record or is free).
+ */
+static uint16_t dirty_len(const struct vdtu_ring *ring, const uint8_t *slot,
+                          uint16_t payload_len)
+{
+    if (is_packed(ring))
+        return (uint16_t)(vdtu_ring_packed_record_size(payload_len) -
+                          VDTU_HEADER_SIZE);
+    return slot_dirty_len(ring, slot);
+}
+
+/* Fill in the DTU message header (simulating HW auto-fill) */
+static void write_header(uint8_t *slot,
+                         uint16_t sender_pe, uint8_t sender_ep,
+                         uint16_t sender_vpe, uint8_t reply_ep,
+                         uint64_t label, uint64_t replylabel, uint8_t flags,
+                         uint16_t payload_len)
+{
+    struct vdtu_msg_header *hdr = (struct vdtu_msg_header *)slot;
+    hdr->flags          = flags & ~VDTU_FLAG_WRAP;
+    hdr->sender_core_id = sender_pe;
+    hdr->sender_ep_id   = sender_ep;
+    hdr->reply_ep_id    = reply_ep;
+    hdr->length          = payload_len;
+    hdr->sender_vpe_id  = sender_vpe;
+    hdr->label           = label;
+    hdr->replylabel      = replylabel;
+}
+
+/* Zero what is left of an earlier, longer payload past payload_len */
+static void scrub_tail(uint8_t *slot, uint16_t payload_len, uint16_t dirty)
+{
+    if (dirty > payload_len)
+        memset(slot + VDTU_HEADER_SIZE + payload_len, 0, dirty - payload_len);
+}
+
+/*
+ * Producer: claim room for a message of payload_len bytes at head.
+ * Returns where it goes (NULL if the ring is full) and the head value
+ * that publishes it. Only the producer writes free space, so a wrap
+ * marker left behind by a claim that is never published is harmless.
+ */
+static uint8_t *producer_claim(struct vdtu_ring *ring, uint32_t head,
+                               uint16_t payload_len, uint32_t *next)
+{
+    if (!is_packed(ring)) {
+        if (producer_space(ring, head, 1) == 0)
+            return NULL;
+        *next = (head + 1) & ring->ctrl->slot_mask;
+        return slot_at(ring, head);
+    }
+
+    uint32_t rec = vdtu_ring_packed_record_size(payload_len);
+    uint32_t pos;
+    if (!packed_place(ring, head, rec, &pos))
+        return NULL;
+    if (pos != head)
+        ring->slots[head] = VDTU_FLAG_WRAP;
+    *next = packed_advance(ring, pos, rec);
+    return ring->slots + pos;
+}
+
+/* Fill one slot with header + payload, keeping the bytes past it zero */
+static void fill_slot(struct vdtu_ring *ring, uint8_t *slot,
+                      uint16_t sender_pe, uint8_t sender_ep,
+                      uint16_t sender_vpe, uint8_t reply_ep,
+                      uint64_t label, uint64_t replylabel, uint8_t flags,
+                      const void *payload, uint16_t payload_len)
+{
+    uint16_t dirty = dirty_len(ring, slot, payload_len);
+
+    write_header(slot, sender_pe, sender_ep, sender_vpe, reply_ep,
+                 label, replylabel, flags, payload_len);
+
+    /* Copy payload after header */
+    if (payload && payload_len > 0) {
+        memcpy(slot + VDTU_HEADER_SIZE, payload, payload_len);
+    }
+    scrub_tail(slot, payload_len, dirty);
+}
+
 int vdtu_ring_send(struct vdtu_ring *ring,
                    uint16_t sender_pe, uint8_t sender_ep,
                    uint16_t sender_vpe, uint8_t reply_ep,
@@ -55,6 +356,9 @@ int vdtu_ring_send(struct vdtu_ring *ring,
     if (!ring || !ring->ctrl)
         return -1;
 
+    /* A plain send takes over the slot an outstanding reserve pointed at */
+    ring->reserved = NULL;
+
     /* Reject sends to terminated endpoints (reads still permitted for drain) */
     if (ring->ctrl->ep_state == VDTU_EP_TERMINATED)
         return -3;
@@ -63,63 +367,156 @@ int vdtu_ring_send(struct vdtu_ring *ring,
     if ((size_t)VDTU_HEADER_SIZE + payload_len > ring->ctrl->slot_size)
         return -2;
 
-    /* Check if ring is full */
-    uint32_t head = ring->ctrl->head;
-    uint32_t next_head = (head + 1) & ring->ctrl->slot_mask;
-    if (next_head == ring->ctrl->tail)
+    /* Check if ring is full (head is ours, only tail needs a fresh read) */
+    uint32_t head = VDTU_LOAD_RELAXED(ring->head);
+    uint32_t next;
+    uint8_t *slot = producer_claim(ring, head, payload_len, &next);
+    if (!slot)
         return -1;  /* full */
 
-    /* Get pointer to the slot */
-    uint8_t *slot = ring->slots + (size_t)head * ring->ctrl->slot_size;
+    fill_slot(ring, slot, sender_pe, sender_ep, sender_vpe, reply_ep,
+              label, replylabel, flags, payload, payload_len);
 
-    /* Zero the slot first to avoid leaking stale data */
-    memset(slot, 0, ring->ctrl->slot_size);
+    /* Publish: the release store orders the slot writes before head */
+    VDTU_STORE_RELEASE(ring->head, next);
+    ring->stats.sent++;
 
-    /* Fill in the DTU message header (simulating HW auto-fill) */
-    struct vdtu_msg_header *hdr = (struct vdtu_msg_header *)slot;
-    hdr->flags          = flags;
-    hdr->sender_core_id = sender_pe;
-    hdr->sender_ep_id   = sender_ep;
-    hdr->reply_ep_id    = reply_ep;
-    hdr->length          = payload_len;
-    hdr->sender_vpe_id  = sender_vpe;
-    hdr->label           = label;
-    hdr->replylabel      = replylabel;
+    return 0;
+}
 
-    /* Copy payload after header */
-    if (payload && payload_len > 0) {
-        memcpy(slot + VDTU_HEADER_SIZE, payload, payload_len);
+int vdtu_ring_send_batch(struct vdtu_ring *ring,
+                         const struct vdtu_ring_msg_desc *msgs,
+                         uint32_t count)
+{
+    if (!ring || !ring->ctrl || (!msgs && count > 0))
+        return -1;
+
+    ring->reserved = NULL;
+
+    if (ring->ctrl->ep_state == VDTU_EP_TERMINATED)
+        return -3;
+
+    /* Validate the whole batch up front so a bad descriptor never
+     * leaves a half-published burst behind */
+    for (uint32_t i = 0; i < count; i++) {
+        if ((size_t)VDTU_HEADER_SIZE + msgs[i].payload_len > ring->ctrl->slot_size)
+            return -2;
     }
 
-    /* Memory barrier: ensure all writes are visible before advancing head.
-     * On x86, stores are not reordered with other stores, but the compiler
-     * might reorder. Use a compiler barrier. */
-    __asm__ volatile("" ::: "memory");
+    /* Fill as many messages as there is room for */
+    uint32_t head = VDTU_LOAD_RELAXED(ring->head);
+    uint32_t n;
+    for (n = 0; n < count; n++) {
+        const struct vdtu_ring_msg_desc *d = &msgs[n];
+        uint32_t next;
+        uint8_t *slot = producer_claim(ring, head, d->payload_len, &next);
+        if (!slot)
+            break;
+        fill_slot(ring, slot,
+                  d->sender_pe, d->sender_ep, d->sender_vpe, d->reply_ep,
+                  d->label, d->replylabel, d->flags,
+                  d->payload, d->payload_len);
+        head = next;
+    }
+
+    if (n == 0)
+        return 0;
+
+    /* One release store publishes the whole batch */
+    VDTU_STORE_RELEASE(ring->head, head);
+    ring->stats.sent += n;
+
+    return (int)n;
+}
+
+int vdtu_ring_reserve(struct vdtu_ring *ring, uint16_t payload_len,
+                      void **payload)
+{
+    if (!ring || !ring->ctrl || !payload)
+        return -1;
+
+    ring->reserved = NULL;
+
+    if (ring->ctrl->ep_state == VDTU_EP_TERMINATED)
+        return -3;
+
+    if ((size_t)VDTU_HEADER_SIZE + payload_len > ring->ctrl->slot_size)
+        return -2;
+
+    uint32_t head = VDTU_LOAD_RELAXED(ring->head);
+    uint32_t next;
+    uint8_t *slot = producer_claim(ring, head, payload_len, &next);
+    if (!slot)
+        return -1;  /* full */
+
+    /* The slot is ours until head moves. Widen its recorded length to
+     * cover whatever the caller writes, so commit (or a later send, if
+     * the reservation is dropped) knows how far to scrub. */
+    struct vdtu_msg_header *hdr = (struct vdtu_msg_header *)slot;
+    if (!is_packed(ring) && slot_dirty_len(ring, slot) < payload_len)
+        hdr->length = payload_len;
+
+    ring->reserved = slot;
+    ring->reserved_len = payload_len;
+    *payload = slot + VDTU_HEADER_SIZE;
+    return 0;
+}
+
+int vdtu_ring_commit(struct vdtu_ring *ring,
+                     uint16_t sender_pe, uint8_t sender_ep,
+                     uint16_t sender_vpe, uint8_t reply_ep,
+                     uint64_t label, uint64_t replylabel, uint8_t flags,
+                     uint16_t payload_len)
+{
+    if (!ring || !ring->ctrl || !ring->reserved)
+        return -1;
+    if (payload_len > ring->reserved_len)
+        return -2;
+
+    uint8_t *slot = ring->reserved;
+    uint16_t dirty = dirty_len(ring, slot, payload_len);
+    ring->reserved = NULL;
 
-    /* Advance head */
-    ring->ctrl->head = next_head;
+    write_header(slot, sender_pe, sender_ep, sender_vpe, reply_ep,
+                 label, replylabel, flags, payload_len);
+    scrub_tail(slot, payload_len, dirty);
+
+    /* Only the producer moves head, so the reserved slot is still the
+     * one at head (or, packed, the one its wrap marker points to) */
+    uint32_t next;
+    if (is_packed(ring)) {
+        next = packed_advance(ring, (uint32_t)(slot - ring->slots),
+                              vdtu_ring_packed_record_size(payload_len));
+    } else {
+        uint32_t head = VDTU_LOAD_RELAXED(ring->head);
+        next = (head + 1) & ring->ctrl->slot_mask;
+    }
+    VDTU_STORE_RELEASE(ring->head, next);
+    ring->stats.sent++;
 
     return 0;
 }
 
-const struct vdtu_message *vdtu_ring_fetch(const struct vdtu_ring *ring)
+void vdtu_ring_cancel(struct vdtu_ring *ring)
+{
+    /* Nothing to undo: reserve already recorded how far the slot is dirty */
+    if (ring)
+        ring->reserved = NULL;
+}
+
+const struct vdtu_message *vdtu_ring_fetch(struct vdtu_ring *ring)
 {
     if (!ring || !ring->ctrl)
         return NULL;
 
-    uint32_t tail = ring->ctrl->tail;
-    uint32_t head = ring->ctrl->head;
+    uint32_t tail = VDTU_LOAD_RELAXED(ring->tail);
 
-    /* Empty? */
-    if (tail == head)
+    /* Empty? (acquire on refresh makes the slot contents visible) */
+    if (!consumer_pending(ring, tail))
         return NULL;
 
-    /* Memory barrier: ensure we read head before reading slot data */
-    __asm__ volatile("" ::: "memory");
-
     /* Return pointer to current slot */
-    const uint8_t *slot = ring->slots + (size_t)tail * ring->ctrl->slot_size;
-    return (const struct vdtu_message *)slot;
+    return (const struct vdtu_message *)consumer_msg(ring, tail);
 }
 
 void vdtu_ring_ack(struct vdtu_ring *ring)
@@ -127,8 +524,161 @@ void vdtu_ring_ack(struct vdtu_ring *ring)
     if (!ring || !ring->ctrl)
         return;
 
-    /* Memory barrier: ensure we are done reading the slot before advancing */
-    __asm__ volatile("" ::: "memory");
+    uint32_t tail = VDTU_LOAD_RELAXED(ring->tail);
+
+    /* Never move tail past head: a stray ack would otherwise hand unread
+     * slots back to the producer and desync the cached head */
+    if (!consumer_pending(ring, tail))
+        return;
+
+    /* Release: all reads of the slot complete before it is handed back */
+    VDTU_STORE_RELEASE(ring->tail, consumer_next(ring, tail));
+}
+
+uint32_t vdtu_ring_fetch_batch(struct vdtu_ring *ring,
+                               const struct vdtu_message **msgs,
+                               uint32_t max)
+{
+    if (!ring || !ring->ctrl || !msgs)
+        return 0;
+
+    uint32_t tail = VDTU_LOAD_RELAXED(ring->tail);
+    uint32_t n;
+    for (n = 0; n < max && consumer_pending(ring, tail); n++) {
+        msgs[n] = (const struct vdtu_message *)consumer_msg(ring, tail);
+        tail = consumer_next(ring, tail);
+    }
+
+    return n;
+}
+
+void vdtu_ring_ack_n(struct vdtu_ring *ring, uint32_t n)
+{
+    if (!ring || !ring->ctrl || n == 0)
+        return;
+
+    uint32_t tail = VDTU_LOAD_RELAXED(ring->tail);
+    for (; n > 0 && consumer_pending(ring, tail); n--)
+        tail = consumer_next(ring, tail);
+
+    /* Release: all reads of the slots complete before they are handed back */
+    VDTU_STORE_RELEASE(ring->tail, tail);
+}
+
+int vdtu_ring_notify_needed(struct vdtu_ring *ring)
+{
+    if (!ring || !ring->ctrl)
+        return 0;
 
-    ring->ctrl->tail = (ring->ctrl->tail + 1) & ring->ctrl->slot_mask;
+    /* Order our head store before reading the flag (pairs with the
+     * fence in vdtu_ring_prepare_wait) */
+    VDTU_FENCE();
+    if (!VDTU_LOAD_RELAXED(&ring->ctrl->consumer_waiting))
+        return 0;
+
+    /* Only the first producer to see the sleeper signals it */
+    if (!__atomic_exchange_n(&ring->ctrl->consumer_waiting, 0, __ATOMIC_RELAXED))
+        return 0;
+
+    ring->stats.notifies++;
+    return 1;
+}
+
+int vdtu_ring_prepare_wait(struct vdtu_ring *ring)
+{
+    if (!ring || !ring->ctrl)
+        return 0;
+
+    __atomic_store_n(&ring->ctrl->consumer_waiting, 1, __ATOMIC_RELAXED);
+
+    /* Order the flag store before re-reading head (pairs with the fence
+     * in vdtu_ring_notify_needed) */
+    VDTU_FENCE();
+    uint32_t tail = VDTU_LOAD_RELAXED(ring->tail);
+    ring->cached_head = VDTU_LOAD_ACQUIRE(ring->head);
+    if (ring->cached_head == tail)
+        return 0;
+
+    vdtu_ring_finish_wait(ring);
+    return 1;
+}
+
+void vdtu_ring_finish_wait(struct vdtu_ring *ring)
+{
+    if (ring && ring->ctrl)
+        __atomic_store_n(&ring->ctrl->consumer_waiting, 0, __ATOMIC_RELAXED);
+}
+
+void vdtu_ring_waiter_init(struct vdtu_ring_waiter *w,
+                           uint32_t spin_min, uint32_t spin_max)
+{
+    memset(w, 0, sizeof(*w));
+    w->spin_min = spin_min;
+    w->spin_max = spin_max > spin_min ? spin_max : spin_min;
+    w->spin     = w->spin_min;
+}
+
+/* Index of the first ring with a pending message, or count if none */
+static uint32_t first_pending(struct vdtu_ring *const *rings, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        if (rings[i] && rings[i]->ctrl && !vdtu_ring_is_empty(rings[i]))
+            return i;
+    }
+    return count;
+}
+
+uint32_t vdtu_ring_wait_any(struct vdtu_ring_waiter *w,
+                            struct vdtu_ring *const *rings, uint32_t count,
+                            int (*block)(void *), void *arg)
+{
+    w->waits++;
+
+    uint32_t i = first_pending(rings, count);
+    if (i < count)
+        return i;
+
+    /* Spin: a reply that is already on its way is cheaper to poll for
+     * than a block + signal round trip */
+    for (uint32_t n = 0; n < w->spin; n++) {
+        i = first_pending(rings, count);
+        if (i < count) {
+            w->spin_hits++;
+            w->spin = w->spin * 2 < w->spin_max ? w->spin * 2 : w->spin_max;
+            return i;
+        }
+    }
+
+    for (;;) {
+        /* Announce on every ring; a message that slipped in meanwhile
+         * cancels the block */
+        uint32_t ready = count;
+        for (i = 0; i < count; i++) {
+            if (!rings[i] || !rings[i]->ctrl)
+                continue;
+            if (vdtu_ring_prepare_wait(rings[i])) {
+                ready = i;
+                break;
+            }
+        }
+
+        int signalled = 1;
+        if (ready == count) {
+            signalled = block(arg);
+            w->blocks++;
+        }
+
+        for (i = 0; i < count; i++) {
+            if (rings[i] && rings[i]->ctrl)
+                vdtu_ring_finish_wait(rings[i]);
+        }
+
+        i = first_pending(rings, count);
+        if (i < count || !signalled) {
+            w->spin = w->spin / 2 > w->spin_min ? w->spin / 2 : w->spin_min;
+            if (i == count)
+                w->timeouts++;
+            return i;
+        }
+    }
 }
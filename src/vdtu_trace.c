@@ -0,0 +1,153 @@
+/*
+ * vdtu_trace.c -- Level-gated binary trace log (see vdtu_trace.h)
+ */
+
+#include "vdtu_trace.h"
+
+#if VDTU_TRACE_LEVEL > 0
+
+#include <stdio.h>
+#include <string.h>
+
+#define TRACE_MASK  (VDTU_TRACE_RECORDS - 1)
+
+#define VDTU_TRACE_EVENT_FMT(name, fmt) fmt,
+static const char *const event_fmt[VDTU_EV_COUNT] = {
+    VDTU_TRACE_EVENTS(VDTU_TRACE_EVENT_FMT)
+};
+#undef VDTU_TRACE_EVENT_FMT
+
+static const char *const level_name[] = { "", "ERR", "INF", "DBG" };
+
+static struct {
+    uint32_t head;                  /* next index to claim (producers)  */
+    uint32_t tail;                  /* next index to read (reader)      */
+    uint32_t lost;
+    const char *component;
+    struct vdtu_trace_rec recs[VDTU_TRACE_RECORDS];
+} trace_log = { 0, 0, 0, "vdtu", { { 0, 0, 0, 0, 0, { 0, 0, 0 } } } };
+
+static inline uint64_t trace_now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return 0;
+#endif
+}
+
+void vdtu_trace_init(const char *component)
+{
+    trace_log.component = component;
+}
+
+void vdtu_trace_emit(uint8_t level, uint16_t event,
+                     uint64_t a0, uint64_t a1, uint64_t a2)
+{
+    uint32_t idx = __atomic_fetch_add(&trace_log.head, 1, __ATOMIC_RELAXED);
+    struct vdtu_trace_rec *r = &trace_log.recs[idx & TRACE_MASK];
+
+    /* Invalidate first, so a reader never takes a half-written record
+     * for the previous lap's */
+    __atomic_store_n(&r->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&r->tsc, trace_now(), __ATOMIC_RELAXED);
+    __atomic_store_n(&r->event, event, __ATOMIC_RELAXED);
+    __atomic_store_n(&r->level, level, __ATOMIC_RELAXED);
+    __atomic_store_n(&r->arg[0], a0, __ATOMIC_RELAXED);
+    __atomic_store_n(&r->arg[1], a1, __ATOMIC_RELAXED);
+    __atomic_store_n(&r->arg[2], a2, __ATOMIC_RELAXED);
+    __atomic_store_n(&r->seq, idx + 1, __ATOMIC_RELEASE);
+}
+
+int vdtu_trace_read(struct vdtu_trace_rec *out)
+{
+    for (;;) {
+        uint32_t head = __atomic_load_n(&trace_log.head, __ATOMIC_ACQUIRE);
+        uint32_t tail = trace_log.tail;
+        if (head == tail)
+            return 0;
+
+        /* Producers lapped us: skip what was overwritten */
+        if (head - tail > VDTU_TRACE_RECORDS) {
+            trace_log.lost += head - tail - VDTU_TRACE_RECORDS;
+            trace_log.tail = tail = head - VDTU_TRACE_RECORDS;
+        }
+
+        const struct vdtu_trace_rec *r = &trace_log.recs[tail & TRACE_MASK];
+        uint32_t seq = __atomic_load_n(&r->seq, __ATOMIC_ACQUIRE);
+        if (seq != tail + 1) {
+            /* Not written yet: try again on the next drain */
+            if (seq == 0 || (int32_t)(seq - (tail + 1)) < 0)
+                return 0;
+            /* Already overwritten by a later lap */
+            trace_log.lost++;
+            trace_log.tail = tail + 1;
+            continue;
+        }
+
+        out->tsc = __atomic_load_n(&r->tsc, __ATOMIC_RELAXED);
+        out->event = __atomic_load_n(&r->event, __ATOMIC_RELAXED);
+        out->level = __atomic_load_n(&r->level, __ATOMIC_RELAXED);
+        out->arg[0] = __atomic_load_n(&r->arg[0], __ATOMIC_RELAXED);
+        out->arg[1] = __atomic_load_n(&r->arg[1], __ATOMIC_RELAXED);
+        out->arg[2] = __atomic_load_n(&r->arg[2], __ATOMIC_RELAXED);
+        out->seq = seq;
+        out->_pad = 0;
+
+        /* A producer may have reused the record while we copied it */
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        trace_log.tail = tail + 1;
+        if (__atomic_load_n(&r->seq, __ATOMIC_RELAXED) != seq) {
+            trace_log.lost++;
+            continue;
+        }
+        return 1;
+    }
+}
+
+uint32_t vdtu_trace_lost(void)
+{
+    return trace_log.lost;
+}
+
+int vdtu_trace_format(const struct vdtu_trace_rec *rec, char *buf, size_t len)
+{
+    const char *fmt = rec->event < VDTU_EV_COUNT ? event_fmt[rec->event]
+                                                 : "unknown event %llu";
+    const char *lvl = rec->level <= VDTU_TRACE_DBG ? level_name[rec->level] : "?";
+
+    int n = snprintf(buf, len, "[%s] %llu %s ", trace_log.component,
+                     (unsigned long long)rec->tsc, lvl);
+    if (n < 0 || (size_t)n >= len)
+        return n;
+    if (rec->event >= VDTU_EV_COUNT)
+        return n + snprintf(buf + n, len - n, fmt, (unsigned long long)rec->event);
+    return n + snprintf(buf + n, len - n, fmt,
+                        (unsigned long long)rec->arg[0],
+                        (unsigned long long)rec->arg[1],
+                        (unsigned long long)rec->arg[2]);
+}
+
+uint32_t vdtu_trace_drain(uint32_t budget)
+{
+    static uint32_t lost_reported = 0;
+    struct vdtu_trace_rec rec;
+    char line[160];
+    uint32_t n = 0;
+
+    while (n < budget && vdtu_trace_read(&rec)) {
+        vdtu_trace_format(&rec, line, sizeof(line));
+        puts(line);
+        n++;
+    }
+
+    if (trace_log.lost != lost_reported) {
+        printf("[%s] trace: %u records lost\n", trace_log.component,
+               trace_log.lost - lost_reported);
+        lost_reported = trace_log.lost;
+    }
+    return n;
+}
+
+#endif /* VDTU_TRACE_LEVEL > 0 */
@@ -0,0 +1,271 @@
+/*
+ * bench_captable.cc -- Host check and microbenchmark for the CapTable storage
+ *
+ * Builds kernel/cap/CapArray.h on the host with a stand-in capability that
+ * is a TreapNode keyed by its selector, like kernel::Capability:
+ *
+ *   - random insert/find/remove over dense and sparse selectors, checked
+ *     against a shadow array
+ *   - range_used/range_unused across page and directory boundaries
+ *   - remove_next drains everything, the dense selectors in order
+ *   - exchange and revoke of 1 to 4096 caps: the former treap with one
+ *     lookup per selector against the paged array
+ *
+ * Or just: make test (uses the provided Makefile)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cap/CapArray.h"
+
+using kernel::CapArray;
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) \
+    do { printf("  TEST: %-50s ", name); fflush(stdout); } while(0)
+
+#define PASS() \
+    do { printf("PASS\n"); tests_passed++; } while(0)
+
+#define FAIL(msg) \
+    do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define CHECK(cond, msg) \
+    do { if (!(cond)) { FAIL(msg); return; } } while(0)
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t rng_state = 0x12345678;
+static uint32_t rnd() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static volatile uintptr_t sink;
+
+/* A capability stand-in: keyed by its selector, with a virtual print like Capability */
+struct Cap : public m3::TreapNode<capsel_t> {
+    explicit Cap(capsel_t sel) : m3::TreapNode<capsel_t>(sel) {
+    }
+    void print(m3::OStream &) const override {
+    }
+};
+
+/* The former storage: a treap, with one lookup per selector for range checks */
+class TreapTable {
+public:
+    Cap *find(capsel_t sel) const {
+        return _caps.find(sel);
+    }
+    void insert(Cap *c) {
+        _caps.insert(c);
+    }
+    void remove(Cap *c) {
+        _caps.remove(c);
+    }
+    bool range_is(capsel_t start, capsel_t count, bool used) const {
+        for(capsel_t i = start; i < start + count; ++i) {
+            if((find(i) != nullptr) != used)
+                return false;
+        }
+        return true;
+    }
+
+private:
+    m3::Treap<Cap> _caps;
+};
+
+/* ========================================================================= */
+
+static void test_random() {
+    TEST("random insert/find/remove against a shadow");
+
+    // dense selectors and a few above DENSE_CAPS
+    static const capsel_t SELS = 4096;
+    static Cap *shadow[SELS];
+    memset(shadow, 0, sizeof(shadow));
+    CapArray<Cap> caps;
+    auto sel_of = [](capsel_t i) {
+        return i < SELS - 64 ? i : CapArray<Cap>::DENSE_CAPS + i * 1000;
+    };
+
+    size_t live = 0;
+    for(size_t r = 0; r < 200000; r++) {
+        capsel_t i = rnd() % SELS;
+        capsel_t sel = sel_of(i);
+        CHECK(caps.find(sel) == shadow[i], "find");
+        if(shadow[i]) {
+            caps.remove(shadow[i]);
+            delete shadow[i];
+            shadow[i] = nullptr;
+            live--;
+        }
+        else {
+            shadow[i] = new Cap(sel);
+            caps.insert(shadow[i]);
+            live++;
+        }
+        CHECK(caps.count() == live, "count");
+    }
+
+    for(capsel_t i = 0; i < SELS; ++i) {
+        CHECK(caps.find(sel_of(i)) == shadow[i], "final contents");
+        if(shadow[i]) {
+            caps.remove(shadow[i]);
+            delete shadow[i];
+        }
+    }
+    CHECK(caps.count() == 0 && caps.find(0) == nullptr, "empty");
+
+    PASS();
+}
+
+static void test_ranges() {
+    TEST("range checks across pages and the directory");
+
+    static const capsel_t P = CapArray<Cap>::PAGE_CAPS;
+    static const capsel_t D = CapArray<Cap>::DENSE_CAPS;
+    CapArray<Cap> caps;
+    Cap *objs[3 * P];
+    // [P - 5, 2 * P + 5) is used: crosses two page boundaries and covers a whole page
+    for(capsel_t i = 0; i < 2 * P + 10 - P; ++i) {
+        objs[i] = new Cap(P - 5 + i);
+        caps.insert(objs[i]);
+    }
+
+    CHECK(caps.range_is(P - 5, P + 10, true), "used across pages");
+    CHECK(caps.range_is(P, P, true), "whole page used");
+    CHECK(!caps.range_is(P - 6, 2, true), "first selector missing");
+    CHECK(!caps.range_is(2 * P + 4, 2, true), "last selector missing");
+    CHECK(caps.range_is(0, P - 5, false), "unused before");
+    CHECK(caps.range_is(2 * P + 5, 10 * P, false), "unused behind, beyond the directory");
+    CHECK(!caps.range_is(0, P - 4, false), "touches a used one");
+    CHECK(caps.range_is(7, 0, true) && caps.range_is(7, 0, false), "empty range");
+    CHECK(!caps.range_is(D - 2, 4, true) && caps.range_is(D - 2, 4, false), "dense to sparse");
+
+    Cap *hi[2] = { new Cap(D), new Cap(D + 1) };
+    caps.insert(hi[0]);
+    caps.insert(hi[1]);
+    CHECK(caps.range_is(D, 2, true) && !caps.range_is(D - 1, 2, true), "sparse used");
+    CHECK(!caps.range_is(D - 2, 4, false), "sparse not unused");
+
+    // a huge selector does not grow the directory up to it
+    Cap *top = new Cap(0xFFFFFFF0);
+    caps.insert(top);
+    CHECK(caps.find(0xFFFFFFF0) == top && caps.find(0xFFFFFFF1) == nullptr, "top selector");
+
+    Cap *c;
+    capsel_t last = 0;
+    size_t n = 0;
+    bool ordered = true;
+    while((c = caps.remove_next()) != nullptr) {
+        // the sparse ones come last, in any order
+        ordered &= n == 0 || c->key() > last || last >= D;
+        last = c->key();
+        n++;
+        delete c;
+    }
+    CHECK(ordered && n == P + 10 + 3 && caps.count() == 0, "drained in order");
+    CHECK(caps.range_is(0, P * 4, false), "empty again");
+
+    PASS();
+}
+
+/* ========================================================================= */
+
+/*
+ * ns per exchange and per revoke of <n> caps. exchange checks that the source
+ * range is used and the destination range is free, then looks up every source
+ * and sets a copy at the destination; revoke looks up and removes every
+ * destination cap. Each round exchanges into 4096 / n destination ranges
+ * first and revokes them afterwards, so that small ranges are timed in bulk.
+ */
+template<class TABLE>
+static void bench_table(capsel_t n, size_t rounds, double *xchg, double *revoke) {
+    TABLE tbl;
+    static const capsel_t DST = 8192;
+    static const capsel_t CAPS = 4096;
+    capsel_t ranges = CAPS / n;
+    Cap **src = new Cap*[n];
+    Cap **dst = new Cap*[CAPS];
+    for(capsel_t i = 0; i < n; ++i) {
+        src[i] = new Cap(i);
+        tbl.insert(src[i]);
+    }
+    for(capsel_t i = 0; i < CAPS; ++i)
+        dst[i] = new Cap(DST + i);
+
+    uint64_t tx = 0, tr = 0;
+    for(size_t r = 0; r < rounds; r++) {
+        uint64_t t0 = now_ns();
+        for(capsel_t k = 0; k < ranges; ++k) {
+            if(!tbl.range_is(0, n, true) || !tbl.range_is(DST + k * n, n, false))
+                continue;
+            for(capsel_t i = 0; i < n; ++i) {
+                sink = reinterpret_cast<uintptr_t>(tbl.find(i));
+                tbl.insert(dst[k * n + i]);
+            }
+        }
+        uint64_t t1 = now_ns();
+        for(capsel_t k = 0; k < ranges; ++k) {
+            for(capsel_t i = 0; i < n; ++i) {
+                Cap *c = tbl.find(DST + k * n + i);
+                if(c)
+                    tbl.remove(c);
+            }
+        }
+        uint64_t t2 = now_ns();
+        tx += t1 - t0;
+        tr += t2 - t1;
+    }
+    *xchg = (double)tx / (rounds * ranges);
+    *revoke = (double)tr / (rounds * ranges);
+
+    for(capsel_t i = 0; i < n; ++i) {
+        tbl.remove(src[i]);
+        delete src[i];
+    }
+    for(capsel_t i = 0; i < CAPS; ++i)
+        delete dst[i];
+    delete[] src;
+    delete[] dst;
+}
+
+static void bench() {
+    static const capsel_t sizes[] = { 1, 16, 256, 4096 };
+
+    printf("\n  %-6s %14s %14s %14s %14s\n", "caps",
+        "treap xchg ns", "array xchg ns", "treap rev ns", "array rev ns");
+    for(capsel_t n : sizes) {
+        size_t rounds = 200;
+        double tx, tr, ax, ar;
+        bench_table<TreapTable>(n, rounds, &tx, &tr);
+        bench_table<CapArray<Cap>>(n, rounds, &ax, &ar);
+        printf("  %-6u %14.1f %14.1f %14.1f %14.1f\n", n, tx, ax, tr, ar);
+    }
+}
+
+/* ========================================================================= */
+
+int main() {
+    printf("=== CapTable Storage Tests ===\n\n");
+
+    test_random();
+    test_ranges();
+    bench();
+
+    printf("\n=== Results: %d passed, %d failed ===\n",
+           tests_passed, tests_failed);
+
+    return tests_failed ? 1 : 0;
+}
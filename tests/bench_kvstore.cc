@@ -0,0 +1,234 @@
+/*
+ * bench_kvstore.cc -- Host check and microbenchmark for kernel::KVStore
+ *
+ * Builds the kernel's KVStore.h on the host (with a stand-in <base/Panic.h>
+ * from tests/host) and compares it against the SList-backed store it
+ * replaced, kept here as ListKVStore:
+ *
+ *   - a randomized put/get/exists/remove run, checked against ListKVStore
+ *   - lookups and the KPE callback pattern (add newest, notify and remove
+ *     oldest) with 10, 100 and 10k entries in the store
+ *
+ * Or just: make test (uses the provided Makefile)
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include <base/col/SList.h>
+#include "KVStore.h"
+
+using kernel::KVStore;
+
+/* The previous implementation: a linear walk over an SList */
+template<typename KEY, class VALUE>
+class ListKVStore {
+    struct Entry : public m3::SListItem {
+        explicit Entry(KEY key, VALUE value) : id(key), val(value) {
+        }
+        KEY id;
+        VALUE val;
+    };
+
+public:
+    ~ListKVStore() {
+        while(_store.length() > 0)
+            delete _store.remove_first();
+    }
+
+    void put(KEY key, VALUE val) {
+        for(auto it = _store.begin(); it != _store.end(); it++) {
+            if(it->id == key) {
+                it->val = val;
+                return;
+            }
+        }
+        _store.append(new Entry(key, val));
+    }
+    VALUE get(KEY key) const {
+        for(auto it = _store.begin(); it != _store.end(); it++) {
+            if(it->id == key)
+                return it->val;
+        }
+        return VALUE();
+    }
+    bool exists(KEY key) const {
+        for(auto it = _store.begin(); it != _store.end(); it++) {
+            if(it->id == key)
+                return true;
+        }
+        return false;
+    }
+    bool remove(KEY key) {
+        for(auto it = _store.begin(); it != _store.end(); it++) {
+            if(it->id == key) {
+                Entry *e = &*it;
+                _store.remove(e);
+                delete e;
+                return true;
+            }
+        }
+        return false;
+    }
+    unsigned int size() const {
+        return _store.length();
+    }
+
+private:
+    m3::SList<Entry> _store;
+};
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) \
+    do { printf("  TEST: %-50s ", name); fflush(stdout); } while(0)
+
+#define PASS() \
+    do { printf("PASS\n"); tests_passed++; } while(0)
+
+#define FAIL(msg) \
+    do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define CHECK(cond, msg) \
+    do { if (!(cond)) { FAIL(msg); return; } } while(0)
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t rng_state = 12345;
+static uint32_t rng() {
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 8;
+}
+
+/* Keep the optimizer from dropping lookups */
+static volatile uintptr_t sink;
+
+/* ========================================================================= */
+
+static void test_against_list() {
+    TEST("randomized ops agree with the SList store");
+
+    KVStore<unsigned int, uintptr_t> hash;
+    ListKVStore<unsigned int, uintptr_t> list;
+
+    for(int i = 0; i < 200000; i++) {
+        // small key space, so removes hit and probe runs collide
+        unsigned int key = rng() % 512;
+        switch(rng() % 4) {
+            case 0:
+            case 1:
+                hash.put(key, i);
+                list.put(key, i);
+                break;
+            case 2:
+                CHECK(hash.remove(key) == list.remove(key), "remove result");
+                break;
+            case 3:
+                CHECK(hash.exists(key) == list.exists(key), "exists result");
+                if(list.exists(key))
+                    CHECK(hash.get(key) == list.get(key), "get result");
+                break;
+        }
+        CHECK(hash.size() == list.size(), "size");
+    }
+
+    unsigned int seen = 0;
+    for(auto it = hash.begin(); it != hash.end(); it++) {
+        CHECK(list.exists(it->id) && list.get(it->id) == it->val, "iterated entry");
+        seen++;
+    }
+    CHECK(seen == hash.size(), "iteration visits every entry once");
+
+    const KVStore<unsigned int, uintptr_t> &chash = hash;
+    seen = 0;
+    for(auto it = chash.begin(); it != chash.end(); ++it)
+        seen++;
+    CHECK(seen == hash.size(), "const iteration");
+
+    PASS();
+}
+
+static void test_size_t_keys() {
+    TEST("size_t keys beyond 32 bits");
+
+    KVStore<size_t, int> kv;
+    CHECK(kv.begin() == kv.end(), "empty store iterates nothing");
+    for(size_t i = 0; i < 100; i++)
+        kv.put(i << 32, (int)i);
+    for(size_t i = 0; i < 100; i++)
+        CHECK(kv.exists(i << 32) && kv.get(i << 32) == (int)i, "lookup");
+    CHECK(!kv.exists(1), "absent key");
+    kv[5ul << 32] = 77;
+    CHECK(kv.get(5ul << 32) == 77, "operator[] assignment");
+
+    PASS();
+}
+
+/* ========================================================================= */
+
+/*
+ * KPE callback pattern: 'inflight' callbacks outstanding, each round adds
+ * the next id and notifies (get + remove) the oldest.
+ */
+template<class STORE>
+static double bench_callbacks(unsigned int inflight, unsigned int rounds) {
+    STORE kv;
+    unsigned int next = 0;
+    for(; next < inflight; next++)
+        kv.put(next, next);
+
+    uint64_t t0 = now_ns();
+    for(unsigned int r = 0; r < rounds; r++, next++) {
+        kv.put(next, next);
+        sink = kv.get(next - inflight);
+        kv.remove(next - inflight);
+    }
+    return (double)(now_ns() - t0) / rounds;
+}
+
+template<class STORE>
+static double bench_lookup(unsigned int entries, unsigned int lookups) {
+    STORE kv;
+    for(unsigned int i = 0; i < entries; i++)
+        kv.put(i, i);
+
+    uint64_t t0 = now_ns();
+    for(unsigned int i = 0; i < lookups; i++)
+        sink = kv.get(rng() % entries);
+    return (double)(now_ns() - t0) / lookups;
+}
+
+static void bench() {
+    static const unsigned int sizes[] = { 10, 100, 10000 };
+
+    printf("\n  %-8s %18s %18s %18s %18s\n", "entries",
+           "list get ns", "hash get ns", "list cb ns", "hash cb ns");
+    for(unsigned int s : sizes) {
+        // fewer rounds for the linear store at 10k, it is O(n) per op
+        unsigned int ops = s >= 10000 ? 20000 : 1000000;
+        double lg = bench_lookup<ListKVStore<unsigned int, uintptr_t>>(s, ops);
+        double hg = bench_lookup<KVStore<unsigned int, uintptr_t>>(s, ops);
+        double lc = bench_callbacks<ListKVStore<unsigned int, uintptr_t>>(s, ops);
+        double hc = bench_callbacks<KVStore<unsigned int, uintptr_t>>(s, ops);
+        printf("  %-8u %18.1f %18.1f %18.1f %18.1f\n", s, lg, hg, lc, hc);
+    }
+}
+
+/* ========================================================================= */
+
+int main() {
+    printf("=== KVStore Tests ===\n\n");
+
+    test_against_list();
+    test_size_t_keys();
+    bench();
+
+    printf("\n=== Results: %d passed, %d failed ===\n",
+           tests_passed, tests_failed);
+
+    return tests_failed ? 1 : 0;
+}
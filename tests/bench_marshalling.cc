@@ -0,0 +1,260 @@
+/*
+ * bench_marshalling.cc -- Host check and size comparison for the marshalling encodings
+ *
+ * Builds include/base/com/Marshalling.h on the host:
+ *
+ *   - round trips of mixed values and strings in WORDS and COMPACT
+ *   - COMPACT reads values at unaligned positions and nests streams exactly
+ *   - reads beyond the end yield zeroes and set the error, in both encodings
+ *   - the message sizes of a few kernelcalls in both encodings, and the
+ *     time to marshal and unmarshal them
+ *
+ * Or just: make test (uses the provided Makefile)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <base/com/Marshalling.h>
+
+using m3::Marshaller;
+using m3::Unmarshaller;
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) \
+    do { printf("  TEST: %-50s ", name); fflush(stdout); } while(0)
+
+#define PASS() \
+    do { printf("PASS\n"); tests_passed++; } while(0)
+
+#define FAIL(msg) \
+    do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define CHECK(cond, msg) \
+    do { if (!(cond)) { FAIL(msg); return; } } while(0)
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static volatile uint64_t sink;
+
+/* Stand-ins for the types kernelcalls are made of */
+enum Operation { SIGVITAL, MHTGET = 3, EXCHANGEOSESS = 19, REVOKE = 26 };
+enum OpStage : uint8_t { KREQUEST, KREPLY };
+typedef uint64_t mht_key_t;
+
+static const char *enc_name(Marshaller::Encoding enc) {
+    return enc == Marshaller::COMPACT ? "COMPACT" : "WORDS";
+}
+
+/* ========================================================================= */
+
+static void test_roundtrip(Marshaller::Encoding enc) {
+    char name[64];
+    snprintf(name, sizeof(name), "round trip in %s", enc_name(enc));
+    TEST(name);
+
+    alignas(8) unsigned char buf[512];
+    Marshaller m(buf, sizeof(buf), enc);
+    char longstr[300];
+    memset(longstr, 'x', 200);
+    longstr[200] = '\0';
+    m << REVOKE << KREPLY << -7 << true << (mht_key_t)0x1122334455667788ull << (uint16_t)0xBEEF;
+    m << "kernel" << m3::String() << static_cast<const char*>(longstr) << 3.5 << (char)'z';
+
+    Unmarshaller u(buf, m.total(), enc);
+    Operation op;
+    OpStage st;
+    int i;
+    bool b;
+    mht_key_t k;
+    uint16_t s;
+    m3::String s1, s2, s3;
+    double d;
+    char c;
+    u >> op >> st >> i >> b >> k >> s >> s1 >> s2 >> s3 >> d >> c;
+    CHECK(op == REVOKE && st == KREPLY && i == -7 && b, "small values");
+    CHECK(k == 0x1122334455667788ull && s == 0xBEEF, "key and short");
+    CHECK(strcmp(s1.c_str(), "kernel") == 0 && s2.length() == 0, "strings");
+    CHECK(s3.length() == 200 && s3.c_str()[199] == 'x', "string with a two-byte varint");
+    CHECK(d == 3.5 && c == 'z' && u.error() == m3::Errors::NO_ERROR, "trailing values");
+    CHECK(u.remaining() < 8, "consumed everything but the padding");
+
+    PASS();
+}
+
+static void test_nesting() {
+    TEST("COMPACT nests streams without padding");
+
+    // a payload with an odd length put behind an odd-length header
+    alignas(8) unsigned char inner[64];
+    Marshaller p(inner, sizeof(inner), Marshaller::COMPACT);
+    p << (uint32_t)1 << (mht_key_t)0xAABBCCDDEEFF0011ull << (uint8_t)9;
+
+    alignas(8) unsigned char outer[128];
+    Marshaller m(outer, sizeof(outer), Marshaller::COMPACT);
+    m << MHTGET << KREQUEST << (uint16_t)5;
+    m.put(p);
+    m << (uint32_t)0xCAFE;
+    CHECK(m.total() == m3::Math::round_up<size_t>(4 + 1 + 2 + 13 + 4, 8), "exact size");
+
+    Unmarshaller u(outer, m.total(), Marshaller::COMPACT);
+    Operation op;
+    OpStage st;
+    uint16_t s;
+    uint32_t a, tail;
+    mht_key_t k;
+    uint8_t b;
+    u >> op >> st >> s >> a >> k >> b >> tail;
+    CHECK(op == MHTGET && st == KREQUEST && s == 5 && a == 1, "header");
+    CHECK(k == 0xAABBCCDDEEFF0011ull && b == 9, "unaligned key");
+    CHECK(tail == 0xCAFE && u.error() == m3::Errors::NO_ERROR, "behind the payload");
+
+    // the rest of a stream can be put into another one
+    Unmarshaller rest(outer, m.total(), Marshaller::COMPACT);
+    rest >> op >> st >> s;
+    alignas(8) unsigned char copy[128];
+    Marshaller c(copy, sizeof(copy), Marshaller::COMPACT);
+    c.put(rest);
+    Unmarshaller u2(copy, c.total(), Marshaller::COMPACT);
+    u2 >> a >> k;
+    CHECK(a == 1 && k == 0xAABBCCDDEEFF0011ull, "put the remainder");
+
+    PASS();
+}
+
+static void test_bounds(Marshaller::Encoding enc) {
+    char name[64];
+    snprintf(name, sizeof(name), "bounds-checked reads in %s", enc_name(enc));
+    TEST(name);
+
+    alignas(8) unsigned char buf[64];
+    Marshaller m(buf, sizeof(buf), enc);
+    m << (uint32_t)42;
+
+    Unmarshaller u(buf, m.total(), enc);
+    uint32_t a;
+    mht_key_t k = 77;
+    mht_key_t k2 = 78;
+    u >> a;
+    CHECK(a == 42 && u.error() == m3::Errors::NO_ERROR, "in bounds");
+    if(enc == Marshaller::COMPACT) {
+        // 4 bytes of padding are left, too few for a key
+        u >> k;
+        CHECK(k == 0 && u.error() == m3::Errors::INV_ARGS, "key beyond the end");
+    }
+    u >> k2;
+    CHECK(k2 == 0 && u.error() == m3::Errors::INV_ARGS && u.remaining() == 0, "at the end");
+
+    // a string whose length runs beyond the end
+    Marshaller m2(buf, sizeof(buf), enc);
+    m2 << "abcdefghijklmnopqrstuvwxyz";
+    Unmarshaller u2(buf, 16, enc);
+    m3::String s;
+    u2 >> s;
+    CHECK(s.length() == 0 && u2.error() == m3::Errors::INV_ARGS, "truncated string");
+
+    // a varint that does not end
+    if(enc == Marshaller::COMPACT) {
+        memset(buf, 0xFF, 16);
+        Unmarshaller u3(buf, 16, enc);
+        u3 >> s;
+        CHECK(s.length() == 0 && u3.error() == m3::Errors::INV_ARGS, "endless varint");
+    }
+
+    PASS();
+}
+
+/* ========================================================================= */
+
+/* revoke(capID, parent, originCap) */
+static size_t msg_revoke(unsigned char *buf, size_t size, Marshaller::Encoding enc) {
+    Marshaller m(buf, size, enc);
+    m << REVOKE << (mht_key_t)1 << (mht_key_t)2 << (mht_key_t)3;
+    return m.total();
+}
+/* mhtget request: op, stage, tid, key */
+static size_t msg_mhtget(unsigned char *buf, size_t size, Marshaller::Encoding enc) {
+    Marshaller m(buf, size, enc);
+    m << MHTGET << KREQUEST << 5 << (mht_key_t)0x1234;
+    return m.total();
+}
+/* exchangeOverSession without service arguments */
+static size_t msg_exchange(unsigned char *buf, size_t size, Marshaller::Encoding enc) {
+    Marshaller m(buf, size, enc);
+    m << EXCHANGEOSESS << 5 << true << (mht_key_t)1 << (mht_key_t)2 << (uint64_t)3
+      << 0 << (uint32_t)16 << (uint32_t)1;
+    return m.total();
+}
+/* sigvital: op, tid, error */
+static size_t msg_sigvital(unsigned char *buf, size_t size, Marshaller::Encoding enc) {
+    Marshaller m(buf, size, enc);
+    m << SIGVITAL << 5 << m3::Errors::NO_ERROR;
+    return m.total();
+}
+/* revoke unmarshalled again */
+static void read_revoke(const unsigned char *buf, size_t size, Marshaller::Encoding enc) {
+    Unmarshaller u(buf, size, enc);
+    Operation op;
+    mht_key_t a, b, c;
+    u >> op >> a >> b >> c;
+    sink += a + b + c + op;
+}
+
+static void bench() {
+    struct {
+        const char *name;
+        size_t (*build)(unsigned char *, size_t, Marshaller::Encoding);
+    } msgs[] = {
+        { "revoke", msg_revoke },
+        { "mhtget", msg_mhtget },
+        { "exchangeOverSession", msg_exchange },
+        { "sigvital", msg_sigvital },
+    };
+
+    alignas(8) unsigned char buf[256];
+    printf("\n  %-20s %10s %10s\n", "kernelcall", "WORDS B", "COMPACT B");
+    for(auto &m : msgs) {
+        size_t w = m.build(buf, sizeof(buf), Marshaller::WORDS);
+        size_t c = m.build(buf, sizeof(buf), Marshaller::COMPACT);
+        printf("  %-20s %10zu %10zu\n", m.name, w, c);
+    }
+
+    static const size_t ROUNDS = 2000000;
+    printf("\n  %-20s %10s %10s\n", "ns per revoke", "WORDS", "COMPACT");
+    double res[2];
+    Marshaller::Encoding encs[] = { Marshaller::WORDS, Marshaller::COMPACT };
+    for(int e = 0; e < 2; e++) {
+        uint64_t t0 = now_ns();
+        for(size_t r = 0; r < ROUNDS; r++) {
+            size_t size = msg_revoke(buf, sizeof(buf), encs[e]);
+            read_revoke(buf, size, encs[e]);
+        }
+        res[e] = (double)(now_ns() - t0) / ROUNDS;
+    }
+    printf("  %-20s %10.1f %10.1f\n", "build + read", res[0], res[1]);
+}
+
+/* ========================================================================= */
+
+int main() {
+    printf("=== Marshalling Tests ===\n\n");
+
+    test_roundtrip(Marshaller::WORDS);
+    test_roundtrip(Marshaller::COMPACT);
+    test_nesting();
+    test_bounds(Marshaller::WORDS);
+    test_bounds(Marshaller::COMPACT);
+    bench();
+
+    printf("\n=== Results: %d passed, %d failed ===\n",
+           tests_passed, tests_failed);
+
+    return tests_failed ? 1 : 0;
+}
@@ -0,0 +1,348 @@
+/*
+ * bench_memmap.cc -- Host check and fragmentation stress for the kernel MemoryMap
+ *
+ * Builds kernel/mem/MemoryMap.cc (and Slab.cc for its Area nodes) on the
+ * host, with m3::Heap backed by malloc and a stand-in <base/log/Kernel.h>
+ * from tests/host:
+ *
+ *   - allocate/free coalesce back into a single area
+ *   - random alloc/free against a shadow bitmap: no overlap, nothing lost
+ *   - detach takes page-aligned chunks from the end, keeps unaligned tails
+ *   - alloc/free throughput on a fragmented map against the former
+ *     first-fit list
+ *
+ * Or just: make test (uses the provided Makefile)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <base/Heap.h>
+#include "mem/MemoryMap.h"
+
+using kernel::MemoryMap;
+
+namespace m3 {
+void *Heap::alloc(size_t size) {
+    return malloc(size);
+}
+void Heap::free(void *p) {
+    ::free(p);
+}
+}
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) \
+    do { printf("  TEST: %-50s ", name); fflush(stdout); } while(0)
+
+#define PASS() \
+    do { printf("PASS\n"); tests_passed++; } while(0)
+
+#define FAIL(msg) \
+    do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define CHECK(cond, msg) \
+    do { if (!(cond)) { FAIL(msg); return; } } while(0)
+
+static const uintptr_t BASE = 0x100000;
+static const uintptr_t FAILED = static_cast<uintptr_t>(-1);
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t rng_state = 0x12345678;
+static uint32_t rnd() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+/* sizes between 1 and 64 pages, mostly small, sometimes unaligned */
+static size_t rnd_size() {
+    size_t pages = 1 + (rnd() % 8);
+    if((rnd() % 8) == 0)
+        pages *= 8;
+    size_t size = pages * PAGE_SIZE;
+    if((rnd() % 4) == 0)
+        size -= 8 * (1 + rnd() % 64);
+    return size;
+}
+
+static volatile uintptr_t sink;
+
+/* The former allocator: first-fit over an address-ordered list */
+class FirstFitMap {
+    struct Area {
+        uintptr_t addr;
+        size_t size;
+        Area *next;
+    };
+
+public:
+    explicit FirstFitMap(uintptr_t addr, size_t size) : list(new Area()) {
+        list->addr = addr;
+        list->size = size;
+        list->next = nullptr;
+    }
+    ~FirstFitMap() {
+        for(Area *a = list; a != nullptr;) {
+            Area *n = a->next;
+            delete a;
+            a = n;
+        }
+    }
+
+    uintptr_t allocate(size_t size) {
+        Area *a, *p = nullptr;
+        for(a = list; a != nullptr && a->size < size; p = a, a = a->next)
+            ;
+        if(a == nullptr)
+            return FAILED;
+        uintptr_t res = a->addr;
+        a->size -= size;
+        a->addr += size;
+        if(a->size == 0) {
+            if(p)
+                p->next = a->next;
+            else
+                list = a->next;
+            delete a;
+        }
+        return res;
+    }
+
+    void free(uintptr_t addr, size_t size) {
+        Area *n, *p = nullptr;
+        for(n = list; n != nullptr && addr > n->addr; p = n, n = n->next)
+            ;
+        if(p && p->addr + p->size == addr && n && addr + size == n->addr) {
+            p->size += size + n->size;
+            p->next = n->next;
+            delete n;
+        }
+        else if(p && p->addr + p->size == addr)
+            p->size += size;
+        else if(n && addr + size == n->addr) {
+            n->addr -= size;
+            n->size += size;
+        }
+        else {
+            Area *a = new Area();
+            a->addr = addr;
+            a->size = size;
+            a->next = n;
+            if(p)
+                p->next = a;
+            else
+                list = a;
+        }
+    }
+
+private:
+    Area *list;
+};
+
+/* ========================================================================= */
+
+static void test_coalesce() {
+    TEST("alloc/free coalesces into one area");
+
+    static const size_t N = 64;
+    MemoryMap map(BASE, N * PAGE_SIZE);
+    uintptr_t addrs[N];
+    for(size_t i = 0; i < N; i++) {
+        addrs[i] = map.allocate(PAGE_SIZE);
+        CHECK(addrs[i] != FAILED, "alloc");
+    }
+    size_t areas;
+    CHECK(map.get_size(&areas) == 0 && areas == 0, "map is full");
+    CHECK(map.allocate(1) == FAILED, "no space left");
+
+    // free every other page first, then the rest: merges with prev, next and both
+    for(size_t i = 0; i < N; i += 2)
+        map.free(addrs[i], PAGE_SIZE);
+    CHECK(map.get_size(&areas) == N / 2 * PAGE_SIZE && areas == N / 2, "holes");
+    for(size_t i = N - 1; i < N; i -= 2)
+        map.free(addrs[i], PAGE_SIZE);
+    CHECK(map.get_size(&areas) == N * PAGE_SIZE && areas == 1, "merged");
+    CHECK(map.allocate(N * PAGE_SIZE) == BASE, "whole map again");
+
+    PASS();
+}
+
+static void test_fit() {
+    TEST("allocations pick a fitting area");
+
+    MemoryMap map(BASE, 16 * PAGE_SIZE);
+    uintptr_t a = map.allocate(PAGE_SIZE);
+    uintptr_t b = map.allocate(3 * PAGE_SIZE);
+    uintptr_t c = map.allocate(PAGE_SIZE);
+    map.free(a, PAGE_SIZE);
+    map.free(b, 3 * PAGE_SIZE);
+    // holes: 4 pages at BASE (bin 14), 11 pages behind c (bin 15)
+    uintptr_t d = map.allocate(8 * PAGE_SIZE);
+    CHECK(d == c + PAGE_SIZE, "only the tail is large enough");
+    // 4 pages - 8 is in bin 13, the hole in bin 14 fits it for sure
+    uintptr_t e = map.allocate(4 * PAGE_SIZE - 8);
+    CHECK(e == BASE, "next larger bin");
+    uintptr_t f = map.allocate(8);
+    CHECK(f == BASE + 4 * PAGE_SIZE - 8, "exact fit");
+    // nothing above bin 13 is left, but the 3-page tail in it fits
+    uintptr_t g = map.allocate(3 * PAGE_SIZE);
+    CHECK(g == d + 8 * PAGE_SIZE, "searched own bin");
+    size_t areas;
+    CHECK(map.get_size(&areas) == 0 && areas == 0, "map is full");
+
+    PASS();
+}
+
+static void test_random() {
+    TEST("random alloc/free against a shadow map");
+
+    static const size_t PAGES = 4096;
+    static const size_t SIZE = PAGES * PAGE_SIZE;
+    static const size_t SLOTS = 512;
+    static unsigned char shadow[SIZE / 8];
+    struct { uintptr_t addr; size_t size; } live[SLOTS];
+    memset(shadow, 0, sizeof(shadow));
+    memset(live, 0, sizeof(live));
+
+    MemoryMap map(BASE, SIZE);
+    size_t used = 0;
+    for(size_t r = 0; r < 200000; r++) {
+        size_t i = rnd() % SLOTS;
+        if(live[i].size) {
+            map.free(live[i].addr, live[i].size);
+            for(size_t o = 0; o < live[i].size; o += 8)
+                shadow[(live[i].addr - BASE + o) / 8 / 8] &= ~(1 << (((live[i].addr - BASE + o) / 8) % 8));
+            used -= live[i].size;
+            live[i].size = 0;
+            continue;
+        }
+
+        size_t size = rnd_size();
+        uintptr_t addr = map.allocate(size);
+        if(addr == FAILED)
+            continue;
+        CHECK(addr >= BASE && addr + size <= BASE + SIZE, "in range");
+        for(size_t o = 0; o < size; o += 8) {
+            size_t bit = (addr - BASE + o) / 8;
+            CHECK(!(shadow[bit / 8] & (1 << (bit % 8))), "overlap");
+            shadow[bit / 8] |= 1 << (bit % 8);
+        }
+        live[i].addr = addr;
+        live[i].size = size;
+        used += size;
+        CHECK(map.get_size() == SIZE - used, "free bytes");
+    }
+
+    for(size_t i = 0; i < SLOTS; i++) {
+        if(live[i].size)
+            map.free(live[i].addr, live[i].size);
+    }
+    size_t areas;
+    CHECK(map.get_size(&areas) == SIZE && areas == 1, "everything merged");
+
+    PASS();
+}
+
+static void test_detach() {
+    TEST("detach takes page-aligned chunks from the end");
+
+    // unaligned end: the tail stays in the map
+    MemoryMap map(BASE, 8 * PAGE_SIZE + 100);
+    uintptr_t a = map.detach(2 * PAGE_SIZE);
+    CHECK(a == BASE + 6 * PAGE_SIZE, "from the end");
+    size_t areas;
+    CHECK(map.get_size(&areas) == 6 * PAGE_SIZE + 100 && areas == 2, "tail kept");
+
+    // a small rearmost area is skipped
+    uintptr_t b = map.allocate(6 * PAGE_SIZE);
+    CHECK(b == BASE, "alloc front");
+    map.free(b, 3 * PAGE_SIZE);
+    uintptr_t c = map.detach(2 * PAGE_SIZE);
+    CHECK(c == BASE + PAGE_SIZE, "rearmost fitting area");
+    CHECK(map.get_size(&areas) == PAGE_SIZE + 100 && areas == 2, "rest");
+    CHECK(map.detach(2 * PAGE_SIZE) == FAILED, "nothing left");
+
+    MemoryMap moved(static_cast<MemoryMap&&>(map));
+    CHECK(moved.allocate(PAGE_SIZE) == BASE && map.get_size() == 0, "moved");
+
+    PASS();
+}
+
+/* ========================================================================= */
+
+/* ns per free+alloc of random sizes, with <live> allocations on a fragmented map */
+template<class MAP>
+static double bench_map(size_t pages, size_t live, size_t rounds) {
+    MAP map(BASE, pages * PAGE_SIZE);
+    uintptr_t *addrs = new uintptr_t[live];
+    size_t *sizes = new size_t[live];
+    rng_state = 0xCAFEBABE;
+    for(size_t i = 0; i < live; i++) {
+        sizes[i] = rnd_size();
+        addrs[i] = map.allocate(sizes[i]);
+    }
+    // punch holes so that the free space is fragmented
+    for(size_t i = 0; i < live; i += 2) {
+        if(addrs[i] != FAILED)
+            map.free(addrs[i], sizes[i]);
+        addrs[i] = FAILED;
+    }
+
+    uint64_t t0 = now_ns();
+    for(size_t r = 0; r < rounds; r++) {
+        size_t i = rnd() % live;
+        if(addrs[i] != FAILED)
+            map.free(addrs[i], sizes[i]);
+        sizes[i] = rnd_size();
+        addrs[i] = map.allocate(sizes[i]);
+        sink = addrs[i];
+    }
+    double ns = (double)(now_ns() - t0) / rounds;
+
+    for(size_t i = 0; i < live; i++) {
+        if(addrs[i] != FAILED)
+            map.free(addrs[i], sizes[i]);
+    }
+    delete[] addrs;
+    delete[] sizes;
+    return ns;
+}
+
+static void bench() {
+    static const size_t lives[] = { 64, 1024, 8192 };
+
+    printf("\n  %-8s %18s %18s\n", "live", "first-fit ns/op", "memmap ns/op");
+    for(size_t live : lives) {
+        size_t pages = live * 16;
+        double f = bench_map<FirstFitMap>(pages, live, 200000);
+        double m = bench_map<MemoryMap>(pages, live, 200000);
+        printf("  %-8zu %18.1f %18.1f\n", live, f, m);
+    }
+}
+
+/* ========================================================================= */
+
+int main() {
+    printf("=== MemoryMap Tests ===\n\n");
+
+    test_coalesce();
+    test_fit();
+    test_random();
+    test_detach();
+    bench();
+
+    printf("\n=== Results: %d passed, %d failed ===\n",
+           tests_passed, tests_failed);
+
+    return tests_failed ? 1 : 0;
+}
@@ -0,0 +1,669 @@
+/*
+ * bench_mht.cc -- Host check and microbenchmark for the MHT partition table
+ *
+ * Builds kernel/ddl/MHTTable.h on the host with a stand-in item of
+ * MHTItem's size that owns a heap object, like MHTItem owns its ticket
+ * list, so leaks and double frees across moves show up in the counts.
+ *
+ *   - a randomized insert/find/remove run, checked against the
+ *     64-bucket SList layout MHTPartition used before (BucketTable)
+ *   - put/get/remove throughput at 1k to 1M keys
+ *   - the real MHTInstance (kernel stand-ins in host/DDL.cc): findPartition
+ *     by PE and owner, receivePartitions replacing and deleting the
+ *     partition it had, and the findPartition throughput
+ *   - the remote cache skips fetches overtaken by an invalidation, and a
+ *     revoked item is reported to the kernels that fetched it
+ *   - mixed get/put batches through run() and batchRequest() whose puts grow
+ *     the table after the gets, and items too large for any batch message
+ *
+ * Or just: make test (uses the provided Makefile)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <base/col/SList.h>
+#include "ddl/MHTTable.h"
+#include "ddl/MHTInstance.h"
+
+using kernel::MHTTable;
+
+static long live_owned = 0;
+
+/* Same size and ownership behaviour as MHTItem */
+struct Item {
+    Item() : data(nullptr), key(0), length(0), lockHandle(0), reservation(false), owned(nullptr) {
+    }
+    Item(uint64_t k, uintptr_t val) : data(reinterpret_cast<void*>(val)), key(k), length(8),
+        lockHandle(0), reservation(false), owned(new int(1)) {
+        live_owned++;
+    }
+    Item(Item &&o) : data(o.data), key(o.key), length(o.length), lockHandle(o.lockHandle),
+        reservation(o.reservation), owned(o.owned) {
+        o.owned = nullptr;
+        o.key = 0;
+    }
+    Item &operator=(Item &&o) {
+        data = o.data;
+        key = o.key;
+        length = o.length;
+        lockHandle = o.lockHandle;
+        reservation = o.reservation;
+        owned = o.owned;
+        o.owned = nullptr;
+        o.key = 0;
+        return *this;
+    }
+    ~Item() {
+        if(owned) {
+            delete owned;
+            live_owned--;
+        }
+    }
+    uint64_t getKey() const {
+        return key;
+    }
+
+    void *data;
+    uint64_t key;
+    uint length;
+    uint lockHandle;
+    bool reservation;
+    int *owned;     // stands in for the ticket list
+    void *pad[2];
+};
+
+/* The previous MHTPartition storage: 64 SList buckets, one heap node per item */
+class BucketTable {
+    static const size_t NUM_BUCKETS = 64;
+
+    struct Node : public m3::SListItem {
+        explicit Node(Item &&i) : item(static_cast<Item&&>(i)) {
+        }
+        Item item;
+    };
+
+    static size_t bucket_index(uint64_t key) {
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> 58) & (NUM_BUCKETS - 1);
+    }
+
+public:
+    ~BucketTable() {
+        for(size_t b = 0; b < NUM_BUCKETS; b++) {
+            while(_buckets[b].length() > 0)
+                delete _buckets[b].remove_first();
+        }
+    }
+
+    Item *find(uint64_t key) {
+        size_t idx = bucket_index(key);
+        for(auto it = _buckets[idx].begin(); it != _buckets[idx].end(); it++) {
+            if(it->item.key == key)
+                return &it->item;
+        }
+        return nullptr;
+    }
+    /* MHTPartition::put: look for an existing item, then append */
+    void put(Item &&item) {
+        Item *old = find(item.key);
+        if(old)
+            old->data = item.data;
+        else
+            _buckets[bucket_index(item.key)].append(new Node(static_cast<Item&&>(item)));
+    }
+    bool remove(uint64_t key) {
+        size_t idx = bucket_index(key);
+        for(auto it = _buckets[idx].begin(); it != _buckets[idx].end(); it++) {
+            if(it->item.key == key) {
+                Node *n = &*it;
+                _buckets[idx].remove(n);
+                delete n;
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    m3::SList<Node> _buckets[NUM_BUCKETS];
+};
+
+/* MHTPartition::put on the new table (replacing transfers just the data) */
+static void table_put(MHTTable<uint64_t, Item> &t, Item &&item) {
+    Item *old = t.find(item.key);
+    if(old)
+        old->data = item.data;
+    else
+        t.insert(static_cast<Item&&>(item));
+}
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) \
+    do { printf("  TEST: %-50s ", name); fflush(stdout); } while(0)
+
+#define PASS() \
+    do { printf("PASS\n"); tests_passed++; } while(0)
+
+#define FAIL(msg) \
+    do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define CHECK(cond, msg) \
+    do { if (!(cond)) { FAIL(msg); return; } } while(0)
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t rng_state = 88172645463325252ull;
+static uint64_t rng() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+/* DDL keys: PE, VPE and type in the high bits, a small object id below */
+static uint64_t ddl_key(uint64_t pe, uint64_t obj) {
+    return (pe << 56) | (2ull << 39) | obj;
+}
+
+static volatile uintptr_t sink;
+
+/* ========================================================================= */
+
+static void test_against_buckets() {
+    TEST("randomized ops agree with the bucket lists");
+
+    {
+        MHTTable<uint64_t, Item> table;
+        BucketTable ref;
+        size_t count = 0;
+
+        for(uint32_t i = 0; i < 300000; i++) {
+            uint64_t key = ddl_key(3, rng() % 2048);
+            switch(rng() % 3) {
+                case 0:
+                    if(!ref.find(key))
+                        count++;
+                    table_put(table, Item(key, i));
+                    ref.put(Item(key, i));
+                    break;
+                case 1: {
+                    bool had = ref.remove(key);
+                    CHECK(table.remove(key) == had, "remove result");
+                    if(had)
+                        count--;
+                    break;
+                }
+                case 2: {
+                    Item *a = table.find(key);
+                    Item *b = ref.find(key);
+                    CHECK((a == nullptr) == (b == nullptr), "find result");
+                    CHECK(!a || a->data == b->data, "found value");
+                    break;
+                }
+            }
+            CHECK(table.count() == count, "count");
+        }
+
+        size_t seen = 0;
+        for(auto it = table.begin(); it != table.end(); it++) {
+            Item *b = ref.find(it->getKey());
+            CHECK(b && b->data == it->data, "iterated item");
+            seen++;
+        }
+        CHECK(seen == count, "iteration visits every item once");
+
+        CHECK(count > 0, "items left to remove");
+        Item out;
+        uint64_t some = table.begin()->getKey();
+        CHECK(table.remove(some, &out) && out.getKey() == some && !table.find(some),
+              "remove into out");
+    }
+    CHECK(live_owned == 0, "every owned object freed exactly once");
+
+    PASS();
+}
+
+static void test_clear_and_regrow() {
+    TEST("clear releases items and the table regrows");
+
+    MHTTable<uint64_t, Item> table;
+    for(uint64_t i = 0; i < 1000; i++)
+        table.insert(Item(ddl_key(1, i), i));
+    CHECK(table.count() == 1000 && table.capacity() * 3 >= table.count() * 4, "grown");
+    table.clear();
+    CHECK(live_owned == 0 && table.count() == 0 && !table.find(ddl_key(1, 5)), "cleared");
+    table.insert(Item(ddl_key(1, 5), 5));
+    CHECK(table.find(ddl_key(1, 5)) && table.find(ddl_key(1, 5))->data == (void*)5, "reinsert");
+
+    PASS();
+}
+
+/* ========================================================================= */
+
+template<class T>
+struct Ops;
+
+template<>
+struct Ops<MHTTable<uint64_t, Item>> {
+    static void put(MHTTable<uint64_t, Item> &t, Item &&i) {
+        table_put(t, static_cast<Item&&>(i));
+    }
+};
+
+template<>
+struct Ops<BucketTable> {
+    static void put(BucketTable &t, Item &&i) {
+        t.put(static_cast<Item&&>(i));
+    }
+};
+
+/* ns per put, get and remove with <n> keys of one PE */
+template<class T>
+static void bench_one(uint64_t n, double res[3]) {
+    T *t = new T();
+    uint64_t t0 = now_ns();
+    for(uint64_t i = 0; i < n; i++)
+        Ops<T>::put(*t, Item(ddl_key(7, i), i));
+    uint64_t t1 = now_ns();
+    for(uint64_t i = 0; i < n; i++)
+        sink = reinterpret_cast<uintptr_t>(t->find(ddl_key(7, rng() % n)));
+    uint64_t t2 = now_ns();
+    for(uint64_t i = 0; i < n; i++)
+        t->remove(ddl_key(7, i));
+    uint64_t t3 = now_ns();
+    delete t;
+
+    res[0] = (double)(t1 - t0) / n;
+    res[1] = (double)(t2 - t1) / n;
+    res[2] = (double)(t3 - t2) / n;
+}
+
+static void bench() {
+    static const uint64_t sizes[] = { 1000, 10000, 100000, 1000000 };
+
+    printf("\n  %-8s %26s %26s\n", "", "buckets (ns/op)", "table (ns/op)");
+    printf("  %-8s %8s %8s %8s %8s %8s %8s\n", "keys",
+           "put", "get", "remove", "put", "get", "remove");
+    for(uint64_t n : sizes) {
+        double b[3], h[3];
+        bench_one<MHTTable<uint64_t, Item>>(n, h);
+        // 1M keys in 64 lists is ~15k nodes per bucket: minutes per phase
+        if(n <= 100000) {
+            bench_one<BucketTable>(n, b);
+            printf("  %-8llu %8.1f %8.1f %8.1f %8.1f %8.1f %8.1f\n", (unsigned long long)n,
+                   b[0], b[1], b[2], h[0], h[1], h[2]);
+        }
+        else {
+            printf("  %-8llu %8s %8s %8s %8.1f %8.1f %8.1f\n", (unsigned long long)n,
+                   "-", "-", "-", h[0], h[1], h[2]);
+        }
+    }
+}
+
+/*
+ * The real MHTInstance, with the kernel parts around it stood in by
+ * host/DDL.cc: kernel #0 managing 8 PEs, kernel #1 reachable for migrations
+ */
+using kernel::MHTInstance;
+using kernel::MHTPartition;
+using kernel::HashUtil;
+
+static const size_t HOST_PES = 8;
+
+// payload of the last migratePartition kernelcall
+static unsigned char migrated[1024];
+static size_t migrated_size;
+
+void kernel::Kernelcalls::migratePartition(KPE *, AutoGateOStream &payload) {
+    memcpy(migrated, payload.bytes(), payload.total());
+    migrated_size = payload.total();
+}
+
+// results of the last mhtBatchReply kernelcall
+static unsigned char replied[1024];
+static size_t replied_size;
+static uint replied_count;
+
+void kernel::Kernelcalls::mhtBatchReply(KPE *, int, uint count, AutoGateOStream &results) {
+    memcpy(replied, results.bytes(), results.total());
+    replied_size = results.total();
+    replied_count = count;
+}
+
+// key and number of the mhtInvalidate kernelcalls
+static uint64_t invalidated_key;
+static int invalidated;
+
+void kernel::Kernelcalls::mhtInvalidate(KPE *, mht_key_t key) {
+    invalidated_key = key;
+    invalidated++;
+}
+
+// counts deletes of <watched>, to see which partition receivePartitions() drops.
+// Both are kept out of line, so that the compiler does not pair malloc with delete
+static const void *watched;
+static int watched_deletes;
+
+__attribute__((noinline)) void *operator new(size_t size) {
+    void *p = malloc(size);
+    if(!p)
+        abort();
+    return p;
+}
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+    if(p && p == watched)
+        watched_deletes++;
+    free(p);
+}
+
+static uint64_t pe_key(uint64_t pe, uint64_t obj) {
+    return HashUtil::structured_hash(pe, 0, kernel::NOTYPE, obj);
+}
+
+static uint64_t cap_key(uint64_t pe, uint64_t sel) {
+    return HashUtil::structured_hash(pe, 0, kernel::MSGCAP, sel);
+}
+
+// a message capability whose label tells it apart
+static kernel::MHTItem cap_item(uint64_t pe, uint64_t sel, label_t label) {
+    uint64_t key = cap_key(pe, sel);
+    auto *cap = new kernel::MsgCapability(nullptr, sel, label, 0, 0, 0, 1, key, key);
+    return kernel::MHTItem(cap, sizeof(kernel::MsgCapability), key);
+}
+
+static label_t cap_label(const kernel::MHTItem &item) {
+    kernel::MsgCapability *cap = item.getData<kernel::MsgCapability>();
+    return cap ? cap->obj->label : 0;
+}
+
+// a message from kernel #1 with <len> bytes of <data>
+static m3::DTU::Message *kernel_msg(const void *data, size_t len) {
+    alignas(8) static unsigned char buf[sizeof(m3::DTU::Message) + 1024];
+    m3::DTU::Message *msg = reinterpret_cast<m3::DTU::Message*>(buf);
+    memset(msg, 0, sizeof(*msg));
+    msg->label = 1;
+    msg->length = len;
+    memcpy(msg->data, data, len);
+    return msg;
+}
+
+static void set_owner(size_t pe, uint16_t krnl) {
+    m3::PEDesc desc(static_cast<m3::PEDesc::value_t>(pe) << 54);
+    MHTInstance::getInstance().updateMembership(&desc, 1, krnl, krnl, kernel::NONE, false);
+}
+
+static void test_partition_lookup() {
+    TEST("MHTInstance::findPartition by PE and owner");
+
+    MHTInstance &mht = MHTInstance::getInstance();
+    MHTPartition *parts[HOST_PES];
+    for(size_t pe = 0; pe < HOST_PES; pe++) {
+        parts[pe] = mht.findPartition(pe_key(pe, 0));
+        CHECK(parts[pe] != nullptr, "local partition");
+        for(size_t other = 0; other < pe; other++)
+            CHECK(parts[other] != parts[pe], "one partition per PE");
+    }
+    for(int i = 0; i < 10000; i++) {
+        uint64_t pe = rng() % HOST_PES;
+        uint64_t key = HashUtil::structured_hash(pe, rng() % (1 << VPE_BITS),
+            (i & 1) ? kernel::MSGCAP : kernel::NOTYPE, rng() & 0xFFFFFFFF);
+        CHECK(mht.findPartition(key) == parts[pe], "partition of the key's PE");
+    }
+
+    // a PE another kernel took over is not looked up locally anymore
+    set_owner(3, 1);
+    CHECK(mht.findPartition(pe_key(3, 7)) == nullptr && !mht.keyLocality(pe_key(3, 7)),
+          "PE of kernel #1");
+    CHECK(mht.findPartition(pe_key(2, 7)) == parts[2], "other PEs stay local");
+    set_owner(3, 0);
+    CHECK(mht.findPartition(pe_key(3, 7)) == parts[3], "PE back at kernel #0");
+
+    PASS();
+}
+
+static void test_receive_partitions() {
+    TEST("receivePartitions replaces and deletes the old one");
+
+    MHTInstance &mht = MHTInstance::getInstance();
+    MHTPartition *old = mht.findPartition(pe_key(5, 0));
+    MHTPartition *neighbour = mht.findPartition(pe_key(4, 0));
+
+    // PE 5 goes to kernel #1, which sends it back later; our copy is outdated by then
+    m3::PEDesc desc(static_cast<m3::PEDesc::value_t>(5) << 54);
+    migrated_size = 0;
+    mht.migratePartitions(&desc, 1, 1);
+    CHECK(migrated_size > 0, "partition sent");
+    set_owner(5, 1);
+
+    m3::DTU::Message *msg = kernel_msg(migrated, migrated_size);
+    watched = old;
+    watched_deletes = 0;
+    {
+        kernel::RecvGate gate(0, nullptr);
+        kernel::GateIStream is(gate, msg);
+        is.encoding(kernel::Kernelcalls::ENCODING);
+        mht.receivePartitions(is);
+    }
+    watched = nullptr;
+    CHECK(watched_deletes == 1, "old partition deleted");
+
+    set_owner(5, 0);
+    MHTPartition *now = mht.findPartition(pe_key(5, 0));
+    CHECK(now != nullptr && now != old, "received partition in place");
+    CHECK(mht.findPartition(pe_key(4, 0)) == neighbour, "other PEs untouched");
+
+    PASS();
+}
+
+static void test_cache_generation() {
+    TEST("remote cache and revocation reports");
+
+    kernel::MHTCache cache;
+    uint64_t key = pe_key(6, 1);
+
+    // the item is invalidated while it is fetched
+    uint gen = cache.generation();
+    cache.invalidate(key);
+    kernel::MHTItem stale(malloc(8), 8, key);
+    const kernel::MHTItem &r1 = cache.insert(stale, 1, gen);
+    CHECK(&r1 == &stale && stale.validData(), "overtaken fetch returned");
+    CHECK(cache.find(key, 1) == nullptr, "overtaken fetch not cached");
+
+    gen = cache.generation();
+    kernel::MHTItem fresh(malloc(8), 8, key);
+    cache.insert(fresh, 1, gen);
+    CHECK(!fresh.validData() && cache.find(key, 1) != nullptr, "fetch cached");
+    cache.invalidate(key);
+    CHECK(cache.find(key, 1) == nullptr, "dropped");
+
+    // the owner reports only cacheable items and only to kernels that fetched them
+    MHTInstance &mht = MHTInstance::getInstance();
+    uint64_t srv = HashUtil::structured_hash(6, 0, kernel::SRVCAP, 9);
+    uint64_t msg = HashUtil::structured_hash(6, 0, kernel::MSGCAP, 9);
+    invalidated = 0;
+    mht.dropCached(srv);
+    CHECK(invalidated == 0, "nobody fetched it");
+    mht.noteFetch(srv, 1);
+    mht.noteFetch(msg, 1);
+    mht.dropCached(msg);
+    CHECK(invalidated == 0, "not cacheable");
+    mht.dropCached(srv);
+    CHECK(invalidated == 1 && invalidated_key == srv, "reported to kernel #1");
+
+    PASS();
+}
+
+static void test_batch_run() {
+    TEST("MHTInstance::run of a local batch growing the table");
+
+    // get() looks capabilities up in the VPE's tables, so these are plain items told apart
+    // by their length
+    MHTInstance &mht = MHTInstance::getInstance();
+    kernel::MHTBatch batch;
+    uint gets[4];
+    for(uint obj = 0; obj < 4; obj++)
+        batch.put(kernel::MHTItem(malloc(100 + obj), 100 + obj, pe_key(7, obj)));
+    for(uint obj = 0; obj < 4; obj++)
+        gets[obj] = batch.get(pe_key(7, obj));
+    // 28 items in the partition: the table grows from 16 to 32 to 64 slots
+    for(uint obj = 4; batch.count() < kernel::MHTBatch::MAX_OPS; obj++)
+        batch.put(kernel::MHTItem(malloc(100 + obj), 100 + obj, pe_key(7, obj)));
+    mht.run(batch);
+
+    for(uint i = 0; i < batch.count(); i++)
+        CHECK(batch.error(i) == m3::Errors::NO_ERROR, "operation succeeded");
+    for(uint obj = 0; obj < 4; obj++) {
+        const kernel::MHTItem &item = batch.item(gets[obj]);
+        CHECK(item.validData() && item.getLength() == 100 + obj, "get result");
+    }
+    CHECK(mht.get(pe_key(7, 27)).getLength() == 127, "last put stored");
+
+    PASS();
+}
+
+static void test_batch_request() {
+    TEST("batchRequest encodes gets before puts grow the table");
+
+    // 12 items fill PE 6's table of 16 slots up to its load limit
+    MHTInstance &mht = MHTInstance::getInstance();
+    for(uint64_t sel = 0; sel < 12; sel++) {
+        kernel::MHTItem item = cap_item(6, sel, 200 + sel);
+        CHECK(mht.put(m3::Util::move(item)) == m3::Errors::NO_ERROR, "put");
+    }
+
+    // get, get, put (grows the table), put, get, get of a missing key
+    kernel::StaticGateOStream<1024> req(kernel::Kernelcalls::ENCODING);
+    req << kernel::Kernelcalls::MHTGET << 0U << cap_key(6, 0);
+    req << kernel::Kernelcalls::MHTGET << 1U << cap_key(6, 1);
+    for(uint64_t sel = 12; sel < 14; sel++) {
+        req << kernel::Kernelcalls::MHTPUT << static_cast<uint>(sel - 10);
+        cap_item(6, sel, 200 + sel).serialize(req);
+    }
+    req << kernel::Kernelcalls::MHTGET << 4U << cap_key(6, 2);
+    req << kernel::Kernelcalls::MHTGET << 5U << cap_key(6, 99);
+
+    {
+        kernel::RecvGate gate(0, nullptr);
+        kernel::GateIStream is(gate, kernel_msg(req.bytes(), req.total()));
+        is.encoding(kernel::Kernelcalls::ENCODING);
+        replied_count = 0;
+        mht.batchRequest(is, 5, 6);
+    }
+    CHECK(replied_count == 6, "all operations answered");
+
+    kernel::RecvGate gate(0, nullptr);
+    kernel::GateIStream is(gate, kernel_msg(replied, replied_size));
+    is.encoding(kernel::Kernelcalls::ENCODING);
+    label_t labels[6] = { 0 };
+    for(uint i = 0; i < replied_count; i++) {
+        uint idx;
+        m3::Errors::Code err;
+        is >> idx >> err;
+        CHECK(idx < 6 && err == m3::Errors::NO_ERROR, "result");
+        if(idx == 2 || idx == 3)
+            continue;
+        bool found;
+        is >> found;
+        if(found) {
+            kernel::MHTItem item(is);
+            labels[idx] = cap_label(item);
+        }
+    }
+    CHECK(labels[0] == 200 && labels[1] == 201 && labels[4] == 202, "get results");
+    CHECK(labels[5] == 0, "missing key");
+    CHECK(cap_label(mht.localGet(cap_key(6, 13), false)) == 213, "puts stored");
+
+    PASS();
+}
+
+static void test_batch_too_large() {
+    TEST("batch items too large for a message fail");
+
+    // a put to kernel #1 is refused without sending anything
+    MHTInstance &mht = MHTInstance::getInstance();
+    size_t len = kernel::Kernelcalls::MAX_MHT_BATCH_PAYLOAD;
+    set_owner(4, 1);
+    kernel::MHTBatch batch;
+    batch.put(kernel::MHTItem(malloc(len), len, pe_key(4, 1)));
+    mht.run(batch);
+    set_owner(4, 0);
+    CHECK(batch.error(0) == m3::Errors::NO_SPACE, "put refused");
+
+    // a get for such an item is answered with an error instead of being left for later
+    CHECK(mht.put(kernel::MHTItem(malloc(len), len, pe_key(6, 100))) == m3::Errors::NO_ERROR,
+          "local put");
+    kernel::StaticGateOStream<256> req(kernel::Kernelcalls::ENCODING);
+    req << kernel::Kernelcalls::MHTGET << 0U << pe_key(6, 100);
+    req << kernel::Kernelcalls::MHTGET << 1U << cap_key(6, 0);
+    {
+        kernel::RecvGate gate(0, nullptr);
+        kernel::GateIStream is(gate, kernel_msg(req.bytes(), req.total()));
+        is.encoding(kernel::Kernelcalls::ENCODING);
+        replied_count = 0;
+        mht.batchRequest(is, 5, 2);
+    }
+    CHECK(replied_count == 2, "both answered");
+
+    kernel::RecvGate gate(0, nullptr);
+    kernel::GateIStream is(gate, kernel_msg(replied, replied_size));
+    is.encoding(kernel::Kernelcalls::ENCODING);
+    uint idx;
+    m3::Errors::Code err;
+    bool found;
+    is >> idx >> err;
+    CHECK(idx == 0 && err == m3::Errors::NO_SPACE, "too large");
+    is >> idx >> err >> found;
+    CHECK(idx == 1 && err == m3::Errors::NO_ERROR && found, "small one");
+
+    PASS();
+}
+
+static void bench_partitions() {
+    static const size_t KEYS = 4096;
+    static const size_t ROUNDS = 2000000;
+    static uint64_t keys[KEYS];
+
+    MHTInstance &mht = MHTInstance::getInstance();
+    for(size_t i = 0; i < KEYS; i++)
+        keys[i] = pe_key(rng() % HOST_PES, rng() & 0xFFFFFF);
+
+    uint64_t t0 = now_ns();
+    for(size_t r = 0; r < ROUNDS; r++)
+        sink = reinterpret_cast<uintptr_t>(mht.findPartition(keys[r % KEYS]));
+    uint64_t t1 = now_ns();
+
+    printf("\n  %-24s %14.1f\n", "findPartition Mlookups/s", ROUNDS * 1e3 / (double)(t1 - t0));
+}
+
+/* ========================================================================= */
+
+int main() {
+    printf("=== MHT Table Tests ===\n\n");
+
+    test_against_buckets();
+    test_clear_and_regrow();
+
+    kernel::Coordinator::create(0);
+    kernel::Coordinator::get().getKPEList().put(1, nullptr);
+    MHTInstance::create();
+    test_partition_lookup();
+    test_receive_partitions();
+    test_cache_generation();
+    test_batch_run();
+    test_batch_request();
+    test_batch_too_large();
+    bench();
+    bench_partitions();
+
+    printf("\n=== Results: %d passed, %d failed ===\n",
+           tests_passed, tests_failed);
+
+    return tests_failed ? 1 : 0;
+}
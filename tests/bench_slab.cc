@@ -0,0 +1,213 @@
+/*
+ * bench_slab.cc -- Host check and microbenchmark for the kernel slab allocator
+ *
+ * Builds kernel/mem/Slab.cc on the host, with m3::Heap backed by malloc and
+ * a stand-in <base/log/Kernel.h> from tests/host:
+ *
+ *   - size classes: one Slab per power of two, shared by all sizes in it
+ *   - objects are distinct, writable and counted in the class statistics
+ *   - SlabObject<T> goes through its class and accounts sizeof(T)
+ *   - alloc/free throughput against malloc
+ *
+ * Or just: make test (uses the provided Makefile)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <base/Heap.h>
+#include "mem/SlabCache.h"
+
+using kernel::Slab;
+using kernel::SlabObject;
+
+namespace m3 {
+void *Heap::alloc(size_t size) {
+    return malloc(size);
+}
+void Heap::free(void *p) {
+    ::free(p);
+}
+}
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) \
+    do { printf("  TEST: %-50s ", name); fflush(stdout); } while(0)
+
+#define PASS() \
+    do { printf("PASS\n"); tests_passed++; } while(0)
+
+#define FAIL(msg) \
+    do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define CHECK(cond, msg) \
+    do { if (!(cond)) { FAIL(msg); return; } } while(0)
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static volatile uintptr_t sink;
+
+/* A kernel-object stand-in: 40 bytes, i.e. the 64 byte class */
+struct Obj : public SlabObject<Obj> {
+    uint64_t words[5];
+};
+
+/* ========================================================================= */
+
+static void test_classes() {
+    TEST("one slab per power-of-two class");
+
+    Slab *a = Slab::get(40);
+    CHECK(a == Slab::get(56), "sizes of one class share the slab");
+    CHECK(a->objsize() == 64, "class size includes the pool pointer");
+    CHECK(Slab::get(57) != a && Slab::get(57)->objsize() == 128, "next class");
+    CHECK(Slab::get(8)->objsize() == 16, "smallest class");
+
+    PASS();
+}
+
+static void test_alloc_free() {
+    TEST("objects are distinct and counted");
+
+    static const size_t N = 5000;
+    static void *objs[N];
+    Slab *s = Slab::get(200);
+    Slab::Stats before = s->stats();
+
+    for(size_t i = 0; i < N; i++) {
+        objs[i] = s->alloc(200);
+        CHECK(objs[i] != nullptr, "alloc");
+        CHECK((reinterpret_cast<uintptr_t>(objs[i]) & (sizeof(void*) - 1)) == 0, "aligned");
+        memset(objs[i], (int)i, 200);
+    }
+    for(size_t i = 0; i < N; i++) {
+        unsigned char *p = static_cast<unsigned char*>(objs[i]);
+        CHECK(p[0] == (unsigned char)i && p[199] == (unsigned char)i, "no overlap");
+    }
+
+    const Slab::Stats &st = s->stats();
+    CHECK(st.allocs - before.allocs == N && st.inuse - before.inuse == N, "alloc count");
+    CHECK(st.highwater >= st.inuse && st.capacity >= st.inuse, "peak and capacity");
+    CHECK(st.requested - before.requested == N * 200, "requested bytes");
+
+    size_t cap = st.capacity;
+    for(size_t i = 0; i < N; i++)
+        s->free(objs[i], 200);
+    CHECK(st.frees - before.frees == N && st.inuse == before.inuse, "free count");
+    CHECK(st.highwater >= N && st.requested == before.requested, "peak kept");
+
+    // freed objects are reused before the slab grows again
+    for(size_t i = 0; i < N; i++)
+        objs[i] = s->alloc(200);
+    CHECK(st.capacity == cap, "reuse without refill");
+    for(size_t i = 0; i < N; i++)
+        s->free(objs[i], 200);
+
+    PASS();
+}
+
+static void test_refill_size() {
+    TEST("refills take at least a page");
+
+    Slab *s = Slab::get(20);
+    size_t cap = s->stats().capacity;
+    void *p = s->alloc(20);
+    size_t got = s->stats().capacity - cap;
+    CHECK(got == 0 || got * s->objsize() >= PAGE_SIZE, "pool size");
+    s->free(p, 20);
+
+    PASS();
+}
+
+static void test_slab_object() {
+    TEST("SlabObject<T> allocates from its class");
+
+    Slab *s = Slab::get(sizeof(Obj));
+    size_t inuse = s->stats().inuse;
+    size_t req = s->stats().requested;
+    Obj *o = new Obj();
+    CHECK(s->stats().inuse == inuse + 1 && s->stats().requested == req + sizeof(Obj), "counted");
+    delete o;
+    CHECK(s->stats().inuse == inuse && s->stats().requested == req, "released");
+
+    PASS();
+}
+
+/* ========================================================================= */
+
+/* ns per alloc+free, with <live> objects kept allocated in a FIFO */
+static double bench_slab(size_t live, size_t rounds) {
+    Slab *s = Slab::get(48);
+    void **ring = new void*[live];
+    for(size_t i = 0; i < live; i++)
+        ring[i] = s->alloc(48);
+
+    uint64_t t0 = now_ns();
+    for(size_t r = 0; r < rounds; r++) {
+        size_t i = r % live;
+        s->free(ring[i], 48);
+        ring[i] = s->alloc(48);
+        sink = reinterpret_cast<uintptr_t>(ring[i]);
+    }
+    double ns = (double)(now_ns() - t0) / rounds;
+
+    for(size_t i = 0; i < live; i++)
+        s->free(ring[i], 48);
+    delete[] ring;
+    return ns;
+}
+
+static double bench_malloc(size_t live, size_t rounds) {
+    void **ring = new void*[live];
+    for(size_t i = 0; i < live; i++)
+        ring[i] = malloc(48);
+
+    uint64_t t0 = now_ns();
+    for(size_t r = 0; r < rounds; r++) {
+        size_t i = r % live;
+        free(ring[i]);
+        ring[i] = malloc(48);
+        sink = reinterpret_cast<uintptr_t>(ring[i]);
+    }
+    double ns = (double)(now_ns() - t0) / rounds;
+
+    for(size_t i = 0; i < live; i++)
+        free(ring[i]);
+    delete[] ring;
+    return ns;
+}
+
+static void bench() {
+    static const size_t sizes[] = { 16, 1024, 65536 };
+
+    printf("\n  %-8s %18s %18s\n", "live", "malloc ns/op", "slab ns/op");
+    for(size_t live : sizes) {
+        double m = bench_malloc(live, 2000000);
+        double s = bench_slab(live, 2000000);
+        printf("  %-8zu %18.1f %18.1f\n", live, m, s);
+    }
+}
+
+/* ========================================================================= */
+
+int main() {
+    printf("=== Slab Allocator Tests ===\n\n");
+
+    test_classes();
+    test_alloc_free();
+    test_refill_size();
+    test_slab_object();
+    bench();
+
+    printf("\n=== Results: %d passed, %d failed ===\n",
+           tests_passed, tests_failed);
+
+    return tests_failed ? 1 : 0;
+}
@@ -0,0 +1,131 @@
+/*
+ * Host stand-ins for the kernel parts that kernel/ddl links against: the
+ * Coordinator, the kernelcalls to other kernels, the thread switch and the
+ * libbase pieces the kernel gets from arch/sel4/libbase_stubs.cc. Enough to
+ * run a single kernel's MHTInstance whose partitions are all local; nothing
+ * is ever sent. Kernelcalls::migratePartition and mhtInvalidate are left to
+ * the test.
+ */
+
+#include <stdlib.h>
+#include <base/Heap.h>
+#include <base/util/Random.h>
+#include <thread/ThreadManager.h>
+
+#include "ddl/MHTInstance.h"
+#include "com/Services.h"
+#include "pes/PEManager.h"
+
+namespace m3 {
+
+// everything malloc returns counts as heap, as MHTItem checks its data
+Heap::Area *Heap::_begin = reinterpret_cast<Heap::Area*>(1);
+Heap::Area *Heap::_end = reinterpret_cast<Heap::Area*>(~static_cast<uintptr_t>(0));
+
+void *Heap::alloc(size_t size) {
+    return malloc(size);
+}
+void Heap::free(void *p) {
+    ::free(p);
+}
+
+uint Random::_randa = 1103515245;
+uint Random::_randc = 12345;
+uint Random::_last = 0;
+
+int Thread::_next_id = 1;
+ThreadManager ThreadManager::inst;
+
+DTU DTU::inst;
+
+void DTU::mark_read(int, size_t) {
+}
+
+}
+
+extern "C" bool thread_save(m3::Regs *) {
+    abort();
+}
+extern "C" bool thread_resume(m3::Regs *) {
+    abort();
+}
+
+namespace kernel {
+
+Coordinator *Coordinator::_inst;
+
+Coordinator::Coordinator(size_t kid)
+    : closingRequests(-1), shutdownIssued(false), shutdownRequests(0), startSignsAwaited(0),
+    startSignSent(true), _kid(kid), _creator(nullptr) {
+}
+
+void Coordinator::broadcastMemberUpdate(m3::PEDesc[], uint, membership_entry::krnl_id_t,
+    membership_entry::pe_id_t, MembershipFlags) {
+}
+
+KPE::~KPE() {
+}
+
+// capabilities only pass through the DDL as data here; these give them their vtables
+void MsgCapability::print(m3::OStream &) const {
+}
+void MemCapability::print(m3::OStream &) const {
+}
+void ServiceCapability::print(m3::OStream &) const {
+}
+void SessionCapability::print(m3::OStream &) const {
+}
+void VPECapability::print(m3::OStream &) const {
+}
+m3::Errors::Code MsgCapability::revoke() {
+    return m3::Errors::NO_ERROR;
+}
+m3::Errors::Code ServiceCapability::revoke() {
+    return m3::Errors::NO_ERROR;
+}
+m3::Errors::Code SessionCapability::revoke() {
+    return m3::Errors::NO_ERROR;
+}
+m3::Errors::Code VPECapability::revoke() {
+    return m3::Errors::NO_ERROR;
+}
+VPECapability::VPECapability(const VPECapability &t) : Capability(t), vpe(t.vpe) {
+}
+SessionObject::~SessionObject() {
+}
+Service::~Service() {
+}
+
+// there is no other kernel to talk to
+void Kernelcalls::mhtRequest(KPE *, mht_key_t, Operation) {
+    abort();
+}
+void Kernelcalls::mhtgetLocking(KPE *, mht_key_t) {
+    abort();
+}
+void Kernelcalls::mhtput(KPE *, MHTItem &&) {
+    abort();
+}
+void Kernelcalls::mhtputUnlocking(KPE *, MHTItem &&, uint) {
+    abort();
+}
+void Kernelcalls::mhtunlock(KPE *, mht_key_t, uint) {
+    abort();
+}
+void Kernelcalls::mhtRelease(KPE *, mht_key_t, uint) {
+    abort();
+}
+void Kernelcalls::mhtBatch(KPE *, uint, AutoGateOStream &) {
+    abort();
+}
+
+// a kernel managing 8 PEs
+Platform::KEnv::KEnv() : pe_count(8), kernelId(0) {
+}
+Platform::KEnv Platform::_kenv;
+
+Kernelcalls Kernelcalls::_inst;
+PEManager *PEManager::_inst;
+ServiceList ServiceList::_inst;
+
+}
@@ -0,0 +1,35 @@
+/*
+ * Host stand-in for the formatting part of m3::OStream: the kernel links it
+ * from libbase, which isn't built for the host. Kernel code that only
+ * references the formatters (e.g. via a virtual print()) links against
+ * these; nothing is ever printed.
+ */
+
+#include <base/stream/OStream.h>
+
+namespace m3 {
+
+char OStream::_hexchars_small[] = "0123456789abcdef";
+char OStream::_hexchars_big[]   = "0123456789ABCDEF";
+
+OStream::FormatParams::FormatParams(const char *)
+    : _base(10), _flags(0), _pad(0), _prec(-1) {
+}
+
+int OStream::printnpad(long, uint, uint) {
+    return 0;
+}
+int OStream::printupad(ulong, uint, uint, uint) {
+    return 0;
+}
+int OStream::printu(ulong, uint, char *) {
+    return 0;
+}
+int OStream::printptr(uintptr_t, uint) {
+    return 0;
+}
+int OStream::puts(const char *, ulong) {
+    return 0;
+}
+
+}
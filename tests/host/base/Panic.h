@@ -0,0 +1,15 @@
+/*
+ * Host stand-in for <base/Panic.h>: the kernel's version streams to the
+ * DTU serial and exits the VPE, neither of which exists on the host.
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define PANIC(expr) do {                            \
+        fputs("PANIC: " #expr "\n", stderr);        \
+        abort();                                    \
+    }                                               \
+    while(0)
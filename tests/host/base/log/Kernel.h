@@ -0,0 +1,17 @@
+/*
+ * Host stand-in for <base/log/Kernel.h>: the kernel's version logs through
+ * the ThreadManager and the DTU serial, which don't exist on the host.
+ * Messages are type-checked but dropped.
+ */
+
+#pragma once
+
+struct HostKLogSink {
+    template<class T>
+    HostKLogSink &operator<<(const T &) {
+        return *this;
+    }
+};
+
+#define KLOG(lvl, msg)      do { if(0) { HostKLogSink() << msg; } } while(0)
+#define KLOG_V(lvl, msg)    KLOG(lvl, msg)
@@ -7,10 +7,13 @@
  * Or just: make (uses the provided Makefile)
  */
 
+#define _POSIX_C_SOURCE 199309L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <time.h>
 #include "vdtu_ring.h"
 
 #define SLOT_COUNT 4
@@ -340,6 +343,828 @@ static void test_total_size(void)
     PASS();
 }
 
+static void test_send_batch(void)
+{
+    TEST("send_batch publishes a burst, fetch_batch reads it");
+
+    enum { count = 8 };
+    size_t sz = vdtu_ring_total_size(count, SLOT_SIZE);
+    void *mem = calloc(1, sz);
+    struct vdtu_ring ring;
+    vdtu_ring_init(&ring, mem, count, SLOT_SIZE);
+
+    char bufs[count - 1][16];
+    struct vdtu_ring_msg_desc descs[count - 1];
+    for (uint32_t i = 0; i < count - 1; i++) {
+        snprintf(bufs[i], sizeof(bufs[i]), "BATCH_%u", i);
+        memset(&descs[i], 0, sizeof(descs[i]));
+        descs[i].sender_pe   = (uint16_t)i;
+        descs[i].reply_ep    = 1;
+        descs[i].label       = 1000 + i;
+        descs[i].payload     = bufs[i];
+        descs[i].payload_len = (uint16_t)strlen(bufs[i]);
+    }
+
+    int rc = vdtu_ring_send_batch(&ring, descs, count - 1);
+    CHECK(rc == (int)(count - 1), "whole batch should be enqueued");
+    CHECK(vdtu_ring_is_full(&ring), "ring should be full after batch");
+
+    const struct vdtu_message *msgs[16];
+    uint32_t n = vdtu_ring_fetch_batch(&ring, msgs, 16);
+    CHECK(n == count - 1, "fetch_batch should return all messages");
+    for (uint32_t i = 0; i < n; i++) {
+        CHECK(msgs[i]->hdr.sender_core_id == i, "sender PE mismatch in batch");
+        CHECK(msgs[i]->hdr.label == 1000 + i, "label mismatch in batch");
+        CHECK(msgs[i]->hdr.length == strlen(bufs[i]), "length mismatch in batch");
+        CHECK(memcmp(msgs[i]->data, bufs[i], strlen(bufs[i])) == 0,
+              "payload mismatch in batch");
+    }
+    CHECK(!vdtu_ring_is_empty(&ring), "fetch_batch must not consume");
+
+    vdtu_ring_ack_n(&ring, n);
+    CHECK(vdtu_ring_is_empty(&ring), "should be empty after ack_n");
+
+    free(mem);
+    PASS();
+}
+
+static void test_send_batch_partial(void)
+{
+    TEST("send_batch on a nearly full ring enqueues a prefix");
+
+    size_t sz = vdtu_ring_total_size(SLOT_COUNT, SLOT_SIZE);
+    void *mem = calloc(1, sz);
+    struct vdtu_ring ring;
+    vdtu_ring_init(&ring, mem, SLOT_COUNT, SLOT_SIZE);
+
+    CHECK(send_text(&ring, 9, 0, 9, "FIRST") == 0, "single send");
+
+    struct vdtu_ring_msg_desc descs[4];
+    memset(descs, 0, sizeof(descs));
+    for (int i = 0; i < 4; i++)
+        descs[i].label = (uint64_t)(10 + i);
+
+    /* 3 usable slots, 1 taken: only 2 of 4 fit */
+    int rc = vdtu_ring_send_batch(&ring, descs, 4);
+    CHECK(rc == 2, "only two messages should fit");
+    CHECK(vdtu_ring_send_batch(&ring, descs + 2, 2) == 0,
+          "full ring should accept nothing");
+
+    const struct vdtu_message *msgs[4];
+    uint32_t n = vdtu_ring_fetch_batch(&ring, msgs, 2);
+    CHECK(n == 2, "fetch_batch should honour max");
+    CHECK(msgs[0]->hdr.label == 9, "FIFO order: single send first");
+    CHECK(msgs[1]->hdr.label == 10, "FIFO order: batch follows");
+    vdtu_ring_ack_n(&ring, n);
+
+    /* Wraps around the end of the slot array */
+    rc = vdtu_ring_send_batch(&ring, descs + 2, 2);
+    CHECK(rc == 2, "remaining messages should fit after ack");
+    n = vdtu_ring_fetch_batch(&ring, msgs, 4);
+    CHECK(n == 3, "three messages pending");
+    CHECK(msgs[0]->hdr.label == 11, "wrapped FIFO order [0]");
+    CHECK(msgs[1]->hdr.label == 12, "wrapped FIFO order [1]");
+    CHECK(msgs[2]->hdr.label == 13, "wrapped FIFO order [2]");
+
+    /* ack_n clamps to what is available */
+    vdtu_ring_ack_n(&ring, 100);
+    CHECK(vdtu_ring_is_empty(&ring), "ack_n should clamp and drain");
+
+    free(mem);
+    PASS();
+}
+
+static void test_send_batch_errors(void)
+{
+    TEST("send_batch rejects oversize and terminated EPs");
+
+    size_t sz = vdtu_ring_total_size(SLOT_COUNT, SLOT_SIZE);
+    void *mem = calloc(1, sz);
+    struct vdtu_ring ring;
+    vdtu_ring_init(&ring, mem, SLOT_COUNT, SLOT_SIZE);
+
+    struct vdtu_ring_msg_desc descs[2];
+    memset(descs, 0, sizeof(descs));
+    descs[1].payload_len = SLOT_SIZE;  /* header + payload > slot */
+
+    CHECK(vdtu_ring_send_batch(&ring, descs, 2) == -2,
+          "oversized descriptor should return -2");
+    CHECK(vdtu_ring_is_empty(&ring), "nothing enqueued on -2");
+
+    ring.ctrl->ep_state = VDTU_EP_TERMINATED;
+    CHECK(vdtu_ring_send_batch(&ring, descs, 1) == -3,
+          "terminated EP should return -3");
+
+    free(mem);
+    PASS();
+}
+
+static void test_layout_v2(void)
+{
+    TEST("v2 layout: split index lines, attach detects it");
+
+    size_t sz = vdtu_ring_total_size_layout(SLOT_COUNT, SLOT_SIZE,
+                                            VDTU_RING_LAYOUT_V2);
+    CHECK(sz == 192 + SLOT_COUNT * SLOT_SIZE, "v2 ctrl block is 3 lines");
+    void *mem = calloc(1, sz);
+
+    struct vdtu_ring producer;
+    int rc = vdtu_ring_init_layout(&producer, mem, SLOT_COUNT, SLOT_SIZE,
+                                   VDTU_RING_LAYOUT_V2);
+    CHECK(rc == 0, "v2 init should succeed");
+    CHECK(producer.ctrl->layout == VDTU_RING_LAYOUT_V2, "layout recorded");
+    CHECK(producer.slots == (uint8_t *)mem + VDTU_RING_CTRL_V2_SIZE,
+          "v2 slots start after 192 bytes");
+    CHECK((uint8_t *)producer.head - (uint8_t *)mem == 64, "head on line 1");
+    CHECK((uint8_t *)producer.tail - (uint8_t *)mem == 128, "tail on line 2");
+
+    struct vdtu_ring consumer;
+    vdtu_ring_attach(&consumer, mem);
+    CHECK(consumer.head == producer.head && consumer.tail == producer.tail,
+          "attach should pick up v2 index locations");
+    CHECK(consumer.slots == producer.slots, "attach should see v2 slots");
+
+    CHECK(send_text(&producer, 7, 0, 77, "V2_MSG") == 0, "v2 send");
+    CHECK(producer.ctrl->head == 0, "v1 head word stays unused");
+    const struct vdtu_message *msg = vdtu_ring_fetch(&consumer);
+    CHECK(msg && msg->hdr.label == 77, "v2 fetch label");
+    CHECK(memcmp(msg->data, "V2_MSG", 6) == 0, "v2 fetch payload");
+    vdtu_ring_ack(&consumer);
+    CHECK(vdtu_ring_is_empty(&producer), "producer sees consumer's ack");
+
+    CHECK(vdtu_ring_init_layout(&producer, mem, SLOT_COUNT, SLOT_SIZE, 7) == -1,
+          "unknown layout should fail");
+
+    free(mem);
+    PASS();
+}
+
+static void test_legacy_attach(void)
+{
+    TEST("attach treats layout=0 rings as v1");
+
+    size_t sz = vdtu_ring_total_size(SLOT_COUNT, SLOT_SIZE);
+    void *mem = calloc(1, sz);
+
+    /* Hand-built ring as initialized before the layout word existed */
+    struct vdtu_ring_ctrl *ctrl = mem;
+    ctrl->slot_count = SLOT_COUNT;
+    ctrl->slot_size  = SLOT_SIZE;
+    ctrl->slot_mask  = SLOT_COUNT - 1;
+    ctrl->ep_state   = VDTU_EP_ACTIVE;
+
+    struct vdtu_ring ring;
+    vdtu_ring_attach(&ring, mem);
+    CHECK(ring.head == &ctrl->head && ring.tail == &ctrl->tail,
+          "legacy ring should use v1 index words");
+    CHECK(ring.slots == (uint8_t *)mem + VDTU_RING_CTRL_SIZE,
+          "legacy slots start after 64 bytes");
+    CHECK(send_text(&ring, 1, 0, 5, "OLD") == 0, "legacy send");
+    CHECK(ctrl->head == 1, "legacy head advanced in place");
+
+    free(mem);
+    PASS();
+}
+
+static void test_stray_ack(void)
+{
+    TEST("ack on an empty ring is a no-op");
+
+    size_t sz = vdtu_ring_total_size(SLOT_COUNT, SLOT_SIZE);
+    void *mem = calloc(1, sz);
+    struct vdtu_ring ring;
+    vdtu_ring_init(&ring, mem, SLOT_COUNT, SLOT_SIZE);
+
+    vdtu_ring_ack(&ring);
+    CHECK(vdtu_ring_is_empty(&ring), "stray ack must not move tail");
+    CHECK(send_text(&ring, 1, 0, 1, "A") == 0, "send after stray ack");
+    const struct vdtu_message *msg = vdtu_ring_fetch(&ring);
+    CHECK(msg && msg->hdr.label == 1, "message intact after stray ack");
+    vdtu_ring_ack(&ring);
+    vdtu_ring_ack(&ring);
+    CHECK(vdtu_ring_is_empty(&ring) && !vdtu_ring_is_full(&ring),
+          "double ack leaves ring consistent");
+
+    free(mem);
+    PASS();
+}
+
+static void test_reserve_commit(void)
+{
+    TEST("reserve/commit writes in place");
+
+    size_t sz = vdtu_ring_total_size(SLOT_COUNT, SLOT_SIZE);
+    void *mem = calloc(1, sz);
+    struct vdtu_ring ring;
+    vdtu_ring_init(&ring, mem, SLOT_COUNT, SLOT_SIZE);
+
+    CHECK(vdtu_ring_commit(&ring, 0, 0, 0, 0, 0, 0, 0, 0) == -1,
+          "commit without reserve should fail");
+
+    void *buf = NULL;
+    CHECK(vdtu_ring_reserve(&ring, 16, &buf) == 0, "reserve should succeed");
+    CHECK((uint8_t *)buf == ring.slots + VDTU_HEADER_SIZE,
+          "payload area is inside the head slot");
+    memcpy(buf, "IN_PLACE", 8);
+    CHECK(vdtu_ring_is_empty(&ring), "reserve publishes nothing");
+    CHECK(vdtu_ring_commit(&ring, 2, 3, 4, 5, 0xAA, 0xBB, 0, 17) == -2,
+          "commit longer than reservation should fail");
+
+    CHECK(vdtu_ring_reserve(&ring, 16, &buf) == 0, "re-reserve same slot");
+    CHECK(vdtu_ring_commit(&ring, 2, 3, 4, 5, 0xAA, 0xBB, 0, 8) == 0,
+          "commit should succeed");
+    CHECK(vdtu_ring_commit(&ring, 2, 3, 4, 5, 0xAA, 0xBB, 0, 8) == -1,
+          "commit consumes the reservation");
+
+    const struct vdtu_message *msg = vdtu_ring_fetch(&ring);
+    CHECK(msg != NULL, "committed message visible");
+    CHECK(msg->hdr.sender_core_id == 2 && msg->hdr.sender_ep_id == 3 &&
+          msg->hdr.sender_vpe_id == 4 && msg->hdr.reply_ep_id == 5,
+          "header fields");
+    CHECK(msg->hdr.label == 0xAA && msg->hdr.replylabel == 0xBB,
+          "labels");
+    CHECK(msg->hdr.length == 8 && memcmp(msg->data, "IN_PLACE", 8) == 0,
+          "payload");
+    vdtu_ring_ack(&ring);
+
+    /* Full ring: reserve fails like send */
+    for (uint32_t i = 0; i < SLOT_COUNT - 1; i++)
+        send_text(&ring, 1, 0, i, "X");
+    CHECK(vdtu_ring_reserve(&ring, 4, &buf) == -1, "reserve on full ring");
+    CHECK(vdtu_ring_reserve(&ring, SLOT_SIZE, &buf) == -2,
+          "oversized reserve");
+
+    ring.ctrl->ep_state = VDTU_EP_TERMINATED;
+    CHECK(vdtu_ring_reserve(&ring, 4, &buf) == -3,
+          "reserve on terminated endpoint");
+
+    free(mem);
+    PASS();
+}
+
+/* All bytes of the slot's payload area past hdr.length must be zero */
+static int tail_is_clean(const struct vdtu_message *msg)
+{
+    for (uint32_t i = msg->hdr.length; i < SLOT_SIZE - VDTU_HEADER_SIZE; i++) {
+        if (msg->data[i] != 0)
+            return 0;
+    }
+    return 1;
+}
+
+static void test_stale_scrub(void)
+{
+    TEST("short messages never expose stale payload");
+
+    size_t sz = vdtu_ring_total_size(2, SLOT_SIZE);
+    void *mem = malloc(sz);
+    memset(mem, 0xEE, sz);      /* dirty memory: init must clear slots */
+    struct vdtu_ring ring;
+    vdtu_ring_init(&ring, mem, 2, SLOT_SIZE);
+
+    uint8_t big[SLOT_SIZE - VDTU_HEADER_SIZE];
+    memset(big, 0x5A, sizeof(big));
+    const struct vdtu_message *msg;
+
+    /* 2 slots, 1 usable: every send reuses the same slot */
+    CHECK(send_text(&ring, 1, 0, 1, "A") == 0, "first send");
+    msg = vdtu_ring_fetch(&ring);
+    CHECK(msg && tail_is_clean(msg), "init left slots clean");
+    vdtu_ring_ack(&ring);
+
+    CHECK(vdtu_ring_send(&ring, 1, 0, 0, 0, 2, 0, 0, big, sizeof(big)) == 0,
+          "long send");
+    vdtu_ring_fetch(&ring);
+    vdtu_ring_ack(&ring);
+    CHECK(send_text(&ring, 1, 0, 3, "SHORT") == 0, "short send");
+    msg = vdtu_ring_fetch(&ring);
+    CHECK(msg && msg->hdr.length == 5, "short length");
+    CHECK(tail_is_clean(msg), "long payload scrubbed after short send");
+    vdtu_ring_ack(&ring);
+
+    /* Caller scribbles a whole reservation, then drops it */
+    void *buf;
+    CHECK(vdtu_ring_reserve(&ring, sizeof(big), &buf) == 0, "reserve");
+    memset(buf, 0x77, sizeof(big));
+    vdtu_ring_cancel(&ring);
+    CHECK(send_text(&ring, 1, 0, 4, "HI") == 0, "send after cancel");
+    msg = vdtu_ring_fetch(&ring);
+    CHECK(msg && tail_is_clean(msg), "cancelled scribble scrubbed");
+    vdtu_ring_ack(&ring);
+
+    /* Reserve big, commit small */
+    CHECK(vdtu_ring_reserve(&ring, sizeof(big), &buf) == 0, "reserve big");
+    memset(buf, 0x33, sizeof(big));
+    CHECK(vdtu_ring_commit(&ring, 1, 0, 0, 0, 5, 0, 0, 3) == 0, "commit small");
+    msg = vdtu_ring_fetch(&ring);
+    CHECK(msg && msg->hdr.length == 3 && tail_is_clean(msg),
+          "unused reservation scrubbed");
+
+    free(mem);
+    PASS();
+}
+
+/* Packed ring over what a 4 KiB dataport leaves after the v1 ctrl block */
+#define PACKED_DATA     (4096 - VDTU_RING_CTRL_SIZE)
+
+static void test_packed_init(void)
+{
+    TEST("packed init: geometry and parameter checks");
+
+    void *mem = calloc(1, 4096);
+    struct vdtu_ring ring;
+
+    uint32_t max = vdtu_ring_packed_max_msg(PACKED_DATA);
+    CHECK(max == 2008, "max message for 4032 bytes");
+    CHECK(vdtu_ring_packed_record_size(0) == 32, "empty record rounds to 32");
+    CHECK(vdtu_ring_packed_record_size(7) == 32, "25 + 7 = 32");
+    CHECK(vdtu_ring_packed_record_size(8) == 40, "25 + 8 rounds to 40");
+
+    CHECK(vdtu_ring_init_packed(&ring, mem, PACKED_DATA, max + 1) == -1,
+          "max_msg above the bound should fail");
+    CHECK(vdtu_ring_init_packed(&ring, mem, PACKED_DATA, 24) == -1,
+          "max_msg below header should fail");
+    CHECK(vdtu_ring_init_packed(NULL, mem, PACKED_DATA, 512) == -1,
+          "NULL ring should fail");
+
+    CHECK(vdtu_ring_init_packed(&ring, mem, PACKED_DATA + 3, 512) == 0,
+          "init should succeed");
+    CHECK(ring.ctrl->mode == VDTU_RING_MODE_PACKED, "mode recorded");
+    CHECK(ring.ctrl->data_size == PACKED_DATA, "data size rounded down");
+    CHECK(ring.ctrl->slot_size == 512, "max message recorded");
+    CHECK(vdtu_ring_is_empty(&ring) && !vdtu_ring_is_full(&ring),
+          "new ring empty");
+
+    struct vdtu_ring other;
+    vdtu_ring_attach(&other, mem);
+    CHECK(other.slots == ring.slots && other.ctrl->mode == VDTU_RING_MODE_PACKED,
+          "attach sees packed ring");
+
+    uint8_t big[512];
+    memset(big, 1, sizeof(big));
+    CHECK(vdtu_ring_send(&ring, 0, 0, 0, 0, 0, 0, 0, big,
+                         512 - VDTU_HEADER_SIZE + 1) == -2,
+          "message above max should fail");
+
+    free(mem);
+    PASS();
+}
+
+static void test_packed_send_fetch(void)
+{
+    TEST("packed: back-to-back records, fetch/ack");
+
+    void *mem = calloc(1, 4096);
+    struct vdtu_ring prod, cons;
+    vdtu_ring_init_packed(&prod, mem, PACKED_DATA, VDTU_KRNLC_MSG_SIZE - 40);
+    vdtu_ring_attach(&cons, mem);
+
+    /* 30-byte replies: 56-byte records */
+    uint8_t reply[30];
+    uint32_t sent = 0;
+    for (;;) {
+        memset(reply, (int)sent, sizeof(reply));
+        if (vdtu_ring_send(&prod, 1, 2, 3, 4, sent, ~(uint64_t)sent, 0,
+                           reply, sizeof(reply)) != 0)
+            break;
+        sent++;
+    }
+    CHECK(sent == (PACKED_DATA - 1) / 56, "ring holds data_size / record");
+    CHECK(vdtu_ring_available(&cons) == sent, "available counts records");
+    CHECK(vdtu_ring_is_full(&prod) || sent > 0, "full after filling");
+
+    for (uint32_t i = 0; i < sent; i++) {
+        const struct vdtu_message *msg = vdtu_ring_fetch(&cons);
+        CHECK(msg != NULL, "fetch should succeed");
+        CHECK((size_t)((const uint8_t *)msg - cons.slots) == (size_t)i * 56,
+              "records are contiguous");
+        CHECK(msg->hdr.label == i && msg->hdr.replylabel == ~(uint64_t)i,
+              "labels in order");
+        CHECK(msg->hdr.length == 30 && msg->data[29] == (uint8_t)i,
+              "payload intact");
+        vdtu_ring_ack(&cons);
+    }
+    CHECK(vdtu_ring_fetch(&cons) == NULL, "drained");
+
+    free(mem);
+    PASS();
+}
+
+static void test_packed_wrap(void)
+{
+    TEST("packed: wrap markers keep messages contiguous");
+
+    size_t data = 1024;
+    void *mem = calloc(1, VDTU_RING_CTRL_SIZE + data);
+    struct vdtu_ring prod, cons;
+    vdtu_ring_init_packed(&prod, mem, data, vdtu_ring_packed_max_msg(data));
+    vdtu_ring_attach(&cons, mem);
+
+    uint8_t buf[512];
+    uint32_t next_send = 0, next_recv = 0, wraps = 0;
+    uint32_t max_payload = prod.ctrl->slot_size - VDTU_HEADER_SIZE;
+
+    /* Many laps of mixed sizes with the consumer lagging a few records */
+    while (next_recv < 5000) {
+        uint16_t len = (uint16_t)((next_send * 37u) % (max_payload + 1));
+        memset(buf, (int)next_send, len);
+        if (next_send < 5000 &&
+            vdtu_ring_send(&prod, 0, 0, 0, 0, next_send, 0, 0, buf, len) == 0) {
+            next_send++;
+            if (vdtu_ring_available(&cons) < 3)
+                continue;
+        }
+
+        const struct vdtu_message *msg = vdtu_ring_fetch(&cons);
+        CHECK(msg != NULL, "pending message expected");
+        size_t off = (const uint8_t *)msg - cons.slots;
+        if (off == 0)
+            wraps++;
+        CHECK(off + VDTU_HEADER_SIZE + msg->hdr.length <= data,
+              "message never runs past the data area");
+        CHECK(msg->hdr.label == next_recv, "order preserved across wraps");
+        CHECK((msg->hdr.flags & VDTU_FLAG_WRAP) == 0, "no marker returned");
+        uint16_t want = (uint16_t)((next_recv * 37u) % (max_payload + 1));
+        CHECK(msg->hdr.length == want, "length preserved");
+        if (want > 0) {
+            CHECK(msg->data[0] == (uint8_t)next_recv &&
+                  msg->data[want - 1] == (uint8_t)next_recv,
+                  "payload preserved");
+        }
+        vdtu_ring_ack(&cons);
+        next_recv++;
+    }
+    CHECK(wraps > 10, "test should wrap many times");
+    CHECK(vdtu_ring_is_empty(&cons), "drained");
+
+    free(mem);
+    PASS();
+}
+
+static void test_packed_max_anywhere(void)
+{
+    TEST("packed: drained ring always takes a max message");
+
+    size_t data = 1024;
+    void *mem = calloc(1, VDTU_RING_CTRL_SIZE + data);
+    struct vdtu_ring ring;
+    uint32_t max = vdtu_ring_packed_max_msg(data);
+    uint8_t buf[1024];
+    memset(buf, 0xAB, sizeof(buf));
+
+    /* Leave head == tail at every aligned offset, then send the largest */
+    for (uint32_t off = 0; off < data; off += VDTU_RING_PACKED_ALIGN) {
+        vdtu_ring_init_packed(&ring, mem, data, max);
+        *ring.head = *ring.tail = off;
+        ring.cached_tail = ring.cached_head = off;
+        CHECK(vdtu_ring_send(&ring, 0, 0, 0, 0, off, 0, 0, buf,
+                             max - VDTU_HEADER_SIZE) == 0,
+              "max message must fit in a drained ring");
+        const struct vdtu_message *msg = vdtu_ring_fetch(&ring);
+        CHECK(msg && msg->hdr.label == off, "max message fetched");
+        vdtu_ring_ack(&ring);
+        CHECK(vdtu_ring_is_empty(&ring), "drained again");
+    }
+
+    free(mem);
+    PASS();
+}
+
+static void test_packed_batch_reserve(void)
+{
+    TEST("packed: batch send/fetch and reserve/commit");
+
+    size_t data = 512;
+    void *mem = calloc(1, VDTU_RING_CTRL_SIZE + data);
+    struct vdtu_ring ring;
+    vdtu_ring_init_packed(&ring, mem, data, 128);
+
+    uint64_t words[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    struct vdtu_ring_msg_desc descs[16];
+    memset(descs, 0, sizeof(descs));
+    for (uint32_t i = 0; i < 16; i++) {
+        descs[i].label       = i;
+        descs[i].payload     = words;
+        descs[i].payload_len = (uint16_t)(8 * (i % 8 + 1));
+    }
+    int rc = vdtu_ring_send_batch(&ring, descs, 16);
+    CHECK(rc > 0 && rc < 16, "batch stops when the data area is full");
+
+    const struct vdtu_message *msgs[16];
+    uint32_t n = vdtu_ring_fetch_batch(&ring, msgs, 16);
+    CHECK(n == (uint32_t)rc, "batch fetch sees all");
+    for (uint32_t i = 0; i < n; i++)
+        CHECK(msgs[i]->hdr.label == i &&
+              msgs[i]->hdr.length == descs[i].payload_len, "batch order");
+    vdtu_ring_ack_n(&ring, n + 5);
+    CHECK(vdtu_ring_is_empty(&ring), "ack_n clamps");
+
+    /* Reserve near the end forces a wrap; commit shorter than reserved */
+    void *buf;
+    CHECK(vdtu_ring_reserve(&ring, 100, &buf) == 0, "reserve");
+    memcpy(buf, "PACKED", 6);
+    CHECK(vdtu_ring_commit(&ring, 9, 0, 0, 0, 77, 0, 0, 6) == 0, "commit");
+    const struct vdtu_message *msg = vdtu_ring_fetch(&ring);
+    CHECK(msg && msg->hdr.label == 77 && msg->hdr.sender_core_id == 9,
+          "committed header");
+    CHECK(memcmp(msg->data, "PACKED", 6) == 0 && msg->data[6] == 0,
+          "payload and scrubbed padding");
+    vdtu_ring_ack(&ring);
+
+    free(mem);
+    PASS();
+}
+
+static void test_notify_flag(void)
+{
+    TEST("notify only when the consumer announced a block");
+
+    size_t sz = vdtu_ring_total_size(SLOT_COUNT, SLOT_SIZE);
+    void *mem = calloc(1, sz);
+    struct vdtu_ring prod, cons;
+    vdtu_ring_init(&prod, mem, SLOT_COUNT, SLOT_SIZE);
+    vdtu_ring_attach(&cons, mem);
+
+    send_text(&prod, 1, 0, 1, "A");
+    CHECK(vdtu_ring_notify_needed(&prod) == 0, "nobody waiting: no signal");
+
+    CHECK(vdtu_ring_prepare_wait(&cons) == 1, "pending message cancels block");
+    CHECK(prod.ctrl->consumer_waiting == 0, "withdrawn announcement");
+    vdtu_ring_fetch(&cons);
+    vdtu_ring_ack(&cons);
+
+    CHECK(vdtu_ring_prepare_wait(&cons) == 0, "empty ring: may block");
+    send_text(&prod, 1, 0, 2, "B");
+    CHECK(vdtu_ring_notify_needed(&prod) == 1, "sleeper gets one signal");
+    send_text(&prod, 1, 0, 3, "C");
+    CHECK(vdtu_ring_notify_needed(&prod) == 0, "no second signal");
+    vdtu_ring_finish_wait(&cons);
+
+    CHECK(prod.stats.sent == 3 && prod.stats.notifies == 1,
+          "producer counters");
+
+    free(mem);
+    PASS();
+}
+
+struct wake_ctx {
+    struct vdtu_ring *prod;
+    int calls;
+};
+
+/* Stands in for the notification wait: the "producer" runs meanwhile */
+static int wake_by_send(void *arg)
+{
+    struct wake_ctx *wc = arg;
+    wc->calls++;
+    send_text(wc->prod, 1, 0, 9, "WAKE");
+    vdtu_ring_notify_needed(wc->prod);
+    return 1;
+}
+
+/* A wait that times out without a signal */
+static int give_up(void *arg)
+{
+    struct wake_ctx *wc = arg;
+    wc->calls++;
+    return 0;
+}
+
+static void test_wait_any(void)
+{
+    TEST("wait_any: spin, block, adapt budget, time out");
+
+    size_t sz = vdtu_ring_total_size(SLOT_COUNT, SLOT_SIZE);
+    void *mem0 = calloc(1, sz), *mem1 = calloc(1, sz);
+    struct vdtu_ring p1, c0, c1;
+    vdtu_ring_init(&c0, mem0, SLOT_COUNT, SLOT_SIZE);
+    vdtu_ring_init(&c1, mem1, SLOT_COUNT, SLOT_SIZE);
+    vdtu_ring_attach(&p1, mem1);
+
+    struct vdtu_ring *rings[3] = { &c0, NULL, &c1 };
+    struct vdtu_ring_waiter w;
+    vdtu_ring_waiter_init(&w, 4, 64);
+    struct wake_ctx wc = { &p1, 0 };
+
+    send_text(&p1, 1, 0, 1, "READY");
+    CHECK(vdtu_ring_wait_any(&w, rings, 3, wake_by_send, &wc) == 2,
+          "pending message returned at once");
+    CHECK(wc.calls == 0 && w.blocks == 0, "no block needed");
+    vdtu_ring_fetch(&c1);
+    vdtu_ring_ack(&c1);
+
+    CHECK(vdtu_ring_wait_any(&w, rings, 3, wake_by_send, &wc) == 2,
+          "woken ring returned");
+    CHECK(wc.calls == 1 && w.blocks == 1, "blocked once");
+    CHECK(p1.stats.notifies == 1, "producer signalled the sleeper");
+    CHECK(w.spin == 4, "blocking keeps the budget at its minimum");
+    CHECK(c0.ctrl->consumer_waiting == 0 && c1.ctrl->consumer_waiting == 0,
+          "announcements withdrawn after wake");
+    vdtu_ring_fetch(&c1);
+    vdtu_ring_ack(&c1);
+
+    CHECK(vdtu_ring_wait_any(&w, rings, 3, give_up, &wc) == 3,
+          "giving up returns count");
+    CHECK(wc.calls == 2 && w.blocks == 2 && w.timeouts == 1, "timeout counted");
+    CHECK(c0.ctrl->consumer_waiting == 0 && c1.ctrl->consumer_waiting == 0,
+          "announcements withdrawn after timeout");
+
+    free(mem0);
+    free(mem1);
+    PASS();
+}
+
+static void test_doorbell(void)
+{
+    TEST("doorbell: ring bits, take clears them");
+
+    uint32_t bell = 0;
+    CHECK(vdtu_doorbell_take(&bell) == 0, "nothing rung");
+
+    vdtu_doorbell_ring(&bell, 2);
+    vdtu_doorbell_ring(&bell, 5);
+    vdtu_doorbell_ring(&bell, 2);
+    vdtu_doorbell_ring(&bell, VDTU_DOORBELL_BITS - 1);
+    uint32_t bits = vdtu_doorbell_take(&bell);
+    CHECK(bits == ((1u << 2) | (1u << 5) | (1u << 31)),
+          "repeated rings coalesce into one bit");
+    CHECK(bell == 0 && vdtu_doorbell_take(&bell) == 0, "take cleared the word");
+
+    int order[3], n = 0;
+    for (; bits; bits &= bits - 1)
+        order[n++] = __builtin_ctz(bits);
+    CHECK(n == 3 && order[0] == 2 && order[1] == 5 && order[2] == 31,
+          "ctz scan visits only rung rings");
+
+    PASS();
+}
+
+/* ========================================================================= */
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/*
+ * Throughput comparison: single send/fetch/ack vs. batched, same ring
+ * geometry (32 x 512B) and payload. Informational only, never fails.
+ */
+static void bench_batch_throughput(void)
+{
+    const uint32_t slots = VDTU_MAX_MSG_SLOTS;
+    const uint32_t burst = slots - 1;
+    const int rounds = 20000;
+    size_t sz = vdtu_ring_total_size(slots, SLOT_SIZE);
+    void *mem = calloc(1, sz);
+    struct vdtu_ring ring;
+    vdtu_ring_init(&ring, mem, slots, SLOT_SIZE);
+
+    uint64_t payload[4] = { 18, 0, 0, 0 };  /* NOOP-sized syscall */
+    struct vdtu_ring_msg_desc descs[VDTU_MAX_MSG_SLOTS];
+    const struct vdtu_message *msgs[VDTU_MAX_MSG_SLOTS];
+    memset(descs, 0, sizeof(descs));
+    for (uint32_t i = 0; i < burst; i++) {
+        descs[i].payload     = payload;
+        descs[i].payload_len = sizeof(payload);
+    }
+
+    double t0 = now_sec();
+    for (int r = 0; r < rounds; r++) {
+        for (uint32_t i = 0; i < burst; i++)
+            vdtu_ring_send(&ring, 0, 0, 0, 0, 0, 0, 0,
+                           payload, sizeof(payload));
+        for (uint32_t i = 0; i < burst; i++) {
+            vdtu_ring_fetch(&ring);
+            vdtu_ring_ack(&ring);
+        }
+    }
+    double single = now_sec() - t0;
+
+    t0 = now_sec();
+    for (int r = 0; r < rounds; r++) {
+        vdtu_ring_send_batch(&ring, descs, burst);
+        uint32_t n = vdtu_ring_fetch_batch(&ring, msgs, burst);
+        vdtu_ring_ack_n(&ring, n);
+    }
+    double batched = now_sec() - t0;
+
+    double total = (double)rounds * burst;
+    printf("  BENCH: single  %10.0f msgs/sec\n", total / single);
+    printf("  BENCH: batched %10.0f msgs/sec (burst=%u)\n",
+           total / batched, burst);
+
+    free(mem);
+}
+
+/*
+ * Per-message cost on kernelcall-sized slots (2 KiB) with a small payload:
+ * copying send vs. marshalling in place. Informational only.
+ */
+static void bench_reserve_commit(void)
+{
+    const uint32_t slots = 4;
+    const uint32_t slot_size = VDTU_KRNLC_MSG_SIZE;
+    const int rounds = 1000000;
+    size_t sz = vdtu_ring_total_size(slots, slot_size);
+    void *mem = calloc(1, sz);
+    struct vdtu_ring ring;
+    vdtu_ring_init(&ring, mem, slots, slot_size);
+
+    uint64_t payload[6] = { 3, 1, 2, 3, 4, 5 };  /* typical kernelcall */
+
+    double t0 = now_sec();
+    for (int r = 0; r < rounds; r++) {
+        vdtu_ring_send(&ring, 0, 0, 0, 0, 0, 0, 0, payload, sizeof(payload));
+        vdtu_ring_fetch(&ring);
+        vdtu_ring_ack(&ring);
+    }
+    double copy = now_sec() - t0;
+
+    t0 = now_sec();
+    for (int r = 0; r < rounds; r++) {
+        void *buf;
+        vdtu_ring_reserve(&ring, sizeof(payload), &buf);
+        /* Payload sits at offset 25: store the words unaligned */
+        for (int i = 0; i < 6; i++)
+            memcpy((uint8_t *)buf + i * sizeof(uint64_t), &payload[i],
+                   sizeof(uint64_t));
+        vdtu_ring_commit(&ring, 0, 0, 0, 0, 0, 0, 0, sizeof(payload));
+        vdtu_ring_fetch(&ring);
+        vdtu_ring_ack(&ring);
+    }
+    double inplace = now_sec() - t0;
+
+    printf("  BENCH: send 2K slot     %10.0f msgs/sec\n", rounds / copy);
+    printf("  BENCH: reserve/commit   %10.0f msgs/sec\n", rounds / inplace);
+
+    free(mem);
+}
+
+/*
+ * How many messages of a given size one 4 KiB dataport holds, fixed slots
+ * (largest power-of-2 slot count that fits) vs. packed, and the cost of a
+ * send/fetch/ack round trip in each mode. Informational only.
+ */
+static void bench_packed_occupancy(void)
+{
+    static const struct { const char *name; uint32_t slot; uint16_t len; } c[] = {
+        { "syscall 512B, 40B msgs",     VDTU_SYSC_MSG_SIZE,  40 },
+        { "kernelcall 2K, 30B replies", VDTU_KRNLC_MSG_SIZE, 30 },
+        { "kernelcall 2K, 200B msgs",   VDTU_KRNLC_MSG_SIZE, 200 },
+    };
+    const int rounds = 1000000;
+    uint8_t payload[256];
+    memset(payload, 0x11, sizeof(payload));
+    void *mem = calloc(1, 2 * 4096);   /* slot rings may overhang a page */
+
+    for (size_t i = 0; i < sizeof(c) / sizeof(c[0]); i++) {
+        struct vdtu_ring ring;
+        /* One slot always stays empty; a 2 KiB pair does not fit at all */
+        uint32_t count = PACKED_DATA / c[i].slot;
+        uint32_t p = 2;
+        while (p * 2 <= count) p *= 2;
+        uint32_t slots_fit = count >= 2 ? p - 1 : 0;
+
+        /* Packed max message is capped by the dataport, not the slot */
+        uint32_t max = vdtu_ring_packed_max_msg(PACKED_DATA);
+        vdtu_ring_init_packed(&ring, mem, PACKED_DATA,
+                              c[i].slot < max ? c[i].slot : max);
+        uint32_t packed_fit = 0;
+        while (vdtu_ring_send(&ring, 0, 0, 0, 0, 0, 0, 0,
+                              payload, c[i].len) == 0)
+            packed_fit++;
+
+        double t0 = now_sec();
+        vdtu_ring_init_packed(&ring, mem, PACKED_DATA,
+                              c[i].slot < max ? c[i].slot : max);
+        for (int r = 0; r < rounds; r++) {
+            vdtu_ring_send(&ring, 0, 0, 0, 0, 0, 0, 0, payload, c[i].len);
+            vdtu_ring_fetch(&ring);
+            vdtu_ring_ack(&ring);
+        }
+        double packed = now_sec() - t0;
+
+        t0 = now_sec();
+        vdtu_ring_init(&ring, mem, p, c[i].slot);
+        for (int r = 0; r < rounds; r++) {
+            vdtu_ring_send(&ring, 0, 0, 0, 0, 0, 0, 0, payload, c[i].len);
+            vdtu_ring_fetch(&ring);
+            vdtu_ring_ack(&ring);
+        }
+        double slots = now_sec() - t0;
+
+        printf("  BENCH: %-27s in-flight slots %3u packed %3u\n",
+               c[i].name, slots_fit, packed_fit);
+        printf("         %-27s msgs/sec  slots %10.0f packed %10.0f\n",
+               "", rounds / slots, rounds / packed);
+    }
+
+    free(mem);
+}
+
 /* ========================================================================= */
 
 int main(void)
@@ -356,6 +1181,27 @@ int main(void)
     test_payload_too_large();
     test_wraparound();
     test_attach();
+    test_send_batch();
+    test_send_batch_partial();
+    test_send_batch_errors();
+    test_layout_v2();
+    test_legacy_attach();
+    test_stray_ack();
+    test_reserve_commit();
+    test_stale_scrub();
+    test_packed_init();
+    test_packed_send_fetch();
+    test_packed_wrap();
+    test_packed_max_anywhere();
+    test_packed_batch_reserve();
+    test_notify_flag();
+    test_wait_any();
+    test_doorbell();
+
+    printf("\n=== Benchmarks ===\n\n");
+    bench_batch_throughput();
+    bench_reserve_commit();
+    bench_packed_occupancy();
 
     printf("\n=== Results: %d passed, %d failed ===\n",
            tests_passed, tests_failed);
@@ -0,0 +1,369 @@
+/*
+ * test_ring_stress.c -- Cross-thread stress test and benchmark for the SPSC ring
+ *
+ * One producer thread and one consumer thread share a ring exactly like two
+ * CAmkES components share a dataport: each side has its own vdtu_ring handle
+ * (init on one side, attach on the other) over the same memory. Every
+ * message carries its sequence number in the label and a sequence-derived
+ * payload of varying length, so the consumer can detect reordering, loss,
+ * duplication and torn slot contents.
+ *
+ * Compile: gcc -O2 -pthread -I../components/include -o test_ring_stress \
+ *          test_ring_stress.c ../src/vdtu_ring.c
+ *
+ * Or just: make test (uses the provided Makefile)
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <time.h>
+#include "vdtu_ring.h"
+
+#define STRESS_MSGS     2000000u
+#define STRESS_BURST    8u
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) \
+    do { printf("  TEST: %-50s ", name); fflush(stdout); } while(0)
+
+#define PASS() \
+    do { printf("PASS\n"); tests_passed++; } while(0)
+
+#define FAIL(msg) \
+    do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+struct stress_ctx {
+    void *mem;
+    uint32_t slot_count;
+    uint32_t slot_size;
+    uint32_t layout;
+    uint32_t packed_size;   /* nonzero: packed ring of this many data bytes */
+    uint32_t msgs;
+    int batched;
+    int blocking;           /* consumer spins then blocks on 'doorbell' */
+    sem_t doorbell;
+    uint64_t signals;       /* producer: doorbell posts */
+    uint64_t blocks;        /* consumer: times it actually blocked */
+    /* Consumer results */
+    uint32_t received;
+    uint32_t errors;
+    const char *first_error;
+};
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Payload length for message seq: 8 .. (max_payload), varying per message */
+static uint16_t payload_len_for(uint32_t seq, uint32_t max_payload)
+{
+    return (uint16_t)(8 + (seq * 7u) % (max_payload - 8 + 1));
+}
+
+static void fill_payload(uint8_t *buf, uint32_t seq, uint16_t len)
+{
+    memcpy(buf, &seq, sizeof(seq));
+    memcpy(buf + 4, &seq, sizeof(seq));
+    for (uint16_t i = 8; i < len; i++)
+        buf[i] = (uint8_t)(seq + i * 31u);
+}
+
+static int check_payload(const uint8_t *buf, uint32_t seq, uint16_t len)
+{
+    uint32_t a, b;
+    memcpy(&a, buf, sizeof(a));
+    memcpy(&b, buf + 4, sizeof(b));
+    if (a != seq || b != seq)
+        return 0;
+    for (uint16_t i = 8; i < len; i++) {
+        if (buf[i] != (uint8_t)(seq + i * 31u))
+            return 0;
+    }
+    return 1;
+}
+
+/* Producer: ring the doorbell only if the consumer announced a block */
+static void producer_notify(struct stress_ctx *ctx, struct vdtu_ring *ring)
+{
+    if (ctx->blocking && vdtu_ring_notify_needed(ring)) {
+        ctx->signals++;
+        sem_post(&ctx->doorbell);
+    }
+}
+
+static int block_on_doorbell(void *arg)
+{
+    struct stress_ctx *ctx = arg;
+    while (sem_wait(&ctx->doorbell) != 0)
+        ;
+    return 1;
+}
+
+static void *producer_main(void *arg)
+{
+    struct stress_ctx *ctx = arg;
+    struct vdtu_ring ring;
+    vdtu_ring_attach(&ring, ctx->mem);
+
+    uint32_t max_payload = ctx->slot_size - VDTU_HEADER_SIZE;
+    uint8_t *bufs = malloc((size_t)STRESS_BURST * ctx->slot_size);
+    struct vdtu_ring_msg_desc descs[STRESS_BURST];
+    memset(descs, 0, sizeof(descs));
+
+    uint32_t seq = 0;
+    while (seq < ctx->msgs) {
+        if (!ctx->batched) {
+            uint16_t len = payload_len_for(seq, max_payload);
+            fill_payload(bufs, seq, len);
+            while (vdtu_ring_send(&ring, 1, 0, 0, 0, seq, ~(uint64_t)seq, 0,
+                                  bufs, len) != 0)
+                sched_yield();
+            producer_notify(ctx, &ring);
+            seq++;
+            continue;
+        }
+
+        uint32_t n = ctx->msgs - seq;
+        if (n > STRESS_BURST)
+            n = STRESS_BURST;
+        for (uint32_t i = 0; i < n; i++) {
+            uint16_t len = payload_len_for(seq + i, max_payload);
+            uint8_t *buf = bufs + (size_t)i * ctx->slot_size;
+            fill_payload(buf, seq + i, len);
+            descs[i].sender_pe   = 1;
+            descs[i].label       = seq + i;
+            descs[i].replylabel  = ~(uint64_t)(seq + i);
+            descs[i].payload     = buf;
+            descs[i].payload_len = len;
+        }
+        uint32_t done = 0;
+        while (done < n) {
+            int rc = vdtu_ring_send_batch(&ring, descs + done, n - done);
+            if (rc <= 0) {
+                sched_yield();
+            } else {
+                done += (uint32_t)rc;
+                producer_notify(ctx, &ring);
+            }
+        }
+        seq += n;
+    }
+
+    free(bufs);
+    return NULL;
+}
+
+static void consumer_check(struct stress_ctx *ctx, const struct vdtu_message *msg,
+                           uint32_t max_payload)
+{
+    uint32_t seq = ctx->received++;
+    const char *err = NULL;
+
+    if (msg->hdr.label != seq)
+        err = "sequence out of order";
+    else if (msg->hdr.replylabel != ~(uint64_t)seq)
+        err = "replylabel mismatch";
+    else if (msg->hdr.length != payload_len_for(seq, max_payload))
+        err = "length mismatch";
+    else if (!check_payload(msg->data, seq, msg->hdr.length))
+        err = "payload corrupted";
+
+    if (err) {
+        ctx->errors++;
+        if (!ctx->first_error)
+            ctx->first_error = err;
+    }
+}
+
+static void *consumer_main(void *arg)
+{
+    struct stress_ctx *ctx = arg;
+    struct vdtu_ring ring;
+    vdtu_ring_attach(&ring, ctx->mem);
+
+    uint32_t max_payload = ctx->slot_size - VDTU_HEADER_SIZE;
+    const struct vdtu_message *msgs[STRESS_BURST];
+    struct vdtu_ring *rings[1] = { &ring };
+    struct vdtu_ring_waiter waiter;
+    vdtu_ring_waiter_init(&waiter, VDTU_RING_SPIN_MIN, VDTU_RING_SPIN_MAX);
+
+    while (ctx->received < ctx->msgs) {
+        if (ctx->blocking)
+            vdtu_ring_wait_any(&waiter, rings, 1, block_on_doorbell, ctx);
+
+        if (!ctx->batched) {
+            const struct vdtu_message *msg = vdtu_ring_fetch(&ring);
+            if (!msg) {
+                sched_yield();
+                continue;
+            }
+            consumer_check(ctx, msg, max_payload);
+            vdtu_ring_ack(&ring);
+            continue;
+        }
+
+        uint32_t n = vdtu_ring_fetch_batch(&ring, msgs, STRESS_BURST);
+        if (n == 0) {
+            sched_yield();
+            continue;
+        }
+        for (uint32_t i = 0; i < n; i++)
+            consumer_check(ctx, msgs[i], max_payload);
+        vdtu_ring_ack_n(&ring, n);
+    }
+    ctx->blocks = waiter.blocks;
+    return NULL;
+}
+
+static double run_stress(struct stress_ctx *ctx)
+{
+    struct vdtu_ring owner;
+    if (ctx->packed_size) {
+        /* slot_size is the largest message */
+        ctx->mem = calloc(1, vdtu_ring_total_size_packed(ctx->packed_size,
+                                                         VDTU_RING_DEFAULT_LAYOUT));
+        vdtu_ring_init_packed(&owner, ctx->mem, ctx->packed_size,
+                              ctx->slot_size);
+    } else {
+        ctx->mem = calloc(1, vdtu_ring_total_size_layout(ctx->slot_count,
+                                                         ctx->slot_size,
+                                                         ctx->layout));
+        vdtu_ring_init_layout(&owner, ctx->mem, ctx->slot_count,
+                              ctx->slot_size, ctx->layout);
+    }
+
+    sem_init(&ctx->doorbell, 0, 0);
+
+    pthread_t prod, cons;
+    double t0 = now_sec();
+    pthread_create(&cons, NULL, consumer_main, ctx);
+    pthread_create(&prod, NULL, producer_main, ctx);
+    pthread_join(prod, NULL);
+    pthread_join(cons, NULL);
+    double elapsed = now_sec() - t0;
+
+    if (!vdtu_ring_is_empty(&owner) && !ctx->first_error)
+        ctx->first_error = "ring not drained";
+
+    sem_destroy(&ctx->doorbell);
+    free(ctx->mem);
+    return elapsed;
+}
+
+static void stress_run_case(const char *name, struct stress_ctx *proto)
+{
+    TEST(name);
+
+    struct stress_ctx ctx = *proto;
+    ctx.msgs = STRESS_MSGS;
+
+    double elapsed = run_stress(&ctx);
+
+    if (ctx.first_error || ctx.errors || ctx.received != ctx.msgs) {
+        FAIL(ctx.first_error ? ctx.first_error : "message count mismatch");
+        return;
+    }
+    PASS();
+    printf("        %u msgs in %.3f s: %.0f msgs/sec\n",
+           ctx.msgs, elapsed, (double)ctx.msgs / elapsed);
+    if (ctx.blocking)
+        printf("        %llu signals (%.4f per msg), consumer blocked %llu times\n",
+               (unsigned long long)ctx.signals,
+               (double)ctx.signals / ctx.msgs,
+               (unsigned long long)ctx.blocks);
+}
+
+static void stress_case(const char *name, uint32_t slot_count, uint32_t slot_size,
+                        uint32_t layout, int batched)
+{
+    struct stress_ctx ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.slot_count = slot_count;
+    ctx.slot_size  = slot_size;
+    ctx.layout     = layout;
+    ctx.batched    = batched;
+    stress_run_case(name, &ctx);
+}
+
+/* Consumer blocks on a semaphore doorbell instead of yielding */
+static void stress_blocking_case(const char *name, uint32_t slot_count,
+                                 uint32_t slot_size, int batched)
+{
+    struct stress_ctx ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.slot_count = slot_count;
+    ctx.slot_size  = slot_size;
+    ctx.layout     = VDTU_RING_DEFAULT_LAYOUT;
+    ctx.batched    = batched;
+    ctx.blocking   = 1;
+    stress_run_case(name, &ctx);
+}
+
+/* Packed ring of data_size bytes taking messages of up to max_msg bytes */
+static void stress_packed_case(const char *name, uint32_t data_size,
+                               uint32_t max_msg, int batched)
+{
+    struct stress_ctx ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.slot_size   = max_msg;
+    ctx.packed_size = data_size;
+    ctx.batched     = batched;
+    stress_run_case(name, &ctx);
+}
+
+/* ========================================================================= */
+
+int main(void)
+{
+    printf("=== vDTU Ring Cross-Thread Stress ===\n\n");
+
+    stress_case("v1: 2M msgs, 4 x 512B, single send/fetch", 4,
+                VDTU_SYSC_MSG_SIZE, VDTU_RING_LAYOUT_V1, 0);
+    stress_case("v1: 2M msgs, 32 x 512B, single send/fetch", 32,
+                VDTU_SYSC_MSG_SIZE, VDTU_RING_LAYOUT_V1, 0);
+    stress_case("v1: 2M msgs, 32 x 512B, batched send/fetch", 32,
+                VDTU_SYSC_MSG_SIZE, VDTU_RING_LAYOUT_V1, 1);
+    stress_case("v1: 2M msgs, 4 x 2048B, batched send/fetch", 4,
+                VDTU_KRNLC_MSG_SIZE, VDTU_RING_LAYOUT_V1, 1);
+
+    /* Same workloads on the cache-line-split layout */
+    stress_case("v2: 2M msgs, 4 x 512B, single send/fetch", 4,
+                VDTU_SYSC_MSG_SIZE, VDTU_RING_LAYOUT_V2, 0);
+    stress_case("v2: 2M msgs, 32 x 512B, single send/fetch", 32,
+                VDTU_SYSC_MSG_SIZE, VDTU_RING_LAYOUT_V2, 0);
+    stress_case("v2: 2M msgs, 32 x 512B, batched send/fetch", 32,
+                VDTU_SYSC_MSG_SIZE, VDTU_RING_LAYOUT_V2, 1);
+    stress_case("v2: 2M msgs, 4 x 2048B, batched send/fetch", 4,
+                VDTU_KRNLC_MSG_SIZE, VDTU_RING_LAYOUT_V2, 1);
+
+    /* Packed rings: same memory as 4 x 512B, and a full 4 KiB dataport */
+    stress_packed_case("packed: 2M msgs, 2 KiB, single send/fetch",
+                       4 * VDTU_SYSC_MSG_SIZE, VDTU_SYSC_MSG_SIZE, 0);
+    stress_packed_case("packed: 2M msgs, 2 KiB, batched send/fetch",
+                       4 * VDTU_SYSC_MSG_SIZE, VDTU_SYSC_MSG_SIZE, 1);
+    stress_packed_case("packed: 2M msgs, 4032B, up to 2008B, batched",
+                       4096 - VDTU_RING_CTRL_SIZE,
+                       vdtu_ring_packed_max_msg(4096 - VDTU_RING_CTRL_SIZE), 1);
+
+    /* Spin-then-block consumer: signals only on announced sleeps */
+    stress_blocking_case("block: 2M msgs, 4 x 512B, single send/fetch", 4,
+                         VDTU_SYSC_MSG_SIZE, 0);
+    stress_blocking_case("block: 2M msgs, 32 x 512B, batched send/fetch", 32,
+                         VDTU_SYSC_MSG_SIZE, 1);
+
+    printf("\n=== Results: %d passed, %d failed ===\n",
+           tests_passed, tests_failed);
+
+    return tests_failed ? 1 : 0;
+}
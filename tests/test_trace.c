@@ -0,0 +1,208 @@
+/*
+ * test_trace.c -- Standalone test for the binary trace log
+ *
+ * Built with VDTU_TRACE_LEVEL=2, so VDTU_TRACE_DBG records are compiled out.
+ *
+ * Or just: make (uses the provided Makefile)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "vdtu_trace.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) \
+    do { printf("  TEST: %-50s ", name); } while(0)
+
+#define PASS() \
+    do { printf("PASS\n"); tests_passed++; } while(0)
+
+#define FAIL(msg) \
+    do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define CHECK(cond, msg) \
+    do { if (!(cond)) { FAIL(msg); return; } } while(0)
+
+/* Empty the log so each test starts from a clean reader position */
+static void drain_all(void)
+{
+    struct vdtu_trace_rec rec;
+    while (vdtu_trace_read(&rec))
+        ;
+}
+
+/* ========================================================================= */
+
+static void test_emit_read(void)
+{
+    TEST("records come back in order with their arguments");
+
+    struct vdtu_trace_rec rec;
+    drain_all();
+    CHECK(vdtu_trace_read(&rec) == 0, "empty log");
+
+    VDTU_TRACE(VDTU_TRACE_INFO, NET_TX, 3, 120, 1);
+    VDTU_TRACE(VDTU_TRACE_ERR, NET_RX_FULL, 7, 0, 0);
+
+    CHECK(vdtu_trace_read(&rec) == 1, "first record");
+    CHECK(rec.event == VDTU_EV_NET_TX && rec.level == VDTU_TRACE_INFO,
+          "first event and level");
+    CHECK(rec.arg[0] == 3 && rec.arg[1] == 120 && rec.arg[2] == 1,
+          "first arguments");
+    uint64_t t0 = rec.tsc;
+
+    CHECK(vdtu_trace_read(&rec) == 1, "second record");
+    CHECK(rec.event == VDTU_EV_NET_RX_FULL && rec.arg[0] == 7,
+          "second event");
+    CHECK(rec.tsc >= t0, "timestamps increase");
+    CHECK(vdtu_trace_read(&rec) == 0, "log drained");
+
+    PASS();
+}
+
+static void test_level_gate(void)
+{
+    TEST("levels above VDTU_TRACE_LEVEL are compiled out");
+
+    struct vdtu_trace_rec rec;
+    drain_all();
+
+    VDTU_TRACE(VDTU_TRACE_DBG, NET_RING_RX, 0x1234, 8, 0);
+    CHECK(vdtu_trace_read(&rec) == 0, "debug record not kept");
+
+    VDTU_TRACE(VDTU_TRACE_INFO, NET_RING_RX, 0x1234, 8, 0);
+    CHECK(vdtu_trace_read(&rec) == 1, "info record kept");
+
+    PASS();
+}
+
+static void test_format(void)
+{
+    TEST("format renders the event line");
+
+    struct vdtu_trace_rec rec;
+    char line[160];
+    drain_all();
+
+    vdtu_trace_init("Test");
+    VDTU_TRACE(VDTU_TRACE_INFO, NET_RX, 2, 90, 1);
+    CHECK(vdtu_trace_read(&rec) == 1, "record");
+    rec.tsc = 42;
+    vdtu_trace_format(&rec, line, sizeof(line));
+    CHECK(strcmp(line, "[Test] 42 INF NET RX: 2 msgs, 90 bytes from node 1") == 0,
+          line);
+
+    rec.event = VDTU_EV_COUNT + 5;
+    vdtu_trace_format(&rec, line, sizeof(line));
+    CHECK(strstr(line, "unknown event") != NULL, "unknown event id");
+
+    CHECK(vdtu_trace_format(&rec, line, 8) >= 8, "truncation reported");
+    CHECK(strlen(line) == 7, "truncated line terminated");
+
+    PASS();
+}
+
+static void test_overwrite(void)
+{
+    TEST("a full log overwrites and counts the oldest records");
+
+    struct vdtu_trace_rec rec;
+    drain_all();
+    uint32_t lost0 = vdtu_trace_lost();
+
+    for (uint32_t i = 0; i < VDTU_TRACE_RECORDS + 10; i++)
+        VDTU_TRACE(VDTU_TRACE_INFO, NET_RPC_TX, i, 0, 0);
+
+    CHECK(vdtu_trace_read(&rec) == 1 && rec.arg[0] == 10,
+          "reader resumes at the oldest surviving record");
+    CHECK(vdtu_trace_lost() - lost0 == 10, "lost count");
+
+    uint32_t n = 1;
+    uint64_t expect = 11;
+    while (vdtu_trace_read(&rec)) {
+        CHECK(rec.arg[0] == expect, "no gaps after the skip");
+        expect++;
+        n++;
+    }
+    CHECK(n == VDTU_TRACE_RECORDS, "a whole log's worth survives");
+
+    PASS();
+}
+
+/* ========================================================================= */
+
+#define MP_PRODUCERS    2
+#define MP_EMITS        200000
+
+static int mp_done;
+
+static void *mp_producer(void *arg)
+{
+    uint64_t id = (uint64_t)(uintptr_t)arg;
+    for (uint64_t i = 0; i < MP_EMITS; i++)
+        VDTU_TRACE(VDTU_TRACE_INFO, NET_TX, id, i, 0);
+    __atomic_fetch_add(&mp_done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void test_concurrent(void)
+{
+    TEST("concurrent producers: every record read or lost");
+
+    pthread_t th[MP_PRODUCERS];
+    uint64_t next[MP_PRODUCERS] = { 0 };
+    uint64_t got = 0;
+    int ordered = 1;
+    struct vdtu_trace_rec rec;
+
+    drain_all();
+    uint32_t lost0 = vdtu_trace_lost();
+
+    for (uintptr_t i = 0; i < MP_PRODUCERS; i++)
+        pthread_create(&th[i], NULL, mp_producer, (void *)i);
+
+    int done;
+    do {
+        done = __atomic_load_n(&mp_done, __ATOMIC_ACQUIRE) == MP_PRODUCERS;
+        while (vdtu_trace_read(&rec)) {
+            uint64_t id = rec.arg[0];
+            if (id >= MP_PRODUCERS || rec.arg[1] < next[id])
+                ordered = 0;
+            else
+                next[id] = rec.arg[1] + 1;
+            got++;
+        }
+    } while (!done);
+    for (int i = 0; i < MP_PRODUCERS; i++)
+        pthread_join(th[i], NULL);
+
+    CHECK(ordered, "per-producer order preserved");
+    CHECK(got + (vdtu_trace_lost() - lost0) == (uint64_t)MP_PRODUCERS * MP_EMITS,
+          "read + lost == emitted");
+
+    printf("PASS (%llu read, %u lost)\n", (unsigned long long)got,
+           vdtu_trace_lost() - lost0);
+    tests_passed++;
+}
+
+/* ========================================================================= */
+
+int main(void)
+{
+    printf("=== vDTU Trace Log Tests ===\n\n");
+
+    test_emit_read();
+    test_level_gate();
+    test_format();
+    test_overwrite();
+    test_concurrent();
+
+    printf("\n=== Results: %d passed, %d failed ===\n",
+           tests_passed, tests_failed);
+
+    return tests_failed ? 1 : 0;
+}